@@ -113,11 +113,12 @@ void PopMatrix(glm::mat4& M);
 // logo após a definição de main() neste arquivo.
 void BuildTrianglesAndAddToVirtualScene(ObjModel*); // Constrói representação de um ObjModel como malha de triângulos para renderização
 void ComputeNormals(ObjModel* model); // Computa normais de um ObjModel, caso não existam.
-void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento, criando um programa de GPU
+void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento, criando um programa de GPU para cada objeto
+void UseObjectProgram(int object_id); // Liga o programa de GPU de um objeto (SPHERE, BUNNY ou PLANE)
 void DrawVirtualObject(const char* object_name); // Desenha um objeto armazenado em g_VirtualScene
-GLuint LoadShader_Vertex(const char* filename);   // Carrega um vertex shader
-GLuint LoadShader_Fragment(const char* filename); // Carrega um fragment shader
-void LoadShader(const char* filename, GLuint shader_id); // Função utilizada pelas duas acima
+GLuint LoadShader_Vertex(const char* filename, const std::string& defines = "");   // Carrega um vertex shader
+GLuint LoadShader_Fragment(const char* filename, const std::string& defines = ""); // Carrega um fragment shader
+void LoadShader(const char* filename, GLuint shader_id, const std::string& defines); // Função utilizada pelas duas acima
 GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Cria um programa de GPU
 void PrintObjModelInfo(ObjModel*); // Função para debugging
 
@@ -207,12 +208,30 @@ bool g_UsePerspectiveProjection = true;
 // Variável que controla se o texto informativo será mostrado na tela.
 bool g_ShowInfoText = true;
 
-// Variáveis que definem um programa de GPU (shaders). Veja função LoadShadersFromFiles().
-GLuint g_GpuProgramID = 0;
+// Identificadores dos objetos da cena. O fragment shader é compilado uma vez
+// para cada objeto, com OBJECT_ID definido como um deles (veja
+// "shader_fragment.glsl"), em vez de testar o objeto em cada fragmento.
+#define SPHERE 0
+#define BUNNY  1
+#define PLANE  2
+#define NUM_OBJECT_PROGRAMS 3
+
+// Variáveis que definem os programas de GPU (shaders), um para cada objeto.
+// Veja função LoadShadersFromFiles(). As localizações das variáveis
+// "uniform" podem ser diferentes em cada programa; as variáveis
+// g_model_uniform, g_view_uniform e g_projection_uniform são as do
+// programa ligado por UseObjectProgram().
+struct ObjectProgram
+{
+    GLuint program_id;
+    GLint  model_uniform;
+    GLint  view_uniform;
+    GLint  projection_uniform;
+};
+ObjectProgram g_ObjectPrograms[NUM_OBJECT_PROGRAMS];
 GLint g_model_uniform;
 GLint g_view_uniform;
 GLint g_projection_uniform;
-GLint g_object_id_uniform;
 
 int main(int argc, char* argv[])
 {
@@ -334,10 +353,6 @@ int main(int argc, char* argv[])
         // e também resetamos todos os pixels do Z-buffer (depth buffer).
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Pedimos para a GPU utilizar o programa de GPU criado acima (contendo
-        // os shaders de vértice e fragmentos).
-        glUseProgram(g_GpuProgramID);
-
         // Computamos a posição da câmera utilizando coordenadas esféricas.  As
         // variáveis g_CameraDistance, g_CameraPhi, e g_CameraTheta são
         // controladas pelo mouse do usuário. Veja as funções CursorPosCallback()
@@ -391,18 +406,20 @@ int main(int argc, char* argv[])
 
         // Enviamos as matrizes "view" e "projection" para a placa de vídeo
         // (GPU). Veja o arquivo "shader_vertex.glsl", onde estas são
-        // efetivamente aplicadas em todos os pontos.
-        glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-        glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
-
-        #define SPHERE 0
-        #define BUNNY  1
-        #define PLANE  2
+        // efetivamente aplicadas em todos os pontos. Cada programa de GPU tem
+        // as suas próprias variáveis "uniform", e por isso as matrizes são
+        // enviadas para o programa de cada objeto.
+        for (int object_id = 0; object_id < NUM_OBJECT_PROGRAMS; ++object_id)
+        {
+            UseObjectProgram(object_id);
+            glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
+            glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
+        }
 
         // Desenhamos o modelo da esfera
         model = Matrix_Translate(-1.0f,0.0f,0.0f);
+        UseObjectProgram(SPHERE);
         glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, SPHERE);
         DrawVirtualObject("the_sphere");
 
         // Desenhamos o modelo do coelho
@@ -410,8 +427,8 @@ int main(int argc, char* argv[])
               * Matrix_Rotate_Z(g_AngleZ)
               * Matrix_Rotate_Y(g_AngleY)
               * Matrix_Rotate_X(g_AngleX);
+        UseObjectProgram(BUNNY);
         glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, BUNNY);
         DrawVirtualObject("the_bunny");
 
 
@@ -497,23 +514,46 @@ void LoadShadersFromFiles()
     //       |
     //       o-- shader_fragment.glsl
     //
-    GLuint vertex_shader_id = LoadShader_Vertex("../../src/shader_vertex.glsl");
-    GLuint fragment_shader_id = LoadShader_Fragment("../../src/shader_fragment.glsl");
-
-    // Deletamos o programa de GPU anterior, caso ele exista.
-    if ( g_GpuProgramID != 0 )
-        glDeleteProgram(g_GpuProgramID);
-
-    // Criamos um programa de GPU utilizando os shaders carregados acima.
-    g_GpuProgramID = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
-
-    // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
-    // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
-    // (GPU)! Veja arquivo "shader_vertex.glsl" e "shader_fragment.glsl".
-    g_model_uniform      = glGetUniformLocation(g_GpuProgramID, "model"); // Variável da matriz "model"
-    g_view_uniform       = glGetUniformLocation(g_GpuProgramID, "view"); // Variável da matriz "view" em shader_vertex.glsl
-    g_projection_uniform = glGetUniformLocation(g_GpuProgramID, "projection"); // Variável da matriz "projection" em shader_vertex.glsl
-    g_object_id_uniform  = glGetUniformLocation(g_GpuProgramID, "object_id"); // Variável "object_id" em shader_fragment.glsl
+    //
+    // Criamos um programa de GPU para cada objeto: o fragment shader é
+    // compilado com "#define OBJECT_ID" inserido no início do código (veja
+    // LoadShader()). O vertex shader é o mesmo para todos, mas é compilado
+    // novamente pois CreateGpuProgram() deleta os shaders após o link.
+    for (int object_id = 0; object_id < NUM_OBJECT_PROGRAMS; ++object_id)
+    {
+        char defines[32];
+        snprintf(defines, sizeof(defines), "#define OBJECT_ID %d\n", object_id);
+        GLuint vertex_shader_id = LoadShader_Vertex("../../src/shader_vertex.glsl");
+        GLuint fragment_shader_id = LoadShader_Fragment("../../src/shader_fragment.glsl", defines);
+
+        ObjectProgram& program = g_ObjectPrograms[object_id];
+
+        // Deletamos o programa de GPU anterior, caso ele exista.
+        if ( program.program_id != 0 )
+            glDeleteProgram(program.program_id);
+
+        // Criamos um programa de GPU utilizando os shaders carregados acima.
+        program.program_id = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
+
+        // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
+        // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
+        // (GPU)! Veja arquivo "shader_vertex.glsl" e "shader_fragment.glsl".
+        program.model_uniform      = glGetUniformLocation(program.program_id, "model"); // Variável da matriz "model"
+        program.view_uniform       = glGetUniformLocation(program.program_id, "view"); // Variável da matriz "view" em shader_vertex.glsl
+        program.projection_uniform = glGetUniformLocation(program.program_id, "projection"); // Variável da matriz "projection" em shader_vertex.glsl
+    }
+}
+
+// Pedimos para a GPU utilizar o programa de GPU do objeto object_id (contendo
+// os shaders de vértice e fragmentos), e passamos a utilizar as localizações
+// das variáveis "uniform" deste programa.
+void UseObjectProgram(int object_id)
+{
+    const ObjectProgram& program = g_ObjectPrograms[object_id];
+    glUseProgram(program.program_id);
+    g_model_uniform      = program.model_uniform;
+    g_view_uniform       = program.view_uniform;
+    g_projection_uniform = program.projection_uniform;
 }
 
 // Função que pega a matriz M e guarda a mesma no topo da pilha
@@ -730,36 +770,38 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
 }
 
 // Carrega um Vertex Shader de um arquivo GLSL. Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Vertex(const char* filename)
+GLuint LoadShader_Vertex(const char* filename, const std::string& defines)
 {
     // Criamos um identificador (ID) para este shader, informando que o mesmo
     // será aplicado nos vértices.
     GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
 
     // Carregamos e compilamos o shader
-    LoadShader(filename, vertex_shader_id);
+    LoadShader(filename, vertex_shader_id, defines);
 
     // Retorna o ID gerado acima
     return vertex_shader_id;
 }
 
 // Carrega um Fragment Shader de um arquivo GLSL . Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Fragment(const char* filename)
+GLuint LoadShader_Fragment(const char* filename, const std::string& defines)
 {
     // Criamos um identificador (ID) para este shader, informando que o mesmo
     // será aplicado nos fragmentos.
     GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
 
     // Carregamos e compilamos o shader
-    LoadShader(filename, fragment_shader_id);
+    LoadShader(filename, fragment_shader_id, defines);
 
     // Retorna o ID gerado acima
     return fragment_shader_id;
 }
 
 // Função auxilar, utilizada pelas duas funções acima. Carrega código de GPU de
-// um arquivo GLSL e faz sua compilação.
-void LoadShader(const char* filename, GLuint shader_id)
+// um arquivo GLSL e faz sua compilação. As linhas em "defines" (por exemplo,
+// "#define OBJECT_ID 0\n") são inseridas logo após a diretiva "#version", que
+// precisa ser a primeira do arquivo.
+void LoadShader(const char* filename, GLuint shader_id, const std::string& defines)
 {
     // Lemos o arquivo de texto indicado pela variável "filename"
     // e colocamos seu conteúdo em memória, apontado pela variável
@@ -775,11 +817,28 @@ void LoadShader(const char* filename, GLuint shader_id)
     std::stringstream shader;
     shader << file.rdbuf();
     std::string str = shader.str();
-    const GLchar* shader_string = str.c_str();
-    const GLint   shader_string_length = static_cast<GLint>( str.length() );
 
-    // Define o código do shader GLSL, contido na string "shader_string"
-    glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
+    // Separamos a linha "#version" do restante do código, e inserimos as
+    // definições entre as duas partes, seguidas de "#line 1" para que os números
+    // de linha dos erros de compilação continuem corretos (na GLSL 3.30, a
+    // linha seguinte a "#line 1" é a linha 2).
+    size_t version_end = 0;
+    if ( str.compare(0, 8, "#version") == 0 )
+    {
+        version_end = str.find('\n');
+        version_end = (version_end == std::string::npos) ? str.length() : version_end + 1;
+    }
+    std::string header = str.substr(0, version_end);
+    std::string prefix = defines.empty() ? std::string() : defines + "#line 1\n";
+    const GLchar* shader_strings[3] = { header.c_str(), prefix.c_str(), str.c_str() + version_end };
+    const GLint   shader_string_lengths[3] = {
+        static_cast<GLint>( header.length() ),
+        static_cast<GLint>( prefix.length() ),
+        static_cast<GLint>( str.length() - version_end )
+    };
+
+    // Define o código do shader GLSL, contido nas strings "shader_strings"
+    glShaderSource(shader_id, 3, shader_strings, shader_string_lengths);
 
     // Compila o código do shader GLSL (em tempo de execução)
     glCompileShader(shader_id);
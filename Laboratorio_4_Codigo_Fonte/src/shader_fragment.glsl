@@ -12,11 +12,17 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
-// Identificador que define qual objeto está sendo desenhado no momento
+// Identificador que define qual objeto está sendo desenhado no momento. Em
+// vez de uma variável "uniform" testada em cada fragmento, OBJECT_ID é
+// definido por LoadShadersFromFiles() em "main.cpp", que compila um programa
+// de GPU para cada objeto, e somente as propriedades daquele objeto ficam no
+// código compilado.
 #define SPHERE 0
 #define BUNNY  1
 #define PLANE  2
-uniform int object_id;
+#ifndef OBJECT_ID
+#define OBJECT_ID -1
+#endif
 
 // O valor de saída ("out") de um Fragment Shader é a cor final do fragmento.
 out vec4 color;
@@ -54,7 +60,7 @@ void main()
     vec3 Ka; // Refletância ambiente
     float q; // Expoente especular para o modelo de iluminação de Phong
 
-    if ( object_id == SPHERE )
+#if OBJECT_ID == SPHERE
     {
         // PREENCHA AQUI
         // Propriedades espectrais da esfera
@@ -63,7 +69,7 @@ void main()
         Ka = vec3(0.0,0.0,0.0);
         q = 1.0;
     }
-    else if ( object_id == BUNNY )
+#elif OBJECT_ID == BUNNY
     {
         // PREENCHA AQUI
         // Propriedades espectrais do coelho
@@ -72,7 +78,7 @@ void main()
         Ka = vec3(0.0,0.0,0.0);
         q = 1.0;
     }
-    else if ( object_id == PLANE )
+#elif OBJECT_ID == PLANE
     {
         // PREENCHA AQUI
         // Propriedades espectrais do plano
@@ -81,13 +87,14 @@ void main()
         Ka = vec3(0.0,0.0,0.0);
         q = 1.0;
     }
-    else // Objeto desconhecido = preto
+#else // Objeto desconhecido = preto
     {
         Kd = vec3(0.0,0.0,0.0);
         Ks = vec3(0.0,0.0,0.0);
         Ka = vec3(0.0,0.0,0.0);
         q = 1.0;
     }
+#endif
 
     // Espectro da fonte de iluminação
     vec3 I = vec3(0.0,0.0,0.0); // PREENCH AQUI o espectro da fonte de luz
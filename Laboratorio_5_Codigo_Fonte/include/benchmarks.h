@@ -0,0 +1,52 @@
+#ifndef _BENCHMARKS_H
+#define _BENCHMARKS_H
+
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "scene.h"
+
+// Benchmarks do programa, escolhidos pelas opções "--benchmark-*" da linha
+// de comando. Cada benchmark imprime os seus resultados no terminal, e o
+// programa termina logo depois, sem entrar no laço de renderização.
+// Definidas em "benchmarks.cpp".
+
+// Valores das opções "--benchmark-*"; 0 (ou NULL) se a opção não foi dada.
+struct BenchmarkOptions
+{
+    const char* obj_filename;          // --benchmark-obj-loader ARQUIVO
+    int         tokenizer_megabytes;   // --benchmark-obj-tokenizer MB
+    int         normals_millions;      // --benchmark-normals MILHÕES_DE_TRIÂNGULOS
+    int         draw_objects;          // --benchmark-draw-overhead OBJETOS
+    int         culling_objects;       // --benchmark-culling OBJETOS
+    int         normal_matrix_objects; // --benchmark-normal-matrices OBJETOS
+    int         render_queue_objects;  // --benchmark-render-queue OBJETOS
+    int         instances;             // --benchmark-instancing INSTÂNCIAS
+    int         batching_objects;      // --benchmark-batching OBJETOS
+    int         text_frames;           // --benchmark-text-overlay QUADROS
+};
+
+// Se argv[*i] é uma opção "--benchmark-*" seguida do seu valor, guarda o
+// valor em *options, avança *i até o valor e retorna true.
+bool ParseBenchmarkOption(int argc, char* argv[], int* i, BenchmarkOptions* options);
+
+// Executa o benchmark pedido que não precisa de janela nem de contexto
+// OpenGL, se houver um, com até obj_threads threads de leitura de arquivos
+// ".obj" e normal_threads threads de cálculo das normais. Retorna false se
+// nenhum desses benchmarks foi pedido.
+bool RunStandaloneBenchmark(const BenchmarkOptions& options, unsigned int obj_threads, unsigned int normal_threads);
+
+// Retorna true se foi pedido um benchmark de desenho, que precisa do
+// contexto OpenGL e de todos os modelos já na GPU (e portanto do
+// carregamento síncrono).
+bool HasSceneBenchmark(const BenchmarkOptions& options);
+
+// Executa o benchmark de desenho pedido, se houver um, com os objetos da
+// cena: handles[] são a esfera, o coelho e o plano (object_id 0, 1 e 2), e
+// texture_set o conjunto de texturas da cena. Retorna false se nenhum desses
+// benchmarks foi pedido.
+bool RunSceneBenchmark(const BenchmarkOptions& options, GLFWwindow* window, const SceneObjectHandle handles[3], uint32_t texture_set);
+
+#endif // _BENCHMARKS_H
@@ -0,0 +1,54 @@
+#ifndef _CULLING_H
+#define _CULLING_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// Descarte ("culling") de objetos fora do campo de visão da câmera (view
+// frustum), testando as suas bounding boxes contra os 6 planos do frustum.
+// Definidas em "culling.cpp".
+
+// Bounding boxes alinhadas aos eixos (AABBs) em coordenadas globais,
+// guardadas como centro e metade do tamanho, um vetor para cada coordenada
+// ("structure of arrays"), para que CullBoundingBoxes() teste várias caixas
+// de uma vez com instruções SIMD.
+struct BoundingBoxes
+{
+    std::vector<float> center_x, center_y, center_z;
+    std::vector<float> extent_x, extent_y, extent_z;
+};
+
+// Extrai os planos do frustum de uma matriz projection * view (Gribb e
+// Hartmann, "Fast Extraction of Viewing Frustum Planes from the
+// World-View-Projection Matrix", 2001). Cada plano (a,b,c,d) tem a normal
+// (a,b,c) apontando para dentro do frustum: um ponto p está dentro se
+// a*p.x + b*p.y + c*p.z + d >= 0 para os 6 planos. Funciona para as matrizes
+// de Matrix_Perspective() e de Matrix_Orthographic().
+void ExtractFrustumPlanes(const glm::mat4& view_projection, glm::vec4 planes[6]);
+
+// Computa a AABB em coordenadas globais, como centro e metade do tamanho,
+// que contém a AABB (bbox_min, bbox_max) de um objeto transformada pela sua
+// matriz model (Arvo, "Transforming Axis-Aligned Bounding Boxes", 1990).
+void TransformBoundingBox(const glm::mat4& model, const glm::vec3& bbox_min, const glm::vec3& bbox_max,
+                          glm::vec3* center, glm::vec3* extent);
+
+void ClearBoundingBoxes(BoundingBoxes* boxes);
+void AddBoundingBox(BoundingBoxes* boxes, const glm::vec3& center, const glm::vec3& extent);
+
+// Testa as caixas contra os planos de ExtractFrustumPlanes(), 8 caixas por
+// iteração com SSE quando disponível. Escreve em visible[i] 1 se a caixa i
+// intersecta o frustum (ou está dentro dele) e 0 caso contrário, e retorna o
+// número de caixas visíveis. O teste é conservador: caixas perto dos cantos
+// do frustum podem ser consideradas visíveis sem estar, mas nenhuma caixa
+// visível é descartada.
+size_t CullBoundingBoxes(const glm::vec4 planes[6], const BoundingBoxes& boxes, unsigned char* visible);
+
+// O mesmo que CullBoundingBoxes(), uma caixa por vez e sem SIMD. Utilizada
+// para comparação no benchmark de culling.
+size_t CullBoundingBoxesScalar(const glm::vec4 planes[6], const BoundingBoxes& boxes, unsigned char* visible);
+
+#endif // _CULLING_H
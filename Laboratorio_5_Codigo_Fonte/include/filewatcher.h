@@ -0,0 +1,32 @@
+#ifndef _FILEWATCHER_H
+#define _FILEWATCHER_H
+
+#include <string>
+
+// Observador de modificações nos arquivos de um diretório, utilizado para
+// recarregar os shaders quando os arquivos "src/*.glsl" são salvos (veja
+// ProcessShaderCompiles() em "main.cpp"). Definido em "filewatcher.cpp".
+//
+// No Linux, as modificações são informadas pelo kernel através do inotify,
+// sem nenhuma leitura do diretório a cada quadro. Nos demais sistemas
+// StartFileWatcher() retorna false, e os shaders são recarregados somente
+// pela tecla R.
+struct FileWatcher
+{
+    int         fd;     // Descritor do inotify; -1 se o observador não está ativo
+    std::string suffix; // Somente arquivos terminados com este sufixo são considerados
+};
+
+// Passa a observar os arquivos de "directory" terminados com "suffix"
+// (por exemplo, ".glsl"). Retorna false se não for possível.
+bool StartFileWatcher(FileWatcher* watcher, const char* directory, const char* suffix);
+
+// Retorna true se algum arquivo observado foi escrito, criado ou substituído
+// desde a última chamada. Não bloqueia: retorna false imediatamente se não
+// há nenhuma modificação pendente.
+bool PollFileWatcher(FileWatcher* watcher);
+
+// Para de observar o diretório.
+void StopFileWatcher(FileWatcher* watcher);
+
+#endif // _FILEWATCHER_H
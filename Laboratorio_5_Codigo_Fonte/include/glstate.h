@@ -0,0 +1,76 @@
+#ifndef _GLSTATE_H
+#define _GLSTATE_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+// Cache do estado do OpenGL. Cada função abaixo tem os mesmos parâmetros da
+// função do OpenGL correspondente (GLState_UseProgram() -> glUseProgram(),
+// etc.), e guarda o último valor definido: chamadas que não mudam nada são
+// descartadas sem chegar ao driver. Definidas em "glstate.cpp".
+//
+// Todo o código do laboratório (incluindo "textrendering.cpp") deve mudar
+// esse estado somente através destas funções; uma chamada direta ao OpenGL
+// deixaria o cache desatualizado. Por isso, cada parte do desenho define o
+// estado de que precisa em vez de desfazer, ao final, o que mudou: desfazer
+// e refazer a cada desenho são trocas reais, que o cache não pode evitar.
+//
+// Os valores começam desconhecidos, e a primeira chamada de cada função
+// sempre chega ao driver. Ligações de GL_ELEMENT_ARRAY_BUFFER fazem parte
+// do VAO, e não são guardadas.
+
+// Programa, VAO e buffers. GLState_CurrentProgram() retorna o programa em
+// uso, e consulta o driver somente se o valor ainda for desconhecido.
+void GLState_UseProgram(GLuint program);
+GLuint GLState_CurrentProgram();
+void GLState_BindVertexArray(GLuint vertex_array);
+void GLState_BindBuffer(GLenum target, GLuint buffer);
+void GLState_BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+// Texturas e samplers. GLState_BindTexture() liga a textura na unidade
+// escolhida pela última chamada a GLState_ActiveTexture().
+void GLState_ActiveTexture(GLenum texture);
+void GLState_BindTexture(GLenum target, GLuint texture);
+void GLState_BindSampler(GLuint unit, GLuint sampler);
+
+// Testes e operações por fragmento. GLState_IsEnabled() consulta o driver
+// somente se o valor ainda for desconhecido.
+void GLState_Enable(GLenum cap);
+void GLState_Disable(GLenum cap);
+GLboolean GLState_IsEnabled(GLenum cap);
+void GLState_BlendFunc(GLenum sfactor, GLenum dfactor);
+void GLState_DepthFunc(GLenum func);
+void GLState_DepthMask(GLboolean flag);
+void GLState_ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+void GLState_PolygonMode(GLenum face, GLenum mode);
+void GLState_CullFace(GLenum mode);
+void GLState_FrontFace(GLenum mode);
+
+// Deleção de objetos. O OpenGL desliga os objetos deletados dos pontos em
+// que estavam ligados, e o cache precisa esquecê-los, pois o mesmo nome
+// pode ser reutilizado por um novo objeto.
+void GLState_DeleteProgram(GLuint program);
+void GLState_DeleteVertexArrays(GLsizei n, const GLuint* vertex_arrays);
+void GLState_DeleteBuffers(GLsizei n, const GLuint* buffers);
+void GLState_DeleteTextures(GLsizei n, const GLuint* textures);
+
+// Esquece todo o estado guardado; as próximas chamadas chegam ao driver.
+void GLState_Invalidate();
+
+// Habilita ou desabilita o cache. Desabilitado, todas as chamadas chegam ao
+// driver (mas continuam contadas); utilizado para comparação no benchmark
+// do texto na tela.
+void GLState_SetEnabled(bool enabled);
+
+// Número de chamadas às funções acima e de chamadas descartadas pelo cache,
+// desde a última chamada a GLState_ResetStatistics().
+struct GLStateStatistics
+{
+    size_t calls;
+    size_t elided;
+};
+GLStateStatistics GLState_Statistics();
+void GLState_ResetStatistics();
+
+#endif // _GLSTATE_H
@@ -0,0 +1,109 @@
+#ifndef _LOCKFREEQUEUE_H
+#define _LOCKFREEQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Fila FIFO de capacidade fixa que pode ser utilizada por várias threads ao
+// mesmo tempo, tanto para inserir quanto para remover elementos, sem mutexes
+// (algoritmo "bounded MPMC queue" de Dmitry Vyukov). Cada posição do vetor
+// circular guarda um número de sequência que indica se ela está livre para
+// Push() ou preenchida para Pop() na volta atual do vetor; as threads
+// reservam posições incrementando enqueue_pos/dequeue_pos com
+// compare_exchange.
+template <typename T>
+struct LockFreeQueue
+{
+    // A capacidade é arredondada para cima para uma potência de 2.
+    explicit LockFreeQueue(size_t capacity)
+        : cells(RoundUpToPowerOfTwo(capacity))
+        , mask(cells.size() - 1)
+    {
+        for (size_t i = 0; i < cells.size(); ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    // Insere value no final da fila. Retorna false se a fila estiver cheia.
+    bool Push(const T& value)
+    {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            ptrdiff_t diff = (ptrdiff_t)sequence - (ptrdiff_t)pos;
+            if (diff == 0)
+            {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.data = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // Fila cheia
+            else
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Remove o primeiro elemento da fila, guardando-o em *value. Retorna
+    // false se a fila estiver vazia.
+    bool Pop(T* value)
+    {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            ptrdiff_t diff = (ptrdiff_t)sequence - (ptrdiff_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    *value = cell.data;
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // Fila vazia
+            else
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T                   data;
+    };
+
+    // Os contadores ficam em linhas de cache separadas, para que threads
+    // inserindo e removendo elementos não disputem a mesma linha.
+    std::vector<Cell>   cells;
+    size_t              mask;
+    char                pad0[64];
+    std::atomic<size_t> enqueue_pos;
+    char                pad1[64];
+    std::atomic<size_t> dequeue_pos;
+    char                pad2[64];
+
+    static size_t RoundUpToPowerOfTwo(size_t n)
+    {
+        size_t size = 2;
+        while (size < n)
+            size *= 2;
+        return size;
+    }
+
+    LockFreeQueue(const LockFreeQueue&);
+    LockFreeQueue& operator=(const LockFreeQueue&);
+};
+
+#endif // _LOCKFREEQUEUE_H
@@ -0,0 +1,28 @@
+#ifndef _MAPPEDFILE_H
+#define _MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Arquivo do disco mapeado em memória, somente para leitura. O conteúdo do
+// arquivo pode ser acessado diretamente através do ponteiro "data", sem
+// nenhuma cópia intermediária. Veja as funções MapFile() e UnmapFile(),
+// definidas em "mappedfile.cpp".
+struct MappedFile
+{
+    const unsigned char* data; // Conteúdo do arquivo
+    size_t               size; // Tamanho do arquivo em bytes
+    void*                handle; // Uso interno (Windows: handle do mapeamento)
+};
+
+// Mapeia o arquivo "filename" em memória. Retorna false em caso de erro.
+bool MapFile(const char* filename, MappedFile* file);
+
+// Desfaz o mapeamento criado por MapFile().
+void UnmapFile(MappedFile* file);
+
+// Obtém o tamanho (em bytes) e a data de modificação (em segundos desde
+// 1970) de um arquivo. Retorna false se o arquivo não existir.
+bool GetFileSizeAndModificationTime(const char* filename, uint64_t* size, int64_t* mtime);
+
+#endif // _MAPPEDFILE_H
@@ -0,0 +1,55 @@
+#ifndef _MESHOPTIMIZE_H
+#define _MESHOPTIMIZE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Otimizações da ordem dos triângulos e dos vértices de uma malha indexada
+// (3 índices por triângulo, "positions" com 3 floats por vértice), e funções
+// que medem o efeito destas otimizações. Definidas em "meshoptimize.cpp".
+
+// Reordena os triângulos para aproveitar o cache de vértices já
+// transformados pelo Vertex Shader (algoritmo de Tom Forsyth, "Linear-Speed
+// Vertex Cache Optimisation"), supondo um cache LRU com cache_size vértices.
+void OptimizeVertexCache(uint32_t* indices, size_t num_indices, size_t num_vertices,
+                         unsigned int cache_size);
+
+// Reordena grupos de triângulos consecutivos para reduzir o "overdraw"
+// (fragmentos sombreados e depois escondidos por outros mais próximos),
+// preservando a maior parte da eficiência do cache obtida por
+// OptimizeVertexCache(), que deve ser chamada antes. Os grupos terminam onde
+// o cache recomeça (fronteiras "hard") ou onde a sua taxa de faltas no cache
+// não passa de threshold vezes a do grupo todo (fronteiras "soft"), e são
+// ordenados de fora para dentro do modelo, por uma chave que não depende do
+// ponto de vista (Sander, Nehab e Barczak, "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw", 2007).
+void OptimizeOverdraw(uint32_t* indices, size_t num_indices,
+                      const float* positions, size_t num_vertices,
+                      unsigned int cache_size, float threshold);
+
+// Renumera os vértices na ordem em que são usados pelos índices, para que o
+// Vertex Shader leia o VBO sequencialmente. Retorna em remap[v] o novo
+// número do vértice v e atualiza os índices; vértices não utilizados ficam
+// no final.
+void OptimizeVertexFetch(uint32_t* indices, size_t num_indices, size_t num_vertices,
+                         uint32_t* remap);
+
+// Eficiência do cache de vértices, simulando um cache FIFO de cache_size
+// vértices.
+struct VertexCacheStatistics
+{
+    size_t vertices_transformed; // Número de faltas no cache
+    double acmr; // "Average Cache Miss Ratio": faltas por triângulo (ótimo ~0.5)
+    double atvr; // "Average Transformed Vertex Ratio": faltas por vértice (ótimo 1.0)
+};
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t num_indices, size_t num_vertices,
+                                         unsigned int cache_size);
+
+// Razão entre fragmentos sombreados e pixels cobertos (ótimo 1.0), medida
+// rasterizando a malha em software, com teste de profundidade e "backface
+// culling", com projeções ortográficas vistas de +X, -X, +Y, -Y, +Z e -Z.
+double AnalyzeOverdraw(const uint32_t* indices, size_t num_indices,
+                       const float* positions, size_t num_vertices);
+
+#endif // _MESHOPTIMIZE_H
@@ -0,0 +1,37 @@
+#ifndef _NORMALMATRIX_H
+#define _NORMALMATRIX_H
+
+#include <cstddef>
+
+#include <glm/mat3x4.hpp>
+#include <glm/mat4x4.hpp>
+
+// Matrizes de transformação de normais ("normal matrices"), computadas na
+// CPU uma vez por objeto em vez de uma vez por vértice no vertex shader.
+// Definidas em "normalmatrix.cpp".
+//
+// A normal matrix de uma matriz model é a inversa da transposta da sua
+// parte 3x3 superior esquerda (veja slides 123-151 do documento
+// Aula_07_Transformacoes_Geometricas_3D.pdf). Ela é guardada como uma
+// glm::mat3x4 (3 colunas vec4 com w igual a 0), que tem o mesmo layout de
+// uma "mat3x4" em um bloco std140 ou de 3 texels RGBA32F, e leva uma normal
+// (x,y,z) a um vec4 com w igual a 0.
+
+// Computa as normal matrices de count matrizes model. A matriz i é lida de
+// (char*)models + i*model_stride, e a sua normal matrix é escrita em
+// (char*)normal_matrices + i*normal_stride; as distâncias em bytes permitem
+// ler e escrever diretamente em arrays de structs. Com SSE, 4 matrizes são
+// processadas por iteração. Matrizes singulares (escala 0 em algum eixo)
+// resultam na matriz dos cofatores, sem a divisão pelo determinante.
+void ComputeNormalMatrices(const glm::mat4* models, size_t model_stride,
+                           glm::mat3x4* normal_matrices, size_t normal_stride, size_t count);
+
+// O mesmo que ComputeNormalMatrices(), uma matriz por vez e sem SIMD.
+// Utilizada para comparação no benchmark de normal matrices.
+void ComputeNormalMatricesScalar(const glm::mat4* models, size_t model_stride,
+                                 glm::mat3x4* normal_matrices, size_t normal_stride, size_t count);
+
+// Normal matrix de uma única matriz model.
+glm::mat3x4 NormalMatrix(const glm::mat4& model);
+
+#endif // _NORMALMATRIX_H
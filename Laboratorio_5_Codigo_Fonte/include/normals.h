@@ -0,0 +1,35 @@
+#ifndef _NORMALS_H
+#define _NORMALS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Peso da normal de cada triângulo na média que define a normal de um vértice.
+enum NormalWeighting
+{
+    NORMAL_WEIGHTING_AREA,  // Proporcional à área do triângulo (produto vetorial não normalizado)
+    NORMAL_WEIGHTING_ANGLE  // Proporcional ao ângulo do triângulo no vértice
+};
+
+// Computa a normal de cada vértice como a média ponderada das normais dos
+// triângulos que o compartilham (método de Gouraud). "positions" e
+// "normals" têm 3 floats por vértice; "triangles" tem 3 índices de vértice
+// por triângulo. Vértices que não pertencem a nenhum triângulo recebem a
+// normal (0,0,0). Divide os triângulos em até num_threads intervalos,
+// executados pelas threads de trabalho de RunInParallel() (veja
+// "parallel.h"), sem operações atômicas: cada intervalo acumula as normais
+// dos seus triângulos em um vetor próprio, e os vetores são somados ao
+// final. Definida em "normals.cpp".
+void ComputeVertexNormals(const float* positions, size_t num_vertices,
+                          const uint32_t* triangles, size_t num_triangles,
+                          NormalWeighting weighting, unsigned int num_threads,
+                          float* normals);
+
+// Versão sequencial e sem SIMD de ComputeVertexNormals() com
+// NORMAL_WEIGHTING_AREA, idêntica à implementação original de
+// ComputeNormals(). Utilizada como referência em BenchmarkNormals().
+void ComputeVertexNormalsReference(const float* positions, size_t num_vertices,
+                                   const uint32_t* triangles, size_t num_triangles,
+                                   float* normals);
+
+#endif // _NORMALS_H
@@ -0,0 +1,37 @@
+#ifndef _OBJPARSER_H
+#define _OBJPARSER_H
+
+#include <string>
+#include <vector>
+
+#include <tiny_obj_loader.h>
+
+// Resultado de LoadObjParallel().
+enum ObjParseResult
+{
+    OBJ_PARSE_OK,          // Arquivo carregado com sucesso
+    OBJ_PARSE_UNSUPPORTED, // Arquivo usa recursos não suportados (materiais,
+                           // linhas, pontos, polígonos com mais de 4 vértices);
+                           // o chamador deve utilizar tinyobj::LoadObj().
+    OBJ_PARSE_ERROR        // Erro de leitura ou de sintaxe (veja "err")
+};
+
+// Carrega um arquivo OBJ dividido em até num_threads blocos, interpretados
+// pelas threads de trabalho de RunInParallel() (veja "parallel.h"). O
+// arquivo é mapeado em memória e dividido em blocos (em fronteiras de
+// linha), cada thread interpreta as linhas "v"/"vn"/"vt"/"f"/"g"/"o"/"s" do seu bloco, e
+// os resultados são concatenados utilizando somas de prefixo. A saída é
+// idêntica à de tinyobj::LoadObj() com triangulate = true. Definida em
+// "objparser.cpp".
+ObjParseResult LoadObjParallel(const char* filename, unsigned int num_threads,
+                               tinyobj::attrib_t* attrib,
+                               std::vector<tinyobj::shape_t>* shapes,
+                               std::string* err);
+
+// Apenas interpreta o arquivo, como a primeira fase de LoadObjParallel(),
+// descartando as faces lidas. Usada para medir a vazão do leitor em arquivos
+// grandes demais para caber na memória depois de interpretados.
+ObjParseResult ScanObjFile(const char* filename, unsigned int num_threads,
+                           size_t* num_vertices, size_t* num_faces);
+
+#endif // _OBJPARSER_H
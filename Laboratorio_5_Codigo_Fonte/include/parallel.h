@@ -0,0 +1,25 @@
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+// Executa job(i) para i = 0..count-1 e espera todos terminarem. Os índices
+// são distribuídos entre a thread atual e as threads de um conjunto fixo de
+// threads de trabalho, criadas uma única vez (na primeira chamada) e
+// reutilizadas por todas as chamadas seguintes; nenhuma thread é criada por
+// chamada. Com count == 1, job(0) é executado na própria thread atual.
+//
+// Pode ser chamada por várias threads ao mesmo tempo (por exemplo, pelas
+// threads de carregamento de arquivos). A thread que chama a função também
+// executa índices do seu próprio job, e portanto cada chamada termina mesmo
+// que todas as threads de trabalho estejam ocupadas. Definida em
+// "parallel.cpp".
+void RunInParallel(size_t count, const std::function<void(size_t)>& job);
+
+// Número de threads de trabalho utilizadas por RunInParallel(): uma a menos
+// que o número de núcleos da máquina (a thread que chama RunInParallel()
+// ocupa o núcleo restante), e no mínimo uma.
+unsigned int ParallelWorkerCount();
+
+#endif // _PARALLEL_H
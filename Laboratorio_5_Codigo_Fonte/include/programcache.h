@@ -0,0 +1,70 @@
+#ifndef _PROGRAMCACHE_H
+#define _PROGRAMCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+
+// Cache em disco de programas de GPU já compilados e linkados ("program
+// binaries"). Em vez de compilar o código GLSL a cada execução do programa
+// (e a cada variante dos shaders; veja GetShaderVariant() em "main.cpp"), o
+// binário gerado pelo driver é gravado com glGetProgramBinary() e
+// recarregado com glProgramBinary(). Definidas em "programcache.cpp".
+//
+// Essas funções são do OpenGL 4.1 ou da extensão GL_ARB_get_program_binary
+// (disponível no Mesa, por exemplo), e não do OpenGL 3.3 carregado pelo
+// glad; InitProgramCache() as carrega com glfwGetProcAddress(). Sem elas,
+// ou sem nenhum formato de binário suportado, as funções abaixo não fazem
+// nada e os programas são sempre compilados do código fonte.
+//
+// Também definidas aqui, pelo mesmo motivo (evitar que a compilação dos
+// programas pare o desenho dos quadros), as funções da compilação em
+// paralelo: InitParallelShaderCompile() e IsProgramLinkComplete().
+
+// Verifica se o driver suporta binários de programas, e carrega as funções
+// necessárias. Deve ser chamada depois de criado o contexto OpenGL, antes
+// das demais. Retorna false se o cache não puder ser utilizado.
+bool InitProgramCache();
+
+// Chave de um programa: um hash de todo o código GLSL dos seus shaders
+// (incluindo #defines inseridos) e das strings GL_VENDOR, GL_RENDERER,
+// GL_VERSION e GL_SHADING_LANGUAGE_VERSION do driver atual. O OpenGL não
+// informa a versão exata do driver em outro lugar; no Mesa, por exemplo,
+// GL_VERSION contém a versão do Mesa ("4.5 (Core Profile) Mesa 23.2.1").
+uint64_t ProgramCacheKey(const std::string* sources, size_t num_sources);
+
+// Nome do arquivo de cache de um programa: "nome" -> "nome.programcache".
+// Os arquivos ficam no diretório atual (o mesmo do executável; veja
+// LoadShadersFromFiles() em "main.cpp"), um por programa, e são
+// sobrescritos quando a chave muda.
+std::string ProgramCacheFilename(const char* name);
+
+// Deve ser chamada antes de glLinkProgram() nos programas que serão
+// gravados com SaveCachedProgram() (GL_PROGRAM_BINARY_RETRIEVABLE_HINT).
+void PrepareProgramForCache(GLuint program_id);
+
+// Cria um programa a partir do arquivo de cache "name", se ele existir, for
+// da mesma chave e for aceito pelo driver (que pode recusar binários de
+// outra versão ou de outra GPU). Retorna 0 caso contrário, e nesse caso o
+// programa deve ser compilado do código fonte e gravado de novo.
+GLuint LoadCachedProgram(const char* name, uint64_t key);
+
+// Grava o binário de um programa já linkado no arquivo de cache "name".
+void SaveCachedProgram(const char* name, uint64_t key, GLuint program_id);
+
+// Habilita a compilação em paralelo das extensões
+// GL_KHR_parallel_shader_compile ou GL_ARB_parallel_shader_compile: com
+// ela, glCompileShader() e glLinkProgram() retornam imediatamente e o
+// driver compila em outras threads. Retorna false se nenhuma das duas
+// estiver disponível.
+bool InitParallelShaderCompile();
+
+// Retorna true se a linkagem de um programa já terminou, e portanto
+// GL_LINK_STATUS e os logs podem ser consultados sem esperar a compilação
+// (GL_COMPLETION_STATUS_KHR). Sem a compilação em paralelo, retorna sempre
+// true, e a primeira consulta espera a compilação terminar.
+bool IsProgramLinkComplete(GLuint program_id);
+
+#endif // _PROGRAMCACHE_H
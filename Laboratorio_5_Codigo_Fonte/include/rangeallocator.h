@@ -0,0 +1,98 @@
+#ifndef _RANGEALLOCATOR_H
+#define _RANGEALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Alocador de intervalos [offset, offset+size) dentro de um espaço de
+// "capacity" unidades (bytes, vértices, ...), utilizado para sub-alocar
+// partes de um único buffer da GPU. Os intervalos livres são guardados
+// ordenados pelo início, e intervalos livres vizinhos são sempre unidos
+// (lista livre com "coalescing"). A alocação escolhe o primeiro intervalo
+// livre grande o suficiente ("first fit"). Definidas em "rangeallocator.cpp".
+struct RangeAllocator
+{
+    size_t capacity;
+    size_t free_size;                   // Soma dos tamanhos dos intervalos livres
+    std::map<size_t, size_t> free_ranges; // Início -> tamanho de cada intervalo livre
+};
+
+// Inicializa o alocador com todo o espaço livre.
+void InitRangeAllocator(RangeAllocator* allocator, size_t capacity);
+
+// Aloca "size" unidades com início múltiplo de "alignment", guardando o
+// início em *offset. Retorna false se nenhum intervalo livre comporta o
+// pedido, o que pode acontecer mesmo com free_size >= size se o espaço
+// livre estiver fragmentado.
+bool AllocateRange(RangeAllocator* allocator, size_t size, size_t alignment, size_t* offset);
+
+// Libera um intervalo retornado por AllocateRange(), com o mesmo tamanho.
+void FreeRange(RangeAllocator* allocator, size_t offset, size_t size);
+
+// Tamanho do maior intervalo livre.
+size_t LargestFreeRange(const RangeAllocator& allocator);
+
+// Arena de geometria: todas as malhas ficam em um único VBO e um único EBO,
+// compartilhados por um único VAO. Cada malha recebe um intervalo de
+// vértices e um intervalo de índices, sub-alocados com RangeAllocator, e os
+// seus índices são relativos ao primeiro vértice do seu intervalo ("base
+// vertex", veja glDrawElementsBaseVertex()). Assim, desenhar objetos de
+// malhas diferentes não exige trocar de VAO.
+//
+// A arena não conhece o formato dos vértices: quem a cria informa o tamanho
+// de cada vértice e uma função que define os atributos do VAO a partir do
+// VBO ligado, chamada sempre que o VBO é recriado. Definidas em "rangeallocator.cpp".
+struct ArenaMesh
+{
+    std::string filename;
+    bool        live;          // false depois de FreeArenaMesh()
+    size_t      base_vertex;   // Primeiro vértice, em vértices
+    size_t      num_vertices;
+    size_t      index_offset;  // Primeiro índice, em bytes
+    size_t      index_bytes;   // Tamanho do intervalo de índices, em bytes (múltiplo de 4)
+    std::vector<uint32_t> objects; // Objetos que utilizam a malha, definidos por quem a alocou
+};
+
+struct GeometryArena
+{
+    int                    vertex_format; // Repassado a setup_vertex_attributes()
+    size_t                 vertex_size;   // Em bytes
+    void                 (*setup_vertex_attributes)(int vertex_format);
+    GLuint                 vertex_array_object_id; // 0 até InitGeometryArena()
+    GLuint                 vertex_buffer_id;
+    GLuint                 index_buffer_id;
+    RangeAllocator         vertices; // Em vértices
+    RangeAllocator         indices;  // Em bytes
+    std::vector<ArenaMesh> meshes;
+};
+
+// Cria o VAO e os buffers da arena, com espaço para vertex_capacity
+// vértices de vertex_size bytes e index_capacity bytes de índices.
+void InitGeometryArena(GeometryArena* arena, int vertex_format, size_t vertex_size,
+                       void (*setup_vertex_attributes)(int vertex_format),
+                       size_t vertex_capacity, size_t index_capacity);
+
+// Reserva espaço para os vértices e índices de uma malha lida do arquivo
+// filename, e retorna o índice da malha em arena->meshes. Se a malha não
+// couber em nenhum intervalo livre, a arena é compactada (se o espaço livre
+// total for suficiente) ou ampliada.
+uint32_t AllocateArenaMesh(GeometryArena* arena, const char* filename, size_t num_vertices, size_t num_index_bytes);
+
+// Libera o espaço de uma malha, que pode ser reutilizado por outras malhas.
+void FreeArenaMesh(GeometryArena* arena, uint32_t arena_mesh);
+
+// Recria o VBO e o EBO da arena com as capacidades dadas, compactando as
+// malhas existentes no início dos novos buffers.
+void ResizeGeometryArena(GeometryArena* arena, size_t vertex_capacity, size_t index_capacity);
+
+// Deslocamento em bytes, dentro do EBO da arena, do índice first_index
+// (relativo ao início dos índices da malha) de uma malha cujos índices têm
+// index_size bytes.
+size_t ArenaIndexOffset(const GeometryArena& arena, uint32_t arena_mesh, size_t first_index, size_t index_size);
+
+#endif // _RANGEALLOCATOR_H
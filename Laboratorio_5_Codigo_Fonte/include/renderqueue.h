@@ -0,0 +1,116 @@
+#ifndef _RENDERQUEUE_H
+#define _RENDERQUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/mat4x4.hpp>
+
+#include "scene.h"
+#include "uniformring.h"
+
+// Chaves de ordenação da fila de desenho. Cada item de desenho é
+// representado por uma chave de 64 bits; ordenando as chaves, os itens que
+// utilizam o mesmo programa de GPU ficam juntos, e dentro destes os que
+// utilizam o mesmo conjunto de texturas e o mesmo VAO, do mais próximo para
+// o mais distante da câmera:
+//
+//    bits 63-56  programa de GPU
+//    bits 55-48  conjunto de texturas
+//    bits 47-32  VAO
+//    bits 31-8   profundidade
+//    bits  7-0   zero
+//
+// Os identificadores são truncados para o número de bits do seu campo. Isto
+// só pode piorar a ordem dos itens (dois VAOs diferentes podem ficar
+// intercalados), mas nunca o resultado do desenho.
+uint64_t MakeDrawKey(uint32_t program, uint32_t texture_set, uint32_t vertex_array, float depth);
+
+// Ordena keys[0..count-1] em ordem crescente, aplicando a mesma permutação
+// em items[0..count-1] (normalmente o índice de cada item). Utiliza radix
+// sort LSD com dígitos de 8 bits, pulando os dígitos iguais em todas as
+// chaves. "temp_keys" e "temp_items" são redimensionados se necessário, e
+// podem ser reutilizados entre chamadas para evitar alocações. A ordenação
+// é estável. Definida em "renderqueue.cpp".
+void RadixSortDrawKeys(uint64_t* keys, uint32_t* items, size_t count,
+                       std::vector<uint64_t>* temp_keys, std::vector<uint32_t>* temp_items);
+
+// Fila de desenho. Em vez de desenhar cada objeto imediatamente com
+// DrawVirtualObject(), o código de main() adiciona itens de desenho à fila
+// com SubmitDrawItem(), e FlushRenderQueue() os ordena pelas chaves acima e
+// os desenha, pulando as trocas de programa, texturas e VAO iguais às do
+// item anterior. Definidas em "renderqueue.cpp".
+//
+// Cada item é identificado pelo seu objeto e por um número de instância
+// dado por quem o adiciona, que distingue as cópias de um mesmo objeto em
+// um quadro e deve ser o mesmo em todos os quadros: o estado das consultas
+// de oclusão (veja g_UseOcclusionCulling) é mantido entre quadros por essa
+// identificação, e descartado no primeiro quadro em que ela não é adicionada.
+#define MAX_TEXTURE_SET_UNITS 3 // TextureImage0, TextureImage1 e TextureImage2 em "shader_fragment.glsl"
+
+// Unidade de textura do texture buffer "draw_data" dos shaders, logo após as
+// unidades dos conjuntos de texturas.
+#define DRAW_DATA_TEXTURE_UNIT MAX_TEXTURE_SET_UNITS
+
+// Conjunto de texturas ligadas às unidades 0, 1, ... durante um desenho.
+// Cada elemento é a posição da textura em RenderQueueResources::texture_ids,
+// ou -1 para não mudar a unidade.
+struct TextureSet
+{
+    int images[MAX_TEXTURE_SET_UNITS];
+};
+
+// Texturas e programas de GPU de quem utiliza a fila, que a fila só lê.
+// Definidos uma única vez, antes do primeiro FlushRenderQueue(); os vetores
+// podem mudar depois disso.
+struct RenderQueueResources
+{
+    const std::vector<TextureSet>* texture_sets;    // Indexado pelo texture_set de SubmitDrawItem()
+    const std::vector<GLuint>*     texture_ids;     // IDs das texturas; 0 se ainda não carregada
+    void (*use_program)(GLuint program);            // glUseProgram(), atualizando *batched_uniform
+    const GLint*                   batched_uniform; // Localização da variável "batched" do programa atual
+};
+
+// Trocas de estado feitas e evitadas ("skipped") pelo último
+// FlushRenderQueue().
+struct RenderQueueStatistics
+{
+    size_t draws;
+    size_t program_binds,  program_binds_skipped;
+    size_t texture_binds,  texture_binds_skipped;
+    size_t vao_binds,      vao_binds_skipped;
+    size_t uniform_writes;      // glUniform*() e glBindBufferRange() dos blocos ObjectUniforms
+    size_t occlusion_queries;   // Bboxes desenhadas em consultas de oclusão
+    size_t occluded_draws;      // Itens não desenhados por estarem escondidos
+    size_t conditional_draws;   // Itens desenhados com glBeginConditionalRender()
+    size_t occluded_triangles;  // Triângulos dos itens não desenhados
+    size_t batches;             // Chamadas de desenho feitas por FlushDrawBatch()
+    size_t batched_items;       // Itens desenhados por essas chamadas
+};
+
+void SetRenderQueueResources(const RenderQueueResources& resources); // Define as texturas e programas utilizados pela fila
+void BeginRenderQueue(const FrameUniforms& frame_uniforms); // Esvazia a fila no início de um quadro
+void SubmitDrawItem(GLuint program, uint32_t texture_set, SceneObjectHandle object, uint32_t instance, const glm::mat4& model); // Adiciona um item à fila
+void FlushRenderQueue(); // Ordena e desenha os itens da fila
+const RenderQueueStatistics& GetRenderQueueStatistics(); // Trocas de estado do último FlushRenderQueue()
+const std::vector<uint64_t>& GetRenderQueueKeys(); // Chaves dos itens adicionados desde BeginRenderQueue(), antes de FlushRenderQueue() ordená-las
+
+// Variável que controla o descarte dos objetos fora do campo de visão
+// (frustum culling) em FlushRenderQueue().
+// Desabilitado com a opção "--no-culling".
+extern bool g_UseFrustumCulling;
+
+// Variável que controla o descarte de objetos escondidos atrás de outros
+// (occlusion culling) em FlushRenderQueue(), habilitado com a opção
+// "--occlusion-culling".
+extern bool g_UseOcclusionCulling;
+
+// Variável que controla o agrupamento dos itens da fila de desenho em lotes
+// (veja FlushDrawBatch() em "renderqueue.cpp"). Desabilitado com a opção
+// "--no-batching".
+extern bool g_UseDrawBatching;
+
+#endif // _RENDERQUEUE_H
@@ -0,0 +1,161 @@
+#ifndef _SCENE_H
+#define _SCENE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/mat3x4.hpp>
+#include <glm/vec3.hpp>
+
+#include "rangeallocator.h"
+#include "uniformring.h"
+
+// Objetos da cena virtual, os formatos dos seus vértices na GPU, e as
+// funções que os desenham um a um. As malhas são lidas e enviadas para a GPU
+// por "main.cpp", e os objetos são desenhados em grupo pela fila de desenho
+// de "renderqueue.h". Definidas em "scene.cpp".
+
+// Definimos uma estrutura que armazenará dados necessários para renderizar
+// cada objeto da cena virtual.
+// Número máximo de níveis de detalhe de um objeto, incluindo o original.
+#define MAX_LODS 5
+
+struct SceneObject
+{
+    std::string  name;        // Nome do objeto
+    size_t       first_index; // Índice do primeiro vértice dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
+    size_t       num_indices; // Número de índices do objeto dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
+    GLenum       rendering_mode; // Modo de rasterização (GL_TRIANGLES, GL_TRIANGLE_STRIP, etc.)
+    GLenum       index_type; // Tipo dos índices (GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT ou GL_UNSIGNED_INT)
+    GLuint       vertex_array_object_id; // ID do VAO onde estão armazenados os atributos do modelo
+    uint32_t     arena_mesh; // Malha de g_GeometryArena que contém os vértices e índices do objeto
+    glm::vec3    bbox_min; // Axis-Aligned Bounding Box do objeto
+    glm::vec3    bbox_max;
+    bool         quantized_positions; // Posições quantizadas relativas à bbox? Veja BuildMeshData()
+    bool         resident; // Vértices e índices já estão na GPU? Veja ProcessAssetUploads()
+
+    // Níveis de detalhe (LODs): versões simplificadas do objeto, que usam os
+    // mesmos vértices e cujos índices ficam logo após os do objeto original
+    // (LOD 0, igual a first_index e num_indices). Veja BuildLevelsOfDetail()
+    // e SelectLevelOfDetail().
+    int          num_lods;
+    size_t       lod_first_index[MAX_LODS];
+    size_t       lod_num_indices[MAX_LODS];
+    int          current_lod; // LOD desenhado no último quadro
+};
+
+// Formatos possíveis para os vértices enviados para a GPU. Veja
+// SetupVertexAttributes().
+enum VertexFormat
+{
+    VERTEX_FORMAT_FLOAT,     // FloatVertex: 40 bytes por vértice
+    VERTEX_FORMAT_QUANTIZED, // QuantizedVertex: 16 bytes por vértice
+};
+
+// Vértice com todos os atributos em float, como em "shader_vertex.glsl".
+struct FloatVertex
+{
+    GLfloat position[4];  // X, Y, Z, W = 1
+    GLfloat normal[4];    // X, Y, Z, W = 0
+    GLfloat texcoords[2]; // U, V
+};
+
+// Vértice compactado: a posição é quantizada em 16 bits por coordenada
+// relativa à bbox do objeto, a normal utiliza 10 bits por coordenada
+// (GL_INT_2_10_10_10_REV) e as coordenadas de textura são "half floats".
+struct QuantizedVertex
+{
+    GLushort position[4];  // X, Y, Z em [0,65535] dentro da bbox; W = 65535
+    GLuint   normal;       // X, Y, Z, W empacotados em GL_INT_2_10_10_10_REV
+    GLushort texcoords[2]; // U, V em half float
+};
+
+// Tamanho em bytes de um vértice no formato vertex_format.
+size_t VertexFormatSize(VertexFormat vertex_format);
+
+// Identificador de um objeto da cena virtual: a posição dos seus dados nos
+// vetores de g_VirtualScene. Veja FindSceneObject().
+typedef uint32_t SceneObjectHandle;
+
+// Funções que acessam e desenham os objetos da cena virtual.
+SceneObjectHandle FindSceneObject(const char* object_name); // Retorna o handle de um objeto, reservando-o se ainda não existir
+void SetSceneObject(SceneObjectHandle handle, const SceneObject& object); // Copia os dados de um objeto para g_VirtualScene
+void WarnMissingSceneObjects(); // Avisa sobre objetos procurados que não existem em nenhum arquivo carregado
+float ProjectedScreenSize(SceneObjectHandle handle, const glm::mat4& model_view_projection); // Tamanho da bbox de um objeto na tela
+int LevelOfDetailForScreenSize(float screen_size, int lod, int num_lods); // Escolhe um LOD pelo tamanho na tela, com histerese
+int SelectLevelOfDetail(SceneObjectHandle handle, const glm::mat4& model_view_projection); // Escolhe o LOD de um objeto pelo seu tamanho na tela
+void DrawVirtualObject(SceneObjectHandle handle, const glm::mat4& model, const glm::mat4& view_projection); // Desenha um objeto armazenado em g_VirtualScene
+void DrawSceneObjectElements(SceneObjectHandle handle, const glm::mat4& model_view_projection); // Chama glDrawElements() para um objeto, com o VAO e as variáveis já definidos
+void FillObjectUniforms(ObjectUniforms* uniforms, SceneObjectHandle handle, const glm::mat4& model, const glm::mat3x4& normal_matrix); // Preenche o bloco ObjectUniforms de um objeto
+void SetObjectUniforms(SceneObjectHandle handle, const glm::mat4& model); // Envia e liga o bloco ObjectUniforms de um único objeto
+size_t IndexTypeSize(GLenum index_type); // Tamanho em bytes de um índice do tipo index_type
+void SetupVertexAttributes(VertexFormat vertex_format); // Define os atributos de vértice do VAO atual
+void SetupArenaVertexAttributes(int vertex_format); // SetupVertexAttributes() para a arena de geometria de "rangeallocator.h"
+void CreateBoundingBoxProxy(); // Cria o VAO desenhado no lugar de objetos ainda não carregados
+
+// A cena virtual guarda os dados de todos os objetos em vetores densos, um
+// vetor para cada campo de SceneObject ("structure of arrays"), indexados
+// pelo "handle" do objeto. O nome de um objeto é procurado uma única vez,
+// por FindSceneObject(), e a partir daí o objeto é acessado somente pelo
+// handle, que nunca muda. Veja dentro da função AddMeshToVirtualScene() como
+// que são incluídos objetos dentro da variável g_VirtualScene, e veja na
+// função main() como estes são acessados.
+struct VirtualScene
+{
+    std::vector<std::string>   names;
+    std::vector<unsigned char> loaded;   // Objeto já foi lido de algum arquivo? Veja AddMeshToVirtualScene()
+    std::vector<unsigned char> resident; // Vértices e índices já estão na GPU? Veja ProcessAssetUploads()
+    std::vector<GLuint>        vertex_array_object_ids;
+    std::vector<uint32_t>      arena_meshes; // Veja GeometryArena
+    std::vector<GLenum>        rendering_modes;
+    std::vector<GLenum>        index_types;
+    std::vector<glm::vec3>     bbox_mins;
+    std::vector<glm::vec3>     bbox_maxs;
+    std::vector<unsigned char> quantized_positions;
+    std::vector<int>           num_lods;
+    std::vector<int>           current_lods;
+    std::vector<size_t>        lod_first_indices; // MAX_LODS valores por objeto: [handle*MAX_LODS + lod]
+    std::vector<size_t>        lod_num_indices;   // Idem
+
+    std::unordered_map<std::string, SceneObjectHandle> handles; // Utilizado somente por FindSceneObject()
+};
+
+extern VirtualScene g_VirtualScene;
+
+// Razão de proporção da janela (largura/altura), utilizada na escolha do LOD.
+// Atualizada pela função FramebufferSizeCallback() de "main.cpp".
+extern float g_ScreenRatio;
+
+// Variável que controla a escolha do nível de detalhe (LOD) de cada objeto
+// desenhado (veja SelectLevelOfDetail()). Com a opção "--no-lod", todos os
+// objetos são desenhados com a malha original.
+extern bool g_UseLevelsOfDetail;
+
+// Número de objetos e de triângulos desenhados no quadro atual em cada
+// nível de detalhe. Veja TextRendering_ShowLodStatistics().
+extern size_t g_LodDraws[MAX_LODS];
+extern size_t g_LodTriangles[MAX_LODS];
+
+// Número de objetos desenhados e descartados pelo frustum culling no quadro
+// atual. Veja TextRendering_ShowRenderQueueStatistics().
+extern size_t g_VisibleObjects;
+extern size_t g_CulledObjects;
+
+// Arena com os vértices e índices de todas as malhas, criada pela primeira
+// chamada de AddMeshToVirtualScene(). Veja "rangeallocator.h".
+extern GeometryArena g_GeometryArena;
+
+// VAO do cubo de CreateBoundingBoxProxy().
+extern GLuint g_BoundingBoxProxyVAO;
+
+// Índices dos triângulos do cubo de CreateBoundingBoxProxy(), logo após os
+// índices das arestas, no mesmo buffer.
+#define BOUNDING_BOX_PROXY_TRIANGLES_OFFSET 24
+
+#endif // _SCENE_H
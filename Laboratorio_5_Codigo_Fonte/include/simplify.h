@@ -0,0 +1,28 @@
+#ifndef _SIMPLIFY_H
+#define _SIMPLIFY_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Simplifica uma malha indexada (3 índices por triângulo, "positions" com 3
+// floats por vértice) por colapsos de arestas guiados por quádricas de erro
+// (Garland e Heckbert, "Surface Simplification Using Quadric Error Metrics",
+// 1997), até no máximo target_index_count índices. Cada colapso move um
+// vértice para a posição de um vizinho já existente, e portanto o resultado
+// utiliza os mesmos vértices da malha original: só os índices mudam, e todos
+// os níveis de detalhe podem compartilhar o mesmo VBO.
+//
+// Vértices na borda da malha e vértices que compartilham a posição com
+// outros (costuras de normais ou de coordenadas de textura) nunca são
+// removidos, e colapsos que invertem algum triângulo são rejeitados; por
+// isso o resultado pode ter mais índices que target_index_count.
+//
+// Escreve os índices em "destination" (com espaço para num_indices índices)
+// e retorna quantos foram escritos. Se result_error != NULL, guarda nele o
+// maior erro (distância) introduzido, relativo ao tamanho da malha.
+// Definida em "simplify.cpp".
+size_t SimplifyMesh(uint32_t* destination, const uint32_t* indices, size_t num_indices,
+                    const float* positions, size_t num_vertices,
+                    size_t target_index_count, float* result_error);
+
+#endif // _SIMPLIFY_H
@@ -0,0 +1,61 @@
+#ifndef _TEXTURECACHE_H
+#define _TEXTURECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+// Formato dos pixels de uma TextureData.
+enum TextureFormat
+{
+    TEXTURE_FORMAT_SRGB8_ALPHA8 = 1 // RGBA, 4 bytes por pixel, RGB codificado em sRGB
+};
+
+// Um nível de mipmap de uma textura.
+struct TextureLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset; // Posição do primeiro pixel, em bytes, a partir de TextureData::pixels
+    uint64_t size;   // Tamanho do nível em bytes
+};
+
+// Textura com todos os níveis de mipmap já computados, pronta para ser
+// enviada para a GPU nível por nível. Os níveis ficam contíguos em "pixels",
+// do maior (nível 0) para o menor (1x1). Os pixels podem estar em "storage"
+// (veja BuildTextureMipmaps()) ou diretamente no arquivo de cache mapeado em
+// memória (veja LoadTextureCache()).
+struct TextureData
+{
+    TextureFormat              format;
+    uint32_t                   width;
+    uint32_t                   height;
+    std::vector<TextureLevel>  levels;
+    const unsigned char*       pixels;
+    std::vector<unsigned char> storage;
+    MappedFile                 file;   // file.data == NULL se a textura não veio de um arquivo
+};
+
+// Computa todos os níveis de mipmap de uma imagem RGBA com RGB em sRGB. Cada
+// pixel de um nível é a média de (até) 2x2 pixels do nível anterior, calculada
+// em espaço de cor linear, como recomendado (mas não exigido) para
+// glGenerateMipmap() em texturas sRGB como a GL_SRGB8 de LoadTextureImage().
+void BuildTextureMipmaps(const unsigned char* rgba, uint32_t width, uint32_t height, TextureData* texture);
+
+// Nome do arquivo de cache de uma imagem: "imagem.jpeg" -> "imagem.jpeg.texcache".
+std::string TextureCacheFilename(const char* image_filename);
+
+// Carrega (mapeando em memória) o arquivo de cache de uma imagem, somente se
+// ele for mais recente que a própria imagem. Retorna false caso contrário.
+bool LoadTextureCache(const char* image_filename, TextureData* texture);
+
+// Grava o arquivo de cache de uma imagem. Retorna false em caso de erro.
+bool SaveTextureCache(const char* image_filename, const TextureData& texture);
+
+// Libera os pixels de uma TextureData, desfazendo o mapeamento se existir.
+void FreeTextureData(TextureData* texture);
+
+#endif // _TEXTURECACHE_H
@@ -0,0 +1,93 @@
+#ifndef _UNIFORMRING_H
+#define _UNIFORMRING_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/mat3x4.hpp>
+#include <glm/vec4.hpp>
+
+// Blocos "uniform" dos shaders, com layout std140 (matrizes e vec4 em
+// múltiplos de 16 bytes), enviados em "uniform buffer objects" (UBOs)
+// sub-alocados do buffer circular abaixo. FrameUniforms é ligado ao ponto
+// FRAME_UNIFORMS_BINDING uma vez por quadro (e de novo a cada segmento do
+// buffer que o quadro ocupar), e ObjectUniforms ao ponto
+// OBJECT_UNIFORMS_BINDING antes de cada desenho, com glBindBufferRange().
+// Devem ser idênticos aos blocos de "shader_vertex.glsl".
+struct FrameUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 camera_position; // Em coordenadas globais
+    glm::vec4 light_direction; // Sentido da fonte de luz, em coordenadas globais
+    float     time;            // Segundos desde glfwInit()
+    float     padding[3];
+};
+
+struct ObjectUniforms
+{
+    glm::mat4   model;
+    glm::mat3x4 normal_matrix; // Veja "normalmatrix.h"
+    glm::vec4   bbox_min;
+    glm::vec4   bbox_max;
+    GLint       quantized_positions; // Veja QuantizedVertex em "scene.h"
+    GLint       padding[3];
+};
+
+#define FRAME_UNIFORMS_BINDING  0
+#define OBJECT_UNIFORMS_BINDING 1
+
+// Buffer circular de dados "uniform", dividido em segmentos ("triple
+// buffering"). Cada quadro escreve no seu segmento com
+// glMapBufferRange(GL_MAP_UNSYNCHRONIZED_BIT), sem que o driver espere a
+// GPU; a sincronização é feita por um fence criado ao final do uso de cada
+// segmento, e esperado somente antes de reutilizá-lo, dois quadros depois.
+// O buffer é criado na primeira chamada de qualquer uma das funções abaixo.
+// Definidas em "uniformring.cpp".
+//
+// Um quadro com muitos desenhos fora da fila de desenho (um bloco
+// ObjectUniforms por desenho) pode ocupar vários segmentos, e o buffer pode
+// dar a volta dentro do mesmo quadro, sobrescrevendo o bloco FrameUniforms
+// ainda ligado. Por isso, ao passar para o próximo segmento no meio de um
+// quadro, o bloco FrameUniforms do quadro é enviado de novo no novo
+// segmento, e ligado no lugar do anterior.
+
+// Garante que o segmento atual tem "size" bytes livres, passando para o
+// próximo segmento se necessário. Se "size" é maior que um segmento
+// inteiro, o buffer é recriado com segmentos maiores, e os dados já
+// escritos deixam de valer para os próximos desenhos; por isso, quem envia
+// vários blocos no mesmo quadro deve reservar todo o espaço antes de
+// escrever.
+void ReserveUniforms(size_t size);
+
+// Reserva "size" bytes no segmento atual (veja ReserveUniforms()), com o
+// início alinhado a GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, e retorna o
+// deslocamento em bytes no buffer.
+size_t AllocateUniforms(size_t size);
+
+// Mapeia para escrita um intervalo reservado por AllocateUniforms(), e
+// termina a escrita.
+void* MapUniforms(size_t offset, size_t size);
+void UnmapUniforms();
+
+// Distância em bytes entre blocos consecutivos de "size" bytes em um mesmo
+// intervalo, para que o início de cada um possa ser ligado com
+// glBindBufferRange().
+size_t UniformStride(size_t size);
+
+// Envia o bloco FrameUniforms do quadro e o liga ao ponto
+// FRAME_UNIFORMS_BINDING. O bloco vale até AdvanceUniformRing().
+void SetFrameUniforms(const FrameUniforms& frame);
+
+// Termina o quadro atual: o bloco FrameUniforms deixa de valer, e o próximo
+// quadro começa em um novo segmento.
+void AdvanceUniformRing();
+
+// Buffer em que estão os blocos, para glBindBufferRange(), e número de
+// vezes em que a CPU esperou a GPU liberar um segmento.
+GLuint UniformRingBuffer();
+size_t UniformRingStalls();
+
+#endif // _UNIFORMRING_H
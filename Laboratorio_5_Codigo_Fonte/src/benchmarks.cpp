@@ -0,0 +1,1150 @@
+// Benchmarks das opções "--benchmark-*". Veja "include/benchmarks.h".
+#include "benchmarks.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/mat3x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include <glm/matrix.hpp>
+
+#include <tiny_obj_loader.h>
+
+#include "mappedfile.h"
+#include "objparser.h"
+#include "normals.h"
+#include "renderqueue.h"
+#include "culling.h"
+#include "normalmatrix.h"
+#include "glstate.h"
+#include "rangeallocator.h"
+#include "uniformring.h"
+#include "scene.h"
+
+// Funções e variáveis definidas em main.cpp. As funções de "matrices.h" são
+// definidas no próprio header, que por isso só é incluído por main.cpp.
+GLuint GetShaderVariant(uint32_t features, bool wait);
+uint32_t SceneObjectShaderFeatures(GLint object_id);
+void UseGpuProgram(GLuint program);
+FrameUniforms ComputeFrameUniforms(const glm::mat4& view, const glm::mat4& projection);
+void DrawTextOverlay(GLFWwindow* window);
+void TextRendering_ShowModelViewProjection(GLFWwindow* window, glm::mat4 projection, glm::mat4 view, glm::mat4 model, glm::vec4 p_model);
+extern bool g_ShowInfoText;
+glm::mat4 Matrix_Translate(float tx, float ty, float tz);
+glm::mat4 Matrix_Scale(float sx, float sy, float sz);
+glm::mat4 Matrix_Rotate_X(float angle);
+glm::mat4 Matrix_Rotate_Y(float angle);
+glm::mat4 Matrix_Camera_View(glm::vec4 position_c, glm::vec4 view_vector, glm::vec4 up_vector);
+glm::mat4 Matrix_Perspective(float field_of_view, float aspect, float n, float f);
+
+void TextRendering_Flush(); // Função definida em textrendering.cpp
+
+namespace
+{
+
+// Dados de uma instância de um objeto desenhado com
+// DrawVirtualObjectInstanced(). Correspondem aos atributos "instance_model"
+// (locations 3 a 6, uma por coluna) e "instance_normal_matrix" (locations 9
+// a 11) de "shader_vertex.glsl". A normal matrix deve ser preenchida junto
+// com a matriz model, de preferência para todas as instâncias de uma vez com
+// ComputeNormalMatrices().
+struct InstanceData
+{
+    glm::mat4   model;
+    glm::mat3x4 normal_matrix; // Veja "normalmatrix.h"
+};
+
+// Buffer com os dados das instâncias desenhadas por
+// DrawVirtualObjectInstanced(), criado no primeiro desenho e reenviado a cada
+// chamada, e as instâncias agrupadas por LOD antes do envio.
+GLuint instance_buffer = 0;
+std::vector<InstanceData> instance_scratch;
+std::vector<unsigned char> instance_lods;
+
+// Desenha num_instances cópias de um objeto de g_VirtualScene, cada uma com
+// a sua matriz model (veja InstanceData), com uma chamada de
+// glDrawElementsInstancedBaseVertex() para cada nível de detalhe utilizado.
+// Os dados das instâncias são enviados para a GPU a cada chamada, e lidos
+// pelo vertex shader como atributos com glVertexAttribDivisor() igual a 1
+// (um valor por instância, e não por vértice), com a variável "instanced"
+// do programa atual (de localização instanced_uniform) verdadeira.
+//
+// Faz somente o que DrawVirtualObject() faz para cada cópia, para que
+// BenchmarkInstancing() compare as duas: escolhe o LOD de cada instância
+// (view_projection é o produto das matrizes view e projection), sem frustum
+// culling, e não desenha objetos que ainda não estão na GPU. Na cena,
+// objetos repetidos são desenhados com instancing pelos lotes da fila de
+// desenho (veja FlushDrawBatch() em "renderqueue.cpp").
+void DrawVirtualObjectInstanced(SceneObjectHandle handle, const InstanceData* instances, size_t num_instances,
+                                const glm::mat4& view_projection, GLint instanced_uniform)
+{
+    const VirtualScene& scene = g_VirtualScene;
+
+    if (!scene.resident[handle] || num_instances == 0)
+        return;
+
+    int num_lods = g_UseLevelsOfDetail ? std::max(1, scene.num_lods[handle]) : 1;
+
+    // Escolhemos o LOD de cada instância e agrupamos as instâncias por LOD
+    // (counting sort), para que cada grupo seja contíguo no buffer. As
+    // instâncias não guardam o LOD do quadro anterior, e portanto todas
+    // partem do LOD 0 em LevelOfDetailForScreenSize().
+    instance_lods.resize(num_instances);
+    size_t lod_counts[MAX_LODS] = { 0 };
+    for (size_t i = 0; i < num_instances; ++i)
+    {
+        int lod = 0;
+        if (num_lods > 1)
+        {
+            float screen_size = ProjectedScreenSize(handle, view_projection * instances[i].model);
+            lod = LevelOfDetailForScreenSize(screen_size, 0, num_lods);
+        }
+        instance_lods[i] = (unsigned char)lod;
+        lod_counts[lod] += 1;
+    }
+
+    size_t lod_first_instance[MAX_LODS + 1] = { 0 };
+    for (int lod = 0; lod < num_lods; ++lod)
+        lod_first_instance[lod + 1] = lod_first_instance[lod] + lod_counts[lod];
+
+    // Se todas as instâncias usam o mesmo LOD, enviamos os dados na ordem
+    // dada, sem cópia.
+    const InstanceData* upload_data = instances;
+    if (std::count(lod_counts, lod_counts + num_lods, num_instances) == 0)
+    {
+        size_t next_instance[MAX_LODS];
+        std::copy(lod_first_instance, lod_first_instance + num_lods, next_instance);
+        instance_scratch.resize(num_instances);
+        for (size_t i = 0; i < num_instances; ++i)
+            instance_scratch[next_instance[instance_lods[i]]++] = instances[i];
+        upload_data = instance_scratch.data();
+    }
+
+    // Enviamos os dados das instâncias. Chamar glBufferData() com o buffer
+    // inteiro a cada quadro ("orphaning") permite que o driver aloque uma
+    // nova área de memória se a anterior ainda estiver sendo lida por um
+    // desenho do quadro anterior, em vez de esperar por ele.
+    if (instance_buffer == 0)
+        glGenBuffers(1, &instance_buffer);
+    GLState_BindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    glBufferData(GL_ARRAY_BUFFER, num_instances * sizeof(InstanceData), upload_data, GL_STREAM_DRAW);
+
+    GLState_BindVertexArray(scene.vertex_array_object_ids[handle]);
+
+    // A matriz model do bloco ObjectUniforms não é utilizada; somente a
+    // bbox.
+    SetObjectUniforms(handle, glm::mat4(1.0f));
+    glUniform1i(instanced_uniform, 1);
+
+    // A matriz model ocupa 4 atributos (locations 3 a 6) e a normal matrix
+    // 3 (locations 9 a 11), um por coluna.
+    for (int column = 0; column < 4; ++column)
+    {
+        glVertexAttribDivisor(3 + column, 1);
+        glEnableVertexAttribArray(3 + column);
+    }
+    for (int column = 0; column < 3; ++column)
+    {
+        glVertexAttribDivisor(9 + column, 1);
+        glEnableVertexAttribArray(9 + column);
+    }
+
+    GLenum index_type = scene.index_types[handle];
+    for (int lod = 0; lod < num_lods; ++lod)
+    {
+        size_t first_instance = lod_first_instance[lod];
+        size_t lod_instances  = lod_first_instance[lod + 1] - first_instance;
+        if (lod_instances == 0)
+            continue;
+
+        // OpenGL 3.3 não tem glDrawElementsInstancedBaseInstance(); por isso
+        // apontamos os atributos para o início do grupo de cada LOD.
+        size_t offset = first_instance * sizeof(InstanceData);
+        for (int column = 0; column < 4; ++column)
+            glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  (void*)(offset + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        for (int column = 0; column < 3; ++column)
+            glVertexAttribPointer(9 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  (void*)(offset + offsetof(InstanceData, normal_matrix) + column * sizeof(glm::vec4)));
+
+        size_t first_index = scene.lod_first_indices[handle*MAX_LODS + lod];
+        size_t num_indices = scene.lod_num_indices[handle*MAX_LODS + lod];
+
+        g_LodDraws[lod] += lod_instances;
+        g_LodTriangles[lod] += lod_instances * (num_indices / 3);
+
+        glDrawElementsInstancedBaseVertex(
+            scene.rendering_modes[handle],
+            num_indices,
+            index_type,
+            (void*)ArenaIndexOffset(g_GeometryArena, scene.arena_meshes[handle], first_index, IndexTypeSize(index_type)),
+            lod_instances,
+            g_GeometryArena.meshes[scene.arena_meshes[handle]].base_vertex
+        );
+    }
+
+    // Desabilitamos os atributos das instâncias, que ficam no estado do VAO,
+    // para que DrawVirtualObject() possa voltar a utilizar o mesmo VAO.
+    for (int location = 3; location <= 11; ++location)
+    {
+        if (location == 7 || location == 8) // 7 não é utilizado; 8 é "draw_id", controlado por FlushDrawBatch()
+            continue;
+        glVertexAttribDivisor(location, 0);
+        glDisableVertexAttribArray(location);
+    }
+    glUniform1i(instanced_uniform, 0);
+}
+
+// Compara o tempo de leitura de um arquivo ".obj" pela tinyobjloader
+// (sequencial) e por LoadObjParallel() com 1, 2, 4, ..., max_threads threads,
+// e verifica se os resultados são idênticos.
+void BenchmarkObjLoader(const char* filename, unsigned int max_threads)
+{
+    typedef std::chrono::steady_clock Clock;
+    const int repetitions = 3;
+
+    uint64_t file_size = 0;
+    int64_t file_mtime = 0;
+    if (!GetFileSizeAndModificationTime(filename, &file_size, &file_mtime))
+    {
+        fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", filename);
+        std::exit(EXIT_FAILURE);
+    }
+    double megabytes = file_size / (1024.0 * 1024.0);
+    printf("Benchmark de leitura de \"%s\" (%.1f MB, melhor de %d execuções):\n", filename, megabytes, repetitions);
+
+    // Referência: tinyobj::LoadObj()
+    tinyobj::attrib_t reference_attrib;
+    std::vector<tinyobj::shape_t> reference_shapes;
+    double reference_time = 0.0;
+    for (int r = 0; r < repetitions; ++r)
+    {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+
+        Clock::time_point start = Clock::now();
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename, NULL, true))
+        {
+            fprintf(stderr, "ERROR: tinyobj::LoadObj() failed: %s\n", err.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+        double time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (r == 0 || time < reference_time)
+            reference_time = time;
+        reference_attrib = attrib;
+        reference_shapes.swap(shapes);
+    }
+    printf("  tinyobj::LoadObj()       : %8.2f ms  %8.1f MB/s\n", 1000.0*reference_time, megabytes/reference_time);
+
+    double single_thread_time = 0.0;
+    for (unsigned int threads = 1; ; threads = std::min(2*threads, max_threads))
+    {
+        double best_time = 0.0;
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        for (int r = 0; r < repetitions; ++r)
+        {
+            std::string err;
+            Clock::time_point start = Clock::now();
+            ObjParseResult result = LoadObjParallel(filename, threads, &attrib, &shapes, &err);
+            double time = std::chrono::duration<double>(Clock::now() - start).count();
+
+            if (result == OBJ_PARSE_UNSUPPORTED)
+            {
+                printf("  O arquivo usa recursos não suportados pelo leitor paralelo.\n");
+                return;
+            }
+            if (result == OBJ_PARSE_ERROR)
+            {
+                fprintf(stderr, "ERROR: LoadObjParallel() failed: %s\n", err.c_str());
+                std::exit(EXIT_FAILURE);
+            }
+            if (r == 0 || time < best_time)
+                best_time = time;
+        }
+        if (threads == 1)
+            single_thread_time = best_time;
+
+        // Conferimos se o resultado é igual ao da tinyobjloader.
+        bool identical = attrib.vertices == reference_attrib.vertices
+                      && attrib.normals == reference_attrib.normals
+                      && attrib.texcoords == reference_attrib.texcoords
+                      && attrib.colors == reference_attrib.colors
+                      && shapes.size() == reference_shapes.size();
+        for (size_t i = 0; identical && i < shapes.size(); ++i)
+        {
+            const tinyobj::mesh_t& a = shapes[i].mesh;
+            const tinyobj::mesh_t& b = reference_shapes[i].mesh;
+            identical = shapes[i].name == reference_shapes[i].name
+                     && a.indices.size() == b.indices.size()
+                     && a.num_face_vertices == b.num_face_vertices
+                     && a.material_ids == b.material_ids
+                     && a.smoothing_group_ids == b.smoothing_group_ids;
+            for (size_t j = 0; identical && j < a.indices.size(); ++j)
+                identical = a.indices[j].vertex_index == b.indices[j].vertex_index
+                         && a.indices[j].normal_index == b.indices[j].normal_index
+                         && a.indices[j].texcoord_index == b.indices[j].texcoord_index;
+        }
+
+        printf("  LoadObjParallel(), %2u thr: %8.2f ms  %8.1f MB/s  %5.2fx tinyobj  %5.2fx 1 thread  %s\n",
+               threads, 1000.0*best_time, megabytes/best_time,
+               reference_time/best_time, single_thread_time/best_time,
+               identical ? "(idêntico)" : "(DIFERENTE!)");
+
+        if (threads >= max_threads)
+            break;
+    }
+}
+
+// Mede a vazão (MB/s) da interpretação de arquivos ".obj" por ScanObjFile().
+// Como os modelos em "data/" são pequenos, criamos um arquivo sintético com
+// aproximadamente "megabytes" MB: os vértices de "filename" seguidos das suas
+// faces repetidas várias vezes. O arquivo é removido ao final.
+void BenchmarkObjTokenizer(const char* filename, size_t megabytes, unsigned int max_threads)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    MappedFile source;
+    if (!MapFile(filename, &source))
+    {
+        fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", filename);
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Separamos as linhas "f" do arquivo original.
+    const char* data = reinterpret_cast<const char*>(source.data);
+    const char* data_end = data + source.size;
+    std::string faces;
+    for (const char* line = data; line < data_end; )
+    {
+        const char* line_end = static_cast<const char*>(memchr(line, '\n', data_end - line));
+        line_end = line_end ? line_end + 1 : data_end;
+        if (line[0] == 'f' && line[1] == ' ')
+            faces.append(line, line_end);
+        line = line_end;
+    }
+
+    std::string synthetic_filename = std::string(filename) + ".synthetic.obj";
+    FILE* file = fopen(synthetic_filename.c_str(), "wb");
+    if (file == NULL || faces.empty())
+    {
+        fprintf(stderr, "ERROR: Cannot create file \"%s\".\n", synthetic_filename.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    printf("Criando \"%s\" com %zu MB...\n", synthetic_filename.c_str(), megabytes);
+    size_t size = fwrite(data, 1, source.size, file);
+    if (source.size > 0 && data[source.size-1] != '\n')
+        size += fwrite("\n", 1, 1, file);
+    UnmapFile(&source);
+    while (size < megabytes * 1024 * 1024)
+        size += fwrite(faces.data(), 1, faces.size(), file);
+    fclose(file);
+
+    double file_megabytes = size / (1024.0 * 1024.0);
+    printf("Benchmark de interpretação de \"%s\" (%.1f MB):\n", synthetic_filename.c_str(), file_megabytes);
+
+    double single_thread_time = 0.0;
+    for (unsigned int threads = 1; ; threads = std::min(2*threads, max_threads))
+    {
+        size_t num_vertices = 0, num_faces = 0;
+        Clock::time_point start = Clock::now();
+        ObjParseResult result = ScanObjFile(synthetic_filename.c_str(), threads, &num_vertices, &num_faces);
+        double time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (result != OBJ_PARSE_OK)
+        {
+            fprintf(stderr, "ERROR: ScanObjFile() failed.\n");
+            break;
+        }
+        if (threads == 1)
+            single_thread_time = time;
+
+        printf("  ScanObjFile(), %2u thr: %8.2f s  %8.1f MB/s  %5.2fx 1 thread  (%zu vértices, %zu faces)\n",
+               threads, time, file_megabytes/time, single_thread_time/time, num_vertices, num_faces);
+
+        if (threads >= max_threads)
+            break;
+    }
+
+    remove(synthetic_filename.c_str());
+}
+
+// Compara o tempo de ComputeVertexNormals() com 1, 2, 4, ..., max_threads
+// threads com o da implementação sequencial original, em uma malha
+// sintética com aproximadamente num_triangles triângulos: uma grade
+// quadrada deformada por ondas senoidais.
+void BenchmarkNormals(size_t num_triangles, unsigned int max_threads)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    size_t n = (size_t)std::sqrt(num_triangles / 2.0) + 2; // Vértices por lado da grade
+    size_t num_vertices = n*n;
+    num_triangles = 2*(n-1)*(n-1);
+
+    std::vector<float> positions(3*num_vertices);
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t j = 0; j < n; ++j)
+        {
+            float x = (float)i / (n-1);
+            float z = (float)j / (n-1);
+            positions[3*(i*n + j) + 0] = x;
+            positions[3*(i*n + j) + 1] = 0.05f * std::sin(40.0f*x) * std::cos(30.0f*z);
+            positions[3*(i*n + j) + 2] = z;
+        }
+    }
+
+    std::vector<uint32_t> triangles;
+    triangles.reserve(3*num_triangles);
+    for (size_t i = 0; i + 1 < n; ++i)
+    {
+        for (size_t j = 0; j + 1 < n; ++j)
+        {
+            uint32_t v00 = i*n + j, v01 = i*n + j+1, v10 = (i+1)*n + j, v11 = (i+1)*n + j+1;
+            uint32_t quad[6] = { v00, v01, v11, v00, v11, v10 };
+            triangles.insert(triangles.end(), quad, quad + 6);
+        }
+    }
+
+    printf("Benchmark de ComputeVertexNormals() (%zu triângulos, %zu vértices):\n", num_triangles, num_vertices);
+
+    std::vector<float> reference(3*num_vertices);
+    Clock::time_point start = Clock::now();
+    ComputeVertexNormalsReference(positions.data(), num_vertices, triangles.data(), num_triangles, reference.data());
+    double reference_time = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("  Referência sequencial  : %8.2f ms\n", 1000.0*reference_time);
+
+    std::vector<float> normals(3*num_vertices);
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        NormalWeighting weighting = (mode == 0) ? NORMAL_WEIGHTING_AREA : NORMAL_WEIGHTING_ANGLE;
+        for (unsigned int threads = 1; ; threads = std::min(2*threads, max_threads))
+        {
+            start = Clock::now();
+            ComputeVertexNormals(positions.data(), num_vertices, triangles.data(), num_triangles, weighting, threads, normals.data());
+            double time = std::chrono::duration<double>(Clock::now() - start).count();
+
+            // Maior ângulo entre a normal computada e a da referência, calculado
+            // como atan2(|a x b|, a . b), que é preciso para ângulos pequenos.
+            double max_error = 0.0;
+            for (size_t v = 0; v < num_vertices; ++v)
+            {
+                glm::dvec3 a(normals[3*v+0], normals[3*v+1], normals[3*v+2]);
+                glm::dvec3 b(reference[3*v+0], reference[3*v+1], reference[3*v+2]);
+                double angle = std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b));
+                max_error = std::max(max_error, glm::degrees(angle));
+            }
+
+            printf("  %s, %2u thr: %8.2f ms  %5.2fx referência  diferença máxima %.2e graus\n",
+                   mode == 0 ? "Área  " : "Ângulo", threads, 1000.0*time, reference_time/time, max_error);
+
+            if (threads >= max_threads)
+                break;
+        }
+    }
+}
+
+// Argumentos das chamadas OpenGL feitas por DrawVirtualObject() para um
+// objeto, acumulados por BenchmarkDrawOverhead() no lugar das chamadas.
+struct DrawArguments
+{
+    uint64_t integers;
+    float    floats;
+
+    void Add(GLuint vertex_array_object_id, const glm::vec3& bbox_min, const glm::vec3& bbox_max,
+             GLenum rendering_mode, size_t num_indices, size_t index_offset)
+    {
+        integers += vertex_array_object_id + rendering_mode + num_indices + index_offset;
+        floats   += bbox_min.x + bbox_min.y + bbox_min.z + bbox_max.x + bbox_max.y + bbox_max.z;
+    }
+};
+
+// Mede o custo de CPU por desenho de num_objects objetos (sem as chamadas
+// OpenGL), comparando o acesso original aos dados de cada objeto (cinco
+// buscas em um std::map<std::string, SceneObject> a partir de um const
+// char*) com uma busca por FindSceneObject() e com o acesso pelo handle.
+void BenchmarkDrawOverhead(size_t num_objects)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const int num_frames = 100;
+
+    // Objetos sintéticos: cubos de 36 índices em VAOs diferentes.
+    std::vector<std::string> names(num_objects);
+    std::map<std::string, SceneObject> scene_map;
+    std::vector<SceneObjectHandle> handles(num_objects);
+    for (size_t i = 0; i < num_objects; ++i)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "object_%06lu", (unsigned long)i);
+        names[i] = name;
+
+        SceneObject object;
+        object.name           = name;
+        object.first_index    = 36*i;
+        object.num_indices    = 36;
+        object.rendering_mode = GL_TRIANGLES;
+        object.index_type     = GL_UNSIGNED_SHORT;
+        object.vertex_array_object_id = GLuint(i + 1);
+        object.arena_mesh = 0;
+        object.bbox_min = glm::vec3(float(i), 0.0f, 0.0f);
+        object.bbox_max = glm::vec3(float(i) + 1.0f, 1.0f, 1.0f);
+        object.quantized_positions = true;
+        object.resident = true;
+        object.num_lods = 1;
+        object.lod_first_index[0] = object.first_index;
+        object.lod_num_indices[0] = object.num_indices;
+        object.current_lod = 0;
+
+        scene_map[name] = object;
+        handles[i] = FindSceneObject(name);
+        SetSceneObject(handles[i], object);
+    }
+
+    printf("Benchmark do custo de CPU por desenho (%lu objetos, %d quadros, sem chamadas OpenGL):\n",
+           (unsigned long)num_objects, num_frames);
+
+    volatile uint64_t sink = 0;
+    double reference_time = 0.0;
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        DrawArguments arguments = { 0, 0.0f };
+
+        Clock::time_point start = Clock::now();
+        for (int frame = 0; frame < num_frames; ++frame)
+        {
+            for (size_t i = 0; i < num_objects; ++i)
+            {
+                if (mode == 0)
+                {
+                    // Como no DrawVirtualObject() original.
+                    const char* object_name = names[i].c_str();
+                    arguments.Add(scene_map[object_name].vertex_array_object_id,
+                                  scene_map[object_name].bbox_min,
+                                  scene_map[object_name].bbox_max,
+                                  scene_map[object_name].rendering_mode,
+                                  scene_map[object_name].num_indices,
+                                  scene_map[object_name].first_index * sizeof(GLushort));
+                }
+                else
+                {
+                    SceneObjectHandle handle = (mode == 1) ? FindSceneObject(names[i].c_str()) : handles[i];
+                    const VirtualScene& scene = g_VirtualScene;
+                    arguments.Add(scene.vertex_array_object_ids[handle],
+                                  scene.bbox_mins[handle],
+                                  scene.bbox_maxs[handle],
+                                  scene.rendering_modes[handle],
+                                  scene.lod_num_indices[handle*MAX_LODS],
+                                  scene.lod_first_indices[handle*MAX_LODS] * IndexTypeSize(scene.index_types[handle]));
+                }
+            }
+        }
+        double time = std::chrono::duration<double>(Clock::now() - start).count();
+        sink = sink + arguments.integers + (uint64_t)arguments.floats;
+
+        if (mode == 0)
+            reference_time = time;
+
+        static const char* mode_names[3] = {
+            "std::map, 5 buscas por nome",
+            "FindSceneObject() por nome ",
+            "Handle                     ",
+        };
+        printf("  %s: %8.2f ns/desenho  %8.3f ms/quadro  %6.2fx\n", mode_names[mode],
+               1e9*time / (double(num_frames) * num_objects), 1000.0*time / num_frames, reference_time/time);
+    }
+}
+
+// Mede o custo de CPU do frustum culling (veja "culling.h") para 1000,
+// 10000, ... até max_objects objetos espalhados em um quadrado no plano XZ,
+// com a câmera no centro olhando para -Z: a transformação das bboxes pelas
+// matrizes model e o teste contra o frustum, com CullBoundingBoxesScalar() e
+// com CullBoundingBoxes().
+void BenchmarkFrustumCulling(size_t max_objects)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    printf("Benchmark de frustum culling (ns/objeto):\n");
+    printf("  %9s %9s %12s %12s %12s %8s\n", "Objetos", "Visíveis", "Transformar", "Escalar", "SSE", "Speedup");
+
+    const glm::vec3 bbox_min(-0.5f, -0.5f, -0.5f);
+    const glm::vec3 bbox_max( 0.5f,  0.5f,  0.5f);
+
+    size_t num_objects = std::min<size_t>(1000, max_objects);
+    while (true)
+    {
+        // Objetos com posição, rotação e escala sorteadas por um gerador
+        // congruencial linear. A densidade é a mesma para todos os tamanhos.
+        float side = 2.5f * std::sqrt((float)num_objects);
+        std::vector<glm::mat4> models(num_objects);
+        uint32_t random = 12345;
+        for (size_t i = 0; i < num_objects; ++i)
+        {
+            float values[4];
+            for (int k = 0; k < 4; ++k)
+            {
+                random = random * 1664525u + 1013904223u;
+                values[k] = (random >> 8) * (1.0f / 16777216.0f);
+            }
+            float scale = 0.5f + 1.5f*values[3];
+            models[i] = Matrix_Translate((values[0] - 0.5f)*side, 0.0f, (values[1] - 0.5f)*side)
+                      * Matrix_Rotate_Y(6.2831853f * values[2])
+                      * Matrix_Scale(scale, scale, scale);
+        }
+
+        glm::vec4 camera_position = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+        glm::mat4 view = Matrix_Camera_View(camera_position, glm::vec4(0.0f, 0.0f, -1.0f, 0.0f), glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+        glm::mat4 projection = Matrix_Perspective(3.141592f / 3.0f, 16.0f / 9.0f, -0.1f, -0.5f*side);
+        glm::vec4 planes[6];
+        ExtractFrustumPlanes(projection * view, planes);
+
+        // Repetimos as medidas para que cada uma leve algumas dezenas de
+        // milissegundos.
+        int num_repeats = (int)std::max<size_t>(1, 4000000 / num_objects);
+
+        BoundingBoxes boxes;
+        Clock::time_point start = Clock::now();
+        for (int repeat = 0; repeat < num_repeats; ++repeat)
+        {
+            ClearBoundingBoxes(&boxes);
+            for (size_t i = 0; i < num_objects; ++i)
+            {
+                glm::vec3 center, extent;
+                TransformBoundingBox(models[i], bbox_min, bbox_max, &center, &extent);
+                AddBoundingBox(&boxes, center, extent);
+            }
+        }
+        double transform_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::vector<unsigned char> visible_scalar(num_objects);
+        std::vector<unsigned char> visible_simd(num_objects);
+        size_t num_visible_scalar = 0;
+        size_t num_visible_simd = 0;
+
+        start = Clock::now();
+        for (int repeat = 0; repeat < num_repeats; ++repeat)
+            num_visible_scalar = CullBoundingBoxesScalar(planes, boxes, visible_scalar.data());
+        double scalar_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        start = Clock::now();
+        for (int repeat = 0; repeat < num_repeats; ++repeat)
+            num_visible_simd = CullBoundingBoxes(planes, boxes, visible_simd.data());
+        double simd_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (num_visible_scalar != num_visible_simd || visible_scalar != visible_simd)
+            fprintf(stderr, "WARNING: CullBoundingBoxes() and CullBoundingBoxesScalar() disagree.\n");
+
+        double scale = 1e9 / (double(num_repeats) * num_objects);
+        printf("  %9lu %8.1f%% %12.2f %12.2f %12.2f %7.2fx\n", (unsigned long)num_objects,
+               100.0 * num_visible_simd / num_objects,
+               transform_time * scale, scalar_time * scale, simd_time * scale, scalar_time / simd_time);
+
+        if (num_objects >= max_objects)
+            break;
+        num_objects = std::min(num_objects * 10, max_objects);
+    }
+}
+
+// Mede o custo, por objeto, das normal matrices de "normalmatrix.h" para
+// 1000, 10000, ... até max_objects objetos: com glm::inverse(glm::transpose())
+// de cada matriz 4x4 (a mesma conta que o vertex shader fazia para cada
+// vértice), com ComputeNormalMatricesScalar() e com ComputeNormalMatrices().
+// Verifica também a diferença entre os resultados.
+void BenchmarkNormalMatrices(size_t max_objects)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    printf("Benchmark de normal matrices (ns/objeto):\n");
+    printf("  %9s %18s %12s %12s %8s %10s\n", "Objetos", "inverse(transpose)", "Escalar", "SSE", "Speedup", "Erro");
+
+    size_t num_objects = std::min<size_t>(1000, max_objects);
+    while (true)
+    {
+        // Matrizes com translação, rotação e escala não uniforme sorteadas
+        // por um gerador congruencial linear.
+        std::vector<glm::mat4> models(num_objects);
+        uint32_t random = 12345;
+        for (size_t i = 0; i < num_objects; ++i)
+        {
+            float values[6];
+            for (int k = 0; k < 6; ++k)
+            {
+                random = random * 1664525u + 1013904223u;
+                values[k] = (random >> 8) * (1.0f / 16777216.0f);
+            }
+            models[i] = Matrix_Translate(100.0f*values[0], 0.0f, 100.0f*values[1])
+                      * Matrix_Rotate_Y(6.2831853f * values[2])
+                      * Matrix_Rotate_X(6.2831853f * values[3])
+                      * Matrix_Scale(0.5f + values[4], 0.5f + values[5], 1.0f);
+        }
+
+        int num_repeats = (int)std::max<size_t>(1, 4000000 / num_objects);
+
+        std::vector<glm::mat4> reference(num_objects);
+        Clock::time_point start = Clock::now();
+        for (int repeat = 0; repeat < num_repeats; ++repeat)
+            for (size_t i = 0; i < num_objects; ++i)
+                reference[i] = glm::inverse(glm::transpose(models[i]));
+        double reference_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::vector<glm::mat3x4> normal_scalar(num_objects);
+        std::vector<glm::mat3x4> normal_simd(num_objects);
+
+        start = Clock::now();
+        for (int repeat = 0; repeat < num_repeats; ++repeat)
+            ComputeNormalMatricesScalar(models.data(), sizeof(glm::mat4), normal_scalar.data(), sizeof(glm::mat3x4), num_objects);
+        double scalar_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        start = Clock::now();
+        for (int repeat = 0; repeat < num_repeats; ++repeat)
+            ComputeNormalMatrices(models.data(), sizeof(glm::mat4), normal_simd.data(), sizeof(glm::mat3x4), num_objects);
+        double simd_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        // Maior diferença entre as 3 primeiras linhas de cada coluna da
+        // referência e os dois resultados.
+        float max_error = 0.0f;
+        for (size_t i = 0; i < num_objects; ++i)
+            for (int c = 0; c < 3; ++c)
+                for (int r = 0; r < 4; ++r)
+                {
+                    float expected = (r < 3) ? reference[i][c][r] : 0.0f;
+                    max_error = std::max(max_error, std::fabs(normal_scalar[i][c][r] - expected));
+                    max_error = std::max(max_error, std::fabs(normal_simd[i][c][r] - expected));
+                }
+
+        double scale = 1e9 / (double(num_repeats) * num_objects);
+        printf("  %9lu %18.2f %12.2f %12.2f %7.2fx %10.2g\n", (unsigned long)num_objects,
+               reference_time * scale, scalar_time * scale, simd_time * scale, reference_time / simd_time, max_error);
+
+        if (num_objects >= max_objects)
+            break;
+        num_objects = std::min(num_objects * 10, max_objects);
+    }
+}
+
+// Posiciona num_objects objetos em uma grade quadrada no plano XZ, com tipo
+// (0, 1 ou 2) e rotação sorteados por um gerador congruencial linear, para
+// que a ordem de desenho não agrupe os objetos por tipo. Retorna também uma
+// câmera vendo toda a grade de cima, em diagonal. Utilizada pelos benchmarks
+// de desenho.
+void BuildBenchmarkGrid(size_t num_objects, std::vector<glm::mat4>* models, std::vector<int>* kinds, glm::mat4* view, glm::mat4* projection)
+{
+    size_t side = (size_t)std::ceil(std::sqrt((double)num_objects));
+    float spacing = 2.5f;
+    models->resize(num_objects);
+    kinds->resize(num_objects);
+    uint32_t random = 12345;
+    for (size_t i = 0; i < num_objects; ++i)
+    {
+        random = random * 1664525u + 1013904223u;
+        (*kinds)[i] = (random >> 16) % 3;
+        random = random * 1664525u + 1013904223u;
+        float angle = (random >> 8) * (6.2831853f / 16777216.0f);
+
+        float x = (float(i % side) - side/2.0f) * spacing;
+        float z = (float(i / side) - side/2.0f) * spacing;
+        (*models)[i] = Matrix_Translate(x, 0.0f, z) * Matrix_Rotate_Y(angle);
+    }
+
+    float distance = side * spacing;
+    glm::vec4 camera_position = glm::vec4(0.0f, 0.5f*distance, distance, 1.0f);
+    glm::vec4 camera_view = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) - camera_position;
+    *view = Matrix_Camera_View(camera_position, camera_view, glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+    *projection = Matrix_Perspective(3.141592f / 3.0f, g_ScreenRatio, -0.1f, -4.0f*distance);
+}
+
+// Compara o tempo de CPU por quadro para desenhar num_objects objetos
+// (esferas, coelhos e planos, na ordem dos handles dados) em ordem aleatória
+// com DrawVirtualObject(), como feito originalmente em main(), e com a fila
+// de desenho. Compara também RadixSortDrawKeys() com std::sort(). Precisa do
+// contexto OpenGL e dos modelos já carregados.
+void BenchmarkRenderQueue(size_t num_objects, const SceneObjectHandle* handles, uint32_t texture_set)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const int num_frames = 50;
+
+    std::vector<glm::mat4> models;
+    std::vector<int> kinds;
+    glm::mat4 view, projection;
+    BuildBenchmarkGrid(num_objects, &models, &kinds, &view, &projection);
+
+    // Variante dos shaders de cada tipo de objeto (esfera, coelho e plano).
+    GLuint programs[3];
+    for (int kind = 0; kind < 3; ++kind)
+        programs[kind] = GetShaderVariant(SceneObjectShaderFeatures(kind), true);
+
+    printf("Benchmark da fila de desenho (%lu objetos, %d quadros):\n", (unsigned long)num_objects, num_frames);
+
+    double reference_time = 0.0;
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        double cpu_time = 0.0;
+        double frame_time = 0.0;
+        for (int frame = 0; frame < num_frames; ++frame)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glFinish();
+
+            Clock::time_point start = Clock::now();
+            if (mode == 0)
+            {
+                SetFrameUniforms(ComputeFrameUniforms(view, projection));
+                for (size_t i = 0; i < num_objects; ++i)
+                {
+                    UseGpuProgram(programs[kinds[i]]);
+                    DrawVirtualObject(handles[kinds[i]], models[i], projection * view);
+                }
+                AdvanceUniformRing();
+            }
+            else
+            {
+                BeginRenderQueue(ComputeFrameUniforms(view, projection));
+                for (size_t i = 0; i < num_objects; ++i)
+                    SubmitDrawItem(programs[kinds[i]], texture_set, handles[kinds[i]], uint32_t(i), models[i]);
+                FlushRenderQueue();
+            }
+            Clock::time_point submitted = Clock::now();
+            glFinish();
+            Clock::time_point finished = Clock::now();
+
+            cpu_time   += std::chrono::duration<double>(submitted - start).count();
+            frame_time += std::chrono::duration<double>(finished - start).count();
+        }
+
+        if (mode == 0)
+            reference_time = cpu_time;
+
+        printf("  %s: CPU %8.3f ms/quadro  %5.2fx   com glFinish() %8.3f ms/quadro\n",
+               mode == 0 ? "DrawVirtualObject()" : "Fila de desenho    ",
+               1000.0*cpu_time / num_frames, reference_time / cpu_time, 1000.0*frame_time / num_frames);
+    }
+
+    // Trocas de estado por quadro. DrawVirtualObject() liga e desliga o VAO
+    // e envia e liga um bloco ObjectUniforms a cada desenho.
+    const RenderQueueStatistics& statistics = GetRenderQueueStatistics();
+    printf("  Trocas de estado por quadro (feitas / evitadas pela fila; DrawVirtualObject() faz todas):\n");
+    printf("    Programas: %6lu / %6lu\n", (unsigned long)statistics.program_binds, (unsigned long)statistics.program_binds_skipped);
+    printf("    Texturas : %6lu / %6lu\n", (unsigned long)statistics.texture_binds, (unsigned long)statistics.texture_binds_skipped);
+    printf("    VAOs     : %6lu / %6lu   (DrawVirtualObject(): %lu)\n", (unsigned long)statistics.vao_binds, (unsigned long)statistics.vao_binds_skipped, (unsigned long)(2*num_objects));
+    printf("    Uniforms : %6lu            (DrawVirtualObject(): %lu)\n", (unsigned long)statistics.uniform_writes, (unsigned long)num_objects);
+    printf("    Esperas pelo buffer de dados \"uniform\": %lu\n", (unsigned long)UniformRingStalls());
+
+    // Ordenação das chaves de um quadro.
+    BeginRenderQueue(ComputeFrameUniforms(view, projection));
+    for (size_t i = 0; i < num_objects; ++i)
+        SubmitDrawItem(programs[kinds[i]], texture_set, handles[kinds[i]], uint32_t(i), models[i]);
+
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order(num_objects);
+    std::vector<uint64_t> temp_keys;
+    std::vector<uint32_t> temp_order;
+    double radix_time = 0.0;
+    double std_sort_time = 0.0;
+    for (int frame = 0; frame < num_frames; ++frame)
+    {
+        keys = GetRenderQueueKeys();
+        Clock::time_point start = Clock::now();
+        RadixSortDrawKeys(keys.data(), order.data(), keys.size(), &temp_keys, &temp_order);
+        radix_time += std::chrono::duration<double>(Clock::now() - start).count();
+
+        keys = GetRenderQueueKeys();
+        start = Clock::now();
+        std::sort(keys.begin(), keys.end());
+        std_sort_time += std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    printf("  Ordenação das chaves: RadixSortDrawKeys() %.1f us, std::sort() %.1f us\n",
+           1e6*radix_time / num_frames, 1e6*std_sort_time / num_frames);
+}
+
+// Compara o tempo por quadro para desenhar num_instances cópias de um
+// objeto (em geral o coelho) com uma chamada de DrawVirtualObject() por
+// cópia e com uma única chamada de DrawVirtualObjectInstanced(). Precisa do
+// contexto OpenGL e do modelo já carregado.
+void BenchmarkInstancing(size_t num_instances, SceneObjectHandle handle, GLint object_id)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const int num_frames = 10;
+
+    std::vector<glm::mat4> models;
+    std::vector<int> kinds;
+    glm::mat4 view, projection;
+    BuildBenchmarkGrid(num_instances, &models, &kinds, &view, &projection);
+    glm::mat4 view_projection = projection * view;
+
+    std::vector<InstanceData> instances(num_instances);
+    for (size_t i = 0; i < num_instances; ++i)
+        instances[i].model = models[i];
+    ComputeNormalMatrices(&instances[0].model, sizeof(InstanceData),
+                          &instances[0].normal_matrix, sizeof(InstanceData), num_instances);
+
+    printf("Benchmark de instancing (%lu instâncias, %d quadros):\n", (unsigned long)num_instances, num_frames);
+
+    GLuint program = GetShaderVariant(SceneObjectShaderFeatures(object_id), true);
+    UseGpuProgram(program);
+    GLint instanced_uniform = glGetUniformLocation(program, "instanced"); // Variável "instanced" em shader_vertex.glsl
+
+    double reference_time = 0.0;
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        double cpu_time = 0.0;
+        double frame_time = 0.0;
+        for (int frame = 0; frame < num_frames; ++frame)
+        {
+            std::fill(g_LodDraws, g_LodDraws + MAX_LODS, 0);
+            std::fill(g_LodTriangles, g_LodTriangles + MAX_LODS, 0);
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glFinish();
+
+            Clock::time_point start = Clock::now();
+            SetFrameUniforms(ComputeFrameUniforms(view, projection));
+            if (mode == 0)
+            {
+                for (size_t i = 0; i < num_instances; ++i)
+                    DrawVirtualObject(handle, models[i], view_projection);
+            }
+            else
+            {
+                DrawVirtualObjectInstanced(handle, instances.data(), num_instances, view_projection, instanced_uniform);
+            }
+            AdvanceUniformRing();
+            Clock::time_point submitted = Clock::now();
+            glFinish();
+            Clock::time_point finished = Clock::now();
+
+            cpu_time   += std::chrono::duration<double>(submitted - start).count();
+            frame_time += std::chrono::duration<double>(finished - start).count();
+        }
+
+        if (mode == 0)
+            reference_time = frame_time;
+
+        size_t triangles = 0;
+        for (int lod = 0; lod < MAX_LODS; ++lod)
+            triangles += g_LodTriangles[lod];
+
+        printf("  %s: CPU %8.3f ms/quadro   com glFinish() %8.3f ms/quadro  %6.2fx   %lu triângulos\n",
+               mode == 0 ? "DrawVirtualObject()         " : "DrawVirtualObjectInstanced()",
+               1000.0*cpu_time / num_frames, 1000.0*frame_time / num_frames, reference_time / frame_time,
+               (unsigned long)triangles);
+    }
+}
+
+// Mede o tempo de CPU por quadro da fila de desenho com e sem lotes (veja
+// FlushDrawBatch()), variando o número de objetos (até max_objects) e o
+// número de malhas diferentes entre eles (1 a 3: esfera, coelho e plano).
+// Sem lotes, o número de chamadas de desenho cresce com o número de
+// objetos; com lotes, somente com o número de malhas e LODs utilizados.
+// Precisa do contexto OpenGL e dos modelos já carregados.
+void BenchmarkDrawBatching(size_t max_objects, const SceneObjectHandle* handles, uint32_t texture_set)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const int num_frames = 20;
+
+    printf("Benchmark dos lotes da fila de desenho (%d quadros):\n", num_frames);
+    printf("  objetos malhas | sem lotes: CPU ms/quadro chamadas | com lotes: CPU ms/quadro chamadas | speedup\n");
+
+    bool use_draw_batching = g_UseDrawBatching;
+    for (size_t num_objects = std::max<size_t>(1, max_objects / 16); ; num_objects = std::min(max_objects, 4 * num_objects))
+    {
+        std::vector<glm::mat4> models;
+        std::vector<int> kinds;
+        glm::mat4 view, projection;
+        BuildBenchmarkGrid(num_objects, &models, &kinds, &view, &projection);
+
+        for (int num_meshes = 1; num_meshes <= 3; ++num_meshes)
+        {
+            double cpu_time[2];
+            size_t draw_calls[2];
+            for (int mode = 0; mode < 2; ++mode)
+            {
+                g_UseDrawBatching = (mode == 1);
+                cpu_time[mode] = 0.0;
+                for (int frame = 0; frame < num_frames; ++frame)
+                {
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    glFinish();
+
+                    Clock::time_point start = Clock::now();
+                    BeginRenderQueue(ComputeFrameUniforms(view, projection));
+                    for (size_t i = 0; i < num_objects; ++i)
+                    {
+                        int kind = kinds[i] % num_meshes;
+                        SubmitDrawItem(GetShaderVariant(SceneObjectShaderFeatures(kind), true), texture_set, handles[kind], uint32_t(i), models[i]);
+                    }
+                    FlushRenderQueue();
+                    cpu_time[mode] += std::chrono::duration<double>(Clock::now() - start).count();
+                }
+
+                const RenderQueueStatistics& statistics = GetRenderQueueStatistics();
+                draw_calls[mode] = statistics.draws - statistics.batched_items + statistics.batches;
+            }
+
+            printf("  %7lu %6d | %14.3f %9lu | %14.3f %9lu | %6.2fx\n",
+                   (unsigned long)num_objects, num_meshes,
+                   1000.0*cpu_time[0] / num_frames, (unsigned long)draw_calls[0],
+                   1000.0*cpu_time[1] / num_frames, (unsigned long)draw_calls[1],
+                   cpu_time[0] / cpu_time[1]);
+        }
+
+        if (num_objects == max_objects)
+            break;
+    }
+    g_UseDrawBatching = use_draw_batching;
+}
+
+// Mede o tempo de CPU por quadro do texto mostrado na tela (veja
+// DrawTextOverlay()), mais as matrizes de TextRendering_ShowModelViewProjection(),
+// com centenas de caracteres, com o cache de estado de "glstate.h"
+// desabilitado e habilitado, e o número de chamadas descartadas pelo cache.
+void BenchmarkTextOverlay(GLFWwindow* window, int num_frames)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    printf("Benchmark do texto na tela (%d quadros):\n", num_frames);
+
+    glm::mat4 model = Matrix_Rotate_Y(0.5f);
+    glm::mat4 view = Matrix_Camera_View(glm::vec4(0.0f, 1.0f, 3.0f, 1.0f), glm::vec4(0.0f, -1.0f, -3.0f, 0.0f), glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+    glm::mat4 projection = Matrix_Perspective(3.141592f / 3.0f, g_ScreenRatio, -0.1f, -10.0f);
+
+    g_ShowInfoText = true;
+    double reference_time = 0.0;
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        GLState_SetEnabled(mode == 1);
+        GLState_Invalidate();
+
+        double cpu_time = 0.0;
+        double frame_time = 0.0;
+        GLStateStatistics statistics = { 0, 0 };
+        for (int frame = 0; frame < num_frames; ++frame)
+        {
+            // Como no laço de renderização, a cena define o seu estado
+            // antes do texto do quadro.
+            GLState_Disable(GL_BLEND);
+            GLState_DepthFunc(GL_LESS);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glFinish();
+            GLState_ResetStatistics();
+
+            Clock::time_point start = Clock::now();
+            DrawTextOverlay(window);
+            TextRendering_ShowModelViewProjection(window, projection, view, model, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+            TextRendering_Flush();
+            Clock::time_point submitted = Clock::now();
+            glFinish();
+            Clock::time_point finished = Clock::now();
+
+            GLStateStatistics frame_statistics = GLState_Statistics();
+            statistics.calls  += frame_statistics.calls;
+            statistics.elided += frame_statistics.elided;
+            cpu_time   += std::chrono::duration<double>(submitted - start).count();
+            frame_time += std::chrono::duration<double>(finished - start).count();
+        }
+
+        if (mode == 0)
+            reference_time = cpu_time;
+
+        printf("  %s: CPU %8.3f ms/quadro   com glFinish() %8.3f ms/quadro  %6.2fx   %6lu chamadas %6lu descartadas/quadro\n",
+               mode == 0 ? "sem cache" : "com cache",
+               1000.0*cpu_time / num_frames, 1000.0*frame_time / num_frames, reference_time / cpu_time,
+               (unsigned long)(statistics.calls / num_frames), (unsigned long)(statistics.elided / num_frames));
+    }
+    GLState_SetEnabled(true);
+}
+
+} // namespace
+
+bool ParseBenchmarkOption(int argc, char* argv[], int* i, BenchmarkOptions* options)
+{
+    if (*i + 1 >= argc || strncmp(argv[*i], "--benchmark-", 12) != 0)
+        return false;
+
+    const char* option = argv[*i];
+    const char* value = argv[*i + 1];
+    if (strcmp(option, "--benchmark-obj-loader") == 0)
+        options->obj_filename = value;
+    else if (strcmp(option, "--benchmark-obj-tokenizer") == 0)
+        options->tokenizer_megabytes = atoi(value);
+    else if (strcmp(option, "--benchmark-normals") == 0)
+        options->normals_millions = atoi(value);
+    else if (strcmp(option, "--benchmark-draw-overhead") == 0)
+        options->draw_objects = atoi(value);
+    else if (strcmp(option, "--benchmark-culling") == 0)
+        options->culling_objects = atoi(value);
+    else if (strcmp(option, "--benchmark-normal-matrices") == 0)
+        options->normal_matrix_objects = atoi(value);
+    else if (strcmp(option, "--benchmark-render-queue") == 0)
+        options->render_queue_objects = atoi(value);
+    else if (strcmp(option, "--benchmark-instancing") == 0)
+        options->instances = atoi(value);
+    else if (strcmp(option, "--benchmark-batching") == 0)
+        options->batching_objects = atoi(value);
+    else if (strcmp(option, "--benchmark-text-overlay") == 0)
+        options->text_frames = atoi(value);
+    else
+        return false;
+
+    *i += 1;
+    return true;
+}
+
+bool RunStandaloneBenchmark(const BenchmarkOptions& options, unsigned int obj_threads, unsigned int normal_threads)
+{
+    if (options.obj_filename != NULL)
+        BenchmarkObjLoader(options.obj_filename, obj_threads);
+    else if (options.tokenizer_megabytes > 0)
+        BenchmarkObjTokenizer("../../data/bunny.obj", options.tokenizer_megabytes, obj_threads);
+    else if (options.normals_millions > 0)
+        BenchmarkNormals(options.normals_millions * size_t(1000000), normal_threads);
+    else if (options.draw_objects > 0)
+        BenchmarkDrawOverhead(options.draw_objects);
+    else if (options.culling_objects > 0)
+        BenchmarkFrustumCulling(options.culling_objects);
+    else if (options.normal_matrix_objects > 0)
+        BenchmarkNormalMatrices(options.normal_matrix_objects);
+    else
+        return false;
+    return true;
+}
+
+bool HasSceneBenchmark(const BenchmarkOptions& options)
+{
+    return options.render_queue_objects > 0 || options.instances > 0
+        || options.batching_objects > 0 || options.text_frames > 0;
+}
+
+bool RunSceneBenchmark(const BenchmarkOptions& options, GLFWwindow* window, const SceneObjectHandle handles[3], uint32_t texture_set)
+{
+    if (options.render_queue_objects > 0)
+        BenchmarkRenderQueue(options.render_queue_objects, handles, texture_set);
+    else if (options.instances > 0)
+        BenchmarkInstancing(options.instances, handles[1], 1); // O coelho (object_id 1)
+    else if (options.batching_objects > 0)
+        BenchmarkDrawBatching(options.batching_objects, handles, texture_set);
+    else if (options.text_frames > 0)
+        BenchmarkTextOverlay(window, options.text_frames);
+    else
+        return false;
+    return true;
+}
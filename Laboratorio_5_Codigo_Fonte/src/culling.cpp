@@ -0,0 +1,170 @@
+// Descarte de objetos fora do frustum. Veja "include/culling.h".
+//
+// Uma caixa (centro c, metade do tamanho e) está totalmente fora do frustum
+// se, para algum plano (n,d), até o vértice da caixa mais "para dentro" do
+// plano fica do lado de fora: dot(n,c) + d + dot(|n|,e) < 0. Com as caixas
+// no formato SoA, cada registrador SSE guarda uma coordenada de 4 caixas, e
+// cada iteração testa 8 caixas (2 registradores por coordenada) contra os 6
+// planos.
+#include "culling.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CULLING_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+// Testa a caixa i contra os planos, sem SIMD.
+inline bool IsBoxVisible(const glm::vec4 planes[6], const BoundingBoxes& boxes, size_t i)
+{
+    for (int p = 0; p < 6; ++p)
+    {
+        const glm::vec4& plane = planes[p];
+        float distance = plane.x * boxes.center_x[i] + plane.y * boxes.center_y[i] + plane.z * boxes.center_z[i] + plane.w;
+        float radius = std::fabs(plane.x) * boxes.extent_x[i] + std::fabs(plane.y) * boxes.extent_y[i] + std::fabs(plane.z) * boxes.extent_z[i];
+        if (distance + radius < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void ExtractFrustumPlanes(const glm::mat4& view_projection, glm::vec4 planes[6])
+{
+    // As matrizes do GLM são "column-major": view_projection[c][r] é o
+    // elemento da linha r e coluna c. Um ponto está dentro do frustum se as
+    // suas coordenadas de recorte satisfazem -w <= x,y,z <= w; cada uma das
+    // 6 desigualdades é um plano, combinação da linha 3 com as linhas 0, 1
+    // ou 2 da matriz.
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; ++r)
+        rows[r] = glm::vec4(view_projection[0][r], view_projection[1][r], view_projection[2][r], view_projection[3][r]);
+
+    planes[0] = rows[3] + rows[0]; // Esquerda
+    planes[1] = rows[3] - rows[0]; // Direita
+    planes[2] = rows[3] + rows[1]; // Baixo
+    planes[3] = rows[3] - rows[1]; // Cima
+    planes[4] = rows[3] + rows[2]; // Perto ou longe, dependendo da convenção da matriz
+    planes[5] = rows[3] - rows[2];
+}
+
+void TransformBoundingBox(const glm::mat4& model, const glm::vec3& bbox_min, const glm::vec3& bbox_max,
+                          glm::vec3* center, glm::vec3* extent)
+{
+    glm::vec3 local_center = (bbox_min + bbox_max) * 0.5f;
+    glm::vec3 local_extent = (bbox_max - bbox_min) * 0.5f;
+
+    glm::vec4 world_center = model * glm::vec4(local_center, 1.0f);
+    *center = glm::vec3(world_center.x, world_center.y, world_center.z);
+
+    // Cada coordenada da nova metade do tamanho é a soma das projeções das
+    // 3 metades dos lados transformadas, em módulo.
+    for (int r = 0; r < 3; ++r)
+        (*extent)[r] = std::fabs(model[0][r]) * local_extent.x
+                     + std::fabs(model[1][r]) * local_extent.y
+                     + std::fabs(model[2][r]) * local_extent.z;
+}
+
+void ClearBoundingBoxes(BoundingBoxes* boxes)
+{
+    boxes->center_x.clear();
+    boxes->center_y.clear();
+    boxes->center_z.clear();
+    boxes->extent_x.clear();
+    boxes->extent_y.clear();
+    boxes->extent_z.clear();
+}
+
+void AddBoundingBox(BoundingBoxes* boxes, const glm::vec3& center, const glm::vec3& extent)
+{
+    boxes->center_x.push_back(center.x);
+    boxes->center_y.push_back(center.y);
+    boxes->center_z.push_back(center.z);
+    boxes->extent_x.push_back(extent.x);
+    boxes->extent_y.push_back(extent.y);
+    boxes->extent_z.push_back(extent.z);
+}
+
+size_t CullBoundingBoxes(const glm::vec4 planes[6], const BoundingBoxes& boxes, unsigned char* visible)
+{
+    size_t count = boxes.center_x.size();
+    size_t num_visible = 0;
+    size_t i = 0;
+
+#ifdef CULLING_SSE2
+    // Componentes dos planos e os seus módulos, repetidos nas 4 posições
+    // dos registradores.
+    __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+    __m128 abs_x[6], abs_y[6], abs_z[6];
+    for (int p = 0; p < 6; ++p)
+    {
+        plane_x[p] = _mm_set1_ps(planes[p].x);
+        plane_y[p] = _mm_set1_ps(planes[p].y);
+        plane_z[p] = _mm_set1_ps(planes[p].z);
+        plane_w[p] = _mm_set1_ps(planes[p].w);
+        abs_x[p]   = _mm_set1_ps(std::fabs(planes[p].x));
+        abs_y[p]   = _mm_set1_ps(std::fabs(planes[p].y));
+        abs_z[p]   = _mm_set1_ps(std::fabs(planes[p].z));
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 cx0 = _mm_loadu_ps(&boxes.center_x[i]), cx1 = _mm_loadu_ps(&boxes.center_x[i + 4]);
+        __m128 cy0 = _mm_loadu_ps(&boxes.center_y[i]), cy1 = _mm_loadu_ps(&boxes.center_y[i + 4]);
+        __m128 cz0 = _mm_loadu_ps(&boxes.center_z[i]), cz1 = _mm_loadu_ps(&boxes.center_z[i + 4]);
+        __m128 ex0 = _mm_loadu_ps(&boxes.extent_x[i]), ex1 = _mm_loadu_ps(&boxes.extent_x[i + 4]);
+        __m128 ey0 = _mm_loadu_ps(&boxes.extent_y[i]), ey1 = _mm_loadu_ps(&boxes.extent_y[i + 4]);
+        __m128 ez0 = _mm_loadu_ps(&boxes.extent_z[i]), ez1 = _mm_loadu_ps(&boxes.extent_z[i + 4]);
+
+        // Bits iguais a 1 nas caixas fora de algum plano.
+        __m128 outside0 = zero;
+        __m128 outside1 = zero;
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 d0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x[p], cx0), _mm_mul_ps(plane_y[p], cy0)),
+                                   _mm_add_ps(_mm_mul_ps(plane_z[p], cz0), plane_w[p]));
+            __m128 d1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x[p], cx1), _mm_mul_ps(plane_y[p], cy1)),
+                                   _mm_add_ps(_mm_mul_ps(plane_z[p], cz1), plane_w[p]));
+            __m128 r0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(abs_x[p], ex0), _mm_mul_ps(abs_y[p], ey0)), _mm_mul_ps(abs_z[p], ez0));
+            __m128 r1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(abs_x[p], ex1), _mm_mul_ps(abs_y[p], ey1)), _mm_mul_ps(abs_z[p], ez1));
+            outside0 = _mm_or_ps(outside0, _mm_cmplt_ps(_mm_add_ps(d0, r0), zero));
+            outside1 = _mm_or_ps(outside1, _mm_cmplt_ps(_mm_add_ps(d1, r1), zero));
+        }
+
+        int mask = _mm_movemask_ps(outside0) | (_mm_movemask_ps(outside1) << 4);
+        for (int k = 0; k < 8; ++k)
+        {
+            unsigned char v = (mask >> k) & 1 ? 0 : 1;
+            visible[i + k] = v;
+            num_visible += v;
+        }
+    }
+#endif
+
+    // Caixas restantes (ou todas, sem SSE).
+    for (; i < count; ++i)
+    {
+        visible[i] = IsBoxVisible(planes, boxes, i) ? 1 : 0;
+        num_visible += visible[i];
+    }
+
+    return num_visible;
+}
+
+size_t CullBoundingBoxesScalar(const glm::vec4 planes[6], const BoundingBoxes& boxes, unsigned char* visible)
+{
+    size_t count = boxes.center_x.size();
+    size_t num_visible = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        visible[i] = IsBoxVisible(planes, boxes, i) ? 1 : 0;
+        num_visible += visible[i];
+    }
+    return num_visible;
+}
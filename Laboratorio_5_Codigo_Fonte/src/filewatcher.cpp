@@ -0,0 +1,97 @@
+// Observador de modificações em arquivos (inotify no Linux). Veja
+// "include/filewatcher.h".
+//
+// Observamos o diretório, e não cada arquivo, porque muitos editores salvam
+// um arquivo escrevendo uma cópia temporária e renomeando-a por cima do
+// original: o arquivo observado deixaria de existir, e a modificação
+// apareceria somente como IN_MOVED_TO no diretório. Arquivos escritos
+// diretamente geram IN_CLOSE_WRITE, uma vez ao final da escrita.
+#include "filewatcher.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace
+{
+
+bool HasSuffix(const char* name, const std::string& suffix)
+{
+    size_t length = strlen(name);
+    return length >= suffix.size() && suffix.compare(0, suffix.size(), name + length - suffix.size()) == 0;
+}
+
+} // namespace
+
+bool StartFileWatcher(FileWatcher* watcher, const char* directory, const char* suffix)
+{
+    watcher->fd = -1;
+    watcher->suffix = suffix;
+
+#ifdef __linux__
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    if (inotify_add_watch(fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    watcher->fd = fd;
+    return true;
+#else
+    (void)directory;
+    return false;
+#endif
+}
+
+bool PollFileWatcher(FileWatcher* watcher)
+{
+    if (watcher->fd < 0)
+        return false;
+
+    bool changed = false;
+
+#ifdef __linux__
+    // Lemos todos os eventos pendentes, para que várias modificações (por
+    // exemplo, de vários arquivos salvos juntos) resultem em uma única
+    // recarga. Com IN_NONBLOCK, read() falha com EAGAIN quando não há mais
+    // nenhum evento.
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;)
+    {
+        ssize_t length = read(watcher->fd, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            if (length < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+            if (event->len > 0 && HasSuffix(event->name, watcher->suffix))
+                changed = true;
+            offset += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#endif
+
+    return changed;
+}
+
+void StopFileWatcher(FileWatcher* watcher)
+{
+#ifdef __linux__
+    if (watcher->fd >= 0)
+        close(watcher->fd);
+#endif
+    watcher->fd = -1;
+}
@@ -0,0 +1,419 @@
+// Cache do estado do OpenGL. Veja "include/glstate.h".
+//
+// Cada valor guardado começa como UNKNOWN (um nome ou enum que o OpenGL
+// nunca retorna), de forma que a primeira chamada sempre chega ao driver.
+// Alvos e capacidades que não estão nas tabelas abaixo não são guardados, e
+// as suas chamadas sempre chegam ao driver.
+#include "glstate.h"
+
+namespace
+{
+
+const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+const int NUM_BUFFER_TARGETS   = 8;
+const int NUM_INDEXED_BINDINGS = 16; // Pontos de GL_UNIFORM_BUFFER guardados
+const int NUM_TEXTURE_UNITS    = 32;
+const int NUM_TEXTURE_TARGETS  = 5;
+const int NUM_CAPABILITIES     = 8;
+
+struct BufferRange
+{
+    GLuint     buffer;
+    GLintptr   offset;
+    GLsizeiptr size;
+};
+
+struct GLStateCache
+{
+    bool enabled;
+
+    GLuint program;
+    GLuint vertex_array;
+    GLuint buffers[NUM_BUFFER_TARGETS];
+    BufferRange uniform_ranges[NUM_INDEXED_BINDINGS];
+
+    GLuint active_texture; // Índice da unidade, e não GL_TEXTURE0 + índice
+    GLuint textures[NUM_TEXTURE_UNITS][NUM_TEXTURE_TARGETS];
+    GLuint samplers[NUM_TEXTURE_UNITS];
+
+    GLuint capabilities[NUM_CAPABILITIES]; // GL_TRUE, GL_FALSE ou UNKNOWN
+    GLuint blend_sfactor;
+    GLuint blend_dfactor;
+    GLuint depth_func;
+    GLuint depth_mask;
+    GLuint color_mask; // Um bit por componente (RGBA)
+    GLuint polygon_mode;
+    GLuint cull_face;
+    GLuint front_face;
+
+    GLStateStatistics statistics;
+};
+
+// Esquece todos os valores guardados, mantendo "enabled" e as estatísticas.
+void ForgetState(GLStateCache* state)
+{
+    state->program = UNKNOWN;
+    state->vertex_array = UNKNOWN;
+    for (int target = 0; target < NUM_BUFFER_TARGETS; ++target)
+        state->buffers[target] = UNKNOWN;
+    for (int index = 0; index < NUM_INDEXED_BINDINGS; ++index)
+        state->uniform_ranges[index].buffer = UNKNOWN;
+
+    state->active_texture = UNKNOWN;
+    for (int unit = 0; unit < NUM_TEXTURE_UNITS; ++unit)
+    {
+        for (int target = 0; target < NUM_TEXTURE_TARGETS; ++target)
+            state->textures[unit][target] = UNKNOWN;
+        state->samplers[unit] = UNKNOWN;
+    }
+
+    for (int cap = 0; cap < NUM_CAPABILITIES; ++cap)
+        state->capabilities[cap] = UNKNOWN;
+    state->blend_sfactor = UNKNOWN;
+    state->blend_dfactor = UNKNOWN;
+    state->depth_func = UNKNOWN;
+    state->depth_mask = UNKNOWN;
+    state->color_mask = UNKNOWN;
+    state->polygon_mode = UNKNOWN;
+    state->cull_face = UNKNOWN;
+    state->front_face = UNKNOWN;
+}
+
+GLStateCache InitialState()
+{
+    GLStateCache state;
+    state.enabled = true;
+    state.statistics.calls = 0;
+    state.statistics.elided = 0;
+    ForgetState(&state);
+    return state;
+}
+
+GLStateCache g_GLState = InitialState();
+
+int BufferTargetIndex(GLenum target)
+{
+    switch (target)
+    {
+        case GL_ARRAY_BUFFER:              return 0;
+        case GL_COPY_READ_BUFFER:          return 1;
+        case GL_COPY_WRITE_BUFFER:         return 2;
+        case GL_PIXEL_PACK_BUFFER:         return 3;
+        case GL_PIXEL_UNPACK_BUFFER:       return 4;
+        case GL_TEXTURE_BUFFER:            return 5;
+        case GL_UNIFORM_BUFFER:            return 6;
+        case GL_TRANSFORM_FEEDBACK_BUFFER: return 7;
+        default:                           return -1; // Inclui GL_ELEMENT_ARRAY_BUFFER (estado do VAO)
+    }
+}
+
+int TextureTargetIndex(GLenum target)
+{
+    switch (target)
+    {
+        case GL_TEXTURE_2D:       return 0;
+        case GL_TEXTURE_BUFFER:   return 1;
+        case GL_TEXTURE_2D_ARRAY: return 2;
+        case GL_TEXTURE_CUBE_MAP: return 3;
+        case GL_TEXTURE_3D:       return 4;
+        default:                  return -1;
+    }
+}
+
+int CapabilityIndex(GLenum cap)
+{
+    switch (cap)
+    {
+        case GL_BLEND:               return 0;
+        case GL_DEPTH_TEST:          return 1;
+        case GL_CULL_FACE:           return 2;
+        case GL_SCISSOR_TEST:        return 3;
+        case GL_STENCIL_TEST:        return 4;
+        case GL_POLYGON_OFFSET_FILL: return 5;
+        case GL_PRIMITIVE_RESTART:   return 6;
+        case GL_RASTERIZER_DISCARD:  return 7;
+        default:                     return -1;
+    }
+}
+
+// Compara o valor guardado com o novo e guarda o novo. Retorna true se a
+// chamada deve chegar ao driver.
+bool Update(GLuint* cached, GLuint value)
+{
+    g_GLState.statistics.calls += 1;
+    if (*cached == value && g_GLState.enabled)
+    {
+        g_GLState.statistics.elided += 1;
+        return false;
+    }
+    *cached = value;
+    return true;
+}
+
+// Chamada que não é guardada: somente contada.
+void PassThrough()
+{
+    g_GLState.statistics.calls += 1;
+}
+
+void SetCapability(GLenum cap, GLboolean value)
+{
+    int index = CapabilityIndex(cap);
+    if (index < 0)
+    {
+        PassThrough();
+    }
+    else if (!Update(&g_GLState.capabilities[index], value))
+    {
+        return;
+    }
+
+    if (value)
+        glEnable(cap);
+    else
+        glDisable(cap);
+}
+
+} // namespace
+
+void GLState_UseProgram(GLuint program)
+{
+    if (Update(&g_GLState.program, program))
+        glUseProgram(program);
+}
+
+GLuint GLState_CurrentProgram()
+{
+    if (g_GLState.program == UNKNOWN || !g_GLState.enabled)
+    {
+        GLint program = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+        g_GLState.program = (GLuint)program;
+    }
+    return g_GLState.program;
+}
+
+void GLState_BindVertexArray(GLuint vertex_array)
+{
+    if (Update(&g_GLState.vertex_array, vertex_array))
+        glBindVertexArray(vertex_array);
+}
+
+void GLState_BindBuffer(GLenum target, GLuint buffer)
+{
+    int index = BufferTargetIndex(target);
+    if (index < 0)
+        PassThrough();
+    else if (!Update(&g_GLState.buffers[index], buffer))
+        return;
+
+    glBindBuffer(target, buffer);
+}
+
+void GLState_BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    g_GLState.statistics.calls += 1;
+    if (target == GL_UNIFORM_BUFFER && index < (GLuint)NUM_INDEXED_BINDINGS)
+    {
+        BufferRange& range = g_GLState.uniform_ranges[index];
+        if (g_GLState.enabled && range.buffer == buffer && range.offset == offset && range.size == size)
+        {
+            g_GLState.statistics.elided += 1;
+            return;
+        }
+        range.buffer = buffer;
+        range.offset = offset;
+        range.size = size;
+    }
+
+    // glBindBufferRange() também liga o buffer no ponto genérico do alvo.
+    int target_index = BufferTargetIndex(target);
+    if (target_index >= 0)
+        g_GLState.buffers[target_index] = buffer;
+
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void GLState_ActiveTexture(GLenum texture)
+{
+    GLuint unit = texture - GL_TEXTURE0;
+    if (Update(&g_GLState.active_texture, unit))
+        glActiveTexture(texture);
+}
+
+void GLState_BindTexture(GLenum target, GLuint texture)
+{
+    GLuint unit = g_GLState.active_texture;
+    int index = TextureTargetIndex(target);
+    if (unit >= (GLuint)NUM_TEXTURE_UNITS || index < 0)
+        PassThrough();
+    else if (!Update(&g_GLState.textures[unit][index], texture))
+        return;
+
+    glBindTexture(target, texture);
+}
+
+void GLState_BindSampler(GLuint unit, GLuint sampler)
+{
+    if (unit >= (GLuint)NUM_TEXTURE_UNITS)
+        PassThrough();
+    else if (!Update(&g_GLState.samplers[unit], sampler))
+        return;
+
+    glBindSampler(unit, sampler);
+}
+
+void GLState_Enable(GLenum cap)
+{
+    SetCapability(cap, GL_TRUE);
+}
+
+void GLState_Disable(GLenum cap)
+{
+    SetCapability(cap, GL_FALSE);
+}
+
+GLboolean GLState_IsEnabled(GLenum cap)
+{
+    int index = CapabilityIndex(cap);
+    if (index < 0)
+        return glIsEnabled(cap);
+
+    if (g_GLState.capabilities[index] == UNKNOWN || !g_GLState.enabled)
+        g_GLState.capabilities[index] = glIsEnabled(cap);
+    return (GLboolean)g_GLState.capabilities[index];
+}
+
+void GLState_BlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    g_GLState.statistics.calls += 1;
+    if (g_GLState.enabled && g_GLState.blend_sfactor == sfactor && g_GLState.blend_dfactor == dfactor)
+    {
+        g_GLState.statistics.elided += 1;
+        return;
+    }
+    g_GLState.blend_sfactor = sfactor;
+    g_GLState.blend_dfactor = dfactor;
+    glBlendFunc(sfactor, dfactor);
+}
+
+void GLState_DepthFunc(GLenum func)
+{
+    if (Update(&g_GLState.depth_func, func))
+        glDepthFunc(func);
+}
+
+void GLState_DepthMask(GLboolean flag)
+{
+    if (Update(&g_GLState.depth_mask, flag))
+        glDepthMask(flag);
+}
+
+void GLState_ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+    GLuint mask = (red ? 1 : 0) | (green ? 2 : 0) | (blue ? 4 : 0) | (alpha ? 8 : 0);
+    if (Update(&g_GLState.color_mask, mask))
+        glColorMask(red, green, blue, alpha);
+}
+
+void GLState_PolygonMode(GLenum face, GLenum mode)
+{
+    // No perfil "core", face deve ser GL_FRONT_AND_BACK.
+    if (face != GL_FRONT_AND_BACK)
+        PassThrough();
+    else if (!Update(&g_GLState.polygon_mode, mode))
+        return;
+
+    glPolygonMode(face, mode);
+}
+
+void GLState_CullFace(GLenum mode)
+{
+    if (Update(&g_GLState.cull_face, mode))
+        glCullFace(mode);
+}
+
+void GLState_FrontFace(GLenum mode)
+{
+    if (Update(&g_GLState.front_face, mode))
+        glFrontFace(mode);
+}
+
+void GLState_DeleteProgram(GLuint program)
+{
+    // Um programa em uso só é apagado quando deixa de estar em uso; mesmo
+    // assim esquecemos o valor, pois o nome pode ser reutilizado depois.
+    if (program != 0 && g_GLState.program == program)
+        g_GLState.program = UNKNOWN;
+    glDeleteProgram(program);
+}
+
+void GLState_DeleteVertexArrays(GLsizei n, const GLuint* vertex_arrays)
+{
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        if (vertex_arrays[i] != 0 && g_GLState.vertex_array == vertex_arrays[i])
+            g_GLState.vertex_array = UNKNOWN;
+    }
+    glDeleteVertexArrays(n, vertex_arrays);
+}
+
+void GLState_DeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        if (buffers[i] == 0)
+            continue;
+        for (int target = 0; target < NUM_BUFFER_TARGETS; ++target)
+        {
+            if (g_GLState.buffers[target] == buffers[i])
+                g_GLState.buffers[target] = UNKNOWN;
+        }
+        for (int index = 0; index < NUM_INDEXED_BINDINGS; ++index)
+        {
+            if (g_GLState.uniform_ranges[index].buffer == buffers[i])
+                g_GLState.uniform_ranges[index].buffer = UNKNOWN;
+        }
+    }
+    glDeleteBuffers(n, buffers);
+}
+
+void GLState_DeleteTextures(GLsizei n, const GLuint* textures)
+{
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        if (textures[i] == 0)
+            continue;
+        for (int unit = 0; unit < NUM_TEXTURE_UNITS; ++unit)
+        {
+            for (int target = 0; target < NUM_TEXTURE_TARGETS; ++target)
+            {
+                if (g_GLState.textures[unit][target] == textures[i])
+                    g_GLState.textures[unit][target] = UNKNOWN;
+            }
+        }
+    }
+    glDeleteTextures(n, textures);
+}
+
+void GLState_Invalidate()
+{
+    ForgetState(&g_GLState);
+}
+
+void GLState_SetEnabled(bool enabled)
+{
+    g_GLState.enabled = enabled;
+}
+
+GLStateStatistics GLState_Statistics()
+{
+    return g_GLState.statistics;
+}
+
+void GLState_ResetStatistics()
+{
+    g_GLState.statistics.calls = 0;
+    g_GLState.statistics.elided = 0;
+}
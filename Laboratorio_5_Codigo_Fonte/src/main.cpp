@@ -18,10 +18,14 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
 
 // Headers abaixo são específicos de C++
 #include <map>
 #include <stack>
+#include <unordered_map>
 #include <string>
 #include <vector>
 #include <limits>
@@ -29,6 +33,9 @@
 #include <sstream>
 #include <stdexcept>
 #include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
 
 // Headers das bibliotecas OpenGL
 #include <glad/glad.h>   // Criação de contexto OpenGL 3.3
@@ -38,6 +45,7 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 
 // Headers da biblioteca para carregar modelos obj
 #include <tiny_obj_loader.h>
@@ -47,6 +55,38 @@
 // Headers locais, definidos na pasta "include/"
 #include "utils.h"
 #include "matrices.h"
+#include "mappedfile.h"
+#include "objparser.h"
+#include "normals.h"
+#include "lockfreequeue.h"
+#include "texturecache.h"
+#include "meshoptimize.h"
+#include "simplify.h"
+#include "renderqueue.h"
+#include "culling.h"
+#include "normalmatrix.h"
+#include "programcache.h"
+#include "filewatcher.h"
+#include "glstate.h"
+#include "rangeallocator.h"
+#include "uniformring.h"
+#include "scene.h"
+#include "benchmarks.h"
+
+// Número de threads utilizadas para ler arquivos ".obj" (opção
+// "--obj-threads N"). Com 0, usamos o leitor da biblioteca tinyobjloader, que
+// lê o arquivo sequencialmente. Inicializada em main().
+unsigned int g_ObjLoaderThreads = 0;
+
+// Número de partes em que ComputeNormals() divide os triângulos de uma malha
+// (opção "--normal-threads N"), executadas pelas threads de trabalho de
+// RunInParallel(). Com 1, as normais são computadas na thread atual.
+// Inicializada em main().
+unsigned int g_NormalThreads = 1;
+
+// Variável que controla o peso de cada triângulo nas normais computadas por
+// ComputeNormals(): área (padrão) ou ângulo (opção "--angle-weighted-normals").
+bool g_UseAngleWeightedNormals = false;
 
 // Estrutura que representa um modelo geométrico carregado a partir de um
 // arquivo ".obj". Veja https://en.wikipedia.org/wiki/Wavefront_.obj_file .
@@ -79,7 +119,23 @@ struct ObjModel
 
         std::string warn;
         std::string err;
-        bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename, basepath, triangulate);
+        bool ret = false;
+
+        // O leitor paralelo (veja "objparser.cpp") só triangula e não suporta
+        // materiais; nesses casos usamos a tinyobjloader.
+        ObjParseResult parse_result = OBJ_PARSE_UNSUPPORTED;
+        if (g_ObjLoaderThreads > 0 && triangulate)
+        {
+            parse_result = LoadObjParallel(filename, g_ObjLoaderThreads, &attrib, &shapes, &err);
+            ret = (parse_result == OBJ_PARSE_OK);
+        }
+
+        if (parse_result == OBJ_PARSE_UNSUPPORTED)
+        {
+            attrib = tinyobj::attrib_t();
+            shapes.clear();
+            ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename, basepath, triangulate);
+        }
 
         if (!err.empty())
             fprintf(stderr, "\n%s\n", err.c_str());
@@ -115,14 +171,23 @@ void PopMatrix(glm::mat4& M);
 // logo após a definição de main() neste arquivo.
 void BuildTrianglesAndAddToVirtualScene(ObjModel*); // Constrói representação de um ObjModel como malha de triângulos para renderização
 void ComputeNormals(ObjModel* model); // Computa normais de um ObjModel, caso não existam.
-void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento, criando um programa de GPU
+void LoadShadersFromFiles(); // Recompila dos arquivos, em segundo plano, as variantes dos shaders já utilizadas
 void LoadTextureImage(const char* filename); // Função que carrega imagens de textura
-void DrawVirtualObject(const char* object_name); // Desenha um objeto armazenado em g_VirtualScene
-GLuint LoadShader_Vertex(const char* filename);   // Carrega um vertex shader
-GLuint LoadShader_Fragment(const char* filename); // Carrega um fragment shader
-void LoadShader(const char* filename, GLuint shader_id); // Função utilizada pelas duas acima
+GLuint LoadShader_Vertex(const char* filename, const std::string& defines = "");   // Carrega um vertex shader
+GLuint LoadShader_Fragment(const char* filename, const std::string& defines = ""); // Carrega um fragment shader
+void LoadShader(const char* filename, GLuint shader_id, const std::string& defines); // Função utilizada pelas duas acima
+void CompileShaderSource(GLuint shader_id, const std::string& source, const std::string& defines); // Inicia a compilação de um shader, sem esperá-la
+bool PrintShaderCompileLog(GLuint shader_id, const char* filename); // Imprime erros e "warnings" da compilação de um shader
+std::string ReadShaderFile(const char* filename); // Lê o código GLSL de um arquivo
 GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Cria um programa de GPU
+GLuint LinkGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Inicia a linkagem de um programa de GPU, sem esperá-la
+bool FinishGpuProgram(GLuint program_id, GLuint vertex_shader_id, GLuint fragment_shader_id); // Verifica a linkagem iniciada por LinkGpuProgram()
 void PrintObjModelInfo(ObjModel*); // Função para debugging
+void WeldVertices(const tinyobj::mesh_t& mesh, std::vector<tinyobj::index_t>* unique_vertices, std::vector<GLuint>* indices); // Remove vértices duplicados de uma malha
+void OptimizeWeldedMesh(const tinyobj::attrib_t& attrib, std::vector<tinyobj::index_t>* unique_vertices, std::vector<GLuint>* indices); // Reordena triângulos e vértices de uma malha soldada
+void PrintMeshOptimizationReport(const std::vector<const char*>& filenames); // Mede ACMR, ATVR e overdraw antes e depois de OptimizeWeldedMesh()
+void BuildLevelsOfDetail(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::index_t>& unique_vertices, std::vector<GLuint>* indices, std::vector<size_t>* lod_num_indices); // Gera versões simplificadas de uma malha soldada
+GLenum SmallestIndexType(size_t num_vertices); // Menor tipo de índice capaz de endereçar num_vertices vértices
 
 // Declaração de funções auxiliares para renderizar texto dentro da janela
 // OpenGL. Estas funções estão definidas no arquivo "textrendering.cpp".
@@ -130,6 +195,13 @@ void TextRendering_Init();
 float TextRendering_LineHeight(GLFWwindow* window);
 float TextRendering_CharWidth(GLFWwindow* window);
 void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f);
+void TextRendering_Flush();
+typedef uint32_t TextHandle; // Texto retido: calculado uma vez, desenhado a cada quadro
+TextHandle TextRendering_CreateText();
+bool TextRendering_TextNeedsLayout(TextHandle text);
+void TextRendering_SetText(GLFWwindow* window, TextHandle text, const std::string &str, float x, float y, float scale = 1.0f);
+void TextRendering_DrawText(TextHandle text);
+void TextRendering_InvalidateTextLayouts();
 void TextRendering_PrintMatrix(GLFWwindow* window, glm::mat4 M, float x, float y, float scale = 1.0f);
 void TextRendering_PrintVector(GLFWwindow* window, glm::vec4 v, float x, float y, float scale = 1.0f);
 void TextRendering_PrintMatrixVectorProduct(GLFWwindow* window, glm::mat4 M, glm::vec4 v, float x, float y, float scale = 1.0f);
@@ -142,6 +214,8 @@ void TextRendering_ShowModelViewProjection(GLFWwindow* window, glm::mat4 project
 void TextRendering_ShowEulerAngles(GLFWwindow* window);
 void TextRendering_ShowProjection(GLFWwindow* window);
 void TextRendering_ShowFramesPerSecond(GLFWwindow* window);
+void TextRendering_ShowLodStatistics(GLFWwindow* window);
+void TextRendering_ShowRenderQueueStatistics(GLFWwindow* window);
 
 // Funções callback para comunicação com o sistema operacional e interação do
 // usuário. Veja mais comentários nas definições das mesmas, abaixo.
@@ -152,33 +226,141 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void CursorPosCallback(GLFWwindow* window, double xpos, double ypos);
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 
-// Definimos uma estrutura que armazenará dados necessários para renderizar
-// cada objeto da cena virtual.
-struct SceneObject
-{
-    std::string  name;        // Nome do objeto
-    size_t       first_index; // Índice do primeiro vértice dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
-    size_t       num_indices; // Número de índices do objeto dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
-    GLenum       rendering_mode; // Modo de rasterização (GL_TRIANGLES, GL_TRIANGLE_STRIP, etc.)
-    GLuint       vertex_array_object_id; // ID do VAO onde estão armazenados os atributos do modelo
-    glm::vec3    bbox_min; // Axis-Aligned Bounding Box do objeto
-    glm::vec3    bbox_max;
+// Malha de triângulos pronta para ser enviada para a GPU. Veja
+// BuildMeshData() e AddMeshToVirtualScene().
+struct MeshData
+{
+    VertexFormat               vertex_format;
+    std::vector<unsigned char> vertex_data;  // Vértices intercalados ("interleaved") no formato vertex_format
+    size_t                     num_vertices;
+    GLenum                     index_type;   // GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT ou GL_UNSIGNED_INT
+    std::vector<unsigned char> index_data;
+    size_t                     num_indices;
+    std::vector<SceneObject>   objects;      // Objetos da malha; vertex_array_object_id e arena_mesh são definidos por AddMeshToVirtualScene()
+
+    // Malhas lidas por LoadMeshCache() não copiam os vértices e índices para
+    // vertex_data e index_data: eles são enviados para a GPU diretamente do
+    // arquivo de cache, que fica mapeado em memória até FreeMeshData(). Veja
+    // MeshVertexData() e MeshIndexData().
+    MappedFile                 file;         // file.data == NULL se a malha foi construída por BuildMeshData()
+    size_t                     file_vertex_offset;
+    size_t                     file_index_offset;
 };
 
-// Abaixo definimos variáveis globais utilizadas em várias funções do código.
+// Variantes ("permutações") dos shaders. Em vez de escolher o mapeamento de
+// textura e o modelo de iluminação com "if"s em cada fragmento, cada
+// combinação de características ("features") é compilada como um programa
+// de GPU separado, com #defines inseridos no início do código GLSL por
+// LoadShader(). As variantes são identificadas por uma máscara de bits,
+// compiladas na primeira vez em que são utilizadas por GetShaderVariant(), e
+// escolhidas a cada desenho pelo programa do item da fila de desenho.
+//
+// A compilação não para o desenho dos quadros: CompileShaderVariant() só
+// inicia a compilação (em outras threads do driver, com a compilação em
+// paralelo de "programcache.h"), e ProcessShaderCompiles() verifica a cada
+// quadro quais terminaram. Enquanto isso, a variante continua utilizando o
+// programa anterior, ou não é desenhada se ainda não tiver nenhum.
+#define SHADER_MAPPING_SPHERICAL  0x0 // Projeção esférica das coordenadas do modelo
+#define SHADER_MAPPING_PLANAR_XY  0x1 // Projeção planar XY, normalizada pela bbox
+#define SHADER_MAPPING_TEXCOORDS  0x2 // Coordenadas de textura do arquivo OBJ
+#define SHADER_MAPPING_MASK       0x3
+#define SHADER_LIGHTING_DAY_NIGHT 0x4 // "shader_fragment-tarefa2.glsl" (com TextureImage1 no lado escuro); senão "tarefa1"
+#define NUM_SHADER_VARIANTS       8
+
+// Programa de GPU de uma variante, e as localizações das suas variáveis
+// "uniform", que podem ser diferentes em cada programa.
+struct ShaderVariant
+{
+    GLuint   program; // 0 se a variante ainda não foi compilada
+    GLint    batched_uniform;
+    uint64_t cache_key; // Chave do programa atual; veja ProgramCacheKey()
+
+    // Compilação em andamento, que substituirá "program" somente se a
+    // linkagem terminar com sucesso. Veja FinishShaderVariant().
+    GLuint   pending_program; // 0 se não há nenhuma compilação em andamento
+    GLuint   pending_shaders[2];
+    uint64_t pending_key;
+    bool     failed; // A compilação do código com a chave failed_key falhou, e não é repetida
+    uint64_t failed_key;
+};
+
+GLuint GetShaderVariant(uint32_t features, bool wait = false); // Programa da variante dos shaders com essas características, ou 0 se ela ainda está sendo compilada
+void CompileShaderVariant(uint32_t features); // Inicia a compilação de uma variante dos arquivos atuais, se eles mudaram
+void FinishShaderVariant(uint32_t features); // Verifica a compilação de uma variante e, se ela teve sucesso, passa a utilizá-la
+void InstallShaderVariant(uint32_t features, GLuint program_id, uint64_t cache_key); // Substitui o programa de uma variante
+void ProcessShaderCompiles(); // Verifica as compilações terminadas e os arquivos GLSL modificados
+std::string ShaderFeatureDefines(uint32_t features); // #defines inseridos no código GLSL de uma variante
+uint32_t SceneObjectShaderFeatures(GLint object_id); // Características dos shaders de um objeto da cena (SPHERE, BUNNY ou PLANE)
+void UseGpuProgram(GLuint program); // glUseProgram(), atualizando a localização da variável "batched" da variante
+
+// Blocos "uniform" dos shaders, preenchidos com os dados da cena e enviados
+// no buffer circular de "uniformring.h".
+FrameUniforms ComputeFrameUniforms(const glm::mat4& view, const glm::mat4& projection); // Bloco FrameUniforms de um quadro
+
+void DrawTextOverlay(GLFWwindow* window); // Escreve na tela todas as informações do quadro
+
+// Declaração de funções que constroem e enviam malhas para a GPU. Definidas
+// após main(), e utilizadas por BuildTrianglesAndAddToVirtualScene().
+void BuildMeshData(ObjModel* model, VertexFormat vertex_format, MeshData* mesh); // Constrói os vértices e índices de um ObjModel
+void AddMeshToVirtualScene(const char* filename, const MeshData& mesh, bool upload_data = true, uint32_t* arena_mesh = NULL); // Envia uma malha para a GPU e adiciona seus objetos em g_VirtualScene
+bool LoadMeshCache(const char* obj_filename, VertexFormat vertex_format, MeshData* mesh); // Carrega uma malha do seu arquivo de cache
+void SaveMeshCache(const char* obj_filename, const MeshData& mesh); // Grava o arquivo de cache de uma malha
+void LoadObjMeshData(const char* filename, VertexFormat vertex_format, MeshData* mesh); // Constrói a malha de um arquivo ".obj", utilizando o cache se possível
+const unsigned char* MeshVertexData(const MeshData& mesh); // Vértices da malha, no arquivo de cache mapeado ou em vertex_data
+const unsigned char* MeshIndexData(const MeshData& mesh); // Índices da malha, no arquivo de cache mapeado ou em index_data
+size_t MeshVertexBytes(const MeshData& mesh); // Tamanho em bytes dos vértices da malha
+size_t MeshIndexBytes(const MeshData& mesh); // Tamanho em bytes dos índices da malha
+void FreeMeshData(MeshData* mesh); // Libera os vértices e índices da malha, desfazendo o mapeamento do arquivo de cache
+void LoadObjModelAndAddToVirtualScene(const char* filename); // Carrega um arquivo ".obj", utilizando o cache se possível
+bool UnloadObjModel(const char* filename); // Remove os objetos de um arquivo ".obj" da cena e libera a sua malha na GPU
+
+// Carregamento assíncrono de texturas e malhas. As funções Queue*() apenas
+// registram os arquivos a serem carregados; StartAssetLoaderThreads() cria
+// threads que leem e decodificam os arquivos, e ProcessAssetUploads(),
+// chamada a cada quadro, envia os dados prontos para a GPU aos poucos.
+// Enquanto uma malha não é enviada por completo, DrawVirtualObject() desenha
+// somente a sua bounding box.
+enum AssetType
+{
+    ASSET_TEXTURE,
+    ASSET_MESH
+};
+
+struct Asset
+{
+    AssetType      type;
+    std::string    filename;
 
-// A cena virtual é uma lista de objetos nomeados, guardados em um dicionário
-// (map).  Veja dentro da função BuildTrianglesAndAddToVirtualScene() como que são incluídos
-// objetos dentro da variável g_VirtualScene, e veja na função main() como
-// estes são acessados.
-std::map<std::string, SceneObject> g_VirtualScene;
+    // Textura (ASSET_TEXTURE)
+    GLuint         texture_unit; // Definida por QueueTextureImage(), na ordem das chamadas
+    TextureData    texture;      // Veja LoadTextureData()
+    size_t         texture_level; // Nível de mipmap sendo enviado; do menor para o maior
+    GLuint         texture_id;
+
+    // Malha (ASSET_MESH)
+    MeshData       mesh;
+    uint32_t       arena_mesh;   // Veja AllocateArenaMesh()
+
+    size_t         uploaded_bytes; // Bytes já enviados para a GPU
+
+    size_t         request_index; // Posição em g_AssetRequests
+    std::string    error;         // Erro de leitura, informado pela thread principal; vazio se a leitura deu certo
+};
+
+void QueueTextureImage(const char* filename); // Agenda o carregamento de uma textura, como LoadTextureImage()
+void QueueObjModel(const char* filename); // Agenda o carregamento de um ".obj", como LoadObjModelAndAddToVirtualScene()
+void StartAssetLoaderThreads(unsigned int num_threads); // Inicia a leitura dos arquivos agendados
+void StopAssetLoaderThreads(); // Espera as threads de carregamento terminarem
+void ProcessAssetUploads(size_t budget_bytes); // Envia até budget_bytes de dados prontos para a GPU
+bool DecodeTextureImage(const char* filename, TextureData* texture); // Lê uma imagem com stb_image e computa seus mipmaps
+bool LoadTextureData(const char* filename, TextureData* texture); // Lê uma imagem e seus mipmaps, utilizando o cache se possível
+void ConvertTextureImage(const char* filename); // Grava o arquivo de cache de uma imagem, sem abrir a janela
+
+// Abaixo definimos variáveis globais utilizadas em várias funções do código.
 
 // Pilha que guardará as matrizes de modelagem.
 std::stack<glm::mat4>  g_MatrixStack;
 
-// Razão de proporção da janela (largura/altura). Veja função FramebufferSizeCallback().
-float g_ScreenRatio = 1.0f;
-
 // Ângulos de Euler que controlam a rotação de um dos cubos da cena virtual
 float g_AngleX = 0.0f;
 float g_AngleY = 0.0f;
@@ -212,20 +394,203 @@ bool g_UsePerspectiveProjection = true;
 // Variável que controla se o texto informativo será mostrado na tela.
 bool g_ShowInfoText = true;
 
-// Variáveis que definem um programa de GPU (shaders). Veja função LoadShadersFromFiles().
-GLuint g_GpuProgramID = 0;
-GLint g_model_uniform;
-GLint g_view_uniform;
-GLint g_projection_uniform;
-GLint g_object_id_uniform;
-GLint g_bbox_min_uniform;
-GLint g_bbox_max_uniform;
-
-// Número de texturas carregadas pela função LoadTextureImage()
+// Variável que controla o formato dos vértices enviados para a GPU: compactado
+// (QuantizedVertex) ou em float (FloatVertex). Pode ser alterada com a opção
+// "--float-vertices" na linha de comando.
+bool g_UseQuantizedVertexFormat = true;
+
+// Variável que controla o uso dos arquivos de cache de malhas (veja
+// LoadMeshCache()). Pode ser desabilitada com a opção "--no-mesh-cache".
+bool g_UseMeshCache = true;
+
+// Variável que controla o cache de binários dos programas de GPU (veja
+// "programcache.h"). Pode ser desabilitado com a opção "--no-program-cache".
+bool g_UseProgramCache = true;
+
+// Observador do diretório "src/", que recarrega os shaders sempre que um
+// arquivo ".glsl" é salvo. Veja ProcessShaderCompiles().
+FileWatcher g_ShaderWatcher;
+
+// Variáveis que controlam a otimização da ordem dos triângulos e vértices
+// de cada malha (veja OptimizeWeldedMesh()): se ela é feita (desabilitada
+// com a opção "--no-mesh-optimization") e o tamanho do cache de vértices
+// transformados considerado ("--vertex-cache-size N").
+bool g_OptimizeMeshes = true;
+unsigned int g_VertexCacheSize = 16;
+
+// Número de chamadas às funções de "glstate.h" no quadro anterior, e
+// quantas delas o cache descartou. Veja TextRendering_ShowRenderQueueStatistics().
+GLStateStatistics g_GLStateFrameStatistics;
+
+// Variantes dos shaders, indexadas pela máscara de características. Veja
+// GetShaderVariant(). A localização abaixo é a do programa ligado por
+// UseGpuProgram(); os demais dados dos shaders ficam nos blocos
+// FrameUniforms e ObjectUniforms.
+ShaderVariant g_ShaderVariants[NUM_SHADER_VARIANTS];
+GLint g_batched_uniform = -1;
+
+// Características de iluminação utilizadas por todos os objetos da cena:
+// SHADER_LIGHTING_DAY_NIGHT com a opção "--day-night-lighting", ou 0.
+uint32_t g_LightingShaderFeatures = 0;
+
+// Sentido da fonte de luz, em coordenadas globais. Veja FrameUniforms.
+const glm::vec4 g_LightDirection = glm::normalize(glm::vec4(1.0f, 1.0f, 0.0f, 0.0f));
+
+// Capacidade inicial da arena. Quando uma malha não cabe, a arena é
+// compactada ou tem a sua capacidade dobrada; veja AllocateArenaMesh().
+#define GEOMETRY_ARENA_INITIAL_VERTICES   (1 << 18)
+#define GEOMETRY_ARENA_INITIAL_INDEX_BYTES (4 << 20)
+
+// Nome do arquivo ".obj" extra dado na linha de comando, recarregado com a
+// tecla M. Veja KeyCallback().
+const char* g_ExtraModelFilename = NULL;
+
+// Número de texturas carregadas pela função LoadTextureImage() (ou agendadas
+// por QueueTextureImage())
 GLuint g_NumLoadedTextures = 0;
 
+// IDs das texturas, na ordem de carregamento (a mesma das unidades de
+// textura em que foram carregadas). Os IDs de texturas carregadas de forma
+// assíncrona ficam 0 até que ProcessAssetUploads() as crie.
+std::vector<GLuint> g_TextureIds;
+
+// Conjuntos de texturas utilizados pelos itens da fila de desenho.
+std::vector<TextureSet> g_TextureSets;
+
+// Variável que controla o uso dos arquivos de cache de texturas, com todos os
+// níveis de mipmap já computados (veja LoadTextureData()). Pode ser
+// desabilitada com a opção "--no-texture-cache".
+bool g_UseTextureCache = true;
+
+// Variável que controla o carregamento assíncrono de texturas e malhas (veja
+// ProcessAssetUploads()). Com a opção "--sync-asset-loading", todos os
+// arquivos são carregados antes do primeiro quadro, como originalmente.
+bool g_UseAsyncAssetLoading = true;
+
+// Número máximo de bytes enviados para a GPU por quadro durante o
+// carregamento assíncrono. Pode ser alterado com a opção "--upload-budget-kb N".
+size_t g_UploadBudgetBytes = 4 * 1024 * 1024;
+
+// Estado do carregamento assíncrono. g_AssetRequests é preenchido antes de
+// StartAssetLoaderThreads(), e as threads de carregamento obtêm o próximo
+// arquivo a ser lido incrementando g_NextAssetRequest. Os recursos lidos são
+// passados para a thread principal através da fila g_LoadedAssets, e ficam em
+// g_PendingUploads até serem enviados por completo para a GPU. Depois disso
+// (ou de um erro de leitura) são liberados, e a sua posição em
+// g_AssetRequests passa a ser NULL (veja ReleaseAsset()).
+std::vector<Asset*>      g_AssetRequests;
+std::atomic<size_t>      g_NextAssetRequest(0);
+LockFreeQueue<Asset*>*   g_LoadedAssets = NULL;
+std::vector<Asset*>      g_PendingUploads;
+size_t                   g_NumResidentAssets = 0;
+size_t                   g_NumFailedAssets = 0;
+std::vector<std::thread> g_AssetLoaderThreads;
+GLuint                   g_StagingBufferId = 0; // Buffer intermediário (PBO) para os envios de ProcessAssetUploads()
+
 int main(int argc, char* argv[])
 {
+    // Processamos as opções da linha de comando. Argumentos que começam com
+    // "--" são opções; o primeiro argumento restante, se existir, é o nome de
+    // um arquivo ".obj" extra a ser carregado.
+    BenchmarkOptions benchmark_options = BenchmarkOptions(); // Veja "benchmarks.h"
+    std::vector<const char*> convert_texture_filenames;
+    bool mesh_optimization_report = false;
+    g_ObjLoaderThreads = std::max(1u, std::thread::hardware_concurrency());
+    g_NormalThreads = g_ObjLoaderThreads;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--float-vertices") == 0)
+            g_UseQuantizedVertexFormat = false;
+        else if (strcmp(argv[i], "--no-mesh-cache") == 0)
+            g_UseMeshCache = false;
+        else if (strcmp(argv[i], "--no-program-cache") == 0)
+            g_UseProgramCache = false;
+        else if (strcmp(argv[i], "--obj-threads") == 0 && i+1 < argc)
+        {
+            // Lido como inteiro com sinal: um valor negativo atribuído
+            // diretamente a g_ObjLoaderThreads viraria bilhões de threads.
+            int threads = atoi(argv[++i]);
+            if (threads < 0)
+            {
+                fprintf(stderr, "ERROR: Invalid number of threads for --obj-threads: %d (using 0).\n", threads);
+                threads = 0;
+            }
+            g_ObjLoaderThreads = threads;
+        }
+        else if (strcmp(argv[i], "--normal-threads") == 0 && i+1 < argc)
+        {
+            int threads = atoi(argv[++i]);
+            if (threads < 1)
+            {
+                fprintf(stderr, "ERROR: Invalid number of threads for --normal-threads: %d (using 1).\n", threads);
+                threads = 1;
+            }
+            g_NormalThreads = threads;
+        }
+        else if (ParseBenchmarkOption(argc, argv, &i, &benchmark_options))
+            continue;
+        else if (strcmp(argv[i], "--angle-weighted-normals") == 0)
+            g_UseAngleWeightedNormals = true;
+        else if (strcmp(argv[i], "--no-mesh-optimization") == 0)
+            g_OptimizeMeshes = false;
+        else if (strcmp(argv[i], "--vertex-cache-size") == 0 && i+1 < argc)
+            g_VertexCacheSize = std::max(4, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--mesh-optimization-report") == 0)
+            mesh_optimization_report = true;
+        else if (strcmp(argv[i], "--no-lod") == 0)
+            g_UseLevelsOfDetail = false;
+        else if (strcmp(argv[i], "--no-culling") == 0)
+            g_UseFrustumCulling = false;
+        else if (strcmp(argv[i], "--occlusion-culling") == 0)
+            g_UseOcclusionCulling = true;
+        else if (strcmp(argv[i], "--no-batching") == 0)
+            g_UseDrawBatching = false;
+        else if (strcmp(argv[i], "--day-night-lighting") == 0)
+            g_LightingShaderFeatures = SHADER_LIGHTING_DAY_NIGHT;
+        else if (strcmp(argv[i], "--no-texture-cache") == 0)
+            g_UseTextureCache = false;
+        else if (strcmp(argv[i], "--convert-texture") == 0 && i+1 < argc)
+            convert_texture_filenames.push_back(argv[++i]);
+        else if (strcmp(argv[i], "--sync-asset-loading") == 0)
+            g_UseAsyncAssetLoading = false;
+        else if (strcmp(argv[i], "--upload-budget-kb") == 0 && i+1 < argc)
+            g_UploadBudgetBytes = std::max(1, atoi(argv[++i])) * size_t(1024);
+        else if (strncmp(argv[i], "--", 2) == 0)
+            fprintf(stderr, "WARNING: Unknown option \"%s\".\n", argv[i]);
+        else if (g_ExtraModelFilename == NULL)
+            g_ExtraModelFilename = argv[i];
+    }
+
+    // Benchmarks que não precisam de janela nem de contexto OpenGL.
+    if (RunStandaloneBenchmark(benchmark_options, g_ObjLoaderThreads, g_NormalThreads))
+        return 0;
+
+    // Os benchmarks de desenho são executados após a criação da janela, com
+    // todos os modelos já na GPU.
+    if (HasSceneBenchmark(benchmark_options))
+        g_UseAsyncAssetLoading = false;
+
+    if (mesh_optimization_report)
+    {
+        std::vector<const char*> filenames;
+        filenames.push_back("../../data/sphere.obj");
+        filenames.push_back("../../data/bunny.obj");
+        filenames.push_back("../../data/plane.obj");
+        if (g_ExtraModelFilename != NULL)
+            filenames.push_back(g_ExtraModelFilename);
+        PrintMeshOptimizationReport(filenames);
+        return 0;
+    }
+
+    // Conversão de imagens para arquivos de cache de textura, que depois são
+    // utilizados automaticamente por LoadTextureData().
+    if (!convert_texture_filenames.empty())
+    {
+        for (size_t i = 0; i < convert_texture_filenames.size(); ++i)
+            ConvertTextureImage(convert_texture_filenames[i]);
+        return 0;
+    }
+
     // Inicializamos a biblioteca GLFW, utilizada para criar uma janela do
     // sistema operacional, onde poderemos renderizar com OpenGL.
     int success = glfwInit();
@@ -292,48 +657,124 @@ int main(int argc, char* argv[])
 
     printf("GPU: %s, %s, OpenGL %s, GLSL %s\n", vendor, renderer, glversion, glslversion);
 
+    // Com o cache de binários, os programas de GPU compilados em uma execução
+    // anterior são reaproveitados. Veja "programcache.h".
+    if (g_UseProgramCache && !InitProgramCache())
+        printf("Cache de programas de GPU não suportado pelo driver.\n");
+
+    // Sem a compilação em paralelo, cada variante dos shaders ainda é
+    // compilada de forma assíncrona (veja ProcessShaderCompiles()), mas o
+    // quadro em que a sua linkagem é verificada espera a compilação.
+    if (!InitParallelShaderCompile())
+        printf("Compilação de shaders em paralelo não suportada pelo driver.\n");
+
+    // Os shaders são recarregados automaticamente quando os seus arquivos
+    // são salvos; sem o observador (fora do Linux), somente pela tecla R.
+    if (!StartFileWatcher(&g_ShaderWatcher, "../../src", ".glsl"))
+        printf("Recarga automática dos shaders não suportada; utilize a tecla R.\n");
+
     // Carregamos os shaders de vértices e de fragmentos que serão utilizados
     // para renderização. Veja slides 180-200 do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
     //
-    LoadShadersFromFiles();
+    // Iniciamos aqui a compilação das variantes da cena, que continua
+    // enquanto as texturas e malhas abaixo são carregadas (object_id 0, 1
+    // e 2: SPHERE, BUNNY e PLANE).
+    for (GLint object_id = 0; object_id < 3; ++object_id)
+        GetShaderVariant(SceneObjectShaderFeatures(object_id));
+
+    // Com o carregamento assíncrono, as texturas e malhas abaixo são apenas
+    // agendadas, e são lidas por outras threads enquanto os primeiros quadros
+    // já são desenhados. Veja ProcessAssetUploads().
+    void (*load_texture)(const char*) = g_UseAsyncAssetLoading ? QueueTextureImage : LoadTextureImage;
+    void (*load_model)(const char*)   = g_UseAsyncAssetLoading ? QueueObjModel : LoadObjModelAndAddToVirtualScene;
 
     // Carregamos duas imagens para serem utilizadas como textura
-    LoadTextureImage("../../data/wall.jpeg");      // TextureImage0
-    LoadTextureImage("../../data/tc-earth_nightmap_citylights.gif"); // TextureImage1
-
-    // Construímos a representação de objetos geométricos através de malhas de triângulos
-    ObjModel spheremodel("../../data/sphere.obj");
-    ComputeNormals(&spheremodel);
-    BuildTrianglesAndAddToVirtualScene(&spheremodel);
-
-    ObjModel bunnymodel("../../data/bunny.obj");
-    ComputeNormals(&bunnymodel);
-    BuildTrianglesAndAddToVirtualScene(&bunnymodel);
-
-    ObjModel planemodel("../../data/plane.obj");
-    ComputeNormals(&planemodel);
-    BuildTrianglesAndAddToVirtualScene(&planemodel);
-
-    if ( argc > 1 )
-    {
-        ObjModel model(argv[1]);
-        BuildTrianglesAndAddToVirtualScene(&model);
-    }
+    load_texture("../../data/wall.jpeg");      // TextureImage0
+    load_texture("../../data/tc-earth_nightmap_citylights.gif"); // TextureImage1
+
+    // Construímos a representação de objetos geométricos através de malhas de
+    // triângulos. Veja LoadObjModelAndAddToVirtualScene().
+    load_model("../../data/sphere.obj");
+    load_model("../../data/bunny.obj");
+    load_model("../../data/plane.obj");
+
+    if ( g_ExtraModelFilename != NULL )
+        load_model(g_ExtraModelFilename);
+
+    // Procuramos os objetos desenhados abaixo pelo nome uma única vez, fora
+    // do laço de renderização. Veja FindSceneObject().
+    SceneObjectHandle sphere_handle = FindSceneObject("the_sphere");
+    SceneObjectHandle bunny_handle  = FindSceneObject("the_bunny");
+    SceneObjectHandle plane_handle  = FindSceneObject("the_plane");
+
+    if (!g_UseAsyncAssetLoading)
+        WarnMissingSceneObjects();
+
+    // Todos os objetos utilizam as texturas carregadas acima, cada uma na
+    // unidade de textura correspondente à ordem de carregamento.
+    TextureSet scene_textures = {{ 0, 1, 2 }};
+    uint32_t scene_texture_set = g_TextureSets.size();
+    g_TextureSets.push_back(scene_textures);
+
+    // A fila de desenho lê as texturas e liga os programas de GPU pelas
+    // variáveis e funções abaixo. Veja "renderqueue.h".
+    RenderQueueResources render_queue_resources;
+    render_queue_resources.texture_sets    = &g_TextureSets;
+    render_queue_resources.texture_ids     = &g_TextureIds;
+    render_queue_resources.use_program     = UseGpuProgram;
+    render_queue_resources.batched_uniform = &g_batched_uniform;
+    SetRenderQueueResources(render_queue_resources);
+
+    if (g_UseAsyncAssetLoading || g_UseOcclusionCulling)
+        CreateBoundingBoxProxy();
+    if (g_UseAsyncAssetLoading)
+        StartAssetLoaderThreads(g_ObjLoaderThreads);
 
     // Inicializamos o código para renderização de texto.
     TextRendering_Init();
 
     // Habilitamos o Z-buffer. Veja slides 104-116 do documento Aula_09_Projecoes.pdf.
-    glEnable(GL_DEPTH_TEST);
+    GLState_Enable(GL_DEPTH_TEST);
 
     // Habilitamos o Backface Culling. Veja slides 8-13 do documento Aula_02_Fundamentos_Matematicos.pdf, slides 23-34 do documento Aula_13_Clipping_and_Culling.pdf e slides 112-123 do documento Aula_14_Laboratorio_3_Revisao.pdf.
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
+    GLState_Enable(GL_CULL_FACE);
+    GLState_CullFace(GL_BACK);
+    GLState_FrontFace(GL_CCW);
+
+    // Os benchmarks de desenho precisam do contexto OpenGL e dos modelos já
+    // carregados (veja HasSceneBenchmark() acima).
+    SceneObjectHandle scene_handles[3] = { sphere_handle, bunny_handle, plane_handle };
+    if (RunSceneBenchmark(benchmark_options, window, scene_handles, scene_texture_set))
+    {
+        glfwTerminate();
+        return 0;
+    }
 
     // Ficamos em um loop infinito, renderizando, até que o usuário feche a janela
+    bool first_frame = true;
     while (!glfwWindowShouldClose(window))
     {
+        // Enviamos para a GPU parte das texturas e malhas já lidas do disco
+        // pelas threads de carregamento, limitados a g_UploadBudgetBytes por
+        // quadro para que nenhum quadro fique lento.
+        ProcessAssetUploads(g_UploadBudgetBytes);
+
+        // Passamos a utilizar as variantes dos shaders cuja compilação
+        // terminou, e recompilamos as que tiveram os arquivos modificados.
+        ProcessShaderCompiles();
+
+        // Guardamos o número de chamadas ao cache de estado do quadro
+        // anterior, mostrado por TextRendering_ShowRenderQueueStatistics().
+        g_GLStateFrameStatistics = GLState_Statistics();
+        GLState_ResetStatistics();
+
+        // Zeramos as estatísticas de LOD e de culling, acumuladas durante o
+        // desenho dos objetos.
+        std::fill(g_LodDraws, g_LodDraws + MAX_LODS, 0);
+        std::fill(g_LodTriangles, g_LodTriangles + MAX_LODS, 0);
+        g_VisibleObjects = 0;
+        g_CulledObjects = 0;
+
         // Aqui executamos as operações de renderização
 
         // Definimos a cor do "fundo" do framebuffer como branco.  Tal cor é
@@ -344,14 +785,17 @@ int main(int argc, char* argv[])
         //           R     G     B     A
         glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
+        // Estado utilizado pelo desenho da cena. O texto do quadro anterior
+        // (veja TextRendering_Flush()) deixa o blending habilitado e a
+        // função de profundidade GL_ALWAYS; com o cache de "glstate.h", as
+        // chamadas abaixo só chegam ao driver se o estado for diferente.
+        GLState_Disable(GL_BLEND);
+        GLState_DepthFunc(GL_LESS);
+
         // "Pintamos" todos os pixels do framebuffer com a cor definida acima,
         // e também resetamos todos os pixels do Z-buffer (depth buffer).
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Pedimos para a GPU utilizar o programa de GPU criado acima (contendo
-        // os shaders de vértice e fragmentos).
-        glUseProgram(g_GpuProgramID);
-
         // Computamos a posição da câmera utilizando coordenadas esféricas.  As
         // variáveis g_CameraDistance, g_CameraPhi, e g_CameraTheta são
         // controladas pelo mouse do usuário. Veja as funções CursorPosCallback()
@@ -403,11 +847,13 @@ int main(int argc, char* argv[])
 
         glm::mat4 model = Matrix_Identity(); // Transformação identidade de modelagem
 
-        // Enviamos as matrizes "view" e "projection" para a placa de vídeo
-        // (GPU). Veja o arquivo "shader_vertex.glsl", onde estas são
-        // efetivamente aplicadas em todos os pontos.
-        glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-        glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
+        // Os objetos são adicionados à fila de desenho, e desenhados todos
+        // juntos por FlushRenderQueue(), que também envia as matrizes "view"
+        // e "projection" para a placa de vídeo (GPU). Veja o arquivo
+        // "shader_vertex.glsl", onde estas são efetivamente aplicadas em
+        // todos os pontos. Cada objeto aparece uma única vez na cena, e
+        // portanto todos são a instância 0 (veja "renderqueue.h").
+        BeginRenderQueue(ComputeFrameUniforms(view, projection));
 
         #define SPHERE 0
         #define BUNNY  1
@@ -418,33 +864,23 @@ int main(int argc, char* argv[])
               * Matrix_Rotate_Z(0.6f)
               * Matrix_Rotate_X(0.2f)
               * Matrix_Rotate_Y(g_AngleY + (float)glfwGetTime() * 0.1f);
-        glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, SPHERE);
-        DrawVirtualObject("the_sphere");
+        SubmitDrawItem(GetShaderVariant(SceneObjectShaderFeatures(SPHERE)), scene_texture_set, sphere_handle, 0, model);
 
         // Desenhamos o modelo do coelho
         model = Matrix_Translate(1.0f,0.0f,0.0f)
               * Matrix_Rotate_X(g_AngleX + (float)glfwGetTime() * 0.1f);
-        glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, BUNNY);
-        DrawVirtualObject("the_bunny");
+        SubmitDrawItem(GetShaderVariant(SceneObjectShaderFeatures(BUNNY)), scene_texture_set, bunny_handle, 0, model);
 
         // Desenhamos o plano do chão
         model = Matrix_Translate(0.0f,-1.1f,0.0f);
-        glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, PLANE);
-        DrawVirtualObject("the_plane");
-
-        // Imprimimos na tela os ângulos de Euler que controlam a rotação do
-        // terceiro cubo.
-        TextRendering_ShowEulerAngles(window);
+        SubmitDrawItem(GetShaderVariant(SceneObjectShaderFeatures(PLANE)), scene_texture_set, plane_handle, 0, model);
 
-        // Imprimimos na informação sobre a matriz de projeção sendo utilizada.
-        TextRendering_ShowProjection(window);
+        FlushRenderQueue();
 
-        // Imprimimos na tela informação sobre o número de quadros renderizados
-        // por segundo (frames per second).
-        TextRendering_ShowFramesPerSecond(window);
+        // Imprimimos na tela as informações do quadro. Veja DrawTextOverlay().
+        // Todo o texto é desenhado de uma vez por TextRendering_Flush().
+        DrawTextOverlay(window);
+        TextRendering_Flush();
 
         // O framebuffer onde OpenGL executa as operações de renderização não
         // é o mesmo que está sendo mostrado para o usuário, caso contrário
@@ -454,6 +890,12 @@ int main(int argc, char* argv[])
         // Veja o link: https://en.wikipedia.org/w/index.php?title=Multiple_buffering&oldid=793452829#Double_buffering_in_computer_graphics
         glfwSwapBuffers(window);
 
+        if (first_frame)
+        {
+            printf("Primeiro quadro desenhado em %.1f ms.\n", glfwGetTime() * 1000.0);
+            first_frame = false;
+        }
+
         // Verificamos com o sistema operacional se houve alguma interação do
         // usuário (teclado, mouse, ...). Caso positivo, as funções de callback
         // definidas anteriormente usando glfwSet*Callback() serão chamadas
@@ -461,6 +903,11 @@ int main(int argc, char* argv[])
         glfwPollEvents();
     }
 
+    // Esperamos as threads de carregamento, caso a janela tenha sido fechada
+    // antes de todos os arquivos serem lidos.
+    StopAssetLoaderThreads();
+    StopFileWatcher(&g_ShaderWatcher);
+
     // Finalizamos o uso dos recursos do sistema operacional
     glfwTerminate();
 
@@ -471,23 +918,15 @@ int main(int argc, char* argv[])
 // Função que carrega uma imagem para ser utilizada como textura
 void LoadTextureImage(const char* filename)
 {
-    printf("Carregando imagem \"%s\"... ", filename);
-
     // Primeiro fazemos a leitura da imagem do disco
     stbi_set_flip_vertically_on_load(true);
-    int width;
-    int height;
-    int channels;
-    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
-
-    if ( data == NULL )
+    TextureData texture;
+    if (!LoadTextureData(filename, &texture))
     {
         fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
         std::exit(EXIT_FAILURE);
     }
 
-    printf("OK (%dx%d).\n", width, height);
-
     // Agora criamos objetos na GPU com OpenGL para armazenar a textura
     GLuint texture_id;
     GLuint sampler_id;
@@ -502,391 +941,1647 @@ void LoadTextureImage(const char* filename)
     glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Agora enviamos a imagem lida do disco para a GPU
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
-    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    // Agora enviamos a imagem lida do disco para a GPU. Cada linha RGBA
+    // ocupa um múltiplo de 4 bytes, e portanto o alinhamento padrão serve.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+    // Todos os níveis de mipmap já foram computados (veja
+    // BuildTextureMipmaps()); não precisamos de glGenerateMipmap(). O
+    // formato interno continua GL_SRGB8, como antes dos mipmaps
+    // pré-computados: o canal alfa dos pixels RGBA é descartado.
+    GLuint textureunit = g_NumLoadedTextures;
+    GLState_ActiveTexture(GL_TEXTURE0 + textureunit);
+    GLState_BindTexture(GL_TEXTURE_2D, texture_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levels.size() - 1);
+    for (size_t i = 0; i < texture.levels.size(); ++i)
+    {
+        const TextureLevel& level = texture.levels[i];
+        glTexImage2D(GL_TEXTURE_2D, i, GL_SRGB8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.pixels + level.offset);
+    }
+    GLState_BindSampler(textureunit, sampler_id);
+
+    FreeTextureData(&texture);
+
+    g_TextureIds.resize(textureunit + 1, 0);
+    g_TextureIds[textureunit] = texture_id;
+
+    g_NumLoadedTextures += 1;
+}
+
+// Decodifica uma imagem com stb_image, em RGBA, e computa todos os seus
+// níveis de mipmap. Retorna false se a imagem não existir ou não puder ser
+// decodificada; o erro é informado por quem chamou a função, pois ela também
+// é chamada pelas threads de carregamento (veja AssetLoaderThread()).
+bool DecodeTextureImage(const char* filename, TextureData* texture)
+{
+    int width;
+    int height;
+    int channels;
+    unsigned char *data = stbi_load(filename, &width, &height, &channels, 4);
+
+    if ( data == NULL )
+        return false;
+
+    BuildTextureMipmaps(data, width, height, texture);
+    stbi_image_free(data);
+    return true;
+}
+
+// Lê uma imagem do disco e computa todos os seus níveis de mipmap, em RGBA
+// sRGB. Se existir um arquivo de cache mais recente que a imagem (veja
+// LoadTextureCache()), ele é apenas mapeado em memória, sem decodificar a
+// imagem nem computar os mipmaps; caso contrário o arquivo é criado. Pode ser
+// chamada por várias threads ao mesmo tempo; a orientação das linhas é
+// definida antes por stbi_set_flip_vertically_on_load(). Os dados devem ser
+// liberados com FreeTextureData(). Retorna false se a imagem não puder ser
+// lida (veja DecodeTextureImage()).
+bool LoadTextureData(const char* filename, TextureData* texture)
+{
+    if (g_UseTextureCache && LoadTextureCache(filename, texture))
+    {
+        printf("Imagem \"%s\" carregada do cache (%ux%u, %lu níveis).\n",
+            filename, texture->width, texture->height, (unsigned long)texture->levels.size());
+        return true;
+    }
+
+    printf("Carregando imagem \"%s\"...\n", filename);
+
+    if (!DecodeTextureImage(filename, texture))
+        return false;
+
+    printf("Imagem \"%s\" carregada (%ux%u, %lu níveis).\n",
+        filename, texture->width, texture->height, (unsigned long)texture->levels.size());
+
+    if (g_UseTextureCache && !SaveTextureCache(filename, *texture))
+        fprintf(stderr, "WARNING: Cannot write texture cache \"%s\".\n", TextureCacheFilename(filename).c_str());
+    return true;
+}
+
+// Converte uma imagem para o seu arquivo de cache de textura, mesmo que já
+// exista um arquivo atualizado (opção "--convert-texture").
+void ConvertTextureImage(const char* filename)
+{
+    stbi_set_flip_vertically_on_load(true);
+
+    TextureData texture;
+    if (!DecodeTextureImage(filename, &texture))
+    {
+        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (!SaveTextureCache(filename, texture))
+    {
+        fprintf(stderr, "ERROR: Cannot write texture cache \"%s\".\n", TextureCacheFilename(filename).c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    const TextureLevel& last = texture.levels.back();
+    printf("%s -> %s: %ux%u, %lu níveis, %lu bytes.\n",
+        filename, TextureCacheFilename(filename).c_str(), texture.width, texture.height,
+        (unsigned long)texture.levels.size(), (unsigned long)(last.offset + last.size));
+
+    FreeTextureData(&texture);
+}
+
+// Bloco FrameUniforms de um quadro, com as matrizes view e projection, a
+// posição da câmera, a fonte de luz e o tempo. Veja SetFrameUniforms().
+FrameUniforms ComputeFrameUniforms(const glm::mat4& view, const glm::mat4& projection)
+{
+    FrameUniforms frame;
+    frame.view = view;
+    frame.projection = projection;
+    // A posição da câmera é a origem do sistema de coordenadas da câmera,
+    // levada para coordenadas globais pela inversa da matriz view.
+    frame.camera_position = glm::inverse(view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    frame.light_direction = g_LightDirection;
+    frame.time = (float)glfwGetTime();
+    frame.padding[0] = frame.padding[1] = frame.padding[2] = 0.0f;
+    return frame;
+}
+
+// Função que recarrega os shaders de vértices e de fragmentos de todas as
+// variantes já utilizadas (veja GetShaderVariant()). As variantes cujos
+// arquivos mudaram são recompiladas em segundo plano, e continuam
+// utilizando o programa anterior até que a nova compilação termine com
+// sucesso; veja ProcessShaderCompiles().
+// Veja slides 180-200 do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
+//
+void LoadShadersFromFiles()
+{
+    for (uint32_t features = 0; features < NUM_SHADER_VARIANTS; ++features)
+    {
+        const ShaderVariant& variant = g_ShaderVariants[features];
+        if ( variant.program != 0 || variant.pending_program != 0 || variant.failed )
+            CompileShaderVariant(features);
+    }
+}
+
+// Retorna o programa de GPU da variante dos shaders com as características
+// "features" (veja SHADER_MAPPING_SPHERICAL e seguintes), iniciando a sua
+// compilação na primeira chamada. Enquanto a primeira compilação não
+// termina, retorna 0, e os objetos da variante não são desenhados (veja
+// SubmitDrawItem()); com "wait", espera a compilação terminar.
+GLuint GetShaderVariant(uint32_t features, bool wait)
+{
+    features %= NUM_SHADER_VARIANTS;
+    ShaderVariant& variant = g_ShaderVariants[features];
+    if ( variant.program == 0 && variant.pending_program == 0 && !variant.failed )
+        CompileShaderVariant(features);
+
+    if ( wait && variant.pending_program != 0 )
+        FinishShaderVariant(features);
+
+    return variant.program;
+}
+
+// Inicia a compilação da variante "features" a partir do código atual dos
+// arquivos GLSL, sem esperá-la. Não faz nada se o código não mudou desde a
+// compilação atual (ou desde a que está em andamento).
+void CompileShaderVariant(uint32_t features)
+{
+    ShaderVariant& variant = g_ShaderVariants[features];
+
+    // Note que o caminho para os arquivos "shader_vertex.glsl" e
+    // "shader_fragment.glsl" estão fixados, sendo que assumimos a existência
+    // da seguinte estrutura no sistema de arquivos:
+    //
+    //    + FCG_Lab_01/
+    //    |
+    //    +--+ bin/
+    //    |  |
+    //    |  +--+ Release/  (ou Debug/ ou Linux/)
+    //    |     |
+    //    |     o-- main.exe
+    //    |
+    //    +--+ src/
+    //       |
+    //       o-- shader_vertex.glsl
+    //       |
+    //       o-- shader_fragment.glsl
+    //
+    // O modelo de iluminação escolhe o arquivo do fragment shader; as demais
+    // características são #defines inseridos no código.
+    std::string defines = ShaderFeatureDefines(features);
+    const char* vertex_filename = "../../src/shader_vertex.glsl";
+    const char* fragment_filename = (features & SHADER_LIGHTING_DAY_NIGHT)
+                                  ? "../../src/shader_fragment-tarefa2.glsl"
+                                  : "../../src/shader_fragment-tarefa1.glsl";
+
+    // A chave do cache de binários (veja ProgramCacheKey()) muda sempre que
+    // o código dos arquivos, os #defines ou o driver mudam; ela também
+    // indica se a variante precisa ser recompilada.
+    std::string sources[3] = { ReadShaderFile(vertex_filename), ReadShaderFile(fragment_filename), defines };
+    uint64_t cache_key = ProgramCacheKey(sources, 3);
+
+    if ( variant.pending_program != 0 )
+    {
+        if ( variant.pending_key == cache_key )
+            return;
+
+        // Os arquivos mudaram de novo durante a compilação: descartamos a
+        // compilação em andamento (o driver a cancela ou termina em
+        // segundo plano) e começamos outra.
+        GLState_DeleteProgram(variant.pending_program);
+        glDeleteShader(variant.pending_shaders[0]);
+        glDeleteShader(variant.pending_shaders[1]);
+        variant.pending_program = 0;
+    }
+
+    // Código igual ao do programa atual, ou ao de uma compilação que falhou.
+    if ( variant.program != 0 && variant.cache_key == cache_key )
+        return;
+    if ( variant.failed && variant.failed_key == cache_key )
+        return;
+
+    // Procuramos primeiro o programa no cache de binários, que é carregado
+    // sem compilar nada.
+    char cache_name[32];
+    snprintf(cache_name, sizeof(cache_name), "shader_variant_%u", (unsigned)features);
+    GLuint program_id = LoadCachedProgram(cache_name, cache_key);
+    if ( program_id != 0 )
+    {
+        InstallShaderVariant(features, program_id, cache_key);
+        return;
+    }
+
+    variant.pending_shaders[0] = glCreateShader(GL_VERTEX_SHADER);
+    variant.pending_shaders[1] = glCreateShader(GL_FRAGMENT_SHADER);
+    CompileShaderSource(variant.pending_shaders[0], sources[0], defines);
+    CompileShaderSource(variant.pending_shaders[1], sources[1], defines);
+    variant.pending_program = LinkGpuProgram(variant.pending_shaders[0], variant.pending_shaders[1]);
+    variant.pending_key = cache_key;
+}
+
+// Termina a compilação iniciada por CompileShaderVariant(), esperando-a se
+// necessário. Se ela teve sucesso, a variante passa a utilizar o novo
+// programa; senão, os erros são impressos e o programa anterior continua
+// em uso.
+void FinishShaderVariant(uint32_t features)
+{
+    ShaderVariant& variant = g_ShaderVariants[features];
+    GLuint program_id = variant.pending_program;
+    variant.pending_program = 0;
+
+    const char* fragment_filename = (features & SHADER_LIGHTING_DAY_NIGHT)
+                                  ? "../../src/shader_fragment-tarefa2.glsl"
+                                  : "../../src/shader_fragment-tarefa1.glsl";
+    bool compiled_ok = PrintShaderCompileLog(variant.pending_shaders[0], "../../src/shader_vertex.glsl");
+    compiled_ok = PrintShaderCompileLog(variant.pending_shaders[1], fragment_filename) && compiled_ok;
+
+    // Sem erros de compilação, verificamos a linkagem; FinishGpuProgram()
+    // também marca os shaders para deleção.
+    bool linked_ok = false;
+    if ( compiled_ok )
+    {
+        linked_ok = FinishGpuProgram(program_id, variant.pending_shaders[0], variant.pending_shaders[1]);
+    }
+    else
+    {
+        glDeleteShader(variant.pending_shaders[0]);
+        glDeleteShader(variant.pending_shaders[1]);
+    }
+
+    if ( !linked_ok )
+    {
+        fprintf(stderr, "ERROR: Shader variant %u not updated; %s.\n", (unsigned)features,
+                (variant.program != 0) ? "keeping the previous program" : "its objects will not be drawn");
+        GLState_DeleteProgram(program_id);
+        variant.failed = true;
+        variant.failed_key = variant.pending_key;
+        return;
+    }
+
+    char cache_name[32];
+    snprintf(cache_name, sizeof(cache_name), "shader_variant_%u", (unsigned)features);
+    SaveCachedProgram(cache_name, variant.pending_key, program_id);
+
+    if ( variant.program != 0 )
+        printf("Variante %u dos shaders recarregada.\n", (unsigned)features);
+    InstallShaderVariant(features, program_id, variant.pending_key);
+}
+
+// Passa a utilizar "program_id" como o programa da variante "features",
+// descartando o anterior, e configura os seus blocos e variáveis "uniform".
+void InstallShaderVariant(uint32_t features, GLuint program_id, uint64_t cache_key)
+{
+    ShaderVariant& variant = g_ShaderVariants[features];
+    GLuint previous_program = variant.program;
+    variant.program = program_id;
+    variant.cache_key = cache_key;
+    variant.failed = false;
+
+    // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
+    // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
+    // (GPU)! Veja arquivo "shader_vertex.glsl" e "shader_fragment.glsl".
+    variant.batched_uniform = glGetUniformLocation(program_id, "batched"); // Variável "batched" em shader_vertex.glsl
+
+    // Os blocos "uniform" são ligados a pontos fixos, os mesmos para todos
+    // os programas, e os buffers são ligados a esses pontos (veja
+    // SetFrameUniforms() e SetObjectUniforms()) sem depender do programa.
+    static const char* block_names[2] = { "FrameUniforms", "ObjectUniforms" };
+    static const GLuint block_bindings[2] = { FRAME_UNIFORMS_BINDING, OBJECT_UNIFORMS_BINDING };
+    for (int i = 0; i < 2; ++i)
+    {
+        GLuint block_index = glGetUniformBlockIndex(program_id, block_names[i]);
+        if (block_index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program_id, block_index, block_bindings[i]);
+    }
+
+    // Variáveis em "shader_fragment.glsl" para acesso das imagens de
+    // textura. As variantes com menos texturas não declaram as demais, e
+    // glGetUniformLocation() retorna -1, ignorado por glUniform1i(). O
+    // programa em uso vem do cache de "glstate.h", e volta a ser ligado ao
+    // final.
+    GLuint current_program = GLState_CurrentProgram();
+    GLState_UseProgram(program_id);
+    glUniform1i(glGetUniformLocation(program_id, "TextureImage0"), 0);
+    glUniform1i(glGetUniformLocation(program_id, "TextureImage1"), 1);
+    glUniform1i(glGetUniformLocation(program_id, "TextureImage2"), 2);
+    glUniform1i(glGetUniformLocation(program_id, "draw_data"), DRAW_DATA_TEXTURE_UNIT); // Em shader_vertex.glsl
+    GLState_UseProgram(current_program);
+
+    // Só então apagamos o programa anterior, para que o cache nunca guarde
+    // um nome já apagado. Se ele ainda estiver em uso, o OpenGL só o apaga
+    // de fato quando deixar de estar ligado por glUseProgram(), e
+    // GLState_DeleteProgram() esquece o programa em uso.
+    if ( previous_program != 0 )
+        GLState_DeleteProgram(previous_program);
+}
+
+// Chamada uma vez por quadro, antes do desenho. Recompila as variantes se
+// algum arquivo GLSL foi salvo, e passa a utilizar as variantes cuja
+// compilação terminou. Com a compilação em paralelo, as que ainda não
+// terminaram são verificadas de novo no próximo quadro.
+void ProcessShaderCompiles()
+{
+    if (PollFileWatcher(&g_ShaderWatcher))
+        LoadShadersFromFiles();
+
+    for (uint32_t features = 0; features < NUM_SHADER_VARIANTS; ++features)
+    {
+        GLuint pending_program = g_ShaderVariants[features].pending_program;
+        if (pending_program != 0 && IsProgramLinkComplete(pending_program))
+            FinishShaderVariant(features);
+    }
+}
+
+// Retorna os #defines que definem uma variante dos shaders: o mapeamento de
+// textura (UV_MAPPING, comparado com as constantes UV_MAPPING_* dos
+// arquivos GLSL) e o número de imagens de textura lidas por fragmento
+// (NUM_TEXTURES), que depende do modelo de iluminação.
+std::string ShaderFeatureDefines(uint32_t features)
+{
+    static const char* mappings[4] = { "UV_MAPPING_SPHERICAL", "UV_MAPPING_PLANAR_XY", "UV_MAPPING_TEXCOORDS", "UV_MAPPING_TEXCOORDS" };
+    int num_textures = (features & SHADER_LIGHTING_DAY_NIGHT) ? 2 : 1;
+
+    char defines[128];
+    snprintf(defines, sizeof(defines), "#define UV_MAPPING %s\n#define NUM_TEXTURES %d\n",
+             mappings[features & SHADER_MAPPING_MASK], num_textures);
+    return defines;
+}
+
+// Características dos shaders de cada objeto da cena (veja SPHERE, BUNNY e
+// PLANE em main()): o mapeamento de textura que antes era escolhido pelo
+// fragment shader a partir do object_id, e o modelo de iluminação comum a
+// todos os objetos.
+uint32_t SceneObjectShaderFeatures(GLint object_id)
+{
+    uint32_t mapping = SHADER_MAPPING_TEXCOORDS;
+    if (object_id == SPHERE)
+        mapping = SHADER_MAPPING_SPHERICAL;
+    else if (object_id == BUNNY)
+        mapping = SHADER_MAPPING_PLANAR_XY;
+    return mapping | g_LightingShaderFeatures;
+}
+
+// Liga um programa de GPU de uma variante dos shaders, e passa a utilizar a
+// localização da sua variável "batched".
+void UseGpuProgram(GLuint program)
+{
+    GLState_UseProgram(program);
+    g_batched_uniform = -1;
+    for (int features = 0; features < NUM_SHADER_VARIANTS; ++features)
+    {
+        if (program != 0 && g_ShaderVariants[features].program == program)
+        {
+            g_batched_uniform = g_ShaderVariants[features].batched_uniform;
+            break;
+        }
+    }
+}
+
+// Função que pega a matriz M e guarda a mesma no topo da pilha
+void PushMatrix(glm::mat4 M)
+{
+    g_MatrixStack.push(M);
+}
+
+// Função que remove a matriz atualmente no topo da pilha e armazena a mesma na variável M
+void PopMatrix(glm::mat4& M)
+{
+    if ( g_MatrixStack.empty() )
+    {
+        M = Matrix_Identity();
+    }
+    else
+    {
+        M = g_MatrixStack.top();
+        g_MatrixStack.pop();
+    }
+}
+
+// Função que computa as normais de um ObjModel, caso elas não tenham sido
+// especificadas dentro do arquivo ".obj"
+void ComputeNormals(ObjModel* model)
+{
+    if ( !model->attrib.normals.empty() )
+        return;
+
+    // Primeiro computamos as normais para todos os TRIÂNGULOS.
+    // Segundo, computamos as normais dos VÉRTICES através do método proposto
+    // por Gouraud, onde a normal de cada vértice vai ser a média das normais de
+    // todas as faces que compartilham este vértice. Veja "normals.cpp".
+
+    size_t num_vertices = model->attrib.vertices.size() / 3;
+
+    // Juntamos os índices dos vértices dos triângulos de todos os objetos.
+    std::vector<uint32_t> triangles;
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        tinyobj::mesh_t& mesh = model->shapes[shape].mesh;
+        size_t num_triangles = mesh.num_face_vertices.size();
+
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        {
+            assert(mesh.num_face_vertices[triangle] == 3);
+
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t& idx = mesh.indices[3*triangle + vertex];
+                triangles.push_back(idx.vertex_index);
+                idx.normal_index = idx.vertex_index;
+            }
+        }
+    }
+
+    model->attrib.normals.resize( 3*num_vertices );
+
+    ComputeVertexNormals(model->attrib.vertices.data(), num_vertices,
+                         triangles.data(), triangles.size() / 3,
+                         g_UseAngleWeightedNormals ? NORMAL_WEIGHTING_ANGLE : NORMAL_WEIGHTING_AREA,
+                         g_NormalThreads, model->attrib.normals.data());
+}
+
+// Função hash para a tupla (vertex_index, normal_index, texcoord_index) de
+// um tinyobj::index_t. Utilizada por WeldVertices() abaixo.
+struct IndexTupleHash
+{
+    size_t operator()(const tinyobj::index_t& idx) const
+    {
+        size_t h = std::hash<int>()(idx.vertex_index);
+        h ^= std::hash<int>()(idx.normal_index)   + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<int>()(idx.texcoord_index) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
+    }
+};
+
+// Comparação de igualdade entre duas tuplas tinyobj::index_t.
+struct IndexTupleEqual
+{
+    bool operator()(const tinyobj::index_t& a, const tinyobj::index_t& b) const
+    {
+        return a.vertex_index   == b.vertex_index
+            && a.normal_index   == b.normal_index
+            && a.texcoord_index == b.texcoord_index;
+    }
+};
+
+// Função que "solda" os vértices de uma malha: cada tupla distinta
+// (vertex_index, normal_index, texcoord_index) do arquivo OBJ vira um único
+// vértice em unique_vertices[], e indices[] passa a conter, para cada vértice
+// de cada triângulo, a posição deste vértice dentro de unique_vertices[].
+// Assim, vértices compartilhados entre triângulos vizinhos são enviados para a
+// GPU (e processados pelo Vertex Shader) uma única vez.
+void WeldVertices(const tinyobj::mesh_t& mesh, std::vector<tinyobj::index_t>* unique_vertices, std::vector<GLuint>* indices)
+{
+    std::unordered_map<tinyobj::index_t, GLuint, IndexTupleHash, IndexTupleEqual> vertex_ids;
+    vertex_ids.reserve(mesh.indices.size());
+
+    unique_vertices->clear();
+    indices->clear();
+    indices->reserve(mesh.indices.size());
+
+    for (size_t i = 0; i < mesh.indices.size(); ++i)
+    {
+        const tinyobj::index_t& idx = mesh.indices[i];
+
+        auto inserted = vertex_ids.insert(std::make_pair(idx, (GLuint)unique_vertices->size()));
+        if (inserted.second)
+            unique_vertices->push_back(idx);
+
+        indices->push_back(inserted.first->second);
+    }
+}
+
+// Posições (3 floats por vértice) dos vértices soldados por WeldVertices().
+std::vector<float> GatherPositions(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::index_t>& unique_vertices)
+{
+    std::vector<float> positions(unique_vertices.size() * 3);
+    for (size_t v = 0; v < unique_vertices.size(); ++v)
+        for (int k = 0; k < 3; ++k)
+            positions[3*v + k] = attrib.vertices[3*unique_vertices[v].vertex_index + k];
+    return positions;
+}
+
+// Limite da perda de eficiência do cache de vértices aceita por
+// OptimizeOverdraw() em troca de menos overdraw: 5%.
+#define OVERDRAW_THRESHOLD 1.05f
+
+// Reordena os triângulos de uma malha soldada por WeldVertices() para o
+// cache de vértices e para reduzir overdraw, e depois renumera os vértices na
+// ordem em que são utilizados. Veja "meshoptimize.h".
+void OptimizeWeldedMesh(const tinyobj::attrib_t& attrib, std::vector<tinyobj::index_t>* unique_vertices, std::vector<GLuint>* indices)
+{
+    size_t num_vertices = unique_vertices->size();
+    std::vector<float> positions = GatherPositions(attrib, *unique_vertices);
+
+    OptimizeVertexCache(indices->data(), indices->size(), num_vertices, g_VertexCacheSize);
+    OptimizeOverdraw(indices->data(), indices->size(), positions.data(), num_vertices, g_VertexCacheSize, OVERDRAW_THRESHOLD);
+
+    std::vector<uint32_t> remap(num_vertices);
+    OptimizeVertexFetch(indices->data(), indices->size(), num_vertices, remap.data());
+
+    std::vector<tinyobj::index_t> reordered(num_vertices);
+    for (size_t v = 0; v < num_vertices; ++v)
+        reordered[remap[v]] = (*unique_vertices)[v];
+    unique_vertices->swap(reordered);
+}
+
+// Fração dos triângulos da malha original mantida em cada nível de detalhe:
+// o LOD l tem cerca de LOD_REDUCTION^l dos triângulos. Não geramos LODs para
+// malhas com menos de LOD_MIN_TRIANGLES triângulos, nem LODs que não reduzem
+// o número de triângulos em pelo menos 25% em relação ao anterior (o que
+// acontece quando a maior parte dos vértices está em bordas ou costuras).
+#define LOD_REDUCTION     0.25f
+#define LOD_MIN_TRIANGLES 64
+#define LOD_MIN_REDUCTION 0.75f
+
+// Gera até MAX_LODS-1 versões simplificadas de uma malha soldada por
+// WeldVertices() (e otimizada por OptimizeWeldedMesh()), utilizando os mesmos
+// vértices. Os índices de cada LOD são adicionados ao final de "indices", e
+// lod_num_indices recebe o número de índices de cada LOD, incluindo o
+// original. Veja "simplify.h".
+void BuildLevelsOfDetail(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::index_t>& unique_vertices, std::vector<GLuint>* indices, std::vector<size_t>* lod_num_indices)
+{
+    size_t num_vertices = unique_vertices.size();
+    size_t num_indices = indices->size();
+    lod_num_indices->assign(1, num_indices);
+
+    if (num_indices / 3 < LOD_MIN_TRIANGLES)
+        return;
+
+    std::vector<float> positions = GatherPositions(attrib, unique_vertices);
+    std::vector<GLuint> lod_indices(num_indices);
+
+    float reduction = 1.0f;
+    while (lod_num_indices->size() < MAX_LODS)
+    {
+        // Cada LOD é simplificado a partir da malha original, e não do LOD
+        // anterior, para que o erro seja medido sempre em relação a ela.
+        reduction *= LOD_REDUCTION;
+        size_t target = size_t(num_indices / 3 * reduction) * 3;
+        size_t count = SimplifyMesh(lod_indices.data(), indices->data(), num_indices,
+                                    positions.data(), num_vertices, target, NULL);
+
+        if (count / 3 < LOD_MIN_TRIANGLES / 4 || count > lod_num_indices->back() * LOD_MIN_REDUCTION)
+            break;
+
+        if (g_OptimizeMeshes)
+        {
+            OptimizeVertexCache(lod_indices.data(), count, num_vertices, g_VertexCacheSize);
+            OptimizeOverdraw(lod_indices.data(), count, positions.data(), num_vertices, g_VertexCacheSize, OVERDRAW_THRESHOLD);
+        }
+
+        indices->insert(indices->end(), lod_indices.begin(), lod_indices.begin() + count);
+        lod_num_indices->push_back(count);
+    }
+}
+
+// Retorna o menor tipo de índice de OpenGL capaz de endereçar num_vertices
+// vértices. Veja o uso de GLubyte para os índices no Laboratório 1.
+GLenum SmallestIndexType(size_t num_vertices)
+{
+    if (num_vertices <= 256)
+        return GL_UNSIGNED_BYTE;
+    else if (num_vertices <= 65536)
+        return GL_UNSIGNED_SHORT;
+    else
+        return GL_UNSIGNED_INT;
+}
+
+// Constrói a representação de um ObjModel como malha de triângulos, pronta
+// para ser enviada para a GPU: vértices intercalados no formato vertex_format
+// e índices do menor tipo possível.
+void BuildMeshData(ObjModel* model, VertexFormat vertex_format, MeshData* mesh)
+{
+    mesh->vertex_format = vertex_format;
+    mesh->vertex_data.clear();
+    mesh->num_vertices = 0;
+    mesh->index_data.clear();
+    mesh->num_indices = 0;
+    mesh->file.data = NULL;
+    mesh->objects.clear();
+
+    size_t vertex_size = VertexFormatSize(vertex_format);
+
+    std::vector<GLuint> indices;
+
+    // Vértices únicos e índices de cada objeto, computados por WeldVertices().
+    std::vector<tinyobj::index_t> unique_vertices;
+    std::vector<GLuint> shape_indices;
+    std::vector<size_t> lod_num_indices;
+
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        size_t first_index = indices.size();
+        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
+
+        // Cada objeto possui seus próprios vértices, que são armazenados após
+        // os vértices dos objetos anteriores do mesmo modelo. Isto permite
+        // quantizar as posições de cada objeto relativas à sua própria bbox.
+        WeldVertices(model->shapes[shape].mesh, &unique_vertices, &shape_indices);
+        if (g_OptimizeMeshes)
+            OptimizeWeldedMesh(model->attrib, &unique_vertices, &shape_indices);
+        BuildLevelsOfDetail(model->attrib, unique_vertices, &shape_indices, &lod_num_indices);
+        GLuint first_vertex = mesh->num_vertices;
+
+        for (size_t i = 0; i < shape_indices.size(); ++i)
+            indices.push_back(first_vertex + shape_indices[i]);
+
+        const float maxval = std::numeric_limits<float>::max();
+
+        glm::vec3 bbox_min = glm::vec3(maxval,maxval,maxval);
+        glm::vec3 bbox_max = glm::vec3(-maxval,-maxval,-maxval);
+
+        for (size_t vertex = 0; vertex < unique_vertices.size(); ++vertex)
+        {
+            tinyobj::index_t idx = unique_vertices[vertex];
+
+            const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
+            const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
+            const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
+
+            bbox_min.x = std::min(bbox_min.x, vx);
+            bbox_min.y = std::min(bbox_min.y, vy);
+            bbox_min.z = std::min(bbox_min.z, vz);
+            bbox_max.x = std::max(bbox_max.x, vx);
+            bbox_max.y = std::max(bbox_max.y, vy);
+            bbox_max.z = std::max(bbox_max.z, vz);
+        }
+
+        // A quantização das posições precisa da bbox completa do objeto, então
+        // os vértices são escritos somente após o laço acima.
+        glm::vec3 bbox_extent = bbox_max - bbox_min;
+
+        mesh->vertex_data.resize((mesh->num_vertices + unique_vertices.size()) * vertex_size);
+
+        for (size_t vertex = 0; vertex < unique_vertices.size(); ++vertex)
+        {
+            tinyobj::index_t idx = unique_vertices[vertex];
+
+            glm::vec3 position = glm::vec3(
+                model->attrib.vertices[3*idx.vertex_index + 0],
+                model->attrib.vertices[3*idx.vertex_index + 1],
+                model->attrib.vertices[3*idx.vertex_index + 2]
+            );
+
+            // Inspecionando o código da tinyobjloader, o aluno Bernardo
+            // Sulzbach (2017/1) apontou que a maneira correta de testar se
+            // existem normais e coordenadas de textura no ObjModel é
+            // comparando se o índice retornado é -1. Fazemos isso abaixo.
+
+            glm::vec3 normal = glm::vec3(0.0f,0.0f,0.0f);
+            if ( idx.normal_index != -1 )
+            {
+                normal.x = model->attrib.normals[3*idx.normal_index + 0];
+                normal.y = model->attrib.normals[3*idx.normal_index + 1];
+                normal.z = model->attrib.normals[3*idx.normal_index + 2];
+            }
+
+            glm::vec2 texcoords = glm::vec2(0.0f,0.0f);
+            if ( idx.texcoord_index != -1 )
+            {
+                texcoords.x = model->attrib.texcoords[2*idx.texcoord_index + 0];
+                texcoords.y = model->attrib.texcoords[2*idx.texcoord_index + 1];
+            }
+
+            unsigned char* dst = mesh->vertex_data.data() + (mesh->num_vertices + vertex) * vertex_size;
+
+            if ( vertex_format == VERTEX_FORMAT_QUANTIZED )
+            {
+                QuantizedVertex v;
+                for (int i = 0; i < 3; ++i)
+                {
+                    float t = bbox_extent[i] > 0.0f ? (position[i] - bbox_min[i]) / bbox_extent[i] : 0.0f;
+                    v.position[i] = glm::packUnorm1x16(t);
+                }
+                v.position[3] = 65535; // W = 1.0 após normalização
+                v.normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+                v.texcoords[0] = glm::packHalf1x16(texcoords.x);
+                v.texcoords[1] = glm::packHalf1x16(texcoords.y);
+                memcpy(dst, &v, sizeof(v));
+            }
+            else
+            {
+                FloatVertex v;
+                v.position[0] = position.x; v.position[1] = position.y; v.position[2] = position.z; v.position[3] = 1.0f;
+                v.normal[0] = normal.x; v.normal[1] = normal.y; v.normal[2] = normal.z; v.normal[3] = 0.0f;
+                v.texcoords[0] = texcoords.x; v.texcoords[1] = texcoords.y;
+                memcpy(dst, &v, sizeof(v));
+            }
+        }
+
+        mesh->num_vertices += unique_vertices.size();
+
+        SceneObject theobject;
+        theobject.name           = model->shapes[shape].name;
+        theobject.first_index    = first_index; // Primeiro índice
+        theobject.num_indices    = lod_num_indices[0]; // Número de indices
+        theobject.rendering_mode = GL_TRIANGLES;       // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
+        theobject.vertex_array_object_id = 0; // Definido por AddMeshToVirtualScene()
+        theobject.arena_mesh = 0;             // Idem
+        theobject.resident = false;           // Idem
+
+        theobject.bbox_min = bbox_min;
+        theobject.bbox_max = bbox_max;
+        theobject.quantized_positions = (vertex_format == VERTEX_FORMAT_QUANTIZED);
+
+        // Os índices dos LODs ficam logo após os do objeto original.
+        theobject.num_lods = lod_num_indices.size();
+        theobject.current_lod = 0;
+        for (int lod = 0; lod < theobject.num_lods; ++lod)
+        {
+            theobject.lod_first_index[lod] = lod == 0 ? first_index : theobject.lod_first_index[lod-1] + lod_num_indices[lod-1];
+            theobject.lod_num_indices[lod] = lod_num_indices[lod];
+        }
+
+        mesh->objects.push_back(theobject);
+    }
+
+    // Utilizamos o menor tipo de índice capaz de endereçar todos os vértices
+    // do modelo: GLubyte, GLushort ou GLuint.
+    mesh->index_type = SmallestIndexType(mesh->num_vertices);
+    mesh->num_indices = indices.size();
+
+    size_t index_size = IndexTypeSize(mesh->index_type);
+    mesh->index_data.resize(indices.size() * index_size);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        if (mesh->index_type == GL_UNSIGNED_BYTE)
+            ((GLubyte*)mesh->index_data.data())[i] = (GLubyte)indices[i];
+        else if (mesh->index_type == GL_UNSIGNED_SHORT)
+            ((GLushort*)mesh->index_data.data())[i] = (GLushort)indices[i];
+        else
+            ((GLuint*)mesh->index_data.data())[i] = indices[i];
+    }
+
+    for (size_t i = 0; i < mesh->objects.size(); ++i)
+        mesh->objects[i].index_type = mesh->index_type;
+}
+
+// Envia uma malha construída por BuildMeshData(), lida do arquivo filename,
+// para a arena de geometria g_GeometryArena, e adiciona seus objetos na cena
+// virtual g_VirtualScene. Com upload_data == false, o espaço na arena é
+// apenas reservado, e o índice da malha na arena é retornado em *arena_mesh;
+// os objetos só são desenhados depois que ProcessAssetUploads() terminar de
+// preencher os buffers.
+void AddMeshToVirtualScene(const char* filename, const MeshData& mesh, bool upload_data, uint32_t* arena_mesh)
+{
+    VertexFormat vertex_format = mesh.vertex_format;
+    size_t num_vertices = mesh.num_vertices;
+    GLenum index_type = mesh.index_type;
+    size_t num_indices = mesh.num_indices;
+
+    GeometryArena& arena = g_GeometryArena;
+    if (arena.vertex_array_object_id == 0)
+    {
+        InitGeometryArena(&arena, vertex_format, VertexFormatSize(vertex_format), SetupArenaVertexAttributes,
+                          std::max<size_t>(GEOMETRY_ARENA_INITIAL_VERTICES, num_vertices),
+                          std::max<size_t>(GEOMETRY_ARENA_INITIAL_INDEX_BYTES, MeshIndexBytes(mesh)));
+    }
+    else if (vertex_format != arena.vertex_format)
+    {
+        fprintf(stderr, "ERROR: Mesh \"%s\" has a different vertex format from the geometry arena.\n", filename);
+        std::exit(EXIT_FAILURE);
+    }
+
+    uint32_t mesh_index = AllocateArenaMesh(&arena, filename, num_vertices, MeshIndexBytes(mesh));
+    const ArenaMesh& arena_data = arena.meshes[mesh_index];
+
+    if (upload_data)
+    {
+        // Todos os atributos de cada vértice (posição, normal e coordenadas
+        // de textura) ficam lado a lado ("interleaved") no VBO da arena.
+        GLState_BindBuffer(GL_ARRAY_BUFFER, arena.vertex_buffer_id);
+        glBufferSubData(GL_ARRAY_BUFFER, arena_data.base_vertex * VertexFormatSize(vertex_format), MeshVertexBytes(mesh), MeshVertexData(mesh));
+        GLState_BindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // O EBO da arena é ligado através de GL_COPY_WRITE_BUFFER, pois
+        // ligá-lo em GL_ELEMENT_ARRAY_BUFFER alteraria o VAO atual.
+        GLState_BindBuffer(GL_COPY_WRITE_BUFFER, arena.index_buffer_id);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, arena_data.index_offset, MeshIndexBytes(mesh), MeshIndexData(mesh));
+        GLState_BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    std::vector<SceneObjectHandle> handles;
+    for (size_t i = 0; i < mesh.objects.size(); ++i)
+    {
+        SceneObject theobject = mesh.objects[i];
+        theobject.vertex_array_object_id = arena.vertex_array_object_id;
+        theobject.arena_mesh = mesh_index;
+        theobject.resident = upload_data;
+        SceneObjectHandle handle = FindSceneObject(theobject.name.c_str());
+        SetSceneObject(handle, theobject);
+        handles.push_back(handle);
+    }
+    arena.meshes[mesh_index].objects = handles;
+
+    if (arena_mesh != NULL)
+        *arena_mesh = mesh_index;
+
+    if (upload_data)
+        printf("Malha enviada para a GPU: %lu vértices x %lu bytes, %lu índices x %lu bytes.\n",
+            (unsigned long)num_vertices, (unsigned long)VertexFormatSize(vertex_format),
+            (unsigned long)num_indices, (unsigned long)IndexTypeSize(index_type));
+}
+
+// Arquivos de cache de malhas: para cada arquivo "modelo.obj" guardamos em
+// "modelo.obj.meshcache" os vértices e índices já no formato da GPU (isto é,
+// o resultado de BuildMeshData()), junto com os dados de cada SceneObject.
+// Assim, nas próximas execuções do programa não precisamos ler o arquivo OBJ
+// em formato texto, computar normais e construir os vértices novamente.
+//
+// Formato do arquivo (valores na ordem de bytes nativa da máquina):
+//
+//    MeshCacheHeader
+//    MeshCacheObject x num_objects
+//    vértices (a partir de vertex_data_offset)
+//    índices  (a partir de index_data_offset)
+//
+// O cache é considerado válido somente se o tamanho e a data de modificação
+// do arquivo OBJ, a versão do formato, o formato de vértices, a otimização
+// da malha (veja OptimizeWeldedMesh()) e o peso dos triângulos nas normais
+// (veja ComputeNormals()) forem iguais aos guardados no cabeçalho, e se o
+// tipo de índices, os tamanhos e os intervalos de índices de cada objeto
+// forem consistentes com o tamanho do arquivo.
+#define MESH_CACHE_MAGIC   0x48534d46 // "FMSH"
+#define MESH_CACHE_VERSION 4
+
+struct MeshCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t source_size;  // Tamanho do arquivo OBJ de origem
+    int64_t  source_mtime; // Data de modificação do arquivo OBJ de origem
+    uint32_t vertex_format;
+    uint32_t index_type;
+    uint32_t vertex_cache_size; // Cache considerado por OptimizeWeldedMesh(), ou 0 se a malha não foi otimizada
+    uint32_t normal_weighting;  // Peso dos triângulos nas normais computadas por ComputeNormals()
+    uint64_t num_vertices;
+    uint64_t num_indices;
+    uint64_t num_objects;
+    uint64_t vertex_data_offset;
+    uint64_t index_data_offset;
+};
+
+struct MeshCacheObject
+{
+    char     name[64];
+    uint64_t first_index;
+    uint64_t num_indices;
+    float    bbox_min[3];
+    float    bbox_max[3];
+    uint32_t quantized_positions;
+    uint32_t num_lods;
+    uint64_t lod_first_index[MAX_LODS];
+    uint64_t lod_num_indices[MAX_LODS];
+};
+
+// Valor de MeshCacheHeader::vertex_cache_size para as opções atuais.
+uint32_t MeshCacheVertexCacheSize()
+{
+    return g_OptimizeMeshes ? g_VertexCacheSize : 0;
+}
+
+// Retorna true se o intervalo [first, first+count) está dentro de [0, total),
+// sem overflow na soma.
+bool MeshCacheRangeValid(uint64_t first, uint64_t count, uint64_t total)
+{
+    return first <= total && count <= total - first;
+}
+
+// Retorna true se os intervalos de índices de um objeto do cache (e de cada
+// um dos seus níveis de detalhe) estão dentro dos índices da malha.
+bool MeshCacheObjectValid(const MeshCacheObject& o, uint64_t num_indices)
+{
+    if (!MeshCacheRangeValid(o.first_index, o.num_indices, num_indices))
+        return false;
+
+    int num_lods = std::max(1, std::min((int)o.num_lods, MAX_LODS));
+    for (int lod = 0; lod < num_lods; ++lod)
+    {
+        if (!MeshCacheRangeValid(o.lod_first_index[lod], o.lod_num_indices[lod], num_indices))
+            return false;
+    }
+    return true;
+}
+
+// Valor de MeshCacheHeader::normal_weighting para as opções atuais.
+uint32_t MeshCacheNormalWeighting()
+{
+    return g_UseAngleWeightedNormals ? NORMAL_WEIGHTING_ANGLE : NORMAL_WEIGHTING_AREA;
+}
+
+// Nome do arquivo de cache correspondente a um arquivo OBJ.
+std::string MeshCacheFilename(const char* obj_filename)
+{
+    return std::string(obj_filename) + ".meshcache";
+}
+
+// Tenta carregar a malha de "obj_filename" a partir do seu arquivo de cache.
+// Os vértices e índices não são copiados: o arquivo continua mapeado em
+// memória, e os dados são enviados diretamente dele para a GPU (veja
+// AddMeshToVirtualScene() e UploadAssetPart()), até FreeMeshData(). Retorna
+// false se o cache não existir ou estiver desatualizado.
+bool LoadMeshCache(const char* obj_filename, VertexFormat vertex_format, MeshData* mesh)
+{
+    uint64_t source_size;
+    int64_t  source_mtime;
+    if (!GetFileSizeAndModificationTime(obj_filename, &source_size, &source_mtime))
+        return false;
+
+    std::string cache_filename = MeshCacheFilename(obj_filename);
+
+    MappedFile file;
+    if (!MapFile(cache_filename.c_str(), &file))
+        return false;
+
+    const MeshCacheHeader* header = (const MeshCacheHeader*)file.data;
+
+    bool valid = file.size >= sizeof(MeshCacheHeader)
+              && header->magic == MESH_CACHE_MAGIC
+              && header->version == MESH_CACHE_VERSION
+              && header->source_size == source_size
+              && header->source_mtime == source_mtime
+              && header->vertex_format == (uint32_t)vertex_format
+              && header->vertex_cache_size == MeshCacheVertexCacheSize()
+              && header->normal_weighting == MeshCacheNormalWeighting()
+              && (header->index_type == GL_UNSIGNED_BYTE
+                  || header->index_type == GL_UNSIGNED_SHORT
+                  || header->index_type == GL_UNSIGNED_INT);
+
+    // Um arquivo truncado ou corrompido não pode levar a leituras fora do
+    // arquivo mapeado, nem a desenhos fora dos índices da malha. Os tamanhos
+    // são comparados por divisão, para que valores enormes não causem
+    // overflow nas multiplicações.
+    if (valid)
+    {
+        size_t vertex_size = VertexFormatSize(vertex_format);
+        size_t index_size  = IndexTypeSize(header->index_type);
+
+        valid = header->num_objects <= (file.size - sizeof(MeshCacheHeader)) / sizeof(MeshCacheObject)
+             && header->vertex_data_offset <= file.size
+             && header->num_vertices <= (file.size - header->vertex_data_offset) / vertex_size
+             && header->index_data_offset <= file.size
+             && header->num_indices <= (file.size - header->index_data_offset) / index_size;
+    }
+
+    const MeshCacheObject* cached_objects = (const MeshCacheObject*)(file.data + sizeof(MeshCacheHeader));
+    for (size_t i = 0; valid && i < header->num_objects; ++i)
+        valid = MeshCacheObjectValid(cached_objects[i], header->num_indices);
+
+    if (!valid)
+    {
+        UnmapFile(&file);
+        return false;
+    }
+
+    printf("Carregando malha do cache \"%s\"...\n", cache_filename.c_str());
+
+    std::vector<SceneObject>& objects = mesh->objects;
+    objects.resize(header->num_objects);
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        const MeshCacheObject& o = cached_objects[i];
+        objects[i].name           = std::string(o.name, strnlen(o.name, sizeof(o.name)));
+        objects[i].first_index    = o.first_index;
+        objects[i].num_indices    = o.num_indices;
+        objects[i].rendering_mode = GL_TRIANGLES;
+        objects[i].index_type     = header->index_type;
+        objects[i].vertex_array_object_id = 0;
+        objects[i].arena_mesh = 0;
+        objects[i].resident = false;
+        objects[i].bbox_min = glm::vec3(o.bbox_min[0], o.bbox_min[1], o.bbox_min[2]);
+        objects[i].bbox_max = glm::vec3(o.bbox_max[0], o.bbox_max[1], o.bbox_max[2]);
+        objects[i].quantized_positions = o.quantized_positions != 0;
+        objects[i].num_lods = std::max(1, std::min((int)o.num_lods, MAX_LODS));
+        objects[i].current_lod = 0;
+        for (int lod = 0; lod < objects[i].num_lods; ++lod)
+        {
+            objects[i].lod_first_index[lod] = o.lod_first_index[lod];
+            objects[i].lod_num_indices[lod] = o.lod_num_indices[lod];
+        }
+        printf("- Objeto '%s'\n", objects[i].name.c_str());
+    }
+
+    mesh->vertex_format = vertex_format;
+    mesh->vertex_data.clear();
+    mesh->num_vertices  = header->num_vertices;
+    mesh->index_type    = header->index_type;
+    mesh->index_data.clear();
+    mesh->num_indices   = header->num_indices;
+    mesh->file = file;
+    mesh->file_vertex_offset = header->vertex_data_offset;
+    mesh->file_index_offset  = header->index_data_offset;
+
+    printf("OK.\n");
+    return true;
+}
+
+// Grava o arquivo de cache de "obj_filename" com a malha construída por
+// BuildMeshData().
+void SaveMeshCache(const char* obj_filename, const MeshData& mesh)
+{
+    uint64_t source_size;
+    int64_t  source_mtime;
+    if (!GetFileSizeAndModificationTime(obj_filename, &source_size, &source_mtime))
+        return;
+
+    std::vector<MeshCacheObject> cached_objects(mesh.objects.size());
+    for (size_t i = 0; i < mesh.objects.size(); ++i)
+    {
+        const SceneObject& o = mesh.objects[i];
+        MeshCacheObject& c = cached_objects[i];
+
+        // Nomes muito longos não cabem no registro de tamanho fixo; nesse
+        // caso simplesmente não utilizamos o cache para este modelo.
+        if (o.name.size() > sizeof(c.name))
+            return;
+
+        memset(&c, 0, sizeof(c));
+        memcpy(c.name, o.name.data(), o.name.size());
+        c.first_index = o.first_index;
+        c.num_indices = o.num_indices;
+        for (int j = 0; j < 3; ++j)
+        {
+            c.bbox_min[j] = o.bbox_min[j];
+            c.bbox_max[j] = o.bbox_max[j];
+        }
+        c.quantized_positions = o.quantized_positions ? 1 : 0;
+        c.num_lods = o.num_lods;
+        for (int lod = 0; lod < o.num_lods; ++lod)
+        {
+            c.lod_first_index[lod] = o.lod_first_index[lod];
+            c.lod_num_indices[lod] = o.lod_num_indices[lod];
+        }
+    }
+
+    // Alinhamos o início dos vértices e dos índices em 16 bytes.
+    const uint64_t alignment = 16;
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic         = MESH_CACHE_MAGIC;
+    header.version       = MESH_CACHE_VERSION;
+    header.source_size   = source_size;
+    header.source_mtime  = source_mtime;
+    header.vertex_format = mesh.vertex_format;
+    header.index_type    = mesh.index_type;
+    header.vertex_cache_size = MeshCacheVertexCacheSize();
+    header.normal_weighting  = MeshCacheNormalWeighting();
+    header.num_vertices  = mesh.num_vertices;
+    header.num_indices   = mesh.num_indices;
+    header.num_objects   = cached_objects.size();
+    header.vertex_data_offset = sizeof(MeshCacheHeader) + cached_objects.size() * sizeof(MeshCacheObject);
+    header.vertex_data_offset = (header.vertex_data_offset + alignment - 1) / alignment * alignment;
+    header.index_data_offset  = header.vertex_data_offset + mesh.vertex_data.size();
+    header.index_data_offset  = (header.index_data_offset + alignment - 1) / alignment * alignment;
+
+    std::string cache_filename = MeshCacheFilename(obj_filename);
+    FILE* f = fopen(cache_filename.c_str(), "wb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "WARNING: Cannot write mesh cache \"%s\".\n", cache_filename.c_str());
+        return;
+    }
+
+    // Bytes de preenchimento antes dos vértices e antes dos índices.
+    static const unsigned char zeros[16] = {0};
+    size_t vertex_padding = header.vertex_data_offset - sizeof(MeshCacheHeader) - cached_objects.size() * sizeof(MeshCacheObject);
+    size_t index_padding  = header.index_data_offset - header.vertex_data_offset - mesh.vertex_data.size();
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = ok && fwrite(cached_objects.data(), sizeof(MeshCacheObject), cached_objects.size(), f) == cached_objects.size();
+    ok = ok && fwrite(zeros, 1, vertex_padding, f) == vertex_padding;
+    ok = ok && fwrite(mesh.vertex_data.data(), 1, mesh.vertex_data.size(), f) == mesh.vertex_data.size();
+    ok = ok && fwrite(zeros, 1, index_padding, f) == index_padding;
+    ok = ok && fwrite(mesh.index_data.data(), 1, mesh.index_data.size(), f) == mesh.index_data.size();
+
+    if (fclose(f) != 0 || !ok)
+    {
+        fprintf(stderr, "WARNING: Cannot write mesh cache \"%s\".\n", cache_filename.c_str());
+        remove(cache_filename.c_str());
+    }
+}
+
+// Constrói a malha de um arquivo ".obj", pronta para ser enviada para a GPU.
+// Se existir um arquivo de cache válido (veja LoadMeshCache()), o arquivo OBJ
+// não é lido. Não utiliza OpenGL, e portanto pode ser chamada pelas threads
+// de carregamento (veja StartAssetLoaderThreads()).
+void LoadObjMeshData(const char* filename, VertexFormat vertex_format, MeshData* mesh)
+{
+    if (g_UseMeshCache && LoadMeshCache(filename, vertex_format, mesh))
+        return;
+
+    ObjModel model(filename);
+    ComputeNormals(&model);
+
+    BuildMeshData(&model, vertex_format, mesh);
+
+    if (g_UseMeshCache)
+        SaveMeshCache(filename, *mesh);
+}
+
+// Carrega um modelo geométrico de um arquivo ".obj" e adiciona seus objetos
+// na cena virtual.
+void LoadObjModelAndAddToVirtualScene(const char* filename)
+{
+    VertexFormat vertex_format = g_UseQuantizedVertexFormat ? VERTEX_FORMAT_QUANTIZED : VERTEX_FORMAT_FLOAT;
+
+    MeshData mesh;
+    LoadObjMeshData(filename, vertex_format, &mesh);
+    AddMeshToVirtualScene(filename, mesh);
+    FreeMeshData(&mesh);
+}
+
+const unsigned char* MeshVertexData(const MeshData& mesh)
+{
+    return mesh.file.data != NULL ? mesh.file.data + mesh.file_vertex_offset : mesh.vertex_data.data();
+}
+
+const unsigned char* MeshIndexData(const MeshData& mesh)
+{
+    return mesh.file.data != NULL ? mesh.file.data + mesh.file_index_offset : mesh.index_data.data();
+}
+
+size_t MeshVertexBytes(const MeshData& mesh)
+{
+    return mesh.num_vertices * VertexFormatSize(mesh.vertex_format);
+}
+
+size_t MeshIndexBytes(const MeshData& mesh)
+{
+    return mesh.num_indices * IndexTypeSize(mesh.index_type);
+}
+
+// Libera os vértices e índices de uma malha, depois de enviados para a GPU.
+// Os objetos da malha continuam em mesh->objects.
+void FreeMeshData(MeshData* mesh)
+{
+    if (mesh->file.data != NULL)
+        UnmapFile(&mesh->file);
+    mesh->file.data = NULL;
+    std::vector<unsigned char>().swap(mesh->vertex_data);
+    std::vector<unsigned char>().swap(mesh->index_data);
+}
+
+// Remove da cena os objetos carregados do arquivo filename por
+// LoadObjModelAndAddToVirtualScene(), liberando o espaço da sua malha na
+// arena de geometria, que pode ser reutilizado por outras malhas. Retorna
+// false se o modelo ainda está sendo carregado por ProcessAssetUploads().
+bool UnloadObjModel(const char* filename)
+{
+    GeometryArena& arena = g_GeometryArena;
+    for (size_t i = 0; i < arena.meshes.size(); ++i)
+    {
+        if (!arena.meshes[i].live || arena.meshes[i].filename != filename)
+            continue;
+
+        // Malhas ainda sendo enviadas por ProcessAssetUploads() não podem
+        // ser liberadas.
+        const std::vector<SceneObjectHandle>& objects = arena.meshes[i].objects;
+        bool resident = true;
+        for (size_t j = 0; j < objects.size(); ++j)
+            resident = resident && g_VirtualScene.resident[objects[j]];
+        if (!resident)
+        {
+            fprintf(stderr, "WARNING: Model \"%s\" is still being loaded and cannot be unloaded.\n", filename);
+            return false;
+        }
+
+        // Os objetos da malha deixam de ser desenhados, como se nunca
+        // tivessem sido carregados.
+        for (size_t j = 0; j < objects.size(); ++j)
+        {
+            SceneObjectHandle handle = objects[j];
+            if (g_VirtualScene.arena_meshes[handle] != i || !g_VirtualScene.loaded[handle])
+                continue; // Objeto substituído por outro de mesmo nome, de outra malha
+            g_VirtualScene.loaded[handle] = 0;
+            g_VirtualScene.resident[handle] = 0;
+        }
 
-    GLuint textureunit = g_NumLoadedTextures;
-    glActiveTexture(GL_TEXTURE0 + textureunit);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindSampler(textureunit, sampler_id);
+        FreeArenaMesh(&arena, i);
+    }
+    return true;
+}
 
-    stbi_image_free(data);
+// Agenda o carregamento de uma imagem de textura. A textura é associada à
+// próxima unidade de textura livre, exatamente como em LoadTextureImage(),
+// mas é amostrada como preto até que ProcessAssetUploads() envie o seu menor
+// nível de mipmap para a GPU. Os níveis são enviados do menor para o maior,
+// e a textura fica mais nítida a cada nível enviado.
+void QueueTextureImage(const char* filename)
+{
+    Asset* asset = new Asset();
+    asset->type = ASSET_TEXTURE;
+    asset->filename = filename;
+    asset->texture_unit = g_NumLoadedTextures;
+    asset->uploaded_bytes = 0;
+    asset->request_index = g_AssetRequests.size();
+    g_AssetRequests.push_back(asset);
 
     g_NumLoadedTextures += 1;
 }
 
-// Função que desenha um objeto armazenado em g_VirtualScene. Veja definição
-// dos objetos na função BuildTrianglesAndAddToVirtualScene().
-void DrawVirtualObject(const char* object_name)
-{
-    // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
-    // vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene(). Veja
-    // comentários detalhados dentro da definição de BuildTrianglesAndAddToVirtualScene().
-    glBindVertexArray(g_VirtualScene[object_name].vertex_array_object_id);
-
-    // Setamos as variáveis "bbox_min" e "bbox_max" do fragment shader
-    // com os parâmetros da axis-aligned bounding box (AABB) do modelo.
-    glm::vec3 bbox_min = g_VirtualScene[object_name].bbox_min;
-    glm::vec3 bbox_max = g_VirtualScene[object_name].bbox_max;
-    glUniform4f(g_bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
-    glUniform4f(g_bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
-
-    // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
-    // apontados pelo VAO como linhas. Veja a definição de
-    // g_VirtualScene[""] dentro da função BuildTrianglesAndAddToVirtualScene(), e veja
-    // a documentação da função glDrawElements() em
-    // http://docs.gl/gl3/glDrawElements.
-    glDrawElements(
-        g_VirtualScene[object_name].rendering_mode,
-        g_VirtualScene[object_name].num_indices,
-        GL_UNSIGNED_INT,
-        (void*)(g_VirtualScene[object_name].first_index * sizeof(GLuint))
-    );
-
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+// Agenda o carregamento de um arquivo ".obj". Seus objetos são adicionados em
+// g_VirtualScene quando a malha estiver pronta na memória da CPU.
+void QueueObjModel(const char* filename)
+{
+    Asset* asset = new Asset();
+    asset->type = ASSET_MESH;
+    asset->filename = filename;
+    asset->uploaded_bytes = 0;
+    asset->request_index = g_AssetRequests.size();
+    g_AssetRequests.push_back(asset);
 }
 
-// Função que carrega os shaders de vértices e de fragmentos que serão
-// utilizados para renderização. Veja slides 180-200 do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
-//
-void LoadShadersFromFiles()
+// Função executada por cada thread de carregamento: lê e decodifica arquivos
+// de g_AssetRequests até que não reste nenhum, passando cada recurso pronto
+// para a thread principal através de g_LoadedAssets. Não utiliza OpenGL.
+// Erros de leitura não encerram o programa a partir desta thread: ficam em
+// Asset::error, e são informados pela thread principal em
+// ProcessAssetUploads().
+void AssetLoaderThread()
 {
-    // Note que o caminho para os arquivos "shader_vertex.glsl" e
-    // "shader_fragment.glsl" estão fixados, sendo que assumimos a existência
-    // da seguinte estrutura no sistema de arquivos:
-    //
-    //    + FCG_Lab_01/
-    //    |
-    //    +--+ bin/
-    //    |  |
-    //    |  +--+ Release/  (ou Debug/ ou Linux/)
-    //    |     |
-    //    |     o-- main.exe
-    //    |
-    //    +--+ src/
-    //       |
-    //       o-- shader_vertex.glsl
-    //       |
-    //       o-- shader_fragment.glsl
-    //
-    GLuint vertex_shader_id = LoadShader_Vertex("../../src/shader_vertex.glsl");
-    GLuint fragment_shader_id = LoadShader_Fragment("../../src/shader_fragment-tarefa1.glsl");
+    VertexFormat vertex_format = g_UseQuantizedVertexFormat ? VERTEX_FORMAT_QUANTIZED : VERTEX_FORMAT_FLOAT;
 
-    // Deletamos o programa de GPU anterior, caso ele exista.
-    if ( g_GpuProgramID != 0 )
-        glDeleteProgram(g_GpuProgramID);
+    for (;;)
+    {
+        size_t i = g_NextAssetRequest.fetch_add(1);
+        if (i >= g_AssetRequests.size())
+            return;
 
-    // Criamos um programa de GPU utilizando os shaders carregados acima.
-    g_GpuProgramID = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
+        Asset* asset = g_AssetRequests[i];
+        if (asset->type == ASSET_TEXTURE)
+        {
+            if (!LoadTextureData(asset->filename.c_str(), &asset->texture))
+                asset->error = "cannot open image file.";
+        }
+        else
+        {
+            // ObjModel lança uma exceção se o arquivo não puder ser lido.
+            try
+            {
+                LoadObjMeshData(asset->filename.c_str(), vertex_format, &asset->mesh);
+            }
+            catch (const std::exception& e)
+            {
+                asset->error = e.what();
+            }
+        }
 
-    // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
-    // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
-    // (GPU)! Veja arquivo "shader_vertex.glsl" e "shader_fragment.glsl".
-    g_model_uniform      = glGetUniformLocation(g_GpuProgramID, "model"); // Variável da matriz "model"
-    g_view_uniform       = glGetUniformLocation(g_GpuProgramID, "view"); // Variável da matriz "view" em shader_vertex.glsl
-    g_projection_uniform = glGetUniformLocation(g_GpuProgramID, "projection"); // Variável da matriz "projection" em shader_vertex.glsl
-    g_object_id_uniform  = glGetUniformLocation(g_GpuProgramID, "object_id"); // Variável "object_id" em shader_fragment.glsl
-    g_bbox_min_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_min");
-    g_bbox_max_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_max");
+        // A fila tem espaço para todos os recursos agendados, e portanto
+        // Push() nunca falha.
+        g_LoadedAssets->Push(asset);
+    }
+}
+
+// Cria até num_threads threads de carregamento para os arquivos agendados por
+// QueueTextureImage() e QueueObjModel(). Deve ser chamada uma única vez,
+// depois de todos os arquivos terem sido agendados.
+void StartAssetLoaderThreads(unsigned int num_threads)
+{
+    // stbi_set_flip_vertically_on_load() altera uma variável global da
+    // biblioteca stb_image; por isso é chamada antes de criar as threads.
+    stbi_set_flip_vertically_on_load(true);
 
-    // Variáveis em "shader_fragment.glsl" para acesso das imagens de textura
-    glUseProgram(g_GpuProgramID);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage0"), 0);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage1"), 1);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "TextureImage2"), 2);
-    glUseProgram(0);
+    g_LoadedAssets = new LockFreeQueue<Asset*>(g_AssetRequests.size());
+
+    size_t count = std::min<size_t>(std::max(1u, num_threads), g_AssetRequests.size());
+    for (size_t i = 0; i < count; ++i)
+        g_AssetLoaderThreads.push_back(std::thread(AssetLoaderThread));
 }
 
-// Função que pega a matriz M e guarda a mesma no topo da pilha
-void PushMatrix(glm::mat4 M)
+// Espera as threads de carregamento terminarem.
+void StopAssetLoaderThreads()
 {
-    g_MatrixStack.push(M);
+    for (size_t i = 0; i < g_AssetLoaderThreads.size(); ++i)
+        g_AssetLoaderThreads[i].join();
+    g_AssetLoaderThreads.clear();
 }
 
-// Função que remove a matriz atualmente no topo da pilha e armazena a mesma na variável M
-void PopMatrix(glm::mat4& M)
+// Cria os objetos OpenGL de um recurso recém lido do disco. Os dados
+// propriamente ditos são enviados depois, por UploadAssetPart().
+void BeginAssetUpload(Asset* asset)
 {
-    if ( g_MatrixStack.empty() )
+    if (asset->type == ASSET_TEXTURE)
     {
-        M = Matrix_Identity();
+        // Veja LoadTextureImage().
+        GLuint sampler_id;
+        glGenTextures(1, &asset->texture_id);
+        glGenSamplers(1, &sampler_id);
+
+        g_TextureIds.resize(std::max<size_t>(g_TextureIds.size(), asset->texture_unit + 1), 0);
+        g_TextureIds[asset->texture_unit] = asset->texture_id;
+
+        glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        // Apenas alocamos os níveis da textura; os pixels são enviados aos
+        // poucos com glTexSubImage2D(). GL_TEXTURE_BASE_LEVEL indica o
+        // maior nível já enviado, e começa no nível 1x1. O formato interno é
+        // o mesmo de LoadTextureImage().
+        const TextureData& texture = asset->texture;
+        GLState_ActiveTexture(GL_TEXTURE0 + asset->texture_unit);
+        GLState_BindTexture(GL_TEXTURE_2D, asset->texture_id);
+        for (size_t i = 0; i < texture.levels.size(); ++i)
+            glTexImage2D(GL_TEXTURE_2D, i, GL_SRGB8, texture.levels[i].width, texture.levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levels.size() - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.levels.size() - 1);
+        GLState_BindSampler(asset->texture_unit, sampler_id);
+
+        asset->texture_level = texture.levels.size() - 1;
     }
     else
     {
-        M = g_MatrixStack.top();
-        g_MatrixStack.pop();
+        // Os objetos da malha já podem ser desenhados como a sua bounding
+        // box (veja DrawVirtualObject()).
+        AddMeshToVirtualScene(asset->filename.c_str(), asset->mesh, false, &asset->arena_mesh);
     }
 }
 
-// Função que computa as normais de um ObjModel, caso elas não tenham sido
-// especificadas dentro do arquivo ".obj"
-void ComputeNormals(ObjModel* model)
+// Tamanho em bytes de todos os dados de um recurso a serem enviados para a GPU.
+size_t AssetUploadSize(const Asset* asset)
 {
-    if ( !model->attrib.normals.empty() )
-        return;
-
-    // Primeiro computamos as normais para todos os TRIÂNGULOS.
-    // Segundo, computamos as normais dos VÉRTICES através do método proposto
-    // por Gouraud, onde a normal de cada vértice vai ser a média das normais de
-    // todas as faces que compartilham este vértice.
-
-    size_t num_vertices = model->attrib.vertices.size() / 3;
+    if (asset->type == ASSET_TEXTURE)
+        return asset->texture.levels.back().offset + asset->texture.levels.back().size;
+    else
+        return MeshVertexBytes(asset->mesh) + MeshIndexBytes(asset->mesh);
+}
 
-    std::vector<int> num_triangles_per_vertex(num_vertices, 0);
-    std::vector<glm::vec4> vertex_normals(num_vertices, glm::vec4(0.0f,0.0f,0.0f,0.0f));
+// Envia para a GPU os próximos bytes de um recurso, sem passar de
+// budget_bytes, através do buffer intermediário g_StagingBufferId (ligado em
+// GL_COPY_READ_BUFFER) a partir de staging_offset. Texturas são enviadas em
+// linhas inteiras, e pelo menos uma linha é enviada se allow_overflow for
+// verdadeiro. Retorna o número de bytes enviados.
+size_t UploadAssetPart(Asset* asset, size_t staging_offset, size_t budget_bytes, bool allow_overflow)
+{
+    if (asset->type == ASSET_TEXTURE)
+    {
+        // Os níveis são enviados do último (1x1) para o primeiro; os bytes
+        // já enviados do nível atual são os que faltam para o seu final.
+        const TextureData& texture = asset->texture;
+        const TextureLevel& level = texture.levels[asset->texture_level];
+        size_t level_end = AssetUploadSize(asset) - asset->uploaded_bytes;
+        size_t level_uploaded = level.size - (level_end - level.offset);
+
+        size_t row_bytes = size_t(level.width) * 4;
+        size_t first_row = level_uploaded / row_bytes;
+        size_t num_rows  = std::min<size_t>(budget_bytes / row_bytes, level.height - first_row);
+        if (num_rows == 0 && allow_overflow)
+            num_rows = 1;
+        if (num_rows == 0)
+            return 0;
+
+        size_t size = num_rows * row_bytes;
+        glBufferSubData(GL_COPY_READ_BUFFER, staging_offset, size, texture.pixels + level.offset + level_uploaded);
+
+        // Com um buffer ligado em GL_PIXEL_UNPACK_BUFFER, o último argumento
+        // de glTexSubImage2D() é um deslocamento dentro deste buffer (PBO).
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        GLState_BindBuffer(GL_PIXEL_UNPACK_BUFFER, g_StagingBufferId);
+        GLState_ActiveTexture(GL_TEXTURE0 + asset->texture_unit);
+        GLState_BindTexture(GL_TEXTURE_2D, asset->texture_id);
+        glTexSubImage2D(GL_TEXTURE_2D, asset->texture_level, 0, first_row, level.width, num_rows, GL_RGBA, GL_UNSIGNED_BYTE, (void*)staging_offset);
+        GLState_BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        asset->uploaded_bytes += size;
+
+        // Nível completo: passa a ser o nível base da textura.
+        if (first_row + num_rows == level.height)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, asset->texture_level);
+            if (asset->texture_level > 0)
+                asset->texture_level -= 1;
+        }
+        return size;
+    }
 
-    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    // Malhas: primeiro os vértices, depois os índices, copiados do buffer
+    // intermediário para os intervalos da malha no VBO/EBO da arena com
+    // glCopyBufferSubData(). Os intervalos são lidos a cada chamada, pois
+    // mudam se a arena for compactada.
+    const MeshData& mesh = asset->mesh;
+    const ArenaMesh& arena_mesh = g_GeometryArena.meshes[asset->arena_mesh];
+    size_t vertex_bytes = MeshVertexBytes(mesh);
+
+    const unsigned char* src;
+    size_t dst_offset;
+    size_t size;
+    GLuint dst_buffer_id;
+    if (asset->uploaded_bytes < vertex_bytes)
     {
-        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+        src = MeshVertexData(mesh) + asset->uploaded_bytes;
+        dst_offset = arena_mesh.base_vertex * VertexFormatSize(mesh.vertex_format) + asset->uploaded_bytes;
+        size = vertex_bytes - asset->uploaded_bytes;
+        dst_buffer_id = g_GeometryArena.vertex_buffer_id;
+    }
+    else
+    {
+        size_t uploaded_index_bytes = asset->uploaded_bytes - vertex_bytes;
+        src = MeshIndexData(mesh) + uploaded_index_bytes;
+        dst_offset = arena_mesh.index_offset + uploaded_index_bytes;
+        size = MeshIndexBytes(mesh) - uploaded_index_bytes;
+        dst_buffer_id = g_GeometryArena.index_buffer_id;
+    }
+    size = std::min(size, budget_bytes);
 
-        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
-        {
-            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
+    glBufferSubData(GL_COPY_READ_BUFFER, staging_offset, size, src);
+    GLState_BindBuffer(GL_COPY_WRITE_BUFFER, dst_buffer_id);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, staging_offset, dst_offset, size);
+    GLState_BindBuffer(GL_COPY_WRITE_BUFFER, 0);
 
-            glm::vec4  vertices[3];
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
-                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
-                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
-                vertices[vertex] = glm::vec4(vx,vy,vz,1.0);
-            }
+    asset->uploaded_bytes += size;
+    return size;
+}
 
-            const glm::vec4  a = vertices[0];
-            const glm::vec4  b = vertices[1];
-            const glm::vec4  c = vertices[2];
+// Finaliza o envio de um recurso: marca os objetos da malha como
+// residentes, e libera a cópia dos dados na CPU.
+void FinishAssetUpload(Asset* asset)
+{
+    if (asset->type == ASSET_TEXTURE)
+    {
+        FreeTextureData(&asset->texture);
+    }
+    else
+    {
+        const MeshData& mesh = asset->mesh;
+        for (size_t i = 0; i < mesh.objects.size(); ++i)
+            g_VirtualScene.resident[FindSceneObject(mesh.objects[i].name.c_str())] = 1;
 
-            const glm::vec4  n = crossproduct(b-a,c-a);
+        printf("Malha \"%s\" enviada para a GPU: %lu vértices x %lu bytes, %lu índices x %lu bytes.\n",
+            asset->filename.c_str(),
+            (unsigned long)mesh.num_vertices, (unsigned long)VertexFormatSize(mesh.vertex_format),
+            (unsigned long)mesh.num_indices, (unsigned long)IndexTypeSize(mesh.index_type));
 
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                num_triangles_per_vertex[idx.vertex_index] += 1;
-                vertex_normals[idx.vertex_index] += n;
-                model->shapes[shape].mesh.indices[3*triangle + vertex].normal_index = idx.vertex_index;
-            }
-        }
+        FreeMeshData(&asset->mesh);
+        asset->mesh = MeshData();
     }
 
-    model->attrib.normals.resize( 3*num_vertices );
+    g_NumResidentAssets += 1;
+}
+
+// Libera um recurso já enviado para a GPU, ou cuja leitura falhou, e
+// informa quando todos os recursos agendados terminaram.
+void ReleaseAsset(Asset* asset)
+{
+    g_AssetRequests[asset->request_index] = NULL;
+    delete asset;
 
-    for (size_t i = 0; i < vertex_normals.size(); ++i)
+    if (g_NumResidentAssets + g_NumFailedAssets == g_AssetRequests.size())
     {
-        glm::vec4 n = vertex_normals[i] / (float)num_triangles_per_vertex[i];
-        n /= norm(n);
-        model->attrib.normals[3*i + 0] = n.x;
-        model->attrib.normals[3*i + 1] = n.y;
-        model->attrib.normals[3*i + 2] = n.z;
+        printf("Todos os %lu arquivos carregados em %.1f ms (%lu com erro).\n",
+            (unsigned long)g_AssetRequests.size(), glfwGetTime() * 1000.0, (unsigned long)g_NumFailedAssets);
+        WarnMissingSceneObjects();
     }
 }
 
-// Constrói triângulos para futura renderização a partir de um ObjModel.
-void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
+// Chamada a cada quadro pela thread principal (a única que utiliza OpenGL).
+// Recebe os recursos já lidos pelas threads de carregamento e envia para a
+// GPU até budget_bytes de seus dados, em ordem de chegada. Todos os dados do
+// quadro são copiados para um único buffer intermediário, que é
+// "orfanado" com glBufferData(NULL) a cada quadro: assim o driver não precisa
+// esperar a GPU terminar as cópias do quadro anterior.
+void ProcessAssetUploads(size_t budget_bytes)
 {
-    GLuint vertex_array_object_id;
-    glGenVertexArrays(1, &vertex_array_object_id);
-    glBindVertexArray(vertex_array_object_id);
-
-    std::vector<GLuint> indices;
-    std::vector<float>  model_coefficients;
-    std::vector<float>  normal_coefficients;
-    std::vector<float>  texture_coefficients;
+    if (g_LoadedAssets == NULL)
+        return;
 
-    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    Asset* loaded;
+    while (g_LoadedAssets->Pop(&loaded))
     {
-        size_t first_index = indices.size();
-        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+        // Um recurso que não pôde ser lido é descartado: a sua textura
+        // continua preta, e os objetos da sua malha não são desenhados
+        // (e são listados por WarnMissingSceneObjects()).
+        if (!loaded->error.empty())
+        {
+            fprintf(stderr, "ERROR: Cannot load \"%s\": %s\n", loaded->filename.c_str(), loaded->error.c_str());
+            g_NumFailedAssets += 1;
+            ReleaseAsset(loaded);
+            continue;
+        }
 
-        const float minval = std::numeric_limits<float>::min();
-        const float maxval = std::numeric_limits<float>::max();
+        BeginAssetUpload(loaded);
+        g_PendingUploads.push_back(loaded);
+    }
 
-        glm::vec3 bbox_min = glm::vec3(maxval,maxval,maxval);
-        glm::vec3 bbox_max = glm::vec3(minval,minval,minval);
+    if (g_PendingUploads.empty())
+        return;
 
-        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
-        {
-            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
+    // Uma linha de textura maior que budget_bytes é enviada sozinha, e por
+    // isso o buffer intermediário precisa comportá-la.
+    size_t staging_size = budget_bytes;
+    if (g_PendingUploads[0]->type == ASSET_TEXTURE)
+        staging_size = std::max(staging_size, size_t(g_PendingUploads[0]->texture.width) * 4);
 
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-
-                indices.push_back(first_index + 3*triangle + vertex);
-
-                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
-                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
-                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
-                //printf("tri %d vert %d = (%.2f, %.2f, %.2f)\n", (int)triangle, (int)vertex, vx, vy, vz);
-                model_coefficients.push_back( vx ); // X
-                model_coefficients.push_back( vy ); // Y
-                model_coefficients.push_back( vz ); // Z
-                model_coefficients.push_back( 1.0f ); // W
-
-                bbox_min.x = std::min(bbox_min.x, vx);
-                bbox_min.y = std::min(bbox_min.y, vy);
-                bbox_min.z = std::min(bbox_min.z, vz);
-                bbox_max.x = std::max(bbox_max.x, vx);
-                bbox_max.y = std::max(bbox_max.y, vy);
-                bbox_max.z = std::max(bbox_max.z, vz);
-
-                // Inspecionando o código da tinyobjloader, o aluno Bernardo
-                // Sulzbach (2017/1) apontou que a maneira correta de testar se
-                // existem normais e coordenadas de textura no ObjModel é
-                // comparando se o índice retornado é -1. Fazemos isso abaixo.
-
-                if ( idx.normal_index != -1 )
-                {
-                    const float nx = model->attrib.normals[3*idx.normal_index + 0];
-                    const float ny = model->attrib.normals[3*idx.normal_index + 1];
-                    const float nz = model->attrib.normals[3*idx.normal_index + 2];
-                    normal_coefficients.push_back( nx ); // X
-                    normal_coefficients.push_back( ny ); // Y
-                    normal_coefficients.push_back( nz ); // Z
-                    normal_coefficients.push_back( 0.0f ); // W
-                }
+    if (g_StagingBufferId == 0)
+        glGenBuffers(1, &g_StagingBufferId);
+    GLState_BindBuffer(GL_COPY_READ_BUFFER, g_StagingBufferId);
+    glBufferData(GL_COPY_READ_BUFFER, staging_size, NULL, GL_STREAM_DRAW);
 
-                if ( idx.texcoord_index != -1 )
-                {
-                    const float u = model->attrib.texcoords[2*idx.texcoord_index + 0];
-                    const float v = model->attrib.texcoords[2*idx.texcoord_index + 1];
-                    texture_coefficients.push_back( u );
-                    texture_coefficients.push_back( v );
-                }
-            }
+    size_t used = 0;
+    size_t num_finished = 0;
+    while (num_finished < g_PendingUploads.size())
+    {
+        Asset* asset = g_PendingUploads[num_finished];
+        size_t total_bytes = AssetUploadSize(asset);
+        while (asset->uploaded_bytes < total_bytes)
+        {
+            size_t available = used < budget_bytes ? budget_bytes - used : 0;
+            size_t sent = UploadAssetPart(asset, used, available, used == 0);
+            if (sent == 0)
+                break;
+            used += sent;
         }
 
-        size_t last_index = indices.size() - 1;
-
-        SceneObject theobject;
-        theobject.name           = model->shapes[shape].name;
-        theobject.first_index    = first_index; // Primeiro índice
-        theobject.num_indices    = last_index - first_index + 1; // Número de indices
-        theobject.rendering_mode = GL_TRIANGLES;       // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
-        theobject.vertex_array_object_id = vertex_array_object_id;
+        if (asset->uploaded_bytes < total_bytes)
+            break; // Orçamento do quadro esgotado
 
-        theobject.bbox_min = bbox_min;
-        theobject.bbox_max = bbox_max;
+        FinishAssetUpload(asset);
+        ReleaseAsset(asset);
+        num_finished += 1;
+    }
 
-        g_VirtualScene[model->shapes[shape].name] = theobject;
-    }
-
-    GLuint VBO_model_coefficients_id;
-    glGenBuffers(1, &VBO_model_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, model_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, model_coefficients.size() * sizeof(float), model_coefficients.data());
-    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
-    GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    if ( !normal_coefficients.empty() )
-    {
-        GLuint VBO_normal_coefficients_id;
-        glGenBuffers(1, &VBO_normal_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, normal_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, normal_coefficients.size() * sizeof(float), normal_coefficients.data());
-        location = 1; // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    }
-
-    if ( !texture_coefficients.empty() )
-    {
-        GLuint VBO_texture_coefficients_id;
-        glGenBuffers(1, &VBO_texture_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_texture_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, texture_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, texture_coefficients.size() * sizeof(float), texture_coefficients.data());
-        location = 2; // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 2; // vec2 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    }
-
-    GLuint indices_id;
-    glGenBuffers(1, &indices_id);
-
-    // "Ligamos" o buffer. Note que o tipo agora é GL_ELEMENT_ARRAY_BUFFER.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
-    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // XXX Errado!
-    //
+    GLState_BindBuffer(GL_COPY_READ_BUFFER, 0);
 
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+    g_PendingUploads.erase(g_PendingUploads.begin(), g_PendingUploads.begin() + num_finished);
 }
 
 // Carrega um Vertex Shader de um arquivo GLSL. Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Vertex(const char* filename)
+GLuint LoadShader_Vertex(const char* filename, const std::string& defines)
 {
     // Criamos um identificador (ID) para este shader, informando que o mesmo
     // será aplicado nos vértices.
     GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
 
     // Carregamos e compilamos o shader
-    LoadShader(filename, vertex_shader_id);
+    LoadShader(filename, vertex_shader_id, defines);
 
     // Retorna o ID gerado acima
     return vertex_shader_id;
 }
 
 // Carrega um Fragment Shader de um arquivo GLSL . Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Fragment(const char* filename)
+GLuint LoadShader_Fragment(const char* filename, const std::string& defines)
 {
     // Criamos um identificador (ID) para este shader, informando que o mesmo
     // será aplicado nos fragmentos.
     GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
 
     // Carregamos e compilamos o shader
-    LoadShader(filename, fragment_shader_id);
+    LoadShader(filename, fragment_shader_id, defines);
 
     // Retorna o ID gerado acima
     return fragment_shader_id;
 }
 
 // Função auxilar, utilizada pelas duas funções acima. Carrega código de GPU de
-// um arquivo GLSL e faz sua compilação.
-void LoadShader(const char* filename, GLuint shader_id)
+// um arquivo GLSL e faz sua compilação. As linhas de "defines" são inseridas
+// logo após a diretiva "#version", que deve ser a primeira do arquivo.
+void LoadShader(const char* filename, GLuint shader_id, const std::string& defines)
 {
     // Lemos o arquivo de texto indicado pela variável "filename"
-    // e colocamos seu conteúdo em memória, apontado pela variável
-    // "shader_string".
-    std::ifstream file;
-    try {
-        file.exceptions(std::ifstream::failbit);
-        file.open(filename);
-    } catch ( std::exception& e ) {
-        fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
-    }
-    std::stringstream shader;
-    shader << file.rdbuf();
-    std::string str = shader.str();
-    const GLchar* shader_string = str.c_str();
-    const GLint   shader_string_length = static_cast<GLint>( str.length() );
+    // e colocamos seu conteúdo em memória, na variável "str".
+    std::string str = ReadShaderFile(filename);
+
+    // Compila o código do shader GLSL (em tempo de execução)
+    CompileShaderSource(shader_id, str, defines);
+
+    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
+    PrintShaderCompileLog(shader_id, filename);
+}
 
-    // Define o código do shader GLSL, contido na string "shader_string"
-    glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
+// Define o código GLSL de um shader, com os #defines inseridos, e inicia a
+// sua compilação. O resultado não é consultado aqui: com a compilação em
+// paralelo (veja "programcache.h"), glCompileShader() retorna antes do fim
+// da compilação, e só as consultas de estado e de log a esperam.
+void CompileShaderSource(GLuint shader_id, const std::string& str, const std::string& defines)
+{
+    // Separamos a linha "#version" do resto do código, e inserimos os
+    // #defines entre os dois, seguidos de "#line 1" para que os números de
+    // linha dos erros de compilação continuem corretos (na GLSL 3.30, a
+    // linha seguinte a "#line 1" é a linha 2).
+    size_t version_end = (str.compare(0, 8, "#version") == 0) ? str.find('\n') : std::string::npos;
+    version_end = (version_end == std::string::npos) ? 0 : version_end + 1;
+    std::string injected = defines.empty() ? std::string() : defines + "#line 1\n";
+
+    const GLchar* shader_strings[3] = { str.c_str(), injected.c_str(), str.c_str() + version_end };
+    const GLint   shader_string_lengths[3] = {
+        static_cast<GLint>( version_end ),
+        static_cast<GLint>( injected.length() ),
+        static_cast<GLint>( str.length() - version_end )
+    };
+
+    // Define o código do shader GLSL, contido nas strings "shader_strings"
+    glShaderSource(shader_id, 3, shader_strings, shader_string_lengths);
 
     // Compila o código do shader GLSL (em tempo de execução)
     glCompileShader(shader_id);
+}
 
-    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
+// Imprime no terminal qualquer erro ou "warning" da compilação de um shader,
+// esperando a compilação terminar. Retorna false se ela falhou.
+bool PrintShaderCompileLog(GLuint shader_id, const char* filename)
+{
     GLint compiled_ok;
     glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
 
@@ -927,11 +2622,40 @@ void LoadShader(const char* filename, GLuint shader_id)
 
     // A chamada "delete" em C++ é equivalente ao "free()" do C
     delete [] log;
+
+    return compiled_ok != GL_FALSE;
+}
+
+// Lê todo o conteúdo de um arquivo GLSL. Termina o programa em caso de erro.
+std::string ReadShaderFile(const char* filename)
+{
+    std::ifstream file;
+    try {
+        file.exceptions(std::ifstream::failbit);
+        file.open(filename);
+    } catch ( std::exception& e ) {
+        fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", filename);
+        std::exit(EXIT_FAILURE);
+    }
+    std::stringstream shader;
+    shader << file.rdbuf();
+    return shader.str();
 }
 
 // Esta função cria um programa de GPU, o qual contém obrigatoriamente um
 // Vertex Shader e um Fragment Shader.
 GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
+{
+    GLuint program_id = LinkGpuProgram(vertex_shader_id, fragment_shader_id);
+    FinishGpuProgram(program_id, vertex_shader_id, fragment_shader_id);
+
+    // Retornamos o ID gerado acima
+    return program_id;
+}
+
+// Cria um programa de GPU e inicia a sua linkagem, sem esperá-la (veja
+// CompileShaderSource()). O resultado é verificado por FinishGpuProgram().
+GLuint LinkGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
 {
     // Criamos um identificador (ID) para este programa de GPU
     GLuint program_id = glCreateProgram();
@@ -940,9 +2664,20 @@ GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
     glAttachShader(program_id, vertex_shader_id);
     glAttachShader(program_id, fragment_shader_id);
 
+    // Pedimos que o binário do programa possa ser lido depois, para o cache
+    // de "programcache.h".
+    PrepareProgramForCache(program_id);
+
     // Linkagem dos shaders acima ao programa
     glLinkProgram(program_id);
 
+    return program_id;
+}
+
+// Verifica a linkagem iniciada por LinkGpuProgram(), esperando-a se
+// necessário, e marca os shaders para deleção. Retorna false em caso de erro.
+bool FinishGpuProgram(GLuint program_id, GLuint vertex_shader_id, GLuint fragment_shader_id)
+{
     // Verificamos se ocorreu algum erro durante a linkagem
     GLint linked_ok = GL_FALSE;
     glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
@@ -976,8 +2711,7 @@ GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
     glDeleteShader(vertex_shader_id);
     glDeleteShader(fragment_shader_id);
 
-    // Retornamos o ID gerado acima
-    return program_id;
+    return linked_ok != GL_FALSE;
 }
 
 // Definição da função que será chamada sempre que a janela do sistema
@@ -999,6 +2733,11 @@ void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
     // O cast para float é necessário pois números inteiros são arredondados ao
     // serem divididos!
     g_ScreenRatio = (float)width / height;
+
+    // O tamanho dos caracteres na tela depende do tamanho da janela: os
+    // textos retidos precisam ser recalculados (veja
+    // TextRendering_ShowProjection()).
+    TextRendering_InvalidateTextLayouts();
 }
 
 // Variáveis globais que armazenam a última posição do cursor do mouse, para
@@ -1216,12 +2955,27 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mod)
     }
 
     // Se o usuário apertar a tecla R, recarregamos os shaders dos arquivos "shader_fragment.glsl" e "shader_vertex.glsl".
+    // A recompilação termina em segundo plano; veja ProcessShaderCompiles().
+    // No Linux, os shaders também são recarregados quando os arquivos são salvos.
     if (key == GLFW_KEY_R && action == GLFW_PRESS)
     {
         LoadShadersFromFiles();
-        fprintf(stdout,"Shaders recarregados!\n");
+        fprintf(stdout,"Recarregando shaders...\n");
         fflush(stdout);
     }
+
+    // Se o usuário apertar a tecla M, recarregamos o modelo extra dado na
+    // linha de comando, liberando a sua malha na arena de geometria e
+    // alocando-a novamente. Veja UnloadObjModel().
+    if (key == GLFW_KEY_M && action == GLFW_PRESS && g_ExtraModelFilename != NULL)
+    {
+        if (UnloadObjModel(g_ExtraModelFilename))
+        {
+            LoadObjModelAndAddToVirtualScene(g_ExtraModelFilename);
+            fprintf(stdout,"Modelo \"%s\" recarregado!\n", g_ExtraModelFilename);
+            fflush(stdout);
+        }
+    }
 }
 
 // Definimos o callback para impressão de erros da GLFW no terminal
@@ -1299,12 +3053,26 @@ void TextRendering_ShowEulerAngles(GLFWwindow* window)
     if ( !g_ShowInfoText )
         return;
 
-    float pad = TextRendering_LineHeight(window);
+    // O texto é formatado somente quando algum ângulo muda (veja
+    // TextRendering_ShowProjection()).
+    static TextHandle text = TextRendering_CreateText();
+    static float angle_x, angle_y, angle_z;
+
+    if ( TextRendering_TextNeedsLayout(text) || angle_x != g_AngleX || angle_y != g_AngleY || angle_z != g_AngleZ )
+    {
+        angle_x = g_AngleX;
+        angle_y = g_AngleY;
+        angle_z = g_AngleZ;
 
-    char buffer[80];
-    snprintf(buffer, 80, "Euler Angles rotation matrix = Z(%.2f)*Y(%.2f)*X(%.2f)\n", g_AngleZ, g_AngleY, g_AngleX);
+        float pad = TextRendering_LineHeight(window);
 
-    TextRendering_PrintString(window, buffer, -1.0f+pad/10, -1.0f+2*pad/10, 1.0f);
+        char buffer[80];
+        snprintf(buffer, 80, "Euler Angles rotation matrix = Z(%.2f)*Y(%.2f)*X(%.2f)\n", g_AngleZ, g_AngleY, g_AngleX);
+
+        TextRendering_SetText(window, text, buffer, -1.0f+pad/10, -1.0f+2*pad/10, 1.0f);
+    }
+
+    TextRendering_DrawText(text);
 }
 
 // Escrevemos na tela qual matriz de projeção está sendo utilizada.
@@ -1313,13 +3081,48 @@ void TextRendering_ShowProjection(GLFWwindow* window)
     if ( !g_ShowInfoText )
         return;
 
-    float lineheight = TextRendering_LineHeight(window);
-    float charwidth = TextRendering_CharWidth(window);
+    // Os dois textos são retidos (veja TextRendering_CreateText()): os
+    // caracteres são calculados e enviados à GPU uma única vez, e de novo
+    // somente quando a janela é redimensionada. A cada quadro, apenas
+    // escolhemos qual deles desenhar.
+    static TextHandle perspective_text = TextRendering_CreateText();
+    static TextHandle orthographic_text = TextRendering_CreateText();
 
-    if ( g_UsePerspectiveProjection )
-        TextRendering_PrintString(window, "Perspective", 1.0f-13*charwidth, -1.0f+2*lineheight/10, 1.0f);
-    else
-        TextRendering_PrintString(window, "Orthographic", 1.0f-13*charwidth, -1.0f+2*lineheight/10, 1.0f);
+    TextHandle text = g_UsePerspectiveProjection ? perspective_text : orthographic_text;
+    if ( TextRendering_TextNeedsLayout(text) )
+    {
+        float lineheight = TextRendering_LineHeight(window);
+        float charwidth = TextRendering_CharWidth(window);
+
+        TextRendering_SetText(window, text, g_UsePerspectiveProjection ? "Perspective" : "Orthographic",
+                              1.0f-13*charwidth, -1.0f+2*lineheight/10, 1.0f);
+    }
+
+    TextRendering_DrawText(text);
+}
+
+// Escreve na tela todas as informações mostradas a cada quadro, depois do
+// desenho da cena. O texto só é desenhado por TextRendering_Flush().
+void DrawTextOverlay(GLFWwindow* window)
+{
+    // Imprimimos na tela os ângulos de Euler que controlam a rotação do
+    // terceiro cubo.
+    TextRendering_ShowEulerAngles(window);
+
+    // Imprimimos na informação sobre a matriz de projeção sendo utilizada.
+    TextRendering_ShowProjection(window);
+
+    // Imprimimos na tela informação sobre o número de quadros renderizados
+    // por segundo (frames per second).
+    TextRendering_ShowFramesPerSecond(window);
+
+    // Imprimimos na tela quantos objetos e triângulos foram desenhados em
+    // cada nível de detalhe.
+    TextRendering_ShowLodStatistics(window);
+
+    // Imprimimos na tela quantas trocas de estado foram feitas e evitadas
+    // pela fila de desenho.
+    TextRendering_ShowRenderQueueStatistics(window);
 }
 
 // Escrevemos na tela o número de quadros renderizados por segundo (frames per
@@ -1335,6 +3138,8 @@ void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
     static int   ellapsed_frames = 0;
     static char  buffer[20] = "?? fps";
     static int   numchars = 7;
+    static TextHandle text = TextRendering_CreateText();
+    bool changed = false;
 
     ellapsed_frames += 1;
 
@@ -1347,15 +3152,91 @@ void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
     if ( ellapsed_seconds > 1.0f )
     {
         numchars = snprintf(buffer, 20, "%.2f fps", ellapsed_frames / ellapsed_seconds);
+        changed = true;
     
         old_seconds = seconds;
         ellapsed_frames = 0;
     }
 
+    // O texto é recalculado somente quando muda, uma vez por segundo (veja
+    // TextRendering_ShowProjection()).
+    if ( changed || TextRendering_TextNeedsLayout(text) )
+    {
+        float lineheight = TextRendering_LineHeight(window);
+        float charwidth = TextRendering_CharWidth(window);
+
+        TextRendering_SetText(window, text, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-lineheight, 1.0f);
+    }
+
+    TextRendering_DrawText(text);
+}
+
+// Escrevemos na tela o número de objetos e de triângulos desenhados no quadro
+// atual em cada nível de detalhe (veja SelectLevelOfDetail()).
+void TextRendering_ShowLodStatistics(GLFWwindow* window)
+{
+    if ( !g_ShowInfoText )
+        return;
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    for (int lod = 0; lod < MAX_LODS; ++lod)
+    {
+        char buffer[80];
+        snprintf(buffer, 80, "LOD %d: %3lu objects %8lu triangles", lod,
+            (unsigned long)g_LodDraws[lod], (unsigned long)g_LodTriangles[lod]);
+
+        TextRendering_PrintString(window, buffer, -1.0f+charwidth, 1.0f-(lod + 1)*lineheight, 1.0f);
+    }
+}
+
+// Escrevemos na tela o número de objetos desenhados e descartados pelo
+// frustum culling e o número de trocas de estado feitas e evitadas pela fila
+// de desenho no quadro atual (veja FlushRenderQueue()), abaixo das
+// estatísticas de LOD, e as chamadas descartadas pelo cache de estado no
+// quadro anterior (veja "glstate.h").
+void TextRendering_ShowRenderQueueStatistics(GLFWwindow* window)
+{
+    if ( !g_ShowInfoText )
+        return;
+
     float lineheight = TextRendering_LineHeight(window);
     float charwidth = TextRendering_CharWidth(window);
 
-    TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-lineheight, 1.0f);
+    const RenderQueueStatistics& statistics = GetRenderQueueStatistics();
+
+    char buffer[8][80];
+    snprintf(buffer[0], 80, "Objects:  %5lu drawn %5lu culled", (unsigned long)g_VisibleObjects, (unsigned long)g_CulledObjects);
+    snprintf(buffer[1], 80, "Programs: %5lu binds %5lu skipped", (unsigned long)statistics.program_binds, (unsigned long)statistics.program_binds_skipped);
+    snprintf(buffer[2], 80, "Textures: %5lu binds %5lu skipped", (unsigned long)statistics.texture_binds, (unsigned long)statistics.texture_binds_skipped);
+    snprintf(buffer[3], 80, "VAOs:     %5lu binds %5lu skipped", (unsigned long)statistics.vao_binds, (unsigned long)statistics.vao_binds_skipped);
+    snprintf(buffer[4], 80, "Uniforms: %5lu sets  %5lu stalls", (unsigned long)statistics.uniform_writes, (unsigned long)UniformRingStalls());
+    snprintf(buffer[5], 80, "GL state: %5lu calls %5lu elided", (unsigned long)g_GLStateFrameStatistics.calls, (unsigned long)g_GLStateFrameStatistics.elided);
+
+    int num_lines = 6;
+    if (g_UseDrawBatching)
+    {
+        snprintf(buffer[num_lines++], 80, "Batches:  %5lu calls %5lu items",
+            (unsigned long)statistics.batches, (unsigned long)statistics.batched_items);
+    }
+
+    // Fração dos triângulos dos itens não desenhados por estarem escondidos,
+    // em relação ao total que seria desenhado sem o occlusion culling.
+    if (g_UseOcclusionCulling)
+    {
+        size_t drawn_triangles = 0;
+        for (int lod = 0; lod < MAX_LODS; ++lod)
+            drawn_triangles += g_LodTriangles[lod];
+        size_t total_triangles = drawn_triangles + statistics.occluded_triangles;
+        double skipped = total_triangles > 0 ? 100.0 * statistics.occluded_triangles / total_triangles : 0.0;
+
+        snprintf(buffer[num_lines++], 80, "Occlusion: %4lu queries %4lu hidden %5.1f%% tris skipped",
+            (unsigned long)statistics.occlusion_queries, (unsigned long)statistics.occluded_draws, skipped);
+    }
+
+    for (int line = 0; line < num_lines; ++line)
+        TextRendering_PrintString(window, buffer[line], -1.0f+charwidth, 1.0f-(MAX_LODS + 2 + line)*lineheight, 1.0f);
 }
 
 // Função para debugging: imprime no terminal todas informações de um modelo
@@ -1373,6 +3254,24 @@ void PrintObjModelInfo(ObjModel* model)
   printf("# of shapes    : %d\n", (int)shapes.size());
   printf("# of materials : %d\n", (int)materials.size());
 
+  // Number of vertices uploaded to the GPU as a triangle soup (one vertex per
+  // index) versus after WeldVertices(), as done by
+  // BuildTrianglesAndAddToVirtualScene().
+  size_t num_soup_vertices = 0;
+  size_t num_welded_vertices = 0;
+  std::vector<tinyobj::index_t> unique_vertices;
+  std::vector<GLuint> welded_indices;
+  for (size_t i = 0; i < shapes.size(); i++) {
+    WeldVertices(shapes[i].mesh, &unique_vertices, &welded_indices);
+    num_soup_vertices += shapes[i].mesh.indices.size();
+    num_welded_vertices += unique_vertices.size();
+  }
+  printf("# of GPU vertices (triangle soup) : %lu\n",
+         static_cast<unsigned long>(num_soup_vertices));
+  printf("# of GPU vertices (welded)        : %lu (%.2fx fewer)\n",
+         static_cast<unsigned long>(num_welded_vertices),
+         num_welded_vertices > 0 ? (double)num_soup_vertices / num_welded_vertices : 0.0);
+
   for (size_t v = 0; v < attrib.vertices.size() / 3; v++) {
     printf("  v[%ld] = (%f, %f, %f)\n", static_cast<long>(v),
            static_cast<const double>(attrib.vertices[3 * v + 0]),
@@ -1527,6 +3426,66 @@ void PrintObjModelInfo(ObjModel* model)
   }
 }
 
+// Imprime, para cada objeto dos modelos dados, a eficiência do cache de
+// vértices (ACMR e ATVR, veja AnalyzeVertexCache()) e o overdraw (veja
+// AnalyzeOverdraw()) com os triângulos na ordem do arquivo OBJ, depois de
+// OptimizeVertexCache() e depois de OptimizeOverdraw(), como feito por
+// OptimizeWeldedMesh(). Opção "--mesh-optimization-report".
+void PrintMeshOptimizationReport(const std::vector<const char*>& filenames)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    std::vector<std::string> lines;
+    for (size_t f = 0; f < filenames.size(); ++f)
+    {
+        ObjModel model(filenames[f]);
+
+        for (size_t shape = 0; shape < model.shapes.size(); ++shape)
+        {
+            std::vector<tinyobj::index_t> unique_vertices;
+            std::vector<GLuint> indices;
+            WeldVertices(model.shapes[shape].mesh, &unique_vertices, &indices);
+            std::vector<float> positions = GatherPositions(model.attrib, unique_vertices);
+            size_t num_vertices = unique_vertices.size();
+
+            VertexCacheStatistics cache[3];
+            double overdraw[3];
+
+            cache[0] = AnalyzeVertexCache(indices.data(), indices.size(), num_vertices, g_VertexCacheSize);
+            overdraw[0] = AnalyzeOverdraw(indices.data(), indices.size(), positions.data(), num_vertices);
+
+            Clock::time_point start = Clock::now();
+            OptimizeVertexCache(indices.data(), indices.size(), num_vertices, g_VertexCacheSize);
+            double cache_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+            cache[1] = AnalyzeVertexCache(indices.data(), indices.size(), num_vertices, g_VertexCacheSize);
+            overdraw[1] = AnalyzeOverdraw(indices.data(), indices.size(), positions.data(), num_vertices);
+
+            start = Clock::now();
+            OptimizeOverdraw(indices.data(), indices.size(), positions.data(), num_vertices, g_VertexCacheSize, OVERDRAW_THRESHOLD);
+            double overdraw_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+            cache[2] = AnalyzeVertexCache(indices.data(), indices.size(), num_vertices, g_VertexCacheSize);
+            overdraw[2] = AnalyzeOverdraw(indices.data(), indices.size(), positions.data(), num_vertices);
+
+            char line[512];
+            snprintf(line, sizeof(line),
+                "%-12s %6lu triângulos  ACMR %.3f %.3f %.3f  ATVR %.3f %.3f %.3f  overdraw %.3f %.3f %.3f  %7.1f ms\n",
+                model.shapes[shape].name.c_str(), (unsigned long)(indices.size() / 3),
+                cache[0].acmr, cache[1].acmr, cache[2].acmr,
+                cache[0].atvr, cache[1].atvr, cache[2].atvr,
+                overdraw[0], overdraw[1], overdraw[2],
+                1000.0 * (cache_time + overdraw_time));
+            lines.push_back(line);
+        }
+    }
+
+    printf("\nOtimização de malhas (cache FIFO de %u vértices; valores na ordem\n"
+           "original, após OptimizeVertexCache() e após OptimizeOverdraw()):\n\n", g_VertexCacheSize);
+    for (size_t i = 0; i < lines.size(); ++i)
+        printf("%s", lines[i].c_str());
+}
+
 // set makeprg=cd\ ..\ &&\ make\ run\ >/dev/null
 // vim: set spell spelllang=pt_br :
 
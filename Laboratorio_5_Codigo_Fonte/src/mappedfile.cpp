@@ -0,0 +1,100 @@
+// Mapeamento de arquivos em memória (mmap no Linux/macOS, MapViewOfFile no
+// Windows). Veja "include/mappedfile.h".
+#include "mappedfile.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+bool MapFile(const char* filename, MappedFile* file)
+{
+    file->data = NULL;
+    file->size = 0;
+    file->handle = NULL;
+
+#ifdef _WIN32
+    HANDLE f = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(f, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(f);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(f);
+    if (mapping == NULL)
+        return false;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    file->data = (const unsigned char*)data;
+    file->size = (size_t)size.QuadPart;
+    file->handle = mapping;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // O mapeamento continua válido após fecharmos o arquivo
+    if (data == MAP_FAILED)
+        return false;
+
+    file->data = (const unsigned char*)data;
+    file->size = (size_t)st.st_size;
+#endif
+
+    return true;
+}
+
+void UnmapFile(MappedFile* file)
+{
+    if (file->data == NULL)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(file->data);
+    CloseHandle((HANDLE)file->handle);
+#else
+    munmap((void*)file->data, file->size);
+#endif
+
+    file->data = NULL;
+    file->size = 0;
+    file->handle = NULL;
+}
+
+bool GetFileSizeAndModificationTime(const char* filename, uint64_t* size, int64_t* mtime)
+{
+    struct stat st;
+    if (stat(filename, &st) != 0)
+        return false;
+
+    *size = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+    return true;
+}
@@ -0,0 +1,463 @@
+// Otimização da ordem de triângulos e vértices. Veja "include/meshoptimize.h".
+#include "meshoptimize.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+
+// Parâmetros da função de pontuação de Forsyth, com os valores sugeridos no
+// artigo original.
+const float CACHE_DECAY_POWER   = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+// Pontuação de um vértice: alta se ele está no cache (principalmente se foi
+// usado pelo último triângulo) e se restam poucos triângulos que o utilizam,
+// para que vértices quase terminados não fiquem "sobrando" na malha.
+float VertexScore(int cache_position, unsigned int remaining_triangles, unsigned int cache_size)
+{
+    if (remaining_triangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cache_position >= 0)
+    {
+        if (cache_position < 3)
+            score = LAST_TRIANGLE_SCORE;
+        else
+            score = powf(1.0f - float(cache_position - 3) / float(cache_size - 3), CACHE_DECAY_POWER);
+    }
+
+    return score + VALENCE_BOOST_SCALE * powf(float(remaining_triangles), -VALENCE_BOOST_POWER);
+}
+
+// Simulação de um cache FIFO de vértices. Um vértice está no cache se foi
+// inserido há no máximo cache_size faltas; Reset() esvazia o cache sem
+// precisar percorrer os vértices.
+struct FifoCache
+{
+    std::vector<unsigned int> timestamps;
+    unsigned int              time;
+    unsigned int              cache_size;
+
+    FifoCache(size_t num_vertices, unsigned int cache_size)
+        : timestamps(num_vertices, 0), time(cache_size + 1), cache_size(cache_size)
+    {
+    }
+
+    // Retorna 1 se v não estava no cache (e o insere), ou 0 caso contrário.
+    unsigned int Access(uint32_t v)
+    {
+        if (time - timestamps[v] <= cache_size)
+            return 0;
+        timestamps[v] = time++;
+        return 1;
+    }
+
+    void Reset()
+    {
+        time += cache_size + 1;
+    }
+};
+
+struct Vec3
+{
+    float x, y, z;
+};
+
+Vec3 Position(const float* positions, uint32_t v)
+{
+    Vec3 p = { positions[3*v + 0], positions[3*v + 1], positions[3*v + 2] };
+    return p;
+}
+
+} // namespace
+
+void OptimizeVertexCache(uint32_t* indices, size_t num_indices, size_t num_vertices,
+                         unsigned int cache_size)
+{
+    cache_size = std::max(cache_size, 4u);
+    size_t num_triangles = num_indices / 3;
+    if (num_triangles == 0)
+        return;
+
+    // Triângulos que utilizam cada vértice (lista de adjacência compacta).
+    // Os primeiros remaining[v] triângulos de cada lista ainda não foram
+    // emitidos.
+    std::vector<unsigned int> remaining(num_vertices, 0);
+    for (size_t i = 0; i < num_triangles * 3; ++i)
+        remaining[indices[i]] += 1;
+
+    std::vector<size_t> offsets(num_vertices + 1, 0);
+    for (size_t v = 0; v < num_vertices; ++v)
+        offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(num_triangles * 3);
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < num_triangles * 3; ++i)
+        adjacency[fill[indices[i]]++] = i / 3;
+
+    std::vector<int> cache_position(num_vertices, -1);
+    std::vector<float> vertex_score(num_vertices);
+    for (size_t v = 0; v < num_vertices; ++v)
+        vertex_score[v] = VertexScore(-1, remaining[v], cache_size);
+
+    std::vector<float> triangle_score(num_triangles);
+    std::vector<bool> emitted(num_triangles, false);
+    for (size_t t = 0; t < num_triangles; ++t)
+        triangle_score[t] = vertex_score[indices[3*t]] + vertex_score[indices[3*t+1]] + vertex_score[indices[3*t+2]];
+
+    long best = std::max_element(triangle_score.begin(), triangle_score.end()) - triangle_score.begin();
+
+    std::vector<uint32_t> output(num_triangles * 3);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> new_cache;
+    size_t input_cursor = 0;
+
+    for (size_t out = 0; out < num_triangles; ++out)
+    {
+        // Nenhum triângulo com vértices no cache: recomeçamos pelo próximo
+        // triângulo ainda não emitido na ordem original.
+        if (best < 0)
+        {
+            while (emitted[input_cursor])
+                ++input_cursor;
+            best = input_cursor;
+        }
+
+        const uint32_t* tri = indices + 3*best;
+        output[3*out + 0] = tri[0];
+        output[3*out + 1] = tri[1];
+        output[3*out + 2] = tri[2];
+        emitted[best] = true;
+
+        // Removemos o triângulo das listas dos seus vértices.
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t v = tri[k];
+            uint32_t* list = &adjacency[offsets[v]];
+            for (unsigned int j = 0; j < remaining[v]; ++j)
+            {
+                if (list[j] == (uint32_t)best)
+                {
+                    std::swap(list[j], list[remaining[v] - 1]);
+                    remaining[v] -= 1;
+                    break;
+                }
+            }
+        }
+
+        // Cache LRU: os vértices do triângulo vão para o início, seguidos
+        // dos que já estavam no cache. Os que passam de cache_size saem.
+        new_cache.clear();
+        for (int k = 0; k < 3; ++k)
+            if (std::find(new_cache.begin(), new_cache.end(), tri[k]) == new_cache.end())
+                new_cache.push_back(tri[k]);
+        for (size_t i = 0; i < cache.size(); ++i)
+            if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+                new_cache.push_back(cache[i]);
+
+        for (size_t i = 0; i < new_cache.size(); ++i)
+        {
+            uint32_t v = new_cache[i];
+            cache_position[v] = i < cache_size ? (int)i : -1;
+            vertex_score[v] = VertexScore(cache_position[v], remaining[v], cache_size);
+        }
+
+        // Somente triângulos com vértices no cache mudam de pontuação; o
+        // melhor deles é o próximo a ser emitido.
+        best = -1;
+        float best_score = -1.0f;
+        for (size_t i = 0; i < new_cache.size(); ++i)
+        {
+            uint32_t v = new_cache[i];
+            const uint32_t* list = &adjacency[offsets[v]];
+            for (unsigned int j = 0; j < remaining[v]; ++j)
+            {
+                uint32_t t = list[j];
+                const uint32_t* tv = indices + 3*t;
+                float score = vertex_score[tv[0]] + vertex_score[tv[1]] + vertex_score[tv[2]];
+                triangle_score[t] = score;
+                if (score > best_score)
+                {
+                    best_score = score;
+                    best = t;
+                }
+            }
+        }
+
+        if (new_cache.size() > cache_size)
+            new_cache.resize(cache_size);
+        cache.swap(new_cache);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeOverdraw(uint32_t* indices, size_t num_indices,
+                      const float* positions, size_t num_vertices,
+                      unsigned int cache_size, float threshold)
+{
+    size_t num_triangles = num_indices / 3;
+    if (num_triangles == 0)
+        return;
+
+    // Fronteiras "hard": triângulos cujos três vértices faltam no cache, isto
+    // é, pontos onde OptimizeVertexCache() recomeçou em outra região.
+    std::vector<size_t> hard_boundaries;
+    FifoCache cache(num_vertices, cache_size);
+    for (size_t t = 0; t < num_triangles; ++t)
+    {
+        unsigned int misses = cache.Access(indices[3*t]) + cache.Access(indices[3*t+1]) + cache.Access(indices[3*t+2]);
+        if (t == 0 || misses == 3)
+            hard_boundaries.push_back(t);
+    }
+    hard_boundaries.push_back(num_triangles);
+
+    // Fronteiras "soft": dentro de cada grupo, terminamos o grupo atual assim
+    // que a sua taxa de faltas (com o cache vazio no seu início) não passar
+    // de threshold vezes a do grupo "hard" inteiro. Assim a taxa de faltas
+    // final fica próxima de threshold vezes a original.
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hard_boundaries.size(); ++h)
+    {
+        size_t begin = hard_boundaries[h];
+        size_t end = hard_boundaries[h + 1];
+
+        cache.Reset();
+        unsigned int cluster_misses = 0;
+        for (size_t t = begin; t < end; ++t)
+            cluster_misses += cache.Access(indices[3*t]) + cache.Access(indices[3*t+1]) + cache.Access(indices[3*t+2]);
+        float cluster_acmr = float(cluster_misses) / float(end - begin);
+
+        cache.Reset();
+        clusters.push_back(begin);
+        size_t start = begin;
+        unsigned int misses = 0;
+        for (size_t t = begin; t < end; ++t)
+        {
+            misses += cache.Access(indices[3*t]) + cache.Access(indices[3*t+1]) + cache.Access(indices[3*t+2]);
+            if (t + 1 < end && float(misses) <= threshold * cluster_acmr * float(t + 1 - start))
+            {
+                clusters.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                cache.Reset();
+            }
+        }
+    }
+    clusters.push_back(num_triangles);
+
+    // Centro da malha: média das posições dos vértices utilizados.
+    Vec3 mesh_center = { 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < num_triangles * 3; ++i)
+    {
+        Vec3 p = Position(positions, indices[i]);
+        mesh_center.x += p.x; mesh_center.y += p.y; mesh_center.z += p.z;
+    }
+    float inv = 1.0f / float(num_triangles * 3);
+    mesh_center.x *= inv; mesh_center.y *= inv; mesh_center.z *= inv;
+
+    // Chave de cada grupo: distância do seu centróide ao centro da malha,
+    // na direção da normal média do grupo. Grupos "externos" e virados para
+    // fora são desenhados primeiro, e tendem a esconder os demais em
+    // qualquer ponto de vista.
+    size_t num_clusters = clusters.size() - 1;
+    std::vector<float> keys(num_clusters);
+    for (size_t c = 0; c < num_clusters; ++c)
+    {
+        Vec3 centroid = { 0.0f, 0.0f, 0.0f };
+        Vec3 normal = { 0.0f, 0.0f, 0.0f };
+        float total_area = 0.0f;
+
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            Vec3 a = Position(positions, indices[3*t + 0]);
+            Vec3 b = Position(positions, indices[3*t + 1]);
+            Vec3 d = Position(positions, indices[3*t + 2]);
+
+            Vec3 u = { b.x - a.x, b.y - a.y, b.z - a.z };
+            Vec3 v = { d.x - a.x, d.y - a.y, d.z - a.z };
+            Vec3 n = { u.y*v.z - u.z*v.y, u.z*v.x - u.x*v.z, u.x*v.y - u.y*v.x };
+            float area = sqrtf(n.x*n.x + n.y*n.y + n.z*n.z);
+
+            centroid.x += (a.x + b.x + d.x) * area;
+            centroid.y += (a.y + b.y + d.y) * area;
+            centroid.z += (a.z + b.z + d.z) * area;
+            normal.x += n.x; normal.y += n.y; normal.z += n.z;
+            total_area += area;
+        }
+
+        float normal_length = sqrtf(normal.x*normal.x + normal.y*normal.y + normal.z*normal.z);
+        if (total_area == 0.0f || normal_length == 0.0f)
+        {
+            keys[c] = 0.0f;
+            continue;
+        }
+
+        float w = 1.0f / (3.0f * total_area);
+        Vec3 offset = { centroid.x*w - mesh_center.x, centroid.y*w - mesh_center.y, centroid.z*w - mesh_center.z };
+        keys[c] = (offset.x*normal.x + offset.y*normal.y + offset.z*normal.z) / normal_length;
+    }
+
+    std::vector<size_t> order(num_clusters);
+    for (size_t c = 0; c < num_clusters; ++c)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(num_triangles * 3);
+    for (size_t i = 0; i < num_clusters; ++i)
+    {
+        size_t c = order[i];
+        output.insert(output.end(), indices + 3*clusters[c], indices + 3*clusters[c + 1]);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeVertexFetch(uint32_t* indices, size_t num_indices, size_t num_vertices,
+                         uint32_t* remap)
+{
+    const uint32_t unused = std::numeric_limits<uint32_t>::max();
+    std::fill(remap, remap + num_vertices, unused);
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < num_indices; ++i)
+    {
+        uint32_t& v = remap[indices[i]];
+        if (v == unused)
+            v = next++;
+        indices[i] = v;
+    }
+
+    for (size_t v = 0; v < num_vertices; ++v)
+        if (remap[v] == unused)
+            remap[v] = next++;
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t num_indices, size_t num_vertices,
+                                         unsigned int cache_size)
+{
+    FifoCache cache(num_vertices, cache_size);
+    std::vector<bool> used(num_vertices, false);
+
+    VertexCacheStatistics stats;
+    stats.vertices_transformed = 0;
+    size_t num_used = 0;
+    for (size_t i = 0; i < num_indices; ++i)
+    {
+        stats.vertices_transformed += cache.Access(indices[i]);
+        if (!used[indices[i]])
+        {
+            used[indices[i]] = true;
+            num_used += 1;
+        }
+    }
+
+    size_t num_triangles = num_indices / 3;
+    stats.acmr = num_triangles > 0 ? double(stats.vertices_transformed) / num_triangles : 0.0;
+    stats.atvr = num_used > 0 ? double(stats.vertices_transformed) / num_used : 0.0;
+    return stats;
+}
+
+double AnalyzeOverdraw(const uint32_t* indices, size_t num_indices,
+                       const float* positions, size_t num_vertices)
+{
+    const int GRID = 256;
+
+    if (num_indices == 0 || num_vertices == 0)
+        return 0.0;
+
+    // Coordenadas normalizadas: centro da bbox na origem, maior dimensão 1.
+    Vec3 bbox_min = Position(positions, indices[0]);
+    Vec3 bbox_max = bbox_min;
+    for (size_t i = 0; i < num_indices; ++i)
+    {
+        Vec3 p = Position(positions, indices[i]);
+        bbox_min.x = std::min(bbox_min.x, p.x); bbox_max.x = std::max(bbox_max.x, p.x);
+        bbox_min.y = std::min(bbox_min.y, p.y); bbox_max.y = std::max(bbox_max.y, p.y);
+        bbox_min.z = std::min(bbox_min.z, p.z); bbox_max.z = std::max(bbox_max.z, p.z);
+    }
+    Vec3 center = { (bbox_min.x + bbox_max.x) * 0.5f, (bbox_min.y + bbox_max.y) * 0.5f, (bbox_min.z + bbox_max.z) * 0.5f };
+    float extent = std::max(bbox_max.x - bbox_min.x, std::max(bbox_max.y - bbox_min.y, bbox_max.z - bbox_min.z));
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+    // Direção de visão (forward) e vetor "up" de cada projeção; o vetor
+    // "right" é forward x up, como em Matrix_Camera_View().
+    const float views[6][2][3] = {
+        { { 0, 0,-1 }, { 0, 1, 0 } }, { { 0, 0, 1 }, { 0, 1, 0 } },
+        { {-1, 0, 0 }, { 0, 1, 0 } }, { { 1, 0, 0 }, { 0, 1, 0 } },
+        { { 0,-1, 0 }, { 0, 0, 1 } }, { { 0, 1, 0 }, { 0, 0, 1 } },
+    };
+
+    std::vector<float> depth(GRID * GRID);
+    size_t shaded = 0;
+    size_t covered = 0;
+
+    for (int view = 0; view < 6; ++view)
+    {
+        const float* f = views[view][0];
+        const float* u = views[view][1];
+        float r[3] = { f[1]*u[2] - f[2]*u[1], f[2]*u[0] - f[0]*u[2], f[0]*u[1] - f[1]*u[0] };
+
+        std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+
+        for (size_t t = 0; t + 2 < num_indices; t += 3)
+        {
+            float sx[3], sy[3], sz[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                Vec3 p = Position(positions, indices[t + k]);
+                float q[3] = { (p.x - center.x) * scale, (p.y - center.y) * scale, (p.z - center.z) * scale };
+                sx[k] = (q[0]*r[0] + q[1]*r[1] + q[2]*r[2] + 0.5f) * (GRID - 1);
+                sy[k] = (q[0]*u[0] + q[1]*u[1] + q[2]*u[2] + 0.5f) * (GRID - 1);
+                sz[k] =  q[0]*f[0] + q[1]*f[1] + q[2]*f[2];
+            }
+
+            // "Backface culling": triângulos de frente têm vértices em
+            // sentido anti-horário, isto é, área com sinal positiva.
+            float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+            if (area <= 0.0f)
+                continue;
+
+            int x0 = std::max(0, (int)floorf(std::min(sx[0], std::min(sx[1], sx[2]))));
+            int x1 = std::min(GRID - 1, (int)ceilf(std::max(sx[0], std::max(sx[1], sx[2]))));
+            int y0 = std::max(0, (int)floorf(std::min(sy[0], std::min(sy[1], sy[2]))));
+            int y1 = std::min(GRID - 1, (int)ceilf(std::max(sy[0], std::max(sy[1], sy[2]))));
+
+            for (int y = y0; y <= y1; ++y)
+            {
+                for (int x = x0; x <= x1; ++x)
+                {
+                    float px = x + 0.5f;
+                    float py = y + 0.5f;
+                    float w0 = (sx[2] - sx[1]) * (py - sy[1]) - (sy[2] - sy[1]) * (px - sx[1]);
+                    float w1 = (sx[0] - sx[2]) * (py - sy[2]) - (sy[0] - sy[2]) * (px - sx[2]);
+                    float w2 = (sx[1] - sx[0]) * (py - sy[0]) - (sy[1] - sy[0]) * (px - sx[0]);
+                    if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                        continue;
+
+                    float z = (w0 * sz[0] + w1 * sz[1] + w2 * sz[2]) / area;
+                    float& d = depth[y * GRID + x];
+                    if (z < d)
+                    {
+                        d = z;
+                        shaded += 1;
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < depth.size(); ++i)
+            if (depth[i] != std::numeric_limits<float>::max())
+                covered += 1;
+    }
+
+    return covered > 0 ? double(shaded) / covered : 0.0;
+}
@@ -0,0 +1,126 @@
+// Normal matrices computadas na CPU. Veja "include/normalmatrix.h".
+//
+// Sendo a, b e c as 3 primeiras colunas da matriz model (sem a coordenada
+// w), a inversa da parte 3x3 tem como linhas (b×c, c×a, a×b) / det, com
+// det = a·(b×c). A inversa da transposta tem portanto essas mesmas 3
+// colunas: basta computar 3 produtos vetoriais e um produto escalar, sem
+// uma inversão 4x4 completa. Com SSE, cada registrador guarda uma
+// coordenada de 4 matrizes: as colunas são carregadas e transpostas com
+// _MM_TRANSPOSE4_PS(), e os resultados transpostos de volta antes de
+// serem escritos.
+#include "normalmatrix.h"
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define NORMALMATRIX_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+inline const glm::mat4& ModelAt(const glm::mat4* models, size_t model_stride, size_t i)
+{
+    return *(const glm::mat4*)((const char*)models + i * model_stride);
+}
+
+inline glm::mat3x4& NormalMatrixAt(glm::mat3x4* normal_matrices, size_t normal_stride, size_t i)
+{
+    return *(glm::mat3x4*)((char*)normal_matrices + i * normal_stride);
+}
+
+} // namespace
+
+glm::mat3x4 NormalMatrix(const glm::mat4& model)
+{
+    glm::vec3 a(model[0]), b(model[1]), c(model[2]);
+    glm::vec3 bc = glm::cross(b, c);
+    glm::vec3 ca = glm::cross(c, a);
+    glm::vec3 ab = glm::cross(a, b);
+
+    float det = glm::dot(a, bc);
+    float inverse_det = (det != 0.0f) ? 1.0f / det : 1.0f;
+
+    return glm::mat3x4(glm::vec4(bc * inverse_det, 0.0f),
+                       glm::vec4(ca * inverse_det, 0.0f),
+                       glm::vec4(ab * inverse_det, 0.0f));
+}
+
+void ComputeNormalMatrices(const glm::mat4* models, size_t model_stride,
+                           glm::mat3x4* normal_matrices, size_t normal_stride, size_t count)
+{
+    size_t i = 0;
+
+#ifdef NORMALMATRIX_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one  = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        // Coluna k das 4 matrizes, transposta: x, y, z e w de cada uma.
+        __m128 a[4], b[4], c[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            const glm::mat4& model = ModelAt(models, model_stride, i + k);
+            a[k] = _mm_loadu_ps(&model[0][0]);
+            b[k] = _mm_loadu_ps(&model[1][0]);
+            c[k] = _mm_loadu_ps(&model[2][0]);
+        }
+        _MM_TRANSPOSE4_PS(a[0], a[1], a[2], a[3]);
+        _MM_TRANSPOSE4_PS(b[0], b[1], b[2], b[3]);
+        _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+
+        // Produtos vetoriais b×c, c×a e a×b.
+        __m128 bc[4], ca[4], ab[4];
+        bc[0] = _mm_sub_ps(_mm_mul_ps(b[1], c[2]), _mm_mul_ps(b[2], c[1]));
+        bc[1] = _mm_sub_ps(_mm_mul_ps(b[2], c[0]), _mm_mul_ps(b[0], c[2]));
+        bc[2] = _mm_sub_ps(_mm_mul_ps(b[0], c[1]), _mm_mul_ps(b[1], c[0]));
+        ca[0] = _mm_sub_ps(_mm_mul_ps(c[1], a[2]), _mm_mul_ps(c[2], a[1]));
+        ca[1] = _mm_sub_ps(_mm_mul_ps(c[2], a[0]), _mm_mul_ps(c[0], a[2]));
+        ca[2] = _mm_sub_ps(_mm_mul_ps(c[0], a[1]), _mm_mul_ps(c[1], a[0]));
+        ab[0] = _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1]));
+        ab[1] = _mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2]));
+        ab[2] = _mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0]));
+
+        // Determinantes, trocando os iguais a 0 por 1 (veja NormalMatrix()).
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], bc[0]), _mm_mul_ps(a[1], bc[1])), _mm_mul_ps(a[2], bc[2]));
+        __m128 singular = _mm_cmpeq_ps(det, zero);
+        det = _mm_or_ps(_mm_andnot_ps(singular, det), _mm_and_ps(singular, one));
+        __m128 inverse_det = _mm_div_ps(one, det);
+
+        for (int r = 0; r < 3; ++r)
+        {
+            bc[r] = _mm_mul_ps(bc[r], inverse_det);
+            ca[r] = _mm_mul_ps(ca[r], inverse_det);
+            ab[r] = _mm_mul_ps(ab[r], inverse_det);
+        }
+        bc[3] = ca[3] = ab[3] = zero;
+
+        // Transpomos de volta: cada registrador passa a ser uma coluna de
+        // uma das 4 matrizes, com w igual a 0.
+        _MM_TRANSPOSE4_PS(bc[0], bc[1], bc[2], bc[3]);
+        _MM_TRANSPOSE4_PS(ca[0], ca[1], ca[2], ca[3]);
+        _MM_TRANSPOSE4_PS(ab[0], ab[1], ab[2], ab[3]);
+        for (int k = 0; k < 4; ++k)
+        {
+            glm::mat3x4& normal_matrix = NormalMatrixAt(normal_matrices, normal_stride, i + k);
+            _mm_storeu_ps(&normal_matrix[0][0], bc[k]);
+            _mm_storeu_ps(&normal_matrix[1][0], ca[k]);
+            _mm_storeu_ps(&normal_matrix[2][0], ab[k]);
+        }
+    }
+#endif
+
+    // Matrizes restantes (ou todas, sem SSE).
+    for (; i < count; ++i)
+        NormalMatrixAt(normal_matrices, normal_stride, i) = NormalMatrix(ModelAt(models, model_stride, i));
+}
+
+void ComputeNormalMatricesScalar(const glm::mat4* models, size_t model_stride,
+                                 glm::mat3x4* normal_matrices, size_t normal_stride, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        NormalMatrixAt(normal_matrices, normal_stride, i) = NormalMatrix(ModelAt(models, model_stride, i));
+}
@@ -0,0 +1,279 @@
+// Cálculo de normais de vértices. Veja "include/normals.h".
+//
+// As normais dos triângulos são computadas em lotes de 4 triângulos no
+// formato SoA (um registrador SSE para as coordenadas X dos 4 triângulos,
+// outro para Y, ...). Cada thread acumula as normais de um intervalo
+// contíguo de triângulos em um vetor próprio com uma normal por vértice, e
+// no final os vetores de todas as threads são somados e normalizados, também
+// em paralelo (cada thread cuida de um intervalo de vértices).
+#include "normals.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define NORMALS_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "parallel.h"
+
+namespace
+{
+
+// Intervalos menores que isto não compensam o custo de passá-los para outra
+// thread (veja RunInParallel()) e de alocar um vetor de normais para eles.
+const size_t MIN_TRIANGLES_PER_THREAD = 1 << 16;
+
+// Normais (não normalizadas) e pesos de cada vértice de 4 triângulos.
+struct TriangleBatch
+{
+    float nx[4], ny[4], nz[4]; // Normal de cada triângulo
+    float weight[3][4];        // Peso de cada vértice (0, 1, 2) de cada triângulo
+};
+
+inline float Angle(float cos_angle)
+{
+    return std::acos(std::max(-1.0f, std::min(1.0f, cos_angle)));
+}
+
+// Ângulo entre dois vetores de comprimentos ao quadrado len2_u e len2_v, a
+// partir do produto escalar entre eles. Vetores nulos definem ângulo 0.
+inline float AngleBetween(float dot, float len2_u, float len2_v)
+{
+    float denominator = std::sqrt(len2_u * len2_v);
+    return denominator > 0.0f ? Angle(dot / denominator) : 0.0f;
+}
+
+// Computa as normais de 4 triângulos. Com NORMAL_WEIGHTING_AREA, a normal é
+// o produto vetorial (b-a)x(c-a), cujo comprimento é o dobro da área, e os
+// pesos são 1. Com NORMAL_WEIGHTING_ANGLE, a normal é unitária e o peso de
+// cada vértice é o ângulo interno do triângulo naquele vértice.
+void ComputeTriangleBatch(const float* positions, const uint32_t* triangles,
+                          NormalWeighting weighting, TriangleBatch* batch)
+{
+#ifdef NORMALS_SSE2
+    // Carregamos as posições dos vértices a, b e c dos 4 triângulos.
+    #define LOAD_COORDINATE(corner, axis) \
+        _mm_setr_ps(positions[3*triangles[0 + corner] + axis], positions[3*triangles[3 + corner] + axis], \
+                    positions[3*triangles[6 + corner] + axis], positions[3*triangles[9 + corner] + axis])
+    __m128 ax = LOAD_COORDINATE(0, 0), ay = LOAD_COORDINATE(0, 1), az = LOAD_COORDINATE(0, 2);
+    __m128 bx = LOAD_COORDINATE(1, 0), by = LOAD_COORDINATE(1, 1), bz = LOAD_COORDINATE(1, 2);
+    __m128 cx = LOAD_COORDINATE(2, 0), cy = LOAD_COORDINATE(2, 1), cz = LOAD_COORDINATE(2, 2);
+    #undef LOAD_COORDINATE
+
+    __m128 abx = _mm_sub_ps(bx, ax), aby = _mm_sub_ps(by, ay), abz = _mm_sub_ps(bz, az);
+    __m128 acx = _mm_sub_ps(cx, ax), acy = _mm_sub_ps(cy, ay), acz = _mm_sub_ps(cz, az);
+
+    __m128 nx = _mm_sub_ps(_mm_mul_ps(aby, acz), _mm_mul_ps(abz, acy));
+    __m128 ny = _mm_sub_ps(_mm_mul_ps(abz, acx), _mm_mul_ps(abx, acz));
+    __m128 nz = _mm_sub_ps(_mm_mul_ps(abx, acy), _mm_mul_ps(aby, acx));
+
+    if (weighting == NORMAL_WEIGHTING_AREA)
+    {
+        _mm_storeu_ps(batch->nx, nx);
+        _mm_storeu_ps(batch->ny, ny);
+        _mm_storeu_ps(batch->nz, nz);
+        return;
+    }
+
+    // Normalizamos as normais; triângulos degenerados ficam com normal nula.
+    __m128 zero = _mm_setzero_ps();
+    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+    __m128 nonzero = _mm_cmpgt_ps(length, zero);
+    __m128 inverse_length = _mm_and_ps(nonzero, _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(length, _mm_set1_ps(1e-30f))));
+    _mm_storeu_ps(batch->nx, _mm_mul_ps(nx, inverse_length));
+    _mm_storeu_ps(batch->ny, _mm_mul_ps(ny, inverse_length));
+    _mm_storeu_ps(batch->nz, _mm_mul_ps(nz, inverse_length));
+
+    // Produtos escalares e comprimentos das arestas, para os ângulos.
+    __m128 bcx = _mm_sub_ps(cx, bx), bcy = _mm_sub_ps(cy, by), bcz = _mm_sub_ps(cz, bz);
+    #define DOT(ux, uy, uz, vx, vy, vz) \
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(ux, vx), _mm_mul_ps(uy, vy)), _mm_mul_ps(uz, vz))
+    float ab_ac[4], ab_bc[4], ac_bc[4], len2_ab[4], len2_ac[4], len2_bc[4];
+    _mm_storeu_ps(ab_ac, DOT(abx, aby, abz, acx, acy, acz));
+    _mm_storeu_ps(ab_bc, DOT(abx, aby, abz, bcx, bcy, bcz));
+    _mm_storeu_ps(ac_bc, DOT(acx, acy, acz, bcx, bcy, bcz));
+    _mm_storeu_ps(len2_ab, DOT(abx, aby, abz, abx, aby, abz));
+    _mm_storeu_ps(len2_ac, DOT(acx, acy, acz, acx, acy, acz));
+    _mm_storeu_ps(len2_bc, DOT(bcx, bcy, bcz, bcx, bcy, bcz));
+    #undef DOT
+#else
+    float ab_ac[4], ab_bc[4], ac_bc[4], len2_ab[4], len2_ac[4], len2_bc[4];
+    for (int t = 0; t < 4; ++t)
+    {
+        const float* a = &positions[3*triangles[3*t + 0]];
+        const float* b = &positions[3*triangles[3*t + 1]];
+        const float* c = &positions[3*triangles[3*t + 2]];
+        float ab[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] };
+        float ac[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
+        float bc[3] = { c[0]-b[0], c[1]-b[1], c[2]-b[2] };
+
+        float nx = ab[1]*ac[2] - ab[2]*ac[1];
+        float ny = ab[2]*ac[0] - ab[0]*ac[2];
+        float nz = ab[0]*ac[1] - ab[1]*ac[0];
+        float inverse_length = 1.0f;
+        if (weighting == NORMAL_WEIGHTING_ANGLE)
+        {
+            float length = std::sqrt(nx*nx + ny*ny + nz*nz);
+            inverse_length = length > 0.0f ? 1.0f / length : 0.0f;
+        }
+        batch->nx[t] = nx * inverse_length;
+        batch->ny[t] = ny * inverse_length;
+        batch->nz[t] = nz * inverse_length;
+
+        ab_ac[t] = ab[0]*ac[0] + ab[1]*ac[1] + ab[2]*ac[2];
+        ab_bc[t] = ab[0]*bc[0] + ab[1]*bc[1] + ab[2]*bc[2];
+        ac_bc[t] = ac[0]*bc[0] + ac[1]*bc[1] + ac[2]*bc[2];
+        len2_ab[t] = ab[0]*ab[0] + ab[1]*ab[1] + ab[2]*ab[2];
+        len2_ac[t] = ac[0]*ac[0] + ac[1]*ac[1] + ac[2]*ac[2];
+        len2_bc[t] = bc[0]*bc[0] + bc[1]*bc[1] + bc[2]*bc[2];
+    }
+    if (weighting == NORMAL_WEIGHTING_AREA)
+        return;
+#endif
+
+    // Ângulo em a: entre b-a e c-a. Em b: entre a-b e c-b. Em c: entre a-c e b-c.
+    for (int t = 0; t < 4; ++t)
+    {
+        batch->weight[0][t] = AngleBetween( ab_ac[t], len2_ab[t], len2_ac[t]);
+        batch->weight[1][t] = AngleBetween(-ab_bc[t], len2_ab[t], len2_bc[t]);
+        batch->weight[2][t] = AngleBetween( ac_bc[t], len2_ac[t], len2_bc[t]);
+    }
+}
+
+// Acumula em "sums" as normais dos triângulos [begin, end).
+void AccumulateNormals(const float* positions, const uint32_t* triangles,
+                       size_t begin, size_t end, NormalWeighting weighting,
+                       float* sums)
+{
+    TriangleBatch batch;
+    for (int corner = 0; corner < 3; ++corner)
+        for (int t = 0; t < 4; ++t)
+            batch.weight[corner][t] = 1.0f;
+
+    // Lotes de 4 triângulos; o último lote repete o último triângulo.
+    for (size_t first = begin; first < end; first += 4)
+    {
+        size_t count = std::min<size_t>(4, end - first);
+
+        uint32_t batch_triangles[12];
+        for (size_t t = 0; t < 4; ++t)
+        {
+            size_t triangle = first + std::min(t, count - 1);
+            batch_triangles[3*t + 0] = triangles[3*triangle + 0];
+            batch_triangles[3*t + 1] = triangles[3*triangle + 1];
+            batch_triangles[3*t + 2] = triangles[3*triangle + 2];
+        }
+
+        ComputeTriangleBatch(positions, batch_triangles, weighting, &batch);
+
+        for (size_t t = 0; t < count; ++t)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                float* sum = &sums[3*batch_triangles[3*t + corner]];
+                float weight = batch.weight[corner][t];
+                sum[0] += batch.nx[t] * weight;
+                sum[1] += batch.ny[t] * weight;
+                sum[2] += batch.nz[t] * weight;
+            }
+        }
+    }
+}
+
+} // namespace
+
+void ComputeVertexNormals(const float* positions, size_t num_vertices,
+                          const uint32_t* triangles, size_t num_triangles,
+                          NormalWeighting weighting, unsigned int num_threads,
+                          float* normals)
+{
+    size_t num_ranges = num_threads > 0 ? num_threads : 1;
+    num_ranges = std::min(num_ranges, num_triangles / MIN_TRIANGLES_PER_THREAD + 1);
+
+    // A primeira thread acumula diretamente em "normals"; as demais, em
+    // vetores próprios.
+    std::vector< std::vector<float> > partial_sums(num_ranges - 1);
+    std::fill(normals, normals + 3*num_vertices, 0.0f);
+
+    RunInParallel(num_ranges, [&](size_t r)
+    {
+        float* sums = normals;
+        if (r > 0)
+        {
+            partial_sums[r-1].assign(3*num_vertices, 0.0f);
+            sums = partial_sums[r-1].data();
+        }
+
+        size_t begin = num_triangles * r / num_ranges;
+        size_t end = num_triangles * (r+1) / num_ranges;
+        AccumulateNormals(positions, triangles, begin, end, weighting, sums);
+    });
+
+    // Somamos os vetores das threads e normalizamos, dividindo os vértices
+    // entre as threads.
+    RunInParallel(num_ranges, [&](size_t r)
+    {
+        size_t begin = num_vertices * r / num_ranges;
+        size_t end = num_vertices * (r+1) / num_ranges;
+        for (size_t v = begin; v < end; ++v)
+        {
+            float* n = &normals[3*v];
+            for (size_t p = 0; p < partial_sums.size(); ++p)
+            {
+                n[0] += partial_sums[p][3*v + 0];
+                n[1] += partial_sums[p][3*v + 1];
+                n[2] += partial_sums[p][3*v + 2];
+            }
+
+            float length = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+            float inverse_length = length > 0.0f ? 1.0f / length : 0.0f;
+            n[0] *= inverse_length;
+            n[1] *= inverse_length;
+            n[2] *= inverse_length;
+        }
+    });
+}
+
+void ComputeVertexNormalsReference(const float* positions, size_t num_vertices,
+                                   const uint32_t* triangles, size_t num_triangles,
+                                   float* normals)
+{
+    std::vector<int> num_triangles_per_vertex(num_vertices, 0);
+    std::fill(normals, normals + 3*num_vertices, 0.0f);
+
+    for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+    {
+        const float* a = &positions[3*triangles[3*triangle + 0]];
+        const float* b = &positions[3*triangles[3*triangle + 1]];
+        const float* c = &positions[3*triangles[3*triangle + 2]];
+
+        float u[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] };
+        float v[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
+        float n[3] = { u[1]*v[2] - u[2]*v[1], u[2]*v[0] - u[0]*v[2], u[0]*v[1] - u[1]*v[0] };
+
+        for (size_t vertex = 0; vertex < 3; ++vertex)
+        {
+            uint32_t index = triangles[3*triangle + vertex];
+            num_triangles_per_vertex[index] += 1;
+            normals[3*index + 0] += n[0];
+            normals[3*index + 1] += n[1];
+            normals[3*index + 2] += n[2];
+        }
+    }
+
+    for (size_t i = 0; i < num_vertices; ++i)
+    {
+        if (num_triangles_per_vertex[i] == 0)
+            continue;
+
+        float* n = &normals[3*i];
+        for (int k = 0; k < 3; ++k)
+            n[k] /= (float)num_triangles_per_vertex[i];
+        float length = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        for (int k = 0; k < 3; ++k)
+            n[k] /= length;
+    }
+}
@@ -0,0 +1,924 @@
+// Leitor de arquivos OBJ paralelo. Veja "include/objparser.h".
+//
+// O arquivo é mapeado em memória (veja "mappedfile.h") e interpretado
+// diretamente no mapeamento, sem cópias nem std::string por linha. Ele é
+// dividido em num_threads blocos, sempre em fronteiras de linha. Cada thread interpreta o seu bloco de forma
+// independente (fase 1). Como um bloco não sabe quantos vértices existem nos
+// blocos anteriores, índices relativos (negativos) são guardados em relação
+// ao início do bloco e corrigidos depois, assim como o grupo de suavização
+// ("s") herdado do bloco anterior. Somas de prefixo sobre as contagens de
+// cada bloco dão a posição final de cada bloco nos vetores de saída (fase 2),
+// e então cada thread copia e triangula os seus dados (fase 3).
+#include "objparser.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define OBJPARSER_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "mappedfile.h"
+#include "parallel.h"
+
+namespace
+{
+
+// Início de um grupo ("g") ou objeto ("o") dentro de um bloco.
+struct ObjGroup
+{
+    std::string name;
+    size_t      first_face;     // Primeira face do grupo (índice local ao bloco)
+    size_t      first_triangle; // Primeiro triângulo do grupo (índice local ao bloco)
+};
+
+// Resultado da interpretação de um bloco do arquivo.
+struct ObjChunk
+{
+    const char* begin;
+    const char* end;
+
+    std::vector<float> v;  // Posições ("v"), 3 floats por vértice
+    std::vector<float> vc; // Cores dos vértices, 3 floats por vértice
+    std::vector<float> vn; // Normais ("vn"), 3 floats por normal
+    std::vector<float> vt; // Coordenadas de textura ("vt"), 2 floats cada
+
+    std::vector<tinyobj::index_t> corners;    // Vértices de todas as faces, em ordem
+    std::vector<unsigned char>    relative;   // Por vértice de face: quais índices são relativos ao bloco
+    std::vector<unsigned char>    face_sizes; // Número de vértices de cada face
+    std::vector<unsigned int>     smoothing;  // Grupo de suavização de cada face
+
+    std::vector<ObjGroup> groups;
+
+    size_t       faces_before_smoothing; // Faces antes da primeira linha "s" (herdam o grupo do bloco anterior)
+    bool         sets_smoothing;         // O bloco contém alguma linha "s"?
+    unsigned int last_smoothing;         // Grupo de suavização ao final do bloco
+
+    size_t num_triangles;
+
+    // Se verdadeiro, as faces são descartadas durante a leitura (usado por
+    // BenchmarkObjTokenizer() para não esgotar a memória). Veja ParseChunk().
+    bool   discard_faces;
+    size_t num_discarded_faces;
+
+    bool        unsupported;
+    const char* error; // Linha com erro de sintaxe, ou NULL
+};
+
+enum
+{
+    RELATIVE_VERTEX   = 1,
+    RELATIVE_TEXCOORD = 2,
+    RELATIVE_NORMAL   = 4
+};
+
+// Marca um quadrilátero descartado por conter índices inválidos.
+const unsigned char SKIPPED_QUAD = 0xFF;
+
+inline bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+inline bool IsNewLine(char c)
+{
+    return c == '\r' || c == '\n' || c == '\0';
+}
+
+inline bool IsFieldEnd(char c)
+{
+    return IsSpace(c) || IsNewLine(c);
+}
+
+inline const char* SkipSpaces(const char* p)
+{
+    while (IsSpace(*p))
+        ++p;
+    return p;
+}
+
+inline bool IsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Potências de 10 representáveis exatamente em um double.
+const double EXACT_POWERS_OF_TEN[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Converte o número real que começa em p para double, com arredondamento
+// correto. Retorna um ponteiro para o primeiro caractere após o número, ou p
+// se não houver um número em p.
+//
+// Lemos até 19 dígitos significativos em um inteiro de 64 bits m, e o
+// expoente decimal e. Se m <= 2^53 e |e| <= 22, tanto m quanto 10^|e| são
+// exatos em double, e uma única multiplicação (ou divisão) IEEE produz o
+// double mais próximo do valor real (algoritmo de Clinger). Este é o caso
+// de praticamente todos os números de um arquivo OBJ; os demais são
+// convertidos por strtod().
+const char* ParseDouble(const char* p, double* value)
+{
+    const char* start = p;
+
+    bool negative = false;
+    if (*p == '-' || *p == '+')
+        negative = (*p++ == '-');
+
+    uint64_t mantissa = 0;
+    int significant_digits = 0;
+    int exponent = 0;
+    bool has_digits = false;
+    bool too_many_digits = false;
+
+    for (; IsDigit(*p); ++p)
+    {
+        has_digits = true;
+        if (mantissa == 0 && *p == '0')
+            continue;
+        if (significant_digits < 19)
+        {
+            mantissa = mantissa*10 + (*p - '0');
+            ++significant_digits;
+        }
+        else
+        {
+            too_many_digits = true;
+            ++exponent;
+        }
+    }
+
+    if (*p == '.')
+    {
+        for (++p; IsDigit(*p); ++p)
+        {
+            has_digits = true;
+            if (mantissa == 0 && *p == '0')
+            {
+                --exponent;
+                continue;
+            }
+            if (significant_digits < 19)
+            {
+                mantissa = mantissa*10 + (*p - '0');
+                ++significant_digits;
+                --exponent;
+            }
+            else
+                too_many_digits = true;
+        }
+    }
+
+    if (!has_digits)
+        return start;
+
+    if ((*p == 'e' || *p == 'E') && (IsDigit(p[1]) || ((p[1] == '-' || p[1] == '+') && IsDigit(p[2]))))
+    {
+        ++p;
+        bool negative_exponent = false;
+        if (*p == '-' || *p == '+')
+            negative_exponent = (*p++ == '-');
+
+        int explicit_exponent = 0;
+        for (; IsDigit(*p); ++p)
+            if (explicit_exponent < 100000)
+                explicit_exponent = explicit_exponent*10 + (*p - '0');
+
+        exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+    }
+
+    if (mantissa == 0)
+    {
+        *value = negative ? -0.0 : 0.0;
+        return p;
+    }
+
+    if (!too_many_digits && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double d = static_cast<double>(mantissa);
+        d = exponent < 0 ? d / EXACT_POWERS_OF_TEN[-exponent] : d * EXACT_POWERS_OF_TEN[exponent];
+        *value = negative ? -d : d;
+        return p;
+    }
+
+    // Caso raro: strtod() (o número termina em um espaço ou '\n', portanto a
+    // leitura nunca passa do final da linha).
+    char* end;
+    *value = strtod(start, &end);
+    return end;
+}
+
+// Lê um número real delimitado por espaços, como tinyobj::parseReal().
+// Retorna false (e não altera *value) se o campo não for um número.
+bool ParseReal(const char** token, float* value)
+{
+    const char* p = SkipSpaces(*token);
+
+    double d = 0.0;
+    const char* number_end = ParseDouble(p, &d);
+
+    const char* end = number_end;
+    while (!IsFieldEnd(*end))
+        ++end;
+    *token = end;
+
+    if (number_end == p)
+        return false;
+
+    // Assim como tinyobjloader, convertemos de double para float.
+    *value = static_cast<float>(d);
+    return true;
+}
+
+inline float ParseReal(const char** token, float default_value)
+{
+    float value = default_value;
+    ParseReal(token, &value);
+    return value;
+}
+
+// Índice do bit menos significativo ligado (mask != 0).
+inline unsigned int CountTrailingZeros(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Retorna o primeiro '\n' em [p, end), ou end se não houver nenhum.
+//
+// Com SSE2, comparamos 16 bytes por instrução. As leituras são sempre
+// alinhadas em 16 bytes e, portanto, nunca cruzam uma fronteira de página:
+// ler além de "end" dentro do mesmo bloco alinhado é seguro mesmo no final
+// do mapeamento do arquivo. Sem SSE2, usamos memchr().
+inline const char* FindNewLine(const char* p, const char* end)
+{
+    if (p >= end)
+        return end;
+
+#ifdef OBJPARSER_SSE2
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    size_t misalignment = reinterpret_cast<uintptr_t>(p) & 15;
+    const char* block = p - misalignment;
+    unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(block)), newline));
+    mask &= 0xFFFFu << misalignment;
+
+    while (mask == 0)
+    {
+        block += 16;
+        if (block >= end)
+            return end;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(block)), newline));
+    }
+
+    const char* found = block + CountTrailingZeros(mask);
+    return found < end ? found : end;
+#else
+    const void* found = memchr(p, '\n', end - p);
+    return found ? static_cast<const char*>(found) : end;
+#endif
+}
+
+// Lê um inteiro com sinal, como atoi().
+inline int ParseInt(const char* p)
+{
+    bool negative = false;
+    if (*p == '-' || *p == '+')
+        negative = (*p++ == '-');
+
+    int value = 0;
+    while (*p >= '0' && *p <= '9')
+        value = value*10 + (*p++ - '0');
+
+    return negative ? -value : value;
+}
+
+inline const char* SkipIndex(const char* p)
+{
+    while (*p != '/' && !IsFieldEnd(*p))
+        ++p;
+    return p;
+}
+
+// Converte um índice do arquivo (começando em 1, ou negativo se relativo ao
+// último elemento lido) para um índice começando em 0, exatamente como
+// tinyobj::fixIndex(). Índices relativos são resolvidos em relação ao início
+// do bloco e marcados em "*relative" com a flag "relative_flag".
+inline bool FixIndex(int idx, size_t count, bool allow_zero, int* ret,
+                     unsigned char* relative, unsigned char relative_flag)
+{
+    if (idx > 0)
+    {
+        *ret = idx - 1;
+        return true;
+    }
+
+    if (idx == 0)
+    {
+        *ret = -1;
+        return allow_zero;
+    }
+
+    *ret = static_cast<int>(count) + idx;
+    *relative |= relative_flag;
+    return true;
+}
+
+// Lê um vértice de face nos formatos "v", "v/t", "v//n" ou "v/t/n".
+bool ParseTriple(const char** token, const ObjChunk& chunk,
+                 tinyobj::index_t* index, unsigned char* relative)
+{
+    const char* p = *token;
+    index->vertex_index = index->texcoord_index = index->normal_index = -1;
+    *relative = 0;
+
+    if (!FixIndex(ParseInt(p), chunk.v.size()/3, false, &index->vertex_index, relative, RELATIVE_VERTEX))
+        return false;
+
+    p = SkipIndex(p);
+    if (*p == '/')
+    {
+        ++p;
+        if (*p != '/')
+        {
+            if (!FixIndex(ParseInt(p), chunk.vt.size()/2, true, &index->texcoord_index, relative, RELATIVE_TEXCOORD))
+                return false;
+            p = SkipIndex(p);
+        }
+        if (*p == '/')
+        {
+            ++p;
+            if (!FixIndex(ParseInt(p), chunk.vn.size()/3, true, &index->normal_index, relative, RELATIVE_NORMAL))
+                return false;
+            p = SkipIndex(p);
+        }
+    }
+
+    *token = p;
+    return true;
+}
+
+// Interpreta uma linha do arquivo. A linha [line, line_end) deve terminar em
+// '\n' ou '\0' (em *line_end), de forma que nenhuma leitura passe do seu
+// final. Retorna false em caso de erro de sintaxe.
+bool ParseLine(ObjChunk* chunk, const char* line, const char* line_end)
+{
+    const char* token = SkipSpaces(line);
+
+    if (token[0] == 'v' && IsSpace(token[1]))
+    {
+        token += 2;
+        float x = ParseReal(&token, 0.0f);
+        float y = ParseReal(&token, 0.0f);
+        float z = ParseReal(&token, 0.0f);
+        chunk->v.push_back(x);
+        chunk->v.push_back(y);
+        chunk->v.push_back(z);
+
+        float r, g, b;
+        if (!(ParseReal(&token, &r) && ParseReal(&token, &g) && ParseReal(&token, &b)))
+            r = g = b = 1.0f;
+        chunk->vc.push_back(r);
+        chunk->vc.push_back(g);
+        chunk->vc.push_back(b);
+    }
+    else if (token[0] == 'v' && token[1] == 'n' && IsSpace(token[2]))
+    {
+        token += 3;
+        float x = ParseReal(&token, 0.0f);
+        float y = ParseReal(&token, 0.0f);
+        float z = ParseReal(&token, 0.0f);
+        chunk->vn.push_back(x);
+        chunk->vn.push_back(y);
+        chunk->vn.push_back(z);
+    }
+    else if (token[0] == 'v' && token[1] == 't' && IsSpace(token[2]))
+    {
+        token += 3;
+        float u = ParseReal(&token, 0.0f);
+        float v = ParseReal(&token, 0.0f);
+        chunk->vt.push_back(u);
+        chunk->vt.push_back(v);
+    }
+    else if (token[0] == 'f' && IsSpace(token[1]))
+    {
+        token = SkipSpaces(token + 2);
+
+        size_t num_corners = 0;
+        while (!IsNewLine(token[0]))
+        {
+            tinyobj::index_t index;
+            unsigned char relative;
+            if (!ParseTriple(&token, *chunk, &index, &relative))
+                return false;
+
+            chunk->corners.push_back(index);
+            chunk->relative.push_back(relative);
+            ++num_corners;
+
+            while (IsSpace(*token) || *token == '\r')
+                ++token;
+        }
+
+        // Polígonos com mais de 4 vértices são triangulados por
+        // tinyobjloader com "ear clipping", que não reimplementamos aqui.
+        if (num_corners > 4)
+        {
+            chunk->unsupported = true;
+            return true;
+        }
+
+        if (!chunk->sets_smoothing)
+            chunk->faces_before_smoothing++;
+        chunk->face_sizes.push_back(static_cast<unsigned char>(num_corners));
+        chunk->smoothing.push_back(chunk->last_smoothing);
+    }
+    else if ((token[0] == 'g' || token[0] == 'o') && IsSpace(token[1]))
+    {
+        ObjGroup group;
+        group.first_face = chunk->face_sizes.size();
+        group.first_triangle = 0;
+
+        if (token[0] == 'o')
+        {
+            // Nome do objeto: todo o resto da linha.
+            const char* name_end = line_end;
+            if (name_end > token + 2 && name_end[-1] == '\r')
+                --name_end;
+            if (name_end > token + 2)
+                group.name.assign(token + 2, name_end);
+        }
+        else
+        {
+            // Vários nomes de grupo são concatenados com espaços.
+            token += 1;
+            for (;;)
+            {
+                token = SkipSpaces(token);
+                if (IsNewLine(*token))
+                    break;
+                const char* name_begin = token;
+                while (!IsFieldEnd(*token))
+                    ++token;
+                if (!group.name.empty())
+                    group.name += ' ';
+                group.name.append(name_begin, token);
+            }
+        }
+
+        chunk->groups.push_back(group);
+    }
+    else if (token[0] == 's' && IsSpace(token[1]))
+    {
+        token = SkipSpaces(token + 2);
+        if (IsNewLine(*token))
+            return true;
+
+        unsigned int smoothing = 0;
+        if (strncmp(token, "off", 3) != 0)
+        {
+            int id = ParseInt(token);
+            smoothing = id < 0 ? 0 : static_cast<unsigned int>(id);
+        }
+        chunk->sets_smoothing = true;
+        chunk->last_smoothing = smoothing;
+    }
+    else if (strncmp(token, "usemtl", 6) == 0 || strncmp(token, "mtllib", 6) == 0
+             || (token[0] == 'v' && token[1] == 'w' && IsSpace(token[2]))
+             || ((token[0] == 'l' || token[0] == 'p' || token[0] == 't') && IsSpace(token[1])))
+    {
+        // Materiais, linhas, pontos, pesos e tags: usamos tinyobjloader.
+        chunk->unsupported = true;
+        return true;
+    }
+
+    // Comentários ("#") e comandos desconhecidos são ignorados.
+    return true;
+}
+
+// Fase 1: interpreta as linhas de um bloco do arquivo.
+void ParseChunk(ObjChunk* chunk, const char* data_end)
+{
+    chunk->faces_before_smoothing = 0;
+    chunk->sets_smoothing = false;
+    chunk->last_smoothing = 0;
+    chunk->num_triangles = 0;
+    chunk->num_discarded_faces = 0;
+    chunk->unsupported = false;
+    chunk->error = NULL;
+
+    const char* line = chunk->begin;
+    while (line < chunk->end && !chunk->unsupported)
+    {
+        const char* line_end = FindNewLine(line, chunk->end);
+
+        bool ok;
+        if (line_end < data_end)
+            ok = ParseLine(chunk, line, line_end);
+        else
+        {
+            // A última linha do arquivo não termina em '\n': como o
+            // mapeamento não é terminado em '\0', copiamos a linha.
+            std::string last_line(line, line_end);
+            ok = ParseLine(chunk, last_line.c_str(), last_line.c_str() + last_line.size());
+        }
+
+        if (!ok)
+        {
+            chunk->error = line;
+            return;
+        }
+
+        if (chunk->discard_faces && chunk->corners.size() >= (1 << 16))
+        {
+            chunk->num_discarded_faces += chunk->face_sizes.size();
+            chunk->corners.clear();
+            chunk->relative.clear();
+            chunk->face_sizes.clear();
+            chunk->smoothing.clear();
+        }
+
+        line = line_end + 1;
+    }
+}
+
+// Encontra a linha do bloco que contém o i-ésimo vértice de face.
+const char* FindFaceLine(const ObjChunk& chunk, size_t corner)
+{
+    const char* line = chunk.begin;
+    size_t corners_seen = 0;
+    while (line < chunk.end)
+    {
+        const char* line_end = FindNewLine(line, chunk.end);
+        const char* token = line;
+        while (token < line_end && IsSpace(*token))
+            ++token;
+
+        if (line_end - token > 2 && token[0] == 'f' && IsSpace(token[1]))
+        {
+            // Contamos os campos da face, sem ler além do final da linha.
+            bool in_field = false;
+            for (token += 2; token < line_end && *token != '\r'; ++token)
+            {
+                bool field_char = !IsSpace(*token);
+                if (field_char && !in_field && corners_seen++ == corner)
+                    return line;
+                in_field = field_char;
+            }
+        }
+        line = line_end + 1;
+    }
+    return chunk.begin;
+}
+
+// Preenche "err" com a mensagem de erro de sintaxe na linha "line".
+void SyntaxError(const MappedFile& file, const char* line, std::string* err)
+{
+    const char* data = reinterpret_cast<const char*>(file.data);
+    size_t line_number = 1 + std::count(data, line, '\n');
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer),
+             "Failed to parse `f' line (invalid vertex index). Line %lu.\n",
+             static_cast<unsigned long>(line_number));
+    *err = buffer;
+}
+
+// Blocos menores que isto não compensam o custo de passá-los para outra
+// thread (veja RunInParallel()).
+const size_t MIN_CHUNK_SIZE = 256 << 10;
+
+// Fase 1: divide o arquivo mapeado em blocos terminados em '\n' e
+// interpreta os blocos em paralelo, com RunInParallel().
+void SplitAndParse(const MappedFile& file, unsigned int num_threads, bool discard_faces,
+                   std::vector<ObjChunk>* chunks)
+{
+    const char* data = reinterpret_cast<const char*>(file.data);
+    const char* data_end = data + file.size;
+
+    size_t num_chunks = num_threads > 0 ? num_threads : 1;
+    if (num_chunks > file.size / MIN_CHUNK_SIZE + 1)
+        num_chunks = file.size / MIN_CHUNK_SIZE + 1;
+
+    chunks->resize(num_chunks);
+    const char* chunk_begin = data;
+    for (size_t c = 0; c < num_chunks; ++c)
+    {
+        const char* chunk_end = data + file.size * (c+1) / num_chunks;
+        if (chunk_end < chunk_begin)
+            chunk_end = chunk_begin;
+        if (c + 1 == num_chunks)
+            chunk_end = data_end;
+        else
+        {
+            chunk_end = FindNewLine(chunk_end, data_end);
+            if (chunk_end < data_end)
+                ++chunk_end;
+        }
+        (*chunks)[c].begin = chunk_begin;
+        (*chunks)[c].end = chunk_end;
+        (*chunks)[c].discard_faces = discard_faces;
+        chunk_begin = chunk_end;
+    }
+
+    RunInParallel(num_chunks, [&](size_t c) { ParseChunk(&(*chunks)[c], data_end); });
+}
+
+// Fases 2 e 3: junta os resultados dos blocos interpretados por
+// SplitAndParse() em "attrib" e "shapes".
+ObjParseResult MergeChunks(std::vector<ObjChunk>& chunks, tinyobj::attrib_t* attrib,
+                           std::vector<tinyobj::shape_t>* shapes)
+{
+    const size_t num_chunks = chunks.size();
+    for (size_t c = 0; c < num_chunks; ++c)
+    {
+        if (chunks[c].unsupported)
+            return OBJ_PARSE_UNSUPPORTED;
+        if (chunks[c].error != NULL)
+            return OBJ_PARSE_ERROR;
+    }
+
+    // Fase 2: somas de prefixo. A posição de cada bloco nos vetores finais é
+    // a soma dos tamanhos dos blocos anteriores; o grupo de suavização no
+    // início de cada bloco é o último definido nos blocos anteriores.
+    std::vector<size_t> first_vertex(num_chunks + 1, 0);
+    std::vector<size_t> first_normal(num_chunks + 1, 0);
+    std::vector<size_t> first_texcoord(num_chunks + 1, 0);
+    std::vector<unsigned int> initial_smoothing(num_chunks, 0);
+    for (size_t c = 0; c < num_chunks; ++c)
+    {
+        first_vertex[c+1]   = first_vertex[c]   + chunks[c].v.size()/3;
+        first_normal[c+1]   = first_normal[c]   + chunks[c].vn.size()/3;
+        first_texcoord[c+1] = first_texcoord[c] + chunks[c].vt.size()/2;
+        if (c > 0)
+            initial_smoothing[c] = chunks[c-1].sets_smoothing ? chunks[c-1].last_smoothing : initial_smoothing[c-1];
+    }
+
+    const size_t num_vertices = first_vertex[num_chunks];
+
+    attrib->vertices.resize(3*num_vertices);
+    attrib->colors.resize(3*num_vertices);
+    attrib->normals.resize(3*first_normal[num_chunks]);
+    attrib->texcoords.resize(2*first_texcoord[num_chunks]);
+    attrib->vertex_weights.clear();
+    attrib->texcoord_ws.clear();
+    attrib->skin_weights.clear();
+
+    // Fase 3a: cópia dos atributos, correção dos índices relativos e
+    // contagem de triângulos de cada bloco.
+    RunInParallel(num_chunks, [&](size_t c)
+    {
+        ObjChunk& chunk = chunks[c];
+
+        std::copy(chunk.v.begin(),  chunk.v.end(),  attrib->vertices.begin()  + 3*first_vertex[c]);
+        std::copy(chunk.vc.begin(), chunk.vc.end(), attrib->colors.begin()    + 3*first_vertex[c]);
+        std::copy(chunk.vn.begin(), chunk.vn.end(), attrib->normals.begin()   + 3*first_normal[c]);
+        std::copy(chunk.vt.begin(), chunk.vt.end(), attrib->texcoords.begin() + 2*first_texcoord[c]);
+
+        for (size_t i = 0; i < chunk.relative.size(); ++i)
+        {
+            tinyobj::index_t& index = chunk.corners[i];
+            bool valid = true;
+            if (chunk.relative[i] & RELATIVE_VERTEX)
+            {
+                index.vertex_index += static_cast<int>(first_vertex[c]);
+                valid = valid && index.vertex_index >= 0;
+            }
+            if (chunk.relative[i] & RELATIVE_TEXCOORD)
+            {
+                index.texcoord_index += static_cast<int>(first_texcoord[c]);
+                valid = valid && index.texcoord_index >= 0;
+            }
+            if (chunk.relative[i] & RELATIVE_NORMAL)
+            {
+                index.normal_index += static_cast<int>(first_normal[c]);
+                valid = valid && index.normal_index >= 0;
+            }
+            if (!valid && chunk.error == NULL)
+                chunk.error = FindFaceLine(chunk, i);
+        }
+
+        if (!chunk.sets_smoothing)
+            chunk.last_smoothing = initial_smoothing[c];
+        for (size_t f = 0; f < chunk.faces_before_smoothing; ++f)
+            chunk.smoothing[f] = initial_smoothing[c];
+
+        // Faces com menos de 3 vértices são descartadas, assim como
+        // quadriláteros com índices inválidos (como em tinyobjloader).
+        size_t corner = 0;
+        size_t group = 0;
+        for (size_t f = 0; f < chunk.face_sizes.size(); ++f)
+        {
+            while (group < chunk.groups.size() && chunk.groups[group].first_face == f)
+                chunk.groups[group++].first_triangle = chunk.num_triangles;
+
+            unsigned char face_size = chunk.face_sizes[f];
+            if (face_size == 3)
+                chunk.num_triangles += 1;
+            else if (face_size == 4)
+            {
+                bool valid = true;
+                for (size_t k = 0; k < 4; ++k)
+                    if (static_cast<size_t>(chunk.corners[corner+k].vertex_index) >= num_vertices)
+                        valid = false;
+
+                if (valid)
+                    chunk.num_triangles += 2;
+                else
+                    chunk.face_sizes[f] = SKIPPED_QUAD;
+            }
+            corner += face_size;
+        }
+        for (; group < chunk.groups.size(); ++group)
+            chunk.groups[group].first_triangle = chunk.num_triangles;
+    });
+
+    std::vector<size_t> first_triangle(num_chunks + 1, 0);
+    for (size_t c = 0; c < num_chunks; ++c)
+    {
+        if (chunks[c].error != NULL)
+            return OBJ_PARSE_ERROR;
+        first_triangle[c+1] = first_triangle[c] + chunks[c].num_triangles;
+    }
+
+    const size_t num_triangles = first_triangle[num_chunks];
+    std::vector<tinyobj::index_t> indices(3*num_triangles);
+    std::vector<unsigned int> smoothing_group_ids(num_triangles);
+
+    // Fase 3b: triangulação. Quadriláteros são divididos pela menor diagonal,
+    // exatamente como em tinyobjloader.
+    RunInParallel(num_chunks, [&](size_t c)
+    {
+        const ObjChunk& chunk = chunks[c];
+        const std::vector<float>& v = attrib->vertices;
+
+        tinyobj::index_t* out = indices.data() + 3*first_triangle[c];
+        unsigned int* out_smoothing = smoothing_group_ids.data() + first_triangle[c];
+        const tinyobj::index_t* in = chunk.corners.data();
+
+        for (size_t f = 0; f < chunk.face_sizes.size(); ++f)
+        {
+            unsigned char face_size = chunk.face_sizes[f];
+            unsigned char corners_used = face_size;
+            if (face_size == SKIPPED_QUAD)
+            {
+                // Quadrilátero inválido: os 4 vértices são ignorados.
+                corners_used = 4;
+            }
+            else if (face_size == 3)
+            {
+                out[0] = in[0];
+                out[1] = in[1];
+                out[2] = in[2];
+                out += 3;
+                *out_smoothing++ = chunk.smoothing[f];
+            }
+            else if (face_size == 4)
+            {
+                const float* p0 = &v[3*in[0].vertex_index];
+                const float* p1 = &v[3*in[1].vertex_index];
+                const float* p2 = &v[3*in[2].vertex_index];
+                const float* p3 = &v[3*in[3].vertex_index];
+
+                float e02x = p2[0] - p0[0], e02y = p2[1] - p0[1], e02z = p2[2] - p0[2];
+                float e13x = p3[0] - p1[0], e13y = p3[1] - p1[1], e13z = p3[2] - p1[2];
+                float sqr02 = e02x*e02x + e02y*e02y + e02z*e02z;
+                float sqr13 = e13x*e13x + e13y*e13y + e13z*e13z;
+
+                if (sqr02 < sqr13)
+                {
+                    out[0] = in[0]; out[1] = in[1]; out[2] = in[2];
+                    out[3] = in[0]; out[4] = in[2]; out[5] = in[3];
+                }
+                else
+                {
+                    out[0] = in[0]; out[1] = in[1]; out[2] = in[3];
+                    out[3] = in[1]; out[4] = in[2]; out[5] = in[3];
+                }
+                out += 6;
+                *out_smoothing++ = chunk.smoothing[f];
+                *out_smoothing++ = chunk.smoothing[f];
+            }
+            in += corners_used;
+        }
+    });
+
+    // Por fim, cada sequência de faces entre duas linhas "g"/"o" vira um
+    // shape_t, com o nome definido pela linha que a inicia.
+    struct Run { const std::string* name; size_t first_triangle; size_t first_face; };
+    static const std::string no_name;
+    std::vector<Run> runs;
+    Run initial_run = { &no_name, 0, 0 };
+    runs.push_back(initial_run);
+
+    size_t first_face = 0;
+    for (size_t c = 0; c < num_chunks; ++c)
+    {
+        for (size_t g = 0; g < chunks[c].groups.size(); ++g)
+        {
+            Run run = { &chunks[c].groups[g].name,
+                        first_triangle[c] + chunks[c].groups[g].first_triangle,
+                        first_face + chunks[c].groups[g].first_face };
+            runs.push_back(run);
+        }
+        first_face += chunks[c].face_sizes.size();
+    }
+    const size_t num_faces = first_face;
+
+    shapes->clear();
+    for (size_t r = 0; r < runs.size(); ++r)
+    {
+        bool last = (r + 1 == runs.size());
+        size_t begin = runs[r].first_triangle;
+        size_t end = last ? num_triangles : runs[r+1].first_triangle;
+        size_t end_face = last ? num_faces : runs[r+1].first_face;
+
+        // tinyobjloader mantém o último shape mesmo que todas as suas faces
+        // tenham sido descartadas.
+        if (end == begin && !(last && end_face > runs[r].first_face))
+            continue;
+
+        shapes->push_back(tinyobj::shape_t());
+        tinyobj::mesh_t& mesh = shapes->back().mesh;
+        shapes->back().name = *runs[r].name;
+        mesh.indices.assign(indices.begin() + 3*begin, indices.begin() + 3*end);
+        mesh.num_face_vertices.assign(end - begin, 3);
+        mesh.material_ids.assign(end - begin, -1);
+        mesh.smoothing_group_ids.assign(smoothing_group_ids.begin() + begin, smoothing_group_ids.begin() + end);
+    }
+
+    return OBJ_PARSE_OK;
+}
+
+} // namespace
+
+ObjParseResult LoadObjParallel(const char* filename, unsigned int num_threads,
+                               tinyobj::attrib_t* attrib,
+                               std::vector<tinyobj::shape_t>* shapes,
+                               std::string* err)
+{
+    // Arquivos que não podem ser mapeados (inexistentes ou vazios) ficam a
+    // cargo da tinyobjloader, que reporta o erro adequado.
+    MappedFile file;
+    if (!MapFile(filename, &file))
+        return OBJ_PARSE_UNSUPPORTED;
+
+    // Fase 1: interpretação de cada bloco.
+    std::vector<ObjChunk> chunks;
+    SplitAndParse(file, num_threads, false, &chunks);
+
+    ObjParseResult result = MergeChunks(chunks, attrib, shapes);
+    if (result == OBJ_PARSE_ERROR)
+    {
+        for (size_t c = 0; c < chunks.size(); ++c)
+        {
+            if (chunks[c].error != NULL)
+            {
+                SyntaxError(file, chunks[c].error, err);
+                break;
+            }
+        }
+    }
+
+    UnmapFile(&file);
+    return result;
+}
+
+
+ObjParseResult ScanObjFile(const char* filename, unsigned int num_threads,
+                           size_t* num_vertices, size_t* num_faces)
+{
+    MappedFile file;
+    if (!MapFile(filename, &file))
+        return OBJ_PARSE_ERROR;
+
+    std::vector<ObjChunk> chunks;
+    SplitAndParse(file, num_threads, true, &chunks);
+
+    ObjParseResult result = OBJ_PARSE_OK;
+    *num_vertices = *num_faces = 0;
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+        if (chunks[c].unsupported)
+            result = OBJ_PARSE_UNSUPPORTED;
+        else if (chunks[c].error != NULL)
+            result = OBJ_PARSE_ERROR;
+        *num_vertices += chunks[c].v.size() / 3;
+        *num_faces += chunks[c].num_discarded_faces + chunks[c].face_sizes.size();
+    }
+
+    UnmapFile(&file);
+    return result;
+}
@@ -0,0 +1,125 @@
+// Conjunto de threads de trabalho de RunInParallel(). Veja
+// "include/parallel.h".
+//
+// Cada chamada de RunInParallel() é um lote de índices, colocado em uma
+// lista de lotes pendentes. As threads de trabalho (e a thread que chamou
+// RunInParallel()) retiram um índice por vez do primeiro lote da lista; um
+// lote sai da lista quando o seu último índice é retirado, e a chamada
+// termina quando todos os seus índices foram executados.
+#include "parallel.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+
+struct ParallelBatch
+{
+    const std::function<void(size_t)>* job;
+    size_t count;
+    size_t next;      // Próximo índice a ser retirado
+    size_t remaining; // Índices retirados ou não que ainda não terminaram
+};
+
+struct WorkerPool
+{
+    std::mutex                 mutex;   // Protege "batches" e os campos de cada lote
+    std::condition_variable    work;    // Sinalizada quando um lote é adicionado
+    std::condition_variable    done;    // Sinalizada quando um lote termina
+    std::deque<ParallelBatch*> batches; // Lotes com índices ainda não retirados
+};
+
+// Retira o próximo índice de "batch", que deve estar em pool->batches. O
+// mutex deve estar travado.
+size_t TakeIndex(WorkerPool* pool, ParallelBatch* batch)
+{
+    size_t index = batch->next++;
+    if (batch->next == batch->count)
+        pool->batches.erase(std::find(pool->batches.begin(), pool->batches.end(), batch));
+    return index;
+}
+
+// Executa um índice de "batch" com o mutex destravado, e avisa quem espera
+// pelo lote se ele terminou. O mutex deve estar travado por "lock".
+void RunIndex(WorkerPool* pool, ParallelBatch* batch, size_t index, std::unique_lock<std::mutex>& lock)
+{
+    lock.unlock();
+    (*batch->job)(index);
+    lock.lock();
+
+    batch->remaining -= 1;
+    if (batch->remaining == 0)
+        pool->done.notify_all();
+}
+
+void WorkerThread(WorkerPool* pool)
+{
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    for (;;)
+    {
+        while (pool->batches.empty())
+            pool->work.wait(lock);
+
+        ParallelBatch* batch = pool->batches.front();
+        RunIndex(pool, batch, TakeIndex(pool, batch), lock);
+    }
+}
+
+// Cria o conjunto de threads na primeira chamada. O conjunto nunca é
+// destruído: as threads ficam esperando por trabalho até o fim do programa,
+// e por isso são "detached" e o WorkerPool nunca é liberado.
+WorkerPool* GetWorkerPool()
+{
+    static WorkerPool* pool = NULL;
+    static std::once_flag created;
+    std::call_once(created, []()
+    {
+        pool = new WorkerPool();
+        for (unsigned int i = 0; i < ParallelWorkerCount(); ++i)
+            std::thread(WorkerThread, pool).detach();
+    });
+    return pool;
+}
+
+} // namespace
+
+unsigned int ParallelWorkerCount()
+{
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 2 ? cores - 1 : 1;
+}
+
+void RunInParallel(size_t count, const std::function<void(size_t)>& job)
+{
+    if (count == 0)
+        return;
+    if (count == 1)
+    {
+        job(0);
+        return;
+    }
+
+    WorkerPool* pool = GetWorkerPool();
+
+    ParallelBatch batch;
+    batch.job = &job;
+    batch.count = count;
+    batch.next = 0;
+    batch.remaining = count;
+
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->batches.push_back(&batch);
+    pool->work.notify_all();
+
+    // A thread atual também executa os índices do seu lote, até que todos
+    // tenham sido retirados; depois espera pelos que ainda estão sendo
+    // executados pelas threads de trabalho.
+    while (batch.next < batch.count)
+        RunIndex(pool, &batch, TakeIndex(pool, &batch), lock);
+    while (batch.remaining > 0)
+        pool->done.wait(lock);
+}
@@ -0,0 +1,288 @@
+// Cache de binários de programas de GPU. Veja "include/programcache.h".
+//
+// Formato do arquivo "nome.programcache" (valores na ordem de bytes nativa
+// da máquina):
+//
+//    ProgramCacheHeader
+//    binário do programa (binary_size bytes), no formato binary_format
+//
+// O arquivo é válido somente se a versão do formato for igual a
+// PROGRAM_CACHE_VERSION e a chave for igual à do programa pedido; mesmo
+// assim, o driver pode recusar o binário, e nesse caso o programa é
+// compilado do código fonte.
+#include "programcache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <GLFW/glfw3.h>
+
+#include "mappedfile.h"
+
+// Constantes do OpenGL 4.1 / GL_ARB_get_program_binary, que não estão no
+// "glad.h" do OpenGL 3.3.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// Constante de GL_KHR_parallel_shader_compile (igual a
+// GL_COMPLETION_STATUS_ARB).
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei buffer_size, GLsizei* length, GLenum* binary_format, void* binary);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binary_format, const void* binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+// Funções carregadas por InitProgramCache(); NULL se o cache está desabilitado.
+GetProgramBinaryProc  g_GetProgramBinary  = NULL;
+ProgramBinaryProc     g_ProgramBinary     = NULL;
+ProgramParameteriProc g_ProgramParameteri = NULL;
+
+// Verdadeiro se InitParallelShaderCompile() habilitou a compilação em paralelo.
+bool g_ParallelShaderCompile = false;
+
+const uint32_t PROGRAM_CACHE_MAGIC   = 0x47525046; // "FPRG"
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binary_format;
+    uint32_t binary_size;
+};
+
+// Hash FNV-1a de 64 bits, continuado a partir de "hash".
+uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Acrescenta ao hash uma string precedida do seu tamanho, para que
+// ("ab","c") e ("a","bc") resultem em chaves diferentes.
+uint64_t HashString(uint64_t hash, const char* str, size_t length)
+{
+    uint64_t length64 = length;
+    hash = HashBytes(hash, &length64, sizeof(length64));
+    return HashBytes(hash, str, length);
+}
+
+bool HasExtension(const char* name)
+{
+    GLint num_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+    for (GLint i = 0; i < num_extensions; ++i)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension != NULL && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+bool InitProgramCache()
+{
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool supported = (major > 4 || (major == 4 && minor >= 1)) || HasExtension("GL_ARB_get_program_binary");
+
+    // Alguns drivers expõem as funções mas não suportam nenhum formato.
+    GLint num_formats = 0;
+    if (supported)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+
+    if (supported && num_formats > 0)
+    {
+        g_GetProgramBinary  = (GetProgramBinaryProc)glfwGetProcAddress("glGetProgramBinary");
+        g_ProgramBinary     = (ProgramBinaryProc)glfwGetProcAddress("glProgramBinary");
+        g_ProgramParameteri = (ProgramParameteriProc)glfwGetProcAddress("glProgramParameteri");
+    }
+
+    if (g_GetProgramBinary == NULL || g_ProgramBinary == NULL || g_ProgramParameteri == NULL)
+    {
+        g_GetProgramBinary  = NULL;
+        g_ProgramBinary     = NULL;
+        g_ProgramParameteri = NULL;
+        return false;
+    }
+    return true;
+}
+
+uint64_t ProgramCacheKey(const std::string* sources, size_t num_sources)
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    const GLenum driver_strings[4] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+    for (int i = 0; i < 4; ++i)
+    {
+        const char* str = (const char*)glGetString(driver_strings[i]);
+        if (str == NULL)
+            str = "";
+        hash = HashString(hash, str, strlen(str));
+    }
+
+    for (size_t i = 0; i < num_sources; ++i)
+        hash = HashString(hash, sources[i].data(), sources[i].size());
+
+    return hash;
+}
+
+std::string ProgramCacheFilename(const char* name)
+{
+    return std::string(name) + ".programcache";
+}
+
+void PrepareProgramForCache(GLuint program_id)
+{
+    if (g_ProgramParameteri != NULL)
+        g_ProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+GLuint LoadCachedProgram(const char* name, uint64_t key)
+{
+    if (g_ProgramBinary == NULL)
+        return 0;
+
+    std::string cache_filename = ProgramCacheFilename(name);
+
+    MappedFile file;
+    if (!MapFile(cache_filename.c_str(), &file))
+        return 0;
+
+    const ProgramCacheHeader* header = (const ProgramCacheHeader*)file.data;
+    bool valid = file.size >= sizeof(ProgramCacheHeader)
+              && header->magic == PROGRAM_CACHE_MAGIC
+              && header->version == PROGRAM_CACHE_VERSION
+              && header->key == key
+              && header->binary_size > 0
+              && sizeof(ProgramCacheHeader) + uint64_t(header->binary_size) <= file.size;
+    if (!valid)
+    {
+        UnmapFile(&file);
+        return 0;
+    }
+
+    // Descartamos erros anteriores, para que glGetError() abaixo indique
+    // somente se glProgramBinary() recusou o formato.
+    while (glGetError() != GL_NO_ERROR)
+        ;
+
+    GLuint program_id = glCreateProgram();
+    g_ProgramBinary(program_id, header->binary_format, file.data + sizeof(ProgramCacheHeader), header->binary_size);
+    GLenum error = glGetError();
+    UnmapFile(&file);
+
+    // O driver recusa binários de versões ou GPUs diferentes com um erro ou
+    // deixando o programa não linkado; nos dois casos o programa é
+    // compilado de novo, e o arquivo será sobrescrito.
+    GLint linked_ok = GL_FALSE;
+    if (error == GL_NO_ERROR)
+        glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+    if (linked_ok == GL_FALSE)
+    {
+        fprintf(stderr, "WARNING: Program binary \"%s\" rejected by the driver; compiling from source.\n", cache_filename.c_str());
+        glDeleteProgram(program_id);
+        return 0;
+    }
+
+    return program_id;
+}
+
+void SaveCachedProgram(const char* name, uint64_t key, GLuint program_id)
+{
+    if (g_GetProgramBinary == NULL)
+        return;
+
+    GLint linked_ok = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+    GLint binary_size = 0;
+    glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+    if (linked_ok == GL_FALSE || binary_size <= 0)
+        return;
+
+    std::vector<unsigned char> binary(binary_size);
+    GLsizei length = 0;
+    GLenum binary_format = 0;
+    g_GetProgramBinary(program_id, binary_size, &length, &binary_format, binary.data());
+    if (length <= 0)
+        return;
+
+    ProgramCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic         = PROGRAM_CACHE_MAGIC;
+    header.version       = PROGRAM_CACHE_VERSION;
+    header.key           = key;
+    header.binary_format = binary_format;
+    header.binary_size   = (uint32_t)length;
+
+    std::string cache_filename = ProgramCacheFilename(name);
+    FILE* f = fopen(cache_filename.c_str(), "wb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "WARNING: Cannot write program cache \"%s\".\n", cache_filename.c_str());
+        return;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = ok && fwrite(binary.data(), 1, length, f) == size_t(length);
+
+    if (fclose(f) != 0 || !ok)
+    {
+        fprintf(stderr, "WARNING: Cannot write program cache \"%s\".\n", cache_filename.c_str());
+        remove(cache_filename.c_str());
+    }
+}
+
+bool InitParallelShaderCompile()
+{
+    // As duas extensões têm a mesma constante GL_COMPLETION_STATUS; somente
+    // o sufixo do nome da função muda.
+    MaxShaderCompilerThreadsProc max_shader_compiler_threads = NULL;
+    if (HasExtension("GL_KHR_parallel_shader_compile"))
+        max_shader_compiler_threads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    else if (HasExtension("GL_ARB_parallel_shader_compile"))
+        max_shader_compiler_threads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+
+    if (max_shader_compiler_threads == NULL)
+        return false;
+
+    // 0xFFFFFFFF deixa o driver escolher o número de threads. O valor
+    // padrão já é esse na especificação, mas alguns drivers só compilam em
+    // paralelo depois que a função é chamada.
+    max_shader_compiler_threads(0xFFFFFFFF);
+    g_ParallelShaderCompile = true;
+    return true;
+}
+
+bool IsProgramLinkComplete(GLuint program_id)
+{
+    if (!g_ParallelShaderCompile)
+        return true;
+
+    GLint complete = GL_TRUE;
+    glGetProgramiv(program_id, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete != GL_FALSE;
+}
@@ -0,0 +1,240 @@
+// Alocador de intervalos de buffers e arena de geometria. Veja
+// "include/rangeallocator.h".
+#include "rangeallocator.h"
+
+#include <cassert>
+#include <cstdio>
+#include <algorithm>
+
+#include "glstate.h"
+
+void InitRangeAllocator(RangeAllocator* allocator, size_t capacity)
+{
+    allocator->capacity = capacity;
+    allocator->free_size = capacity;
+    allocator->free_ranges.clear();
+    if (capacity > 0)
+        allocator->free_ranges[0] = capacity;
+}
+
+bool AllocateRange(RangeAllocator* allocator, size_t size, size_t alignment, size_t* offset)
+{
+    if (size == 0)
+    {
+        *offset = 0;
+        return true;
+    }
+
+    std::map<size_t, size_t>& ranges = allocator->free_ranges;
+    for (std::map<size_t, size_t>::iterator it = ranges.begin(); it != ranges.end(); ++it)
+    {
+        size_t range_start = it->first;
+        size_t range_size  = it->second;
+        size_t start = (range_start + alignment - 1) / alignment * alignment;
+        size_t padding = start - range_start;
+        if (padding + size > range_size)
+            continue;
+
+        // O intervalo livre é dividido em até três partes: o espaço antes do
+        // início alinhado (que continua livre), o intervalo alocado e o
+        // restante, também livre.
+        ranges.erase(it);
+        if (padding > 0)
+            ranges[range_start] = padding;
+        if (padding + size < range_size)
+            ranges[start + size] = range_size - padding - size;
+
+        allocator->free_size -= size;
+        *offset = start;
+        return true;
+    }
+
+    return false;
+}
+
+void FreeRange(RangeAllocator* allocator, size_t offset, size_t size)
+{
+    if (size == 0)
+        return;
+
+    std::map<size_t, size_t>& ranges = allocator->free_ranges;
+    std::map<size_t, size_t>::iterator next = ranges.lower_bound(offset);
+    assert(next == ranges.end() || next->first >= offset + size);
+
+    // Unimos o intervalo liberado com o intervalo livre anterior e com o
+    // seguinte, se forem vizinhos.
+    size_t start = offset;
+    size_t end = offset + size;
+    if (next != ranges.begin())
+    {
+        std::map<size_t, size_t>::iterator previous = next;
+        --previous;
+        assert(previous->first + previous->second <= offset);
+        if (previous->first + previous->second == offset)
+        {
+            start = previous->first;
+            ranges.erase(previous);
+        }
+    }
+    if (next != ranges.end() && next->first == end)
+    {
+        end += next->second;
+        ranges.erase(next);
+    }
+
+    ranges[start] = end - start;
+    allocator->free_size += size;
+}
+
+size_t LargestFreeRange(const RangeAllocator& allocator)
+{
+    size_t largest = 0;
+    for (std::map<size_t, size_t>::const_iterator it = allocator.free_ranges.begin(); it != allocator.free_ranges.end(); ++it)
+        largest = std::max(largest, it->second);
+    return largest;
+}
+
+void InitGeometryArena(GeometryArena* arena, int vertex_format, size_t vertex_size,
+                       void (*setup_vertex_attributes)(int vertex_format),
+                       size_t vertex_capacity, size_t index_capacity)
+{
+    arena->vertex_format = vertex_format;
+    arena->vertex_size = vertex_size;
+    arena->setup_vertex_attributes = setup_vertex_attributes;
+    arena->vertex_buffer_id = 0;
+    arena->index_buffer_id = 0;
+    arena->meshes.clear();
+    glGenVertexArrays(1, &arena->vertex_array_object_id);
+    ResizeGeometryArena(arena, vertex_capacity, index_capacity);
+}
+
+uint32_t AllocateArenaMesh(GeometryArena* arena, const char* filename, size_t num_vertices, size_t num_index_bytes)
+{
+    // Intervalos de índices com tamanho múltiplo de 4 bytes ficam sempre
+    // alinhados para qualquer tipo de índice, e podem ser compactados sem
+    // espaços entre eles.
+    size_t index_bytes = (num_index_bytes + 3) & ~size_t(3);
+
+    ArenaMesh mesh;
+    mesh.filename = filename;
+    mesh.live = true;
+    mesh.num_vertices = num_vertices;
+    mesh.index_bytes = index_bytes;
+
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        bool vertices_ok = AllocateRange(&arena->vertices, num_vertices, 1, &mesh.base_vertex);
+        bool indices_ok  = AllocateRange(&arena->indices, index_bytes, 4, &mesh.index_offset);
+        if (vertices_ok && indices_ok)
+            break;
+
+        if (vertices_ok)
+            FreeRange(&arena->vertices, mesh.base_vertex, num_vertices);
+        if (indices_ok)
+            FreeRange(&arena->indices, mesh.index_offset, index_bytes);
+
+        // Depois da compactação todo o espaço livre fica no final dos
+        // buffers. Se ele não for suficiente, dobramos a capacidade.
+        size_t vertex_capacity = arena->vertices.capacity;
+        size_t index_capacity = arena->indices.capacity;
+        if (arena->vertices.free_size < num_vertices)
+            vertex_capacity = std::max(2 * vertex_capacity, vertex_capacity + num_vertices);
+        if (arena->indices.free_size < index_bytes)
+            index_capacity = std::max(2 * index_capacity, index_capacity + index_bytes);
+        ResizeGeometryArena(arena, vertex_capacity, index_capacity);
+    }
+
+    // Reutilizamos a posição de uma malha liberada, se existir.
+    for (size_t i = 0; i < arena->meshes.size(); ++i)
+    {
+        if (!arena->meshes[i].live)
+        {
+            arena->meshes[i] = mesh;
+            return i;
+        }
+    }
+    arena->meshes.push_back(mesh);
+    return arena->meshes.size() - 1;
+}
+
+void FreeArenaMesh(GeometryArena* arena, uint32_t arena_mesh)
+{
+    ArenaMesh& mesh = arena->meshes[arena_mesh];
+    if (!mesh.live)
+        return;
+
+    FreeRange(&arena->vertices, mesh.base_vertex, mesh.num_vertices);
+    FreeRange(&arena->indices, mesh.index_offset, mesh.index_bytes);
+    mesh.live = false;
+    mesh.objects.clear();
+}
+
+// Os dados das malhas existentes são copiados para os novos buffers, uma
+// após a outra, com glCopyBufferSubData(). O VAO da arena continua o mesmo;
+// somente os seus atributos são redefinidos, apontando para o novo VBO.
+void ResizeGeometryArena(GeometryArena* arena, size_t vertex_capacity, size_t index_capacity)
+{
+    size_t vertex_size = arena->vertex_size;
+
+    GLuint vertex_buffer_id, index_buffer_id;
+    glGenBuffers(1, &vertex_buffer_id);
+    GLState_BindBuffer(GL_COPY_WRITE_BUFFER, vertex_buffer_id);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertex_capacity * vertex_size, NULL, GL_STATIC_DRAW);
+    glGenBuffers(1, &index_buffer_id);
+    GLState_BindBuffer(GL_COPY_WRITE_BUFFER, index_buffer_id);
+    glBufferData(GL_COPY_WRITE_BUFFER, index_capacity, NULL, GL_STATIC_DRAW);
+
+    RangeAllocator vertices, indices;
+    InitRangeAllocator(&vertices, vertex_capacity);
+    InitRangeAllocator(&indices, index_capacity);
+
+    for (size_t i = 0; i < arena->meshes.size(); ++i)
+    {
+        ArenaMesh& mesh = arena->meshes[i];
+        if (!mesh.live)
+            continue;
+
+        size_t base_vertex, index_offset;
+        AllocateRange(&vertices, mesh.num_vertices, 1, &base_vertex);
+        AllocateRange(&indices, mesh.index_bytes, 4, &index_offset);
+
+        GLState_BindBuffer(GL_COPY_READ_BUFFER, arena->vertex_buffer_id);
+        GLState_BindBuffer(GL_COPY_WRITE_BUFFER, vertex_buffer_id);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            mesh.base_vertex * vertex_size, base_vertex * vertex_size, mesh.num_vertices * vertex_size);
+        GLState_BindBuffer(GL_COPY_READ_BUFFER, arena->index_buffer_id);
+        GLState_BindBuffer(GL_COPY_WRITE_BUFFER, index_buffer_id);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, mesh.index_offset, index_offset, mesh.index_bytes);
+
+        mesh.base_vertex = base_vertex;
+        mesh.index_offset = index_offset;
+    }
+    GLState_BindBuffer(GL_COPY_READ_BUFFER, 0);
+    GLState_BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (arena->vertex_buffer_id != 0)
+    {
+        GLState_DeleteBuffers(1, &arena->vertex_buffer_id);
+        GLState_DeleteBuffers(1, &arena->index_buffer_id);
+        printf("Arena de geometria recriada: %lu vértices (%lu livres), %lu bytes de índices (%lu livres).\n",
+            (unsigned long)vertex_capacity, (unsigned long)vertices.free_size,
+            (unsigned long)index_capacity, (unsigned long)indices.free_size);
+    }
+
+    arena->vertex_buffer_id = vertex_buffer_id;
+    arena->index_buffer_id = index_buffer_id;
+    arena->vertices = vertices;
+    arena->indices = indices;
+
+    GLState_BindVertexArray(arena->vertex_array_object_id);
+    GLState_BindBuffer(GL_ARRAY_BUFFER, arena->vertex_buffer_id);
+    arena->setup_vertex_attributes(arena->vertex_format);
+    GLState_BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena->index_buffer_id);
+    GLState_BindVertexArray(0);
+}
+
+size_t ArenaIndexOffset(const GeometryArena& arena, uint32_t arena_mesh, size_t first_index, size_t index_size)
+{
+    return arena.meshes[arena_mesh].index_offset + first_index * index_size;
+}
@@ -0,0 +1,832 @@
+// Fila de desenho e as suas chaves de ordenação. Veja
+// "include/renderqueue.h".
+#include "renderqueue.h"
+
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+#include "glstate.h"
+#include "culling.h"
+#include "normalmatrix.h"
+
+bool g_UseFrustumCulling = true;
+bool g_UseOcclusionCulling = false;
+bool g_UseDrawBatching = true;
+
+uint64_t MakeDrawKey(uint32_t program, uint32_t texture_set, uint32_t vertex_array, float depth)
+{
+    // Para floats positivos, a ordem dos bits interpretados como inteiro é a
+    // mesma dos valores; os 24 bits mais significativos mantêm 15 bits de
+    // mantissa, suficientes para ordenar os objetos por distância.
+    uint32_t depth_bits = 0;
+    if (depth > 0.0f)
+        memcpy(&depth_bits, &depth, sizeof(depth_bits));
+
+    return (uint64_t(program & 0xFF) << 56)
+         | (uint64_t(texture_set & 0xFF) << 48)
+         | (uint64_t(vertex_array & 0xFFFF) << 32)
+         | (uint64_t(depth_bits >> 8) << 8);
+}
+
+void RadixSortDrawKeys(uint64_t* keys, uint32_t* items, size_t count,
+                       std::vector<uint64_t>* temp_keys, std::vector<uint32_t>* temp_items)
+{
+    if (count <= 1)
+        return;
+
+    if (temp_keys->size() < count)
+        temp_keys->resize(count);
+    if (temp_items->size() < count)
+        temp_items->resize(count);
+
+    // Histogramas dos 8 dígitos, computados em uma única passada.
+    size_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (size_t i = 0; i < count; ++i)
+        for (int digit = 0; digit < 8; ++digit)
+            histograms[digit][(keys[i] >> (8*digit)) & 0xFF] += 1;
+
+    uint64_t* source_keys  = keys;
+    uint32_t* source_items = items;
+    uint64_t* target_keys  = temp_keys->data();
+    uint32_t* target_items = temp_items->data();
+
+    for (int digit = 0; digit < 8; ++digit)
+    {
+        size_t* histogram = histograms[digit];
+
+        // Se todas as chaves têm o mesmo valor neste dígito, a passada não
+        // mudaria a ordem. Isto é comum: por exemplo, há poucos programas.
+        if (histogram[(source_keys[0] >> (8*digit)) & 0xFF] == count)
+            continue;
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket)
+        {
+            size_t n = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += n;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t position = histogram[(source_keys[i] >> (8*digit)) & 0xFF]++;
+            target_keys[position]  = source_keys[i];
+            target_items[position] = source_items[i];
+        }
+
+        std::swap(source_keys, target_keys);
+        std::swap(source_items, target_items);
+    }
+
+    // Se o resultado terminou nos vetores temporários, copiamos de volta.
+    if (source_keys != keys)
+    {
+        memcpy(keys, source_keys, count * sizeof(uint64_t));
+        memcpy(items, source_items, count * sizeof(uint32_t));
+    }
+}
+
+namespace
+{
+
+// Itens visíveis têm a sua oclusão consultada somente a cada
+// OCCLUSION_QUERY_INTERVAL quadros (coerência temporal: o que está visível
+// em um quadro em geral continua visível no próximo). Itens escondidos são
+// consultados a cada quadro, para que reapareçam sem atraso.
+const int OCCLUSION_QUERY_INTERVAL = 8;
+
+// A bbox desenhada nas consultas é aumentada por esta fração da sua
+// diagonal, para que não coincida com a superfície de objetos planos (cuja
+// bbox tem altura zero) e seja escondida pelo próprio objeto.
+const float OCCLUSION_PROXY_MARGIN = 0.01f;
+
+struct DrawItem
+{
+    GLuint            program;
+    uint32_t          texture_set; // Índice em RenderQueueResources::texture_sets
+    SceneObjectHandle object;
+    glm::mat4         model;
+    uint32_t          occlusion_query; // Índice em RenderQueue::occlusion_queries; veja OcclusionQueryIndex()
+};
+
+// Dados de um item desenhado em lote por FlushDrawBatch(), lidos pelo vertex
+// shader do texture buffer "draw_data", 9 texels RGBA32F por item.
+struct BatchDrawData
+{
+    glm::mat4   model;
+    glm::mat3x4 normal_matrix; // Veja "normalmatrix.h"
+    glm::vec4   bbox_min;      // w: não utilizado
+    glm::vec4   bbox_max;      // w: 1 se as posições estão quantizadas, 0 caso contrário
+};
+
+// Estado da consulta de oclusão ("occlusion query") de um item da fila de
+// desenho, mantido entre quadros. Veja UpdateOcclusionQuery().
+struct OcclusionQuery
+{
+    GLuint       query;              // Criada com glGenQueries() na primeira consulta
+    bool         pending;            // Consulta enviada, resultado ainda não lido
+    bool         visible;            // Último resultado lido
+    int          frames_until_query; // Quadros até consultar de novo um item visível
+    unsigned int last_frame;         // Último quadro em que o item foi desenhado
+    unsigned int submitted_frame;    // Último quadro em que o item foi adicionado à fila
+    uint64_t     key;                // Objeto e instância do item; veja OcclusionQueryKey()
+};
+
+// O que FlushRenderQueue() faz com um item, segundo a sua consulta de
+// oclusão.
+enum OcclusionAction
+{
+    OCCLUSION_DRAW,             // Desenha normalmente
+    OCCLUSION_DRAW_CONDITIONAL, // Desenha dentro de glBeginConditionalRender(), com o resultado ainda na GPU
+    OCCLUSION_SKIP,             // Não desenha: a última consulta não passou nenhuma amostra
+    ITEM_BATCHED                // Desenha em um lote de FlushDrawBatch(); veja FlushRenderQueue()
+};
+
+// Estado da fila de desenho. Veja FlushRenderQueue().
+struct RenderQueue
+{
+    std::vector<DrawItem> items;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order;
+    std::vector<uint64_t> temp_keys;  // Utilizados por RadixSortDrawKeys()
+    std::vector<uint32_t> temp_order;
+    BoundingBoxes         boxes;   // AABB de cada item em coordenadas globais, para o culling
+    std::vector<glm::mat3x4> normal_matrices; // Normal matrix de cada item; veja FlushRenderQueue()
+    std::vector<unsigned char> visible;
+    std::vector<unsigned char> actions; // OcclusionAction de cada item visível, na ordem dos desenhos
+
+    // Consultas de oclusão, uma por item (objeto e instância) adicionado à
+    // fila no último quadro desenhado ou no atual. As posições dos itens
+    // descartados (veja ReleaseUnsubmittedOcclusionQueries()) são
+    // reutilizadas.
+    std::vector<OcclusionQuery>            occlusion_queries;
+    std::unordered_map<uint64_t, uint32_t> occlusion_query_indices; // Por OcclusionQueryKey(): índice em occlusion_queries
+    std::vector<uint32_t>                  free_occlusion_queries;  // Índices em occlusion_queries sem item
+    std::vector<uint32_t>                  query_items;             // Itens cuja bbox é consultada ao final do quadro
+    unsigned int                           frame;
+    FrameUniforms         frame_uniforms; // Veja BeginRenderQueue()
+    RenderQueueStatistics statistics; // Do último FlushRenderQueue()
+    RenderQueueResources  resources;  // Veja SetRenderQueueResources()
+
+    // Lote de itens de mesmo programa e conjunto de texturas, desenhado por
+    // FlushDrawBatch(). Veja CreateDrawBatchBuffers().
+    std::vector<uint32_t>      batch_items;
+    std::vector<uint64_t>      batch_keys;
+    std::vector<uint32_t>      batch_order;
+    std::vector<BatchDrawData> batch_data;
+    size_t                     max_batch_items;   // Limitado por GL_MAX_TEXTURE_BUFFER_SIZE
+    GLuint                     draw_data_buffer;  // BatchDrawData de cada item do lote
+    GLuint                     draw_data_texture; // Texture buffer que lê draw_data_buffer
+    GLuint                     draw_id_buffer;    // Inteiros 0, 1, 2, ...; veja FlushDrawBatch()
+    size_t                     draw_id_capacity;
+};
+
+RenderQueue queue;
+
+// Cria o texture buffer com os dados dos itens de um lote e o buffer de
+// identificadores de FlushDrawBatch(). O tamanho máximo de um lote é
+// limitado pelo número de texels de um texture buffer.
+void CreateDrawBatchBuffers()
+{
+
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    queue.max_batch_items = std::max<size_t>(1, size_t(max_texels) / (sizeof(BatchDrawData) / sizeof(glm::vec4)));
+
+    glGenBuffers(1, &queue.draw_data_buffer);
+    GLState_BindBuffer(GL_TEXTURE_BUFFER, queue.draw_data_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(BatchDrawData), NULL, GL_STREAM_DRAW);
+    GLState_BindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &queue.draw_data_texture);
+    GLState_ActiveTexture(GL_TEXTURE0 + DRAW_DATA_TEXTURE_UNIT);
+    GLState_BindTexture(GL_TEXTURE_BUFFER, queue.draw_data_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, queue.draw_data_buffer);
+    GLState_ActiveTexture(GL_TEXTURE0);
+
+    glGenBuffers(1, &queue.draw_id_buffer);
+    queue.draw_id_capacity = 0;
+}
+
+// Desenha os itens de RenderQueue::batch_items, todos de mesmo programa e
+// conjunto de texturas (já ligados por FlushRenderQueue()) e com os seus
+// vértices na arena de geometria. Os itens são agrupados por objeto e nível
+// de detalhe, e cada grupo é desenhado com uma única chamada de
+// glDrawElementsInstancedBaseVertex(), qualquer que seja o número de itens.
+// A matriz model, a normal matrix e a bbox de cada item vêm do
+// texture buffer "draw_data", e não de variáveis "uniform".
+//
+// O OpenGL 3.3 não tem gl_DrawID nem "base instance", e portanto um desenho
+// de glMultiDrawElementsBaseVertex() não tem como saber qual item ele é. Em
+// vez disso, o índice do item é o atributo de instância "draw_id", lido de
+// um buffer com os inteiros 0, 1, 2, ..., apontado para o primeiro item de
+// cada grupo. Assim, o número de chamadas depende só do número de malhas e
+// LODs diferentes no lote, e não do número de itens.
+void FlushDrawBatch(const glm::mat4& view_projection)
+{
+    VirtualScene& scene = g_VirtualScene;
+    RenderQueueStatistics& statistics = queue.statistics;
+    size_t count = queue.batch_items.size();
+
+    // Ordenamos os itens por objeto e LOD, mantendo juntos os de cada grupo.
+    queue.batch_keys.resize(count);
+    queue.batch_order.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const DrawItem& item = queue.items[queue.batch_items[i]];
+        int lod = SelectLevelOfDetail(item.object, view_projection * item.model);
+        scene.current_lods[item.object] = lod;
+        queue.batch_keys[i] = (uint64_t(item.object) << 8) | uint64_t(lod);
+        queue.batch_order[i] = queue.batch_items[i];
+    }
+    RadixSortDrawKeys(queue.batch_keys.data(), queue.batch_order.data(), count, &queue.temp_keys, &queue.temp_order);
+
+    queue.batch_data.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const DrawItem& item = queue.items[queue.batch_order[i]];
+        SceneObjectHandle handle = item.object;
+        BatchDrawData& data = queue.batch_data[i];
+        data.model = item.model;
+        data.normal_matrix = queue.normal_matrices[queue.batch_order[i]];
+        data.bbox_min = glm::vec4(scene.bbox_mins[handle], 1.0f);
+        data.bbox_max = glm::vec4(scene.bbox_maxs[handle], scene.quantized_positions[handle] ? 1.0f : 0.0f);
+    }
+
+    // Como em DrawVirtualObjectInstanced(), reenviamos o buffer inteiro a
+    // cada lote ("orphaning").
+    GLState_BindBuffer(GL_TEXTURE_BUFFER, queue.draw_data_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, count * sizeof(BatchDrawData), queue.batch_data.data(), GL_STREAM_DRAW);
+
+    // O buffer de identificadores só muda quando precisa crescer.
+    GLState_BindBuffer(GL_ARRAY_BUFFER, queue.draw_id_buffer);
+    if (queue.draw_id_capacity < count)
+    {
+        queue.draw_id_capacity = std::max(count, 2 * queue.draw_id_capacity);
+        std::vector<GLint> draw_ids(queue.draw_id_capacity);
+        for (size_t i = 0; i < draw_ids.size(); ++i)
+            draw_ids[i] = GLint(i);
+        glBufferData(GL_ARRAY_BUFFER, draw_ids.size() * sizeof(GLint), draw_ids.data(), GL_STATIC_DRAW);
+    }
+
+    GLState_BindVertexArray(g_GeometryArena.vertex_array_object_id);
+    glVertexAttribDivisor(8, 1);
+    glEnableVertexAttribArray(8);
+    GLState_ActiveTexture(GL_TEXTURE0 + DRAW_DATA_TEXTURE_UNIT);
+    GLState_BindTexture(GL_TEXTURE_BUFFER, queue.draw_data_texture);
+    glUniform1i(*queue.resources.batched_uniform, 1);
+
+    size_t first = 0;
+    while (first < count)
+    {
+        size_t last = first + 1;
+        while (last < count && queue.batch_keys[last] == queue.batch_keys[first])
+            ++last;
+
+        SceneObjectHandle handle = queue.items[queue.batch_order[first]].object;
+        int lod = int(queue.batch_keys[first] & 0xFF);
+        size_t first_index = scene.lod_first_indices[handle*MAX_LODS + lod];
+        size_t num_indices = scene.lod_num_indices[handle*MAX_LODS + lod];
+        size_t group_items = last - first;
+
+        g_LodDraws[lod] += group_items;
+        g_LodTriangles[lod] += group_items * (num_indices / 3);
+
+        glVertexAttribIPointer(8, 1, GL_INT, sizeof(GLint), (void*)(first * sizeof(GLint)));
+        glDrawElementsInstancedBaseVertex(
+            scene.rendering_modes[handle],
+            num_indices,
+            scene.index_types[handle],
+            (void*)ArenaIndexOffset(g_GeometryArena, scene.arena_meshes[handle], first_index, IndexTypeSize(scene.index_types[handle])),
+            group_items,
+            g_GeometryArena.meshes[scene.arena_meshes[handle]].base_vertex
+        );
+        statistics.batches += 1;
+
+        first = last;
+    }
+    statistics.batched_items += count;
+
+    // O atributo fica desabilitado fora dos lotes, como os de
+    // DrawVirtualObjectInstanced().
+    glDisableVertexAttribArray(8);
+    glUniform1i(*queue.resources.batched_uniform, 0);
+
+    queue.batch_items.clear();
+}
+
+// Identificação de um item entre quadros: o objeto e o número de instância
+// dado por quem adicionou o item. Veja SubmitDrawItem().
+uint64_t OcclusionQueryKey(SceneObjectHandle object, uint32_t instance)
+{
+    return (uint64_t(object) << 32) | instance;
+}
+
+// Índice em queue.occlusion_queries do estado da consulta de oclusão do
+// item com a chave dada, criado (sem consulta) se o item não foi adicionado
+// à fila no quadro anterior.
+uint32_t OcclusionQueryIndex(uint64_t key)
+{
+    std::unordered_map<uint64_t, uint32_t>::iterator found = queue.occlusion_query_indices.find(key);
+    if (found != queue.occlusion_query_indices.end())
+    {
+        queue.occlusion_queries[found->second].submitted_frame = queue.frame;
+        return found->second;
+    }
+
+    OcclusionQuery occlusion;
+    occlusion.query = 0;
+    occlusion.pending = false;
+    occlusion.visible = true;
+    occlusion.frames_until_query = 0;
+    occlusion.last_frame = queue.frame;
+    occlusion.submitted_frame = queue.frame;
+    occlusion.key = key;
+
+    uint32_t index;
+    if (!queue.free_occlusion_queries.empty())
+    {
+        index = queue.free_occlusion_queries.back();
+        queue.free_occlusion_queries.pop_back();
+        queue.occlusion_queries[index] = occlusion;
+    }
+    else
+    {
+        index = queue.occlusion_queries.size();
+        queue.occlusion_queries.push_back(occlusion);
+    }
+    queue.occlusion_query_indices[key] = index;
+    return index;
+}
+
+// Descarta o estado das consultas de oclusão dos itens que não foram
+// adicionados à fila no quadro atual (objetos que deixaram de ser
+// desenhados, ou instâncias que deixaram de existir), apagando as suas
+// consultas na GPU.
+void ReleaseUnsubmittedOcclusionQueries()
+{
+    for (uint32_t index = 0; index < queue.occlusion_queries.size(); ++index)
+    {
+        OcclusionQuery& occlusion = queue.occlusion_queries[index];
+        if (occlusion.submitted_frame == queue.frame)
+            continue;
+
+        // Posições já descartadas não estão mais em occlusion_query_indices.
+        std::unordered_map<uint64_t, uint32_t>::iterator found = queue.occlusion_query_indices.find(occlusion.key);
+        if (found == queue.occlusion_query_indices.end() || found->second != index)
+            continue;
+        queue.occlusion_query_indices.erase(found);
+
+        if (occlusion.query != 0)
+            glDeleteQueries(1, &occlusion.query);
+        occlusion.query = 0;
+        queue.free_occlusion_queries.push_back(index);
+    }
+}
+
+// Atualiza a consulta de oclusão de um item da fila de desenho no início do
+// seu desenho, e retorna como o item deve ser desenhado. O resultado da
+// consulta anterior só é lido se já estiver disponível
+// (GL_QUERY_RESULT_AVAILABLE), e portanto a CPU nunca espera pela GPU.
+// "needs_query" indica se a bbox do item deve ser consultada de novo neste
+// quadro. Itens com always_draw verdadeiro (em geral, perto da câmera) são
+// sempre desenhados, sem consulta.
+OcclusionAction UpdateOcclusionQuery(OcclusionQuery* occlusion, uint32_t index, unsigned int frame, bool always_draw, bool* needs_query)
+{
+    // Se o item não foi desenhado no quadro anterior (por exemplo, porque
+    // estava fora do frustum), o último resultado não vale mais.
+    if (occlusion->last_frame + 1 != frame)
+    {
+        occlusion->pending = false;
+        occlusion->visible = true;
+        occlusion->frames_until_query = 0;
+    }
+    occlusion->last_frame = frame;
+
+    if (occlusion->pending)
+    {
+        GLuint available = 0;
+        glGetQueryObjectuiv(occlusion->query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint any_samples_passed = 0;
+            glGetQueryObjectuiv(occlusion->query, GL_QUERY_RESULT, &any_samples_passed);
+            occlusion->pending = false;
+            occlusion->visible = any_samples_passed != 0;
+
+            // O índice do item distribui as novas consultas dos itens
+            // visíveis entre os quadros.
+            occlusion->frames_until_query = OCCLUSION_QUERY_INTERVAL / 2 + index % OCCLUSION_QUERY_INTERVAL;
+        }
+    }
+
+    *needs_query = false;
+
+    if (always_draw)
+    {
+        occlusion->pending = false;
+        occlusion->visible = true;
+        occlusion->frames_until_query = 0;
+        return OCCLUSION_DRAW;
+    }
+
+    if (occlusion->pending)
+        return OCCLUSION_DRAW_CONDITIONAL;
+
+    if (!occlusion->visible)
+    {
+        *needs_query = true;
+        return OCCLUSION_SKIP;
+    }
+
+    occlusion->frames_until_query -= 1;
+    if (occlusion->frames_until_query <= 0)
+        *needs_query = true;
+    return OCCLUSION_DRAW;
+}
+
+} // namespace
+
+void SetRenderQueueResources(const RenderQueueResources& resources)
+{
+    queue.resources = resources;
+}
+
+// Esvazia a fila de desenho no início de um quadro. As matrizes view e
+// projection do bloco FrameUniforms são utilizadas para calcular a
+// profundidade de cada item, e o bloco é enviado para a GPU por
+// FlushRenderQueue().
+void BeginRenderQueue(const FrameUniforms& frame_uniforms)
+{
+    queue.items.clear();
+    queue.keys.clear();
+    ClearBoundingBoxes(&queue.boxes);
+    queue.query_items.clear();
+    queue.frame += 1;
+    queue.frame_uniforms = frame_uniforms;
+}
+
+// Adiciona um objeto à fila de desenho, a ser desenhado com o programa e o
+// conjunto de texturas (índice em RenderQueueResources::texture_sets) dados. Objetos que ainda
+// não foram lidos de nenhum arquivo são ignorados, como em
+// DrawVirtualObject(). "instance" distingue as cópias do objeto no quadro;
+// veja "renderqueue.h".
+void SubmitDrawItem(GLuint program, uint32_t texture_set, SceneObjectHandle object, uint32_t instance, const glm::mat4& model)
+{
+    const VirtualScene& scene = g_VirtualScene;
+    if (!scene.loaded[object])
+        return;
+
+    // Variante dos shaders ainda sendo compilada; veja GetShaderVariant().
+    if (program == 0)
+        return;
+
+    DrawItem item;
+    item.program     = program;
+    item.texture_set = texture_set;
+    item.object      = object;
+    item.model       = model;
+    item.occlusion_query = 0;
+
+    if (g_UseOcclusionCulling)
+        item.occlusion_query = OcclusionQueryIndex(OcclusionQueryKey(object, instance));
+
+    // A bbox do item em coordenadas globais é testada contra o frustum por
+    // FlushRenderQueue(). A profundidade do item é a distância do centro da
+    // bbox até a câmera, ao longo do eixo -Z do sistema de coordenadas da
+    // câmera.
+    glm::vec3 center, extent;
+    TransformBoundingBox(model, scene.bbox_mins[object], scene.bbox_maxs[object], &center, &extent);
+    AddBoundingBox(&queue.boxes, center, extent);
+    glm::vec4 center_camera = queue.frame_uniforms.view * glm::vec4(center, 1.0f);
+
+    GLuint vertex_array_object_id = scene.resident[object] ? scene.vertex_array_object_ids[object] : g_BoundingBoxProxyVAO;
+
+    queue.items.push_back(item);
+    queue.keys.push_back(MakeDrawKey(program, texture_set, vertex_array_object_id, -center_camera.z));
+}
+
+// Descarta os itens da fila de desenho fora do frustum da câmera, ordena os
+// restantes pelas suas chaves e os desenha. Cada
+// troca de estado é feita somente se o valor for diferente do definido pelo
+// item anterior; o estado do OpenGL no início da função é considerado
+// desconhecido, pois outras partes do código (carregamento de texturas,
+// renderização de texto) também o alteram. Com g_UseDrawBatching, os itens
+// seguidos de mesmo programa e conjunto de texturas são desenhados juntos
+// por FlushDrawBatch().
+void FlushRenderQueue()
+{
+    const VirtualScene& scene = g_VirtualScene;
+    const std::vector<GLuint>& texture_ids = *queue.resources.texture_ids;
+    RenderQueueStatistics& statistics = queue.statistics;
+    memset(&statistics, 0, sizeof(statistics));
+
+    // Descartamos os itens cujas bboxes estão fora do frustum, e ordenamos
+    // somente as chaves dos itens restantes.
+    size_t count = queue.items.size();
+    queue.order.resize(count);
+    if (g_UseFrustumCulling)
+    {
+        glm::vec4 planes[6];
+        ExtractFrustumPlanes(queue.frame_uniforms.projection * queue.frame_uniforms.view, planes);
+        queue.visible.resize(count);
+        CullBoundingBoxes(planes, queue.boxes, queue.visible.data());
+
+        size_t num_visible = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!queue.visible[i])
+                continue;
+            queue.keys[num_visible] = queue.keys[i];
+            queue.order[num_visible] = uint32_t(i);
+            num_visible += 1;
+        }
+        g_CulledObjects += count - num_visible;
+        count = num_visible;
+    }
+    else
+    {
+        for (size_t i = 0; i < count; ++i)
+            queue.order[i] = uint32_t(i);
+    }
+    g_VisibleObjects += count;
+    RadixSortDrawKeys(queue.keys.data(), queue.order.data(), count, &queue.temp_keys, &queue.temp_order);
+
+    if (g_UseDrawBatching && queue.draw_data_texture == 0)
+        CreateDrawBatchBuffers();
+
+    glm::mat4 view_projection = queue.frame_uniforms.projection * queue.frame_uniforms.view;
+
+    // Normal matrices dos itens, computadas de uma só vez com SIMD (veja
+    // "normalmatrix.h"), em vez de uma inversão de matriz por vértice no
+    // vertex shader. Incluímos os itens descartados pelo culling, pois só
+    // queue.items tem os itens contíguos na memória.
+    queue.normal_matrices.resize(queue.items.size());
+    if (!queue.items.empty())
+        ComputeNormalMatrices(&queue.items[0].model, sizeof(DrawItem),
+                              queue.normal_matrices.data(), sizeof(glm::mat3x4), queue.items.size());
+
+    // Primeira passada: decidimos o que fazer com cada item, segundo a sua
+    // consulta de oclusão e se ele pode entrar em um lote. Os itens
+    // desenhados um a um precisam de um bloco ObjectUniforms, enviados
+    // todos juntos antes dos desenhos.
+    queue.actions.resize(count);
+    size_t num_single_draws = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const DrawItem& item = queue.items[queue.order[i]];
+        SceneObjectHandle handle = item.object;
+        bool resident = scene.resident[handle] != 0;
+
+        // Itens cuja última consulta de oclusão não passou nenhuma amostra
+        // não são desenhados, e têm a sua bbox consultada de novo abaixo.
+        // Objetos cuja bbox cruza o plano near nunca são consultados (a
+        // bbox seria recortada, e o resultado não faria sentido), nem
+        // objetos ainda sendo carregados, desenhados como a própria bbox.
+        OcclusionAction occlusion_action = OCCLUSION_DRAW;
+        if (g_UseOcclusionCulling)
+        {
+            glm::mat4 model_view_projection = view_projection * item.model;
+            bool near_camera = ProjectedScreenSize(handle, model_view_projection) == std::numeric_limits<float>::max();
+            bool needs_query = false;
+            occlusion_action = UpdateOcclusionQuery(&queue.occlusion_queries[item.occlusion_query], item.occlusion_query,
+                                                    queue.frame, near_camera || !resident, &needs_query);
+            if (needs_query)
+                queue.query_items.push_back(queue.order[i]);
+
+            if (occlusion_action == OCCLUSION_SKIP)
+            {
+                int lod = SelectLevelOfDetail(handle, model_view_projection);
+                statistics.occluded_draws += 1;
+                statistics.occluded_triangles += scene.lod_num_indices[handle*MAX_LODS + lod] / 3;
+            }
+            if (occlusion_action == OCCLUSION_DRAW_CONDITIONAL)
+                statistics.conditional_draws += 1;
+        }
+
+        // Itens na GPU e sem desenho condicional entram nos lotes; os
+        // demais são desenhados um a um.
+        unsigned char action = (unsigned char)occlusion_action;
+        if (occlusion_action == OCCLUSION_DRAW && g_UseDrawBatching && resident)
+            action = ITEM_BATCHED;
+        else if (occlusion_action != OCCLUSION_SKIP)
+            num_single_draws += 1;
+        queue.actions[i] = action;
+    }
+
+    // Reservamos de uma vez o espaço de todos os blocos do quadro, para que
+    // o buffer circular não precise ser recriado no meio do quadro.
+    size_t object_stride = UniformStride(sizeof(ObjectUniforms));
+    size_t num_object_blocks = std::max<size_t>(1, num_single_draws) + queue.query_items.size();
+    ReserveUniforms(UniformStride(sizeof(FrameUniforms)) + num_object_blocks * object_stride);
+
+    // As matrizes view e projection e os demais dados do quadro são
+    // enviados uma única vez, para todos os programas.
+    SetFrameUniforms(queue.frame_uniforms);
+
+    // Blocos ObjectUniforms dos itens desenhados um a um, na ordem dos
+    // desenhos. Há sempre pelo menos um bloco, ligado durante os lotes
+    // (que não o utilizam, mas o bloco precisa de um buffer ligado).
+    size_t object_offset = AllocateUniforms(std::max<size_t>(1, num_single_draws) * object_stride);
+    char* object_data = (char*)MapUniforms(object_offset, std::max<size_t>(1, num_single_draws) * object_stride);
+    memset(object_data, 0, sizeof(ObjectUniforms));
+    for (size_t i = 0, single_draw = 0; i < count; ++i)
+    {
+        if (queue.actions[i] == ITEM_BATCHED || queue.actions[i] == OCCLUSION_SKIP)
+            continue;
+        const DrawItem& item = queue.items[queue.order[i]];
+        FillObjectUniforms((ObjectUniforms*)(object_data + single_draw * object_stride), item.object, item.model,
+                           queue.normal_matrices[queue.order[i]]);
+        single_draw += 1;
+    }
+    UnmapUniforms();
+    GLState_BindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORMS_BINDING, UniformRingBuffer(), object_offset, sizeof(ObjectUniforms));
+
+    // Estado atual; "valid" indica se o valor já foi definido nesta função.
+    GLuint    program = 0;                              bool program_valid = false;
+    uint32_t  texture_set = 0;                          bool texture_set_valid = false;
+    GLuint    textures[MAX_TEXTURE_SET_UNITS] = { 0 };  bool textures_valid[MAX_TEXTURE_SET_UNITS] = { false };
+    GLuint    vertex_array_object_id = 0;               bool vertex_array_valid = false;
+
+    size_t single_draw = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (queue.actions[i] == OCCLUSION_SKIP)
+            continue;
+
+        const DrawItem& item = queue.items[queue.order[i]];
+        SceneObjectHandle handle = item.object;
+        bool resident = scene.resident[handle] != 0;
+
+        statistics.draws += 1;
+
+        // O lote atual termina quando o programa ou o conjunto de texturas
+        // muda (os itens estão ordenados por eles; veja MakeDrawKey()).
+        if (!queue.batch_items.empty() && (item.program != program || item.texture_set != texture_set))
+        {
+            FlushDrawBatch(view_projection);
+            vertex_array_valid = false;
+        }
+
+        if (!program_valid || item.program != program)
+        {
+            program = item.program;
+            program_valid = true;
+            queue.resources.use_program(program);
+            statistics.program_binds += 1;
+        }
+        else
+            statistics.program_binds_skipped += 1;
+
+        // Texturas: ao trocar de conjunto, comparamos os IDs de cada
+        // unidade, pois conjuntos diferentes podem ter texturas em comum.
+        bool same_texture_set = texture_set_valid && item.texture_set == texture_set;
+        const TextureSet& set = (*queue.resources.texture_sets)[item.texture_set];
+        for (int unit = 0; unit < MAX_TEXTURE_SET_UNITS; ++unit)
+        {
+            int image = set.images[unit];
+            if (image < 0 || (size_t)image >= texture_ids.size())
+                continue;
+
+            if (same_texture_set || (textures_valid[unit] && textures[unit] == texture_ids[image]))
+            {
+                statistics.texture_binds_skipped += 1;
+                continue;
+            }
+
+            textures[unit] = texture_ids[image];
+            textures_valid[unit] = true;
+            GLState_ActiveTexture(GL_TEXTURE0 + unit);
+            GLState_BindTexture(GL_TEXTURE_2D, textures[unit]);
+            statistics.texture_binds += 1;
+        }
+        texture_set = item.texture_set;
+        texture_set_valid = true;
+
+        if (queue.actions[i] == ITEM_BATCHED)
+        {
+            queue.batch_items.push_back(queue.order[i]);
+            if (queue.batch_items.size() == queue.max_batch_items)
+            {
+                FlushDrawBatch(view_projection);
+                vertex_array_valid = false;
+            }
+            continue;
+        }
+
+        GLuint item_vertex_array_object_id = resident ? scene.vertex_array_object_ids[handle] : g_BoundingBoxProxyVAO;
+        if (!vertex_array_valid || item_vertex_array_object_id != vertex_array_object_id)
+        {
+            vertex_array_object_id = item_vertex_array_object_id;
+            vertex_array_valid = true;
+            GLState_BindVertexArray(vertex_array_object_id);
+            statistics.vao_binds += 1;
+        }
+        else
+            statistics.vao_binds_skipped += 1;
+
+        // Uma única chamada liga o bloco do item, com a matriz model, a bbox
+        // e a quantização.
+        GLState_BindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORMS_BINDING, UniformRingBuffer(),
+                          object_offset + single_draw * object_stride, sizeof(ObjectUniforms));
+        statistics.uniform_writes += 1;
+        single_draw += 1;
+
+        // Se o resultado da consulta ainda não chegou à CPU, a própria GPU
+        // descarta o desenho se a bbox estava escondida. GL_QUERY_WAIT faz a
+        // GPU (e não a CPU) esperar o resultado, que em geral já está
+        // pronto, pois a consulta foi feita no quadro anterior.
+        if (queue.actions[i] == OCCLUSION_DRAW_CONDITIONAL)
+            glBeginConditionalRender(queue.occlusion_queries[item.occlusion_query].query, GL_QUERY_WAIT);
+
+        DrawSceneObjectElements(handle, view_projection * item.model);
+
+        if (queue.actions[i] == OCCLUSION_DRAW_CONDITIONAL)
+            glEndConditionalRender();
+    }
+
+    if (!queue.batch_items.empty())
+        FlushDrawBatch(view_projection);
+
+    // Consultas de oclusão. Depois de desenhar todos os itens, desenhamos a
+    // bbox de cada item selecionado acima dentro de uma consulta
+    // GL_ANY_SAMPLES_PASSED, sem escrever cor nem profundidade: o resultado
+    // diz se alguma parte da bbox passou no teste de profundidade contra a
+    // cena deste quadro, e é utilizado no próximo quadro.
+    if (!queue.query_items.empty())
+    {
+        size_t num_queries = queue.query_items.size();
+        size_t query_offset = AllocateUniforms(num_queries * object_stride);
+        char* query_data = (char*)MapUniforms(query_offset, num_queries * object_stride);
+        for (size_t i = 0; i < num_queries; ++i)
+        {
+            const DrawItem& item = queue.items[queue.query_items[i]];
+            SceneObjectHandle handle = item.object;
+
+            ObjectUniforms* uniforms = (ObjectUniforms*)(query_data + i * object_stride);
+            FillObjectUniforms(uniforms, handle, item.model, queue.normal_matrices[queue.query_items[i]]);
+            glm::vec3 margin = glm::vec3(OCCLUSION_PROXY_MARGIN * glm::length(scene.bbox_maxs[handle] - scene.bbox_mins[handle]));
+            uniforms->bbox_min = glm::vec4(scene.bbox_mins[handle] - margin, 1.0f);
+            uniforms->bbox_max = glm::vec4(scene.bbox_maxs[handle] + margin, 1.0f);
+            uniforms->quantized_positions = 1;
+        }
+        UnmapUniforms();
+
+        GLboolean cull_face = GLState_IsEnabled(GL_CULL_FACE);
+        GLState_ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        GLState_DepthMask(GL_FALSE);
+        GLState_Disable(GL_CULL_FACE);
+        GLState_BindVertexArray(g_BoundingBoxProxyVAO);
+
+        for (size_t i = 0; i < num_queries; ++i)
+        {
+            const DrawItem& item = queue.items[queue.query_items[i]];
+
+            if (!program_valid || item.program != program)
+            {
+                program = item.program;
+                program_valid = true;
+                queue.resources.use_program(program);
+            }
+
+            GLState_BindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORMS_BINDING, UniformRingBuffer(),
+                              query_offset + i * object_stride, sizeof(ObjectUniforms));
+
+            OcclusionQuery& occlusion = queue.occlusion_queries[item.occlusion_query];
+            if (occlusion.query == 0)
+                glGenQueries(1, &occlusion.query);
+
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, occlusion.query);
+            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, (void*)BOUNDING_BOX_PROXY_TRIANGLES_OFFSET);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            occlusion.pending = true;
+
+            statistics.occlusion_queries += 1;
+        }
+
+        GLState_ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        GLState_DepthMask(GL_TRUE);
+        if (cull_face)
+            GLState_Enable(GL_CULL_FACE);
+    }
+
+    if (g_UseOcclusionCulling)
+        ReleaseUnsubmittedOcclusionQueries();
+
+    // Os blocos deste quadro ficam no segmento atual do buffer circular até
+    // a GPU terminar de lê-los.
+    AdvanceUniformRing();
+}
+
+const RenderQueueStatistics& GetRenderQueueStatistics()
+{
+    return queue.statistics;
+}
+
+const std::vector<uint64_t>& GetRenderQueueKeys()
+{
+    return queue.keys;
+}
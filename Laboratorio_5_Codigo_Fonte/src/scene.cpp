@@ -0,0 +1,377 @@
+// Objetos da cena virtual e o seu desenho. Veja "include/scene.h".
+#include "scene.h"
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <limits>
+
+#include "glstate.h"
+#include "normalmatrix.h"
+
+VirtualScene g_VirtualScene;
+float g_ScreenRatio = 1.0f;
+bool g_UseLevelsOfDetail = true;
+size_t g_LodDraws[MAX_LODS];
+size_t g_LodTriangles[MAX_LODS];
+size_t g_VisibleObjects;
+size_t g_CulledObjects;
+GeometryArena g_GeometryArena;
+GLuint g_BoundingBoxProxyVAO = 0;
+
+// Tamanho em bytes de um vértice no formato vertex_format.
+size_t VertexFormatSize(VertexFormat vertex_format)
+{
+    return vertex_format == VERTEX_FORMAT_QUANTIZED ? sizeof(QuantizedVertex) : sizeof(FloatVertex);
+}
+
+// Tamanho na tela (fração da altura do viewport) abaixo do qual cada nível
+// de detalhe é trocado pelo seguinte: o LOD l+1 é usado quando o objeto tem
+// menos de LOD_SCREEN_SIZE * 0.5^l da altura da tela. Como cada LOD tem cerca
+// de 1/4 dos triângulos do anterior (veja BuildLevelsOfDetail()), a
+// densidade de triângulos por pixel fica aproximadamente constante.
+#define LOD_SCREEN_SIZE 0.5f
+
+// Margem da histerese da troca de LOD: um objeto só passa para um LOD mais
+// simples com um tamanho 10% menor que o limite, e só volta para o mais
+// detalhado com um tamanho 10% maior, para que objetos perto do limite não
+// fiquem trocando de LOD ("popping") a cada quadro.
+#define LOD_HYSTERESIS 0.1f
+
+// Retorna o tamanho da projeção da bounding box de um objeto na tela, em
+// fração da altura da janela. Se algum vértice da bbox estiver atrás da
+// câmera, o objeto está muito próximo, e retornamos o maior float.
+float ProjectedScreenSize(SceneObjectHandle handle, const glm::mat4& model_view_projection)
+{
+    const glm::vec3& bbox_min = g_VirtualScene.bbox_mins[handle];
+    const glm::vec3& bbox_max = g_VirtualScene.bbox_maxs[handle];
+
+    // Projetamos os 8 vértices da bbox e computamos o tamanho do retângulo
+    // que os contém em NDC. Como a projeção é linear em coordenadas
+    // homogêneas, cada vértice é o centro projetado somado a ± cada uma das
+    // metades dos lados projetadas, e só precisamos de uma multiplicação por
+    // vetor completa.
+    glm::vec3 center = (bbox_min + bbox_max) * 0.5f;
+    glm::vec3 half_size = (bbox_max - bbox_min) * 0.5f;
+    glm::vec4 clip_center = model_view_projection * glm::vec4(center, 1.0f);
+    glm::vec4 clip_x = model_view_projection[0] * half_size.x;
+    glm::vec4 clip_y = model_view_projection[1] * half_size.y;
+    glm::vec4 clip_z = model_view_projection[2] * half_size.z;
+
+    float ndc_min_x =  std::numeric_limits<float>::max();
+    float ndc_min_y =  std::numeric_limits<float>::max();
+    float ndc_max_x = -std::numeric_limits<float>::max();
+    float ndc_max_y = -std::numeric_limits<float>::max();
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        glm::vec4 clip = clip_center
+                       + ((corner & 1) ? clip_x : -clip_x)
+                       + ((corner & 2) ? clip_y : -clip_y)
+                       + ((corner & 4) ? clip_z : -clip_z);
+        if (clip.w <= 0.0f)
+            return std::numeric_limits<float>::max();
+
+        float inverse_w = 1.0f / clip.w;
+        ndc_min_x = std::min(ndc_min_x, clip.x * inverse_w);
+        ndc_min_y = std::min(ndc_min_y, clip.y * inverse_w);
+        ndc_max_x = std::max(ndc_max_x, clip.x * inverse_w);
+        ndc_max_y = std::max(ndc_max_y, clip.y * inverse_w);
+    }
+
+    // NDC vai de -1 a 1; a largura é convertida para a escala da altura.
+    return std::max((ndc_max_x - ndc_min_x) * g_ScreenRatio, ndc_max_y - ndc_min_y) / 2.0f;
+}
+
+// Escolhe um LOD entre 0 e num_lods-1 para um objeto com o tamanho na tela
+// dado, partindo do LOD "lod" (o usado no quadro anterior).
+int LevelOfDetailForScreenSize(float screen_size, int lod, int num_lods)
+{
+    lod = std::min(lod, num_lods - 1);
+    while (lod > 0 && screen_size > LOD_SCREEN_SIZE * powf(0.5f, lod - 1) * (1.0f + LOD_HYSTERESIS))
+        lod -= 1;
+    while (lod + 1 < num_lods && screen_size < LOD_SCREEN_SIZE * powf(0.5f, lod) * (1.0f - LOD_HYSTERESIS))
+        lod += 1;
+
+    return lod;
+}
+
+// Escolhe o nível de detalhe de um objeto a partir do tamanho da projeção da
+// sua bounding box na tela, partindo do LOD usado no quadro anterior.
+int SelectLevelOfDetail(SceneObjectHandle handle, const glm::mat4& model_view_projection)
+{
+    int num_lods = g_VirtualScene.num_lods[handle];
+    if (!g_UseLevelsOfDetail || num_lods <= 1)
+        return 0;
+
+    float screen_size = ProjectedScreenSize(handle, model_view_projection);
+    return LevelOfDetailForScreenSize(screen_size, g_VirtualScene.current_lods[handle], num_lods);
+}
+
+// Retorna o handle do objeto de nome object_name. Se nenhum arquivo lido até
+// agora tiver um objeto com este nome (por exemplo, porque ele ainda está
+// sendo lido pelas threads de carregamento), o handle é reservado, e o objeto
+// só é desenhado depois que AddMeshToVirtualScene() o encontrar em uma malha.
+// Deve ser chamada uma única vez para cada objeto, fora do laço de
+// renderização.
+SceneObjectHandle FindSceneObject(const char* object_name)
+{
+    VirtualScene& scene = g_VirtualScene;
+
+    std::unordered_map<std::string, SceneObjectHandle>::const_iterator it = scene.handles.find(object_name);
+    if (it != scene.handles.end())
+        return it->second;
+
+    SceneObjectHandle handle = scene.names.size();
+    scene.handles[object_name] = handle;
+
+    scene.names.push_back(object_name);
+    scene.loaded.push_back(0);
+    scene.resident.push_back(0);
+    scene.vertex_array_object_ids.push_back(0);
+    scene.arena_meshes.push_back(0);
+    scene.rendering_modes.push_back(GL_TRIANGLES);
+    scene.index_types.push_back(GL_UNSIGNED_INT);
+    scene.bbox_mins.push_back(glm::vec3(0.0f,0.0f,0.0f));
+    scene.bbox_maxs.push_back(glm::vec3(0.0f,0.0f,0.0f));
+    scene.quantized_positions.push_back(0);
+    scene.num_lods.push_back(0);
+    scene.current_lods.push_back(0);
+    scene.lod_first_indices.resize(scene.lod_first_indices.size() + MAX_LODS, 0);
+    scene.lod_num_indices.resize(scene.lod_num_indices.size() + MAX_LODS, 0);
+
+    return handle;
+}
+
+// Copia os dados de um objeto construído por BuildMeshData() para os vetores
+// de g_VirtualScene, na posição dada pelo seu handle.
+void SetSceneObject(SceneObjectHandle handle, const SceneObject& object)
+{
+    VirtualScene& scene = g_VirtualScene;
+
+    scene.loaded[handle]                  = 1;
+    scene.resident[handle]                = object.resident ? 1 : 0;
+    scene.vertex_array_object_ids[handle] = object.vertex_array_object_id;
+    scene.arena_meshes[handle]            = object.arena_mesh;
+    scene.rendering_modes[handle]         = object.rendering_mode;
+    scene.index_types[handle]             = object.index_type;
+    scene.bbox_mins[handle]               = object.bbox_min;
+    scene.bbox_maxs[handle]               = object.bbox_max;
+    scene.quantized_positions[handle]     = object.quantized_positions ? 1 : 0;
+    scene.num_lods[handle]                = object.num_lods;
+    scene.current_lods[handle]            = object.current_lod;
+    for (int lod = 0; lod < MAX_LODS; ++lod)
+    {
+        bool valid = lod < object.num_lods;
+        scene.lod_first_indices[handle*MAX_LODS + lod] = valid ? object.lod_first_index[lod] : 0;
+        scene.lod_num_indices[handle*MAX_LODS + lod]   = valid ? object.lod_num_indices[lod] : 0;
+    }
+}
+
+// Imprime um aviso para cada objeto procurado por FindSceneObject() que não
+// existe em nenhum dos arquivos carregados, em geral por um erro de
+// digitação no nome. Chamada depois que todos os arquivos foram carregados.
+void WarnMissingSceneObjects()
+{
+    for (size_t handle = 0; handle < g_VirtualScene.names.size(); ++handle)
+        if (!g_VirtualScene.loaded[handle])
+            fprintf(stderr, "WARNING: Object \"%s\" not found in any loaded model.\n", g_VirtualScene.names[handle].c_str());
+}
+
+// Função que desenha um objeto armazenado em g_VirtualScene. Veja definição
+// dos objetos na função BuildTrianglesAndAddToVirtualScene(). A matriz model
+// é enviada no bloco ObjectUniforms; view_projection deve
+// ser a mesma do bloco FrameUniforms, e é utilizada para escolher o nível
+// de detalhe do objeto.
+void DrawVirtualObject(SceneObjectHandle handle, const glm::mat4& model, const glm::mat4& view_projection)
+{
+    const VirtualScene& scene = g_VirtualScene;
+
+    // Objetos de arquivos que ainda não foram lidos pelas threads de
+    // carregamento ainda não têm dados; objetos cujos vértices ainda estão
+    // sendo enviados para a GPU são desenhados como a sua bounding box.
+    if (!scene.loaded[handle])
+        return;
+
+    bool resident = scene.resident[handle] != 0;
+
+    // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
+    // vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene(). Veja
+    // comentários detalhados dentro da definição de BuildTrianglesAndAddToVirtualScene().
+    GLState_BindVertexArray(resident ? scene.vertex_array_object_ids[handle] : g_BoundingBoxProxyVAO);
+
+    // Enviamos a matriz model e os parâmetros da axis-aligned bounding box
+    // (AABB) do modelo. Veja FillObjectUniforms().
+    SetObjectUniforms(handle, model);
+
+    DrawSceneObjectElements(handle, view_projection * model);
+
+    // O VAO continua ligado: desligá-lo aqui e ligá-lo de novo no próximo
+    // objeto seriam duas trocas de estado a mais por objeto. O código que
+    // altera um VAO sempre liga o VAO desejado antes (veja "glstate.h").
+}
+
+// Desenha um objeto de g_VirtualScene, supondo que o seu VAO (ou o de
+// CreateBoundingBoxProxy(), se o objeto não está na GPU) e as variáveis
+// "uniform" já foram definidos. Utilizada por DrawVirtualObject() e
+// FlushRenderQueue().
+void DrawSceneObjectElements(SceneObjectHandle handle, const glm::mat4& model_view_projection)
+{
+    VirtualScene& scene = g_VirtualScene;
+
+    if (scene.resident[handle])
+    {
+        int lod = SelectLevelOfDetail(handle, model_view_projection);
+        scene.current_lods[handle] = lod;
+
+        size_t first_index = scene.lod_first_indices[handle*MAX_LODS + lod];
+        size_t num_indices = scene.lod_num_indices[handle*MAX_LODS + lod];
+        GLenum index_type  = scene.index_types[handle];
+
+        g_LodDraws[lod] += 1;
+        g_LodTriangles[lod] += num_indices / 3;
+
+        // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
+        // apontados pelo VAO como linhas. Veja a definição de
+        // g_VirtualScene[""] dentro da função BuildTrianglesAndAddToVirtualScene(), e veja
+        // a documentação da função glDrawElementsBaseVertex() em
+        // http://docs.gl/gl3/glDrawElementsBaseVertex. Os índices do objeto
+        // são relativos ao primeiro vértice da sua malha na arena de
+        // geometria; veja AllocateArenaMesh().
+        glDrawElementsBaseVertex(
+            scene.rendering_modes[handle],
+            num_indices,
+            index_type,
+            (void*)ArenaIndexOffset(g_GeometryArena, scene.arena_meshes[handle], first_index, IndexTypeSize(index_type)),
+            g_GeometryArena.meshes[scene.arena_meshes[handle]].base_vertex
+        );
+    }
+    else
+    {
+        // As 12 arestas da bounding box, como linhas.
+        glDrawElements(GL_LINES, 24, GL_UNSIGNED_BYTE, 0);
+    }
+}
+
+// Preenche o bloco ObjectUniforms de um objeto de g_VirtualScene. Objetos
+// ainda sendo enviados para a GPU são desenhados com o cubo de
+// CreateBoundingBoxProxy(), cujos vértices também são relativos à bbox.
+void FillObjectUniforms(ObjectUniforms* uniforms, SceneObjectHandle handle, const glm::mat4& model, const glm::mat3x4& normal_matrix)
+{
+    const VirtualScene& scene = g_VirtualScene;
+    uniforms->model = model;
+    uniforms->normal_matrix = normal_matrix;
+    uniforms->bbox_min = glm::vec4(scene.bbox_mins[handle], 1.0f);
+    uniforms->bbox_max = glm::vec4(scene.bbox_maxs[handle], 1.0f);
+    uniforms->quantized_positions = scene.quantized_positions[handle] || !scene.resident[handle];
+    uniforms->padding[0] = uniforms->padding[1] = uniforms->padding[2] = 0;
+}
+
+// Envia o bloco ObjectUniforms de um único objeto e o liga ao ponto
+// OBJECT_UNIFORMS_BINDING. Utilizada fora da fila de desenho, que envia os
+// blocos de todos os itens de uma só vez.
+void SetObjectUniforms(SceneObjectHandle handle, const glm::mat4& model)
+{
+    size_t offset = AllocateUniforms(sizeof(ObjectUniforms));
+    FillObjectUniforms((ObjectUniforms*)MapUniforms(offset, sizeof(ObjectUniforms)), handle, model, NormalMatrix(model));
+    UnmapUniforms();
+    GLState_BindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORMS_BINDING, UniformRingBuffer(), offset, sizeof(ObjectUniforms));
+}
+
+// Tamanho em bytes de um índice do tipo index_type.
+size_t IndexTypeSize(GLenum index_type)
+{
+    switch (index_type)
+    {
+        case GL_UNSIGNED_BYTE:  return sizeof(GLubyte);
+        case GL_UNSIGNED_SHORT: return sizeof(GLushort);
+        default:                return sizeof(GLuint);
+    }
+}
+
+// Define os atributos de vértice do VAO atualmente "ligado" de acordo com o
+// formato dos vértices intercalados no VBO atualmente "ligado".
+void SetupVertexAttributes(VertexFormat vertex_format)
+{
+    GLsizei stride = VertexFormatSize(vertex_format);
+
+    if ( vertex_format == VERTEX_FORMAT_QUANTIZED )
+    {
+        // Posição: 4 x uint16 normalizados para [0,1] dentro da bbox do
+        // objeto. O Vertex Shader desfaz a quantização utilizando as variáveis
+        // "bbox_min" e "bbox_max".
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(QuantizedVertex, position));
+        // Normal: 3 x 10 bits com sinal + 2 bits (w = 0), normalizados para [-1,1].
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(QuantizedVertex, normal));
+        // Coordenadas de textura: 2 x half float.
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(QuantizedVertex, texcoords));
+    }
+    else
+    {
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FloatVertex, position));
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FloatVertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FloatVertex, texcoords));
+    }
+
+    glEnableVertexAttribArray(0); // "(location = 0)" em "shader_vertex.glsl"
+    glEnableVertexAttribArray(1); // "(location = 1)" em "shader_vertex.glsl"
+    glEnableVertexAttribArray(2); // "(location = 2)" em "shader_vertex.glsl"
+}
+
+// Define os atributos do VAO da arena de geometria, sempre que o seu VBO é
+// recriado. Veja InitGeometryArena().
+void SetupArenaVertexAttributes(int vertex_format)
+{
+    SetupVertexAttributes(VertexFormat(vertex_format));
+}
+
+// Cria o VAO de um cubo unitário, com as 12 arestas como linhas, desenhado
+// por DrawVirtualObject() no lugar de objetos cujas malhas ainda não estão na
+// GPU, e com as 6 faces como triângulos, utilizadas pelas consultas de
+// oclusão. Os vértices, em [0,1]^3, são interpretados como posições quantizadas
+// relativas à bbox do objeto, e assim o cubo coincide com a bbox.
+void CreateBoundingBoxProxy()
+{
+    FloatVertex vertices[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        FloatVertex& v = vertices[i];
+        v.position[0] = (i & 1) ? 1.0f : 0.0f;
+        v.position[1] = (i & 2) ? 1.0f : 0.0f;
+        v.position[2] = (i & 4) ? 1.0f : 0.0f;
+        v.position[3] = 1.0f;
+        v.normal[0] = 0.0f; v.normal[1] = 1.0f; v.normal[2] = 0.0f; v.normal[3] = 0.0f;
+        v.texcoords[0] = 0.0f; v.texcoords[1] = 0.0f;
+    }
+
+    // Cada aresta liga dois vértices cujos índices diferem em um único bit.
+    GLubyte edges[24 + 36] = {
+        0,1, 2,3, 4,5, 6,7, // Arestas paralelas ao eixo X
+        0,2, 1,3, 4,6, 5,7, // Arestas paralelas ao eixo Y
+        0,4, 1,5, 2,6, 3,7, // Arestas paralelas ao eixo Z
+
+        // As 6 faces, com 2 triângulos cada, desenhadas pelas consultas de
+        // oclusão de FlushRenderQueue() (a partir do índice
+        // BOUNDING_BOX_PROXY_TRIANGLES_OFFSET). A orientação não importa,
+        // pois as consultas desabilitam o backface culling.
+        0,2,6, 0,6,4,  1,3,7, 1,7,5, // Faces X = 0 e X = 1
+        0,1,5, 0,5,4,  2,3,7, 2,7,6, // Faces Y = 0 e Y = 1
+        0,1,3, 0,3,2,  4,5,7, 4,7,6, // Faces Z = 0 e Z = 1
+    };
+
+    glGenVertexArrays(1, &g_BoundingBoxProxyVAO);
+    GLState_BindVertexArray(g_BoundingBoxProxyVAO);
+
+    GLuint vertex_buffer_id;
+    glGenBuffers(1, &vertex_buffer_id);
+    GLState_BindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    SetupVertexAttributes(VERTEX_FORMAT_FLOAT);
+    GLState_BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GLuint index_buffer_id;
+    glGenBuffers(1, &index_buffer_id);
+    GLState_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_id);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(edges), edges, GL_STATIC_DRAW);
+
+    GLState_BindVertexArray(0);
+}
@@ -13,25 +13,45 @@ in vec4 position_model;
 // Coordenadas de textura obtidas do arquivo OBJ (se existirem!)
 in vec2 texcoords;
 
-// Matrizes computadas no código C++ e enviadas para a GPU
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-// Identificador que define qual objeto está sendo desenhado no momento
-#define SPHERE 0
-#define BUNNY  1
-#define PLANE  2
-uniform int object_id;
-
-// Parâmetros da axis-aligned bounding box (AABB) do modelo
-uniform vec4 bbox_min;
-uniform vec4 bbox_max;
-
-// Variáveis para acesso das imagens de textura
+// Dados do quadro atual, computados no código C++ e enviados para a GPU.
+// Veja o mesmo bloco em "shader_vertex.glsl".
+layout (std140) uniform FrameUniforms
+{
+    mat4  view;
+    mat4  projection;
+    vec4  camera_position; // Em coordenadas globais
+    vec4  light_direction; // Sentido da fonte de luz, em coordenadas globais
+    float time;            // Segundos desde o início do programa
+};
+
+// Mapeamentos de textura possíveis. Cada variante deste shader é compilada
+// com UV_MAPPING definido como um deles, e com NUM_TEXTURES igual ao número
+// de imagens de textura lidas (veja ShaderFeatureDefines() em "main.cpp"),
+// em vez de escolher o mapeamento pelo identificador do objeto em cada
+// fragmento.
+#define UV_MAPPING_SPHERICAL 0 // Esfera
+#define UV_MAPPING_PLANAR_XY 1 // Coelho
+#define UV_MAPPING_TEXCOORDS 2 // Plano
+#ifndef UV_MAPPING
+#define UV_MAPPING UV_MAPPING_TEXCOORDS
+#endif
+#ifndef NUM_TEXTURES
+#define NUM_TEXTURES 1
+#endif
+
+// Parâmetros da axis-aligned bounding box (AABB) do modelo, recebidos do
+// Vertex Shader (veja "shader_vertex.glsl")
+flat in vec4 fragment_bbox_min;
+flat in vec4 fragment_bbox_max;
+
+// Variáveis para acesso das imagens de textura, somente as utilizadas
 uniform sampler2D TextureImage0;
+#if NUM_TEXTURES > 1
 uniform sampler2D TextureImage1;
+#endif
+#if NUM_TEXTURES > 2
 uniform sampler2D TextureImage2;
+#endif
 
 // O valor de saída ("out") de um Fragment Shader é a cor final do fragmento.
 out vec4 color;
@@ -42,10 +62,9 @@ out vec4 color;
 
 void main()
 {
-    // Obtemos a posição da câmera utilizando a inversa da matriz que define o
-    // sistema de coordenadas da câmera.
-    vec4 origin = vec4(0.0, 0.0, 0.0, 1.0);
-    vec4 camera_position = inverse(view) * origin;
+    // A posição da câmera (a inversa da matriz que define o sistema de
+    // coordenadas da câmera aplicada à origem) é computada uma única vez por
+    // quadro no código C++, e recebida no bloco FrameUniforms.
 
     // O fragmento atual é coberto por um ponto que percente à superfície de um
     // dos objetos virtuais da cena. Este ponto, p, possui uma posição no
@@ -59,7 +78,7 @@ void main()
     vec4 n = normalize(normal);
 
     // Vetor que define o sentido da fonte de luz em relação ao ponto atual.
-    vec4 l = normalize(vec4(1.0,1.0,0.0,0.0));
+    vec4 l = light_direction;
 
     // Vetor que define o sentido da câmera em relação ao ponto atual.
     vec4 v = normalize(camera_position - p);
@@ -68,7 +87,7 @@ void main()
     float U = 0.0;
     float V = 0.0;
 
-    if ( object_id == SPHERE )
+#if UV_MAPPING == UV_MAPPING_SPHERICAL
     {
         // PREENCHA AQUI as coordenadas de textura da esfera, computadas com
         // projeção esférica EM COORDENADAS DO MODELO. Utilize como referência
@@ -83,7 +102,7 @@ void main()
         //   constante M_PI
         //   variável position_model
 
-        vec4 bbox_center = (bbox_min + bbox_max) / 2.0;
+        vec4 bbox_center = (fragment_bbox_min + fragment_bbox_max) / 2.0;
         float raio = 1.0;
 
         // Normalizando a posição do modelo para a superfície da esfera
@@ -98,7 +117,7 @@ void main()
         U = (tetha + M_PI) / (2*M_PI);
         V = (phi + M_PI_2) / M_PI;
     }
-    else if ( object_id == BUNNY )
+#elif UV_MAPPING == UV_MAPPING_PLANAR_XY
     {
         // PREENCHA AQUI as coordenadas de textura do coelho, computadas com
         // projeção planar XY em COORDENADAS DO MODELO. Utilize como referência
@@ -109,24 +128,25 @@ void main()
         // 'h' no slides 158-160 do documento Aula_20_Mapeamento_de_Texturas.pdf.
         // Veja também a Questão 4 do Questionário 4 no Moodle.
 
-        float minx = bbox_min.x;
-        float maxx = bbox_max.x;
+        float minx = fragment_bbox_min.x;
+        float maxx = fragment_bbox_max.x;
 
-        float miny = bbox_min.y;
-        float maxy = bbox_max.y;
+        float miny = fragment_bbox_min.y;
+        float maxy = fragment_bbox_max.y;
 
-        float minz = bbox_min.z;
-        float maxz = bbox_max.z;
+        float minz = fragment_bbox_min.z;
+        float maxz = fragment_bbox_max.z;
 
         U = (position_model.x - minx) / (maxx - minx);
         V = (position_model.y - miny) / (maxy - miny);
     }
-    else if ( object_id == PLANE )
+#elif UV_MAPPING == UV_MAPPING_TEXCOORDS
     {
         // Coordenadas de textura do plano, obtidas do arquivo OBJ.
         U = texcoords.x;
         V = texcoords.y;
     }
+#endif
 
     // Obtemos a refletância difusa a partir da leitura da imagem TextureImage0
     vec3 Kd0 = texture(TextureImage0, vec2(U,V)).rgb;
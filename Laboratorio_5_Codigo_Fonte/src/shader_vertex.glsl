@@ -1,15 +1,59 @@
 #version 330 core
 
 // Atributos de vértice recebidos como entrada ("in") pelo Vertex Shader.
-// Veja a função BuildTrianglesAndAddToVirtualScene() em "main.cpp".
+// Veja as funções BuildMeshData() em "main.cpp" e SetupVertexAttributes() em
+// "scene.cpp".
 layout (location = 0) in vec4 model_coefficients;
 layout (location = 1) in vec4 normal_coefficients;
 layout (location = 2) in vec2 texture_coefficients;
 
-// Matrizes computadas no código C++ e enviadas para a GPU
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Atributos de cada instância, utilizados somente quando "instanced" é
+// verdadeiro: a matriz de modelagem (uma coluna em cada posição 3-6) e a
+// matriz de transformação das normais (uma coluna em cada posição 9-11). Veja DrawVirtualObjectInstanced() em
+// "benchmarks.cpp".
+layout (location = 3) in mat4   instance_model;
+layout (location = 9) in mat3x4 instance_normal_matrix;
+
+// Índice do item desenhado, utilizado somente quando "batched" é verdadeiro:
+// a matriz de modelagem, a matriz das normais e a bbox de cada item ficam no
+// texture buffer "draw_data", 9 texels por item. O índice é um
+// atributo de instância, pois o OpenGL 3.3 não tem gl_DrawID. Veja
+// FlushDrawBatch() em "renderqueue.cpp".
+layout (location = 8) in int  draw_id;
+uniform samplerBuffer draw_data;
+uniform bool batched;
+
+// Dados do quadro atual, computados no código C++ e enviados para a GPU em
+// um "uniform buffer object" (UBO). O bloco deve ser idêntico ao do
+// Fragment Shader e à struct FrameUniforms em "uniformring.h" (layout std140).
+layout (std140) uniform FrameUniforms
+{
+    mat4  view;
+    mat4  projection;
+    vec4  camera_position; // Em coordenadas globais
+    vec4  light_direction; // Sentido da fonte de luz, em coordenadas globais
+    float time;            // Segundos desde o início do programa
+};
+
+// Dados do objeto sendo desenhado, também em um UBO (veja a struct
+// ObjectUniforms em "uniformring.h"): a matriz de modelagem, a matriz que
+// transforma as normais (a inversa da transposta da matriz de modelagem,
+// computada na CPU uma vez por objeto; veja "normalmatrix.h"), os
+// parâmetros da axis-aligned bounding box (AABB) do modelo e se
+// model_coefficients.xyz está quantizado no intervalo [0,1] relativo à bbox
+// do modelo (veja QuantizedVertex em "scene.h").
+layout (std140) uniform ObjectUniforms
+{
+    mat4   model;
+    mat3x4 normal_matrix;
+    vec4   bbox_min;
+    vec4   bbox_max;
+    int    quantized_positions;
+};
+
+// Se verdadeiro, as matrizes vêm dos atributos de instância acima, em vez
+// das variáveis "model" e "normal_matrix".
+uniform bool instanced;
 
 // Atributos de vértice que serão gerados como saída ("out") pelo Vertex Shader.
 // ** Estes serão interpolados pelo rasterizador! ** gerando, assim, valores
@@ -19,9 +63,45 @@ out vec4 position_world;
 out vec4 position_model;
 out vec4 normal;
 out vec2 texcoords;
+flat out vec4 fragment_bbox_min;
+flat out vec4 fragment_bbox_max;
 
 void main()
 {
+    mat4 model_matrix = instanced ? instance_model : model;
+    mat3x4 object_normal_matrix = instanced ? instance_normal_matrix : normal_matrix;
+    vec4 object_bbox_min = bbox_min;
+    vec4 object_bbox_max = bbox_max;
+    bool object_quantized_positions = quantized_positions != 0;
+
+    if ( batched )
+    {
+        int texel = draw_id * 9;
+        model_matrix = mat4(texelFetch(draw_data, texel),
+                            texelFetch(draw_data, texel + 1),
+                            texelFetch(draw_data, texel + 2),
+                            texelFetch(draw_data, texel + 3));
+        object_normal_matrix = mat3x4(texelFetch(draw_data, texel + 4),
+                                      texelFetch(draw_data, texel + 5),
+                                      texelFetch(draw_data, texel + 6));
+        object_bbox_min = texelFetch(draw_data, texel + 7);
+        object_bbox_max = texelFetch(draw_data, texel + 8);
+        object_quantized_positions = object_bbox_max.w != 0.0;
+        object_bbox_min.w = 1.0;
+        object_bbox_max.w = 1.0;
+    }
+
+    // A bbox é repassada para o Fragment Shader, que não tem acesso aos
+    // dados de "draw_data".
+    fragment_bbox_min = object_bbox_min;
+    fragment_bbox_max = object_bbox_max;
+
+    // Posição do vértice no sistema de coordenadas local do modelo,
+    // desfazendo a quantização feita em "main.cpp" se necessário.
+    vec4 p_model = model_coefficients;
+    if ( object_quantized_positions )
+        p_model = vec4(object_bbox_min.xyz + model_coefficients.xyz * (object_bbox_max.xyz - object_bbox_min.xyz), 1.0);
+
     // A variável gl_Position define a posição final de cada vértice
     // OBRIGATORIAMENTE em "normalized device coordinates" (NDC), onde cada
     // coeficiente estará entre -1 e 1 após divisão por w.
@@ -34,7 +114,7 @@ void main()
     // deste Vertex Shader, a placa de vídeo (GPU) fará a divisão por W. Veja
     // slides 41-67 e 69-86 do documento Aula_09_Projecoes.pdf.
 
-    gl_Position = projection * view * model * model_coefficients;
+    gl_Position = projection * view * model_matrix * p_model;
 
     // Como as variáveis acima  (tipo vec4) são vetores com 4 coeficientes,
     // também é possível acessar e modificar cada coeficiente de maneira
@@ -51,15 +131,17 @@ void main()
     // rasterizador para gerar atributos únicos para cada fragmento gerado.
 
     // Posição do vértice atual no sistema de coordenadas global (World).
-    position_world = model * model_coefficients;
+    position_world = model_matrix * p_model;
 
     // Posição do vértice atual no sistema de coordenadas local do modelo.
-    position_model = model_coefficients;
+    position_model = p_model;
 
     // Normal do vértice atual no sistema de coordenadas global (World).
     // Veja slides 123-151 do documento Aula_07_Transformacoes_Geometricas_3D.pdf.
-    normal = inverse(transpose(model)) * normal_coefficients;
-    normal.w = 0.0;
+    // A matriz inverse(transpose(model_matrix)) é a mesma para todos os
+    // vértices do objeto, e por isso vem pronta da CPU; as suas colunas têm
+    // w igual a 0, e portanto normal.w também é 0.
+    normal = object_normal_matrix * normal_coefficients.xyz;
 
     // Coordenadas de textura obtidas do arquivo OBJ (se existirem!)
     texcoords = texture_coefficients;
@@ -0,0 +1,344 @@
+// Simplificação de malhas por quádricas de erro. Veja "include/simplify.h".
+//
+// A simplificação é feita em passadas. Em cada passada, escolhemos para cada
+// vértice removível o colapso de menor custo para um dos seus vizinhos,
+// ordenamos estes colapsos pelo custo e aplicamos em ordem todos os que não
+// tocam a vizinhança de um colapso já aplicado na mesma passada. As passadas
+// se repetem até atingir o número de índices desejado, ou até que nenhum
+// colapso seja possível.
+#include "simplify.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+
+// Quádrica de erro Q(p) = p^T A p + 2 b^T p + c, com A simétrica, guardada
+// como os 10 coeficientes distintos. "weight" é a soma das áreas dos planos
+// acumulados, usada para converter o custo em uma distância média.
+struct Quadric
+{
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double weight;
+};
+
+void QuadricFromPlane(Quadric* q, double nx, double ny, double nz, double d, double weight)
+{
+    q->a00 = weight * nx * nx; q->a01 = weight * nx * ny; q->a02 = weight * nx * nz;
+    q->a11 = weight * ny * ny; q->a12 = weight * ny * nz; q->a22 = weight * nz * nz;
+    q->b0  = weight * nx * d;  q->b1  = weight * ny * d;  q->b2  = weight * nz * d;
+    q->c   = weight * d * d;
+    q->weight = weight;
+}
+
+void QuadricAdd(Quadric* q, const Quadric& r)
+{
+    q->a00 += r.a00; q->a01 += r.a01; q->a02 += r.a02;
+    q->a11 += r.a11; q->a12 += r.a12; q->a22 += r.a22;
+    q->b0  += r.b0;  q->b1  += r.b1;  q->b2  += r.b2;
+    q->c   += r.c;
+    q->weight += r.weight;
+}
+
+double QuadricError(const Quadric& q, const float* p)
+{
+    double x = p[0], y = p[1], z = p[2];
+    double r = q.a00*x*x + q.a11*y*y + q.a22*z*z
+             + 2.0 * (q.a01*x*y + q.a02*x*z + q.a12*y*z)
+             + 2.0 * (q.b0*x + q.b1*y + q.b2*z)
+             + q.c;
+    return r > 0.0 ? r : 0.0;
+}
+
+void TriangleNormal(const float* p0, const float* p1, const float* p2, double* n)
+{
+    double e1[3] = { double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2] };
+    double e2[3] = { double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2] };
+    n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+    n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+    n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+}
+
+// Marca como travados os vértices cuja posição é compartilhada com outro
+// vértice (costuras): removê-los separaria os dois lados da costura.
+void LockSeamVertices(const float* positions, size_t num_vertices, std::vector<unsigned char>& locked)
+{
+    std::vector<uint32_t> order(num_vertices);
+    for (size_t i = 0; i < num_vertices; ++i)
+        order[i] = uint32_t(i);
+
+    std::sort(order.begin(), order.end(), [positions](uint32_t a, uint32_t b) {
+        return memcmp(positions + 3*size_t(a), positions + 3*size_t(b), 3*sizeof(float)) < 0;
+    });
+
+    for (size_t i = 1; i < num_vertices; ++i)
+    {
+        if (memcmp(positions + 3*size_t(order[i-1]), positions + 3*size_t(order[i]), 3*sizeof(float)) == 0)
+        {
+            locked[order[i-1]] = 1;
+            locked[order[i]]   = 1;
+        }
+    }
+}
+
+// Marca como travados os vértices das arestas de borda, que pertencem a um
+// único triângulo (a aresta a->b existe, mas b->a não).
+void LockBorderVertices(const std::vector<uint32_t>& indices, std::vector<unsigned char>& locked)
+{
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+        for (int e = 0; e < 3; ++e)
+            edges.push_back((uint64_t(indices[i + e]) << 32) | indices[i + (e + 1) % 3]);
+
+    std::sort(edges.begin(), edges.end());
+
+    for (size_t i = 0; i < edges.size(); ++i)
+    {
+        uint32_t a = uint32_t(edges[i] >> 32);
+        uint32_t b = uint32_t(edges[i]);
+        uint64_t reverse = (uint64_t(b) << 32) | a;
+        if (!std::binary_search(edges.begin(), edges.end(), reverse))
+        {
+            locked[a] = 1;
+            locked[b] = 1;
+        }
+    }
+}
+
+// Lista dos triângulos que utilizam cada vértice, no formato CSR:
+// triangles[offsets[v] .. offsets[v+1]-1].
+struct Adjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    void Build(const std::vector<uint32_t>& indices, size_t num_vertices)
+    {
+        offsets.assign(num_vertices + 1, 0);
+        for (size_t i = 0; i < indices.size(); ++i)
+            offsets[indices[i] + 1] += 1;
+        for (size_t v = 0; v < num_vertices; ++v)
+            offsets[v + 1] += offsets[v];
+
+        triangles.resize(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i)
+            triangles[fill[indices[i]]++] = uint32_t(i / 3);
+    }
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double   cost;
+
+    bool operator<(const Collapse& other) const { return cost < other.cost; }
+};
+
+// Retorna true se mover "from" para a posição de "to" inverte (ou degenera)
+// algum triângulo de "from" que não será removido pelo colapso.
+bool CollapseFlipsTriangle(const std::vector<uint32_t>& indices, const Adjacency& adjacency,
+                           const float* positions, uint32_t from, uint32_t to)
+{
+    const float* target = positions + 3*size_t(to);
+
+    for (uint32_t k = adjacency.offsets[from]; k < adjacency.offsets[from + 1]; ++k)
+    {
+        const uint32_t* tri = &indices[3*size_t(adjacency.triangles[k])];
+        if (tri[0] == to || tri[1] == to || tri[2] == to)
+            continue;
+
+        const float* p[3];
+        const float* q[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            p[c] = positions + 3*size_t(tri[c]);
+            q[c] = tri[c] == from ? target : p[c];
+        }
+
+        double before[3], after[3];
+        TriangleNormal(p[0], p[1], p[2], before);
+        TriangleNormal(q[0], q[1], q[2], after);
+        if (before[0]*after[0] + before[1]*after[1] + before[2]*after[2] <= 0.0)
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+size_t SimplifyMesh(uint32_t* destination, const uint32_t* indices, size_t num_indices,
+                    const float* positions, size_t num_vertices,
+                    size_t target_index_count, float* result_error)
+{
+    std::vector<uint32_t> current(indices, indices + num_indices);
+
+    std::vector<unsigned char> locked(num_vertices, 0);
+    LockSeamVertices(positions, num_vertices, locked);
+    LockBorderVertices(current, locked);
+
+    // Quádricas iniciais: cada vértice acumula os planos dos seus
+    // triângulos, ponderados pela área.
+    std::vector<Quadric> quadrics(num_vertices);
+    memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+    for (size_t i = 0; i < current.size(); i += 3)
+    {
+        const float* p0 = positions + 3*size_t(current[i]);
+        double n[3];
+        TriangleNormal(p0, positions + 3*size_t(current[i+1]), positions + 3*size_t(current[i+2]), n);
+        double length = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if (length == 0.0)
+            continue;
+
+        n[0] /= length; n[1] /= length; n[2] /= length;
+        double d = -(n[0]*p0[0] + n[1]*p0[1] + n[2]*p0[2]);
+
+        Quadric q;
+        QuadricFromPlane(&q, n[0], n[1], n[2], d, 0.5 * length);
+        for (int c = 0; c < 3; ++c)
+            QuadricAdd(&quadrics[current[i + c]], q);
+    }
+
+    // Tamanho da malha, para que o erro retornado seja relativo.
+    float bbox_min[3] = {  INFINITY,  INFINITY,  INFINITY };
+    float bbox_max[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (size_t i = 0; i < current.size(); ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            bbox_min[c] = std::min(bbox_min[c], positions[3*size_t(current[i]) + c]);
+            bbox_max[c] = std::max(bbox_max[c], positions[3*size_t(current[i]) + c]);
+        }
+    }
+    float extent = std::max(bbox_max[0] - bbox_min[0], std::max(bbox_max[1] - bbox_min[1], bbox_max[2] - bbox_min[2]));
+
+    double max_error = 0.0;
+
+    Adjacency adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(num_vertices);
+    std::vector<unsigned char> touched(num_vertices);
+
+    while (current.size() > target_index_count)
+    {
+        adjacency.Build(current, num_vertices);
+
+        // O colapso de menor custo de cada vértice removível.
+        collapses.clear();
+        std::vector<Collapse> best(num_vertices);
+        for (size_t v = 0; v < num_vertices; ++v)
+        {
+            best[v].from = uint32_t(v);
+            best[v].to   = uint32_t(v);
+            best[v].cost = INFINITY;
+        }
+
+        for (size_t i = 0; i < current.size(); i += 3)
+        {
+            for (int e = 0; e < 3; ++e)
+            {
+                uint32_t a = current[i + e];
+                uint32_t b = current[i + (e + 1) % 3];
+                uint32_t edge[2][2] = { { a, b }, { b, a } };
+                for (int k = 0; k < 2; ++k)
+                {
+                    uint32_t from = edge[k][0];
+                    uint32_t to   = edge[k][1];
+                    if (locked[from])
+                        continue;
+                    double cost = QuadricError(quadrics[from], positions + 3*size_t(to));
+                    if (cost < best[from].cost)
+                    {
+                        best[from].to   = to;
+                        best[from].cost = cost;
+                    }
+                }
+            }
+        }
+
+        for (size_t v = 0; v < num_vertices; ++v)
+            if (best[v].to != v)
+                collapses.push_back(best[v]);
+
+        if (collapses.empty())
+            break;
+
+        std::sort(collapses.begin(), collapses.end());
+
+        // Aplicamos os colapsos, do mais barato para o mais caro, enquanto
+        // não atingirmos o número de triângulos desejado.
+        for (size_t v = 0; v < num_vertices; ++v)
+            remap[v] = uint32_t(v);
+        std::fill(touched.begin(), touched.end(), 0);
+
+        size_t remaining_triangles = current.size() / 3;
+        size_t target_triangles = target_index_count / 3;
+        size_t applied = 0;
+
+        for (size_t i = 0; i < collapses.size() && remaining_triangles > target_triangles; ++i)
+        {
+            const Collapse& collapse = collapses[i];
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            if (CollapseFlipsTriangle(current, adjacency, positions, collapse.from, collapse.to))
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            applied += 1;
+
+            // Nenhum outro colapso desta passada pode mexer na vizinhança
+            // dos dois vértices, pois os custos e as verificações de
+            // inversão acima não seriam mais válidos.
+            uint32_t ends[2] = { collapse.from, collapse.to };
+            for (int e = 0; e < 2; ++e)
+            {
+                for (uint32_t k = adjacency.offsets[ends[e]]; k < adjacency.offsets[ends[e] + 1]; ++k)
+                {
+                    const uint32_t* tri = &current[3*size_t(adjacency.triangles[k])];
+                    touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+                    if (e == 0 && (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to))
+                        remaining_triangles -= 1;
+                }
+            }
+
+            QuadricAdd(&quadrics[collapse.to], quadrics[collapse.from]);
+
+            double weight = quadrics[collapse.from].weight;
+            if (weight > 0.0)
+                max_error = std::max(max_error, sqrt(collapse.cost / weight));
+        }
+
+        if (applied == 0)
+            break;
+
+        // Reescrevemos os índices, descartando os triângulos degenerados.
+        size_t write = 0;
+        for (size_t i = 0; i < current.size(); i += 3)
+        {
+            uint32_t a = remap[current[i]];
+            uint32_t b = remap[current[i+1]];
+            uint32_t c = remap[current[i+2]];
+            if (a == b || b == c || c == a)
+                continue;
+            current[write++] = a;
+            current[write++] = b;
+            current[write++] = c;
+        }
+        current.resize(write);
+    }
+
+    std::copy(current.begin(), current.end(), destination);
+
+    if (result_error != NULL)
+        *result_error = extent > 0.0f ? float(max_error / extent) : 0.0f;
+
+    return current.size();
+}
@@ -1,6 +1,7 @@
 // Based on http://hamelot.io/visualization/opengl-text-without-any-external-libraries/
 //   and on https://github.com/rougier/freetype-gl
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -10,6 +11,9 @@
 
 #include "utils.h"
 #include "dejavufont.h"
+#include "programcache.h"
+#include "glstate.h"
+#include "rangeallocator.h"
 
 GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
 
@@ -87,10 +91,77 @@ GLuint textVBO;
 GLuint textprogram_id;
 GLuint texttexture_id;
 
+// Glifo de cada caractere ASCII, ou NULL se a fonte não o contém; montada
+// uma única vez por TextRendering_Init(), em vez de procurar cada caractere
+// em todos os glifos da fonte. Veja TextRendering_FindGlyph().
+#define TEXT_GLYPH_TABLE_SIZE 128
+texture_glyph_t* textglyphs[TEXT_GLYPH_TABLE_SIZE];
+
+// Vértices (x, y, s, t) de todos os caracteres escritos no quadro atual,
+// 6 por caractere. TextRendering_PrintString() somente acrescenta os
+// vértices, e TextRendering_Flush() envia e desenha todos de uma vez. O
+// vetor é reutilizado de um quadro para o outro, sem novas alocações.
+std::vector<float> textvertices;
+
+// Textos retidos (veja TextRendering_CreateText()). Os vértices de cada
+// texto ficam em um intervalo próprio de um único VBO, separado do VBO do
+// texto do quadro, e são recalculados e reenviados somente quando o texto,
+// a posição ou a escala mudam, ou quando a janela é redimensionada.
+typedef uint32_t TextHandle;
+
+struct RetainedText
+{
+    std::string str;
+    float       x, y, scale;
+    uint32_t    layout_generation; // Valor de textlayoutgeneration no último cálculo; 0 se nunca calculado
+    size_t      first_vertex;      // Início do intervalo do texto no VBO
+    size_t      capacity;          // Tamanho do intervalo, em vértices
+    size_t      num_vertices;      // Vértices utilizados (6 por caractere)
+};
+
+std::vector<RetainedText> textretained;
+uint32_t textlayoutgeneration = 1; // Incrementado por TextRendering_InvalidateTextLayouts()
+
+GLuint textretainedVAO;
+GLuint textretainedVBO = 0;
+RangeAllocator textretainedvertices;
+
+// Intervalos (primeiro vértice, número de vértices) dos textos retidos a
+// serem desenhados no quadro atual, por TextRendering_Flush().
+std::vector<GLint>   textdrawfirsts;
+std::vector<GLsizei> textdrawcounts;
+
+// Vetor temporário para os vértices de um texto retido.
+std::vector<float> textlayoutvertices;
+
+// Glifo de um caractere, ou NULL se a fonte não o contém.
+texture_glyph_t* TextRendering_FindGlyph(uint32_t codepoint)
+{
+    if (codepoint < TEXT_GLYPH_TABLE_SIZE)
+        return textglyphs[codepoint];
+
+    // Caracteres fora da tabela: procuramos em todos os glifos.
+    for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
+    {
+        if (dejavufont.glyphs[j].codepoint == codepoint)
+            return &dejavufont.glyphs[j];
+    }
+    return NULL;
+}
+
 void TextRendering_Init()
 {
     GLuint sampler;
 
+    for (size_t i = 0; i < TEXT_GLYPH_TABLE_SIZE; ++i)
+        textglyphs[i] = NULL;
+    for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
+    {
+        uint32_t codepoint = dejavufont.glyphs[j].codepoint;
+        if (codepoint < TEXT_GLYPH_TABLE_SIZE && textglyphs[codepoint] == NULL)
+            textglyphs[codepoint] = &dejavufont.glyphs[j];
+    }
+
     glGenBuffers(1, &textVBO);
     glGenVertexArrays(1, &textVAO);
     glGenTextures(1, &texttexture_id);
@@ -101,50 +172,67 @@ void TextRendering_Init()
     glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glCheckError();
 
-    GLuint textvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
-    TextRendering_LoadShader(textvertexshader_source, textvertexshader_id);
-    glCheckError();
+    // O programa vem do cache de binários se o código acima e o driver não
+    // mudaram desde a última execução. Veja "programcache.h".
+    std::string sources[2] = { textvertexshader_source, textfragmentshader_source };
+    uint64_t cache_key = ProgramCacheKey(sources, 2);
+    textprogram_id = LoadCachedProgram("textrendering", cache_key);
+    if (textprogram_id == 0)
+    {
+        GLuint textvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
+        TextRendering_LoadShader(textvertexshader_source, textvertexshader_id);
+        glCheckError();
 
-    GLuint textfragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
-    TextRendering_LoadShader(textfragmentshader_source, textfragmentshader_id);
-    glCheckError();
+        GLuint textfragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
+        TextRendering_LoadShader(textfragmentshader_source, textfragmentshader_id);
+        glCheckError();
 
-    textprogram_id = CreateGpuProgram(textvertexshader_id, textfragmentshader_id);
-    glLinkProgram(textprogram_id);
-    glCheckError();
+        textprogram_id = CreateGpuProgram(textvertexshader_id, textfragmentshader_id);
+        glLinkProgram(textprogram_id);
+        glCheckError();
+
+        SaveCachedProgram("textrendering", cache_key, textprogram_id);
+    }
 
     GLuint texttex_uniform;
     texttex_uniform = glGetUniformLocation(textprogram_id, "tex");
     glCheckError();
 
     GLuint textureunit = 31;
-    glActiveTexture(GL_TEXTURE0 + textureunit);
-    glBindTexture(GL_TEXTURE_2D, texttexture_id);
+    GLState_ActiveTexture(GL_TEXTURE0 + textureunit);
+    GLState_BindTexture(GL_TEXTURE_2D, texttexture_id);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, dejavufont.tex_width, dejavufont.tex_height, 0, GL_RED, GL_UNSIGNED_BYTE, dejavufont.tex_data);
-    glBindSampler(textureunit, sampler);
+    GLState_BindSampler(textureunit, sampler);
     glCheckError();
 
-    glBindVertexArray(textVAO);
+    GLState_BindVertexArray(textVAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
+    GLState_BindBuffer(GL_ARRAY_BUFFER, textVBO);
     glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
     glCheckError();
 
-    glUseProgram(textprogram_id);
+    // O VAO dos textos retidos recebe o seu VBO na primeira chamada a
+    // TextRendering_SetText(). Veja TextRendering_ResizeRetainedBuffer().
+    glGenVertexArrays(1, &textretainedVAO);
+    InitRangeAllocator(&textretainedvertices, 0);
+
+    GLState_UseProgram(textprogram_id);
     glUniform1i(texttex_uniform, textureunit);
-    glUseProgram(0);
+    GLState_UseProgram(0);
     glCheckError();
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GLState_BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState_BindVertexArray(0);
     glCheckError();
 }
 
 float textscale = 1.5f;
 
-void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+// Acrescenta a "vertices" os vértices (x, y, s, t) dos caracteres de "str",
+// 6 por caractere.
+void TextRendering_LayoutString(GLFWwindow* window, const std::string &str, float x, float y, float scale, std::vector<float>* vertices)
 {
     scale *= textscale;
     int width, height;
@@ -155,15 +243,7 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
     for (size_t i = 0; i < str.size(); i++)
     {
         // Find the glyph for the character we are looking for
-        texture_glyph_t *glyph = 0;
-        for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
-        {
-            if (dejavufont.glyphs[j].codepoint == (uint32_t)str[i])
-            {
-                glyph = &dejavufont.glyphs[j];
-                break;
-            }
-        }
+        texture_glyph_t *glyph = TextRendering_FindGlyph((uint32_t)str[i]);
         if (!glyph) {
             continue;
         }
@@ -178,36 +258,218 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
         float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
         float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
 
-        struct {float x, y, s, t;} data[6] = {
-            { x0, y0, s0, t0 },
-            { x0, y1, s0, t1 },
-            { x1, y1, s1, t1 },
-            { x0, y0, s0, t0 },
-            { x1, y1, s1, t1 },
-            { x1, y0, s1, t0 }
+        const float data[24] = {
+            x0, y0, s0, t0,
+            x0, y1, s0, t1,
+            x1, y1, s1, t1,
+            x0, y0, s0, t0,
+            x1, y1, s1, t1,
+            x1, y0, s1, t0
         };
+        vertices->insert(vertices->end(), data, data + 24);
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        x += (glyph->advance_x * sx);
+    }
+}
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDepthFunc(GL_ALWAYS);
-        glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), data);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+// Acrescenta os vértices dos caracteres de "str" aos do quadro atual. Nada
+// é desenhado até a chamada de TextRendering_Flush().
+void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+{
+    TextRendering_LayoutString(window, str, x, y, scale, &textvertices);
+}
 
-        glUseProgram(textprogram_id);
-        glBindVertexArray(textVAO);
+// Recria o VBO dos textos retidos com a capacidade dada (em vértices),
+// copiando os vértices de cada texto para o início do novo buffer, um após
+// o outro, com glCopyBufferSubData(), como ResizeGeometryArena() em
+// "main.cpp".
+void TextRendering_ResizeRetainedBuffer(size_t capacity)
+{
+    const size_t vertex_size = 4 * sizeof(float);
 
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+    GLuint buffer_id;
+    glGenBuffers(1, &buffer_id);
+    GLState_BindBuffer(GL_COPY_WRITE_BUFFER, buffer_id);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity * vertex_size, NULL, GL_DYNAMIC_DRAW);
 
-        glBindVertexArray(0);
-        glUseProgram(0);
-        glDepthFunc(GL_LESS);
+    RangeAllocator vertices;
+    InitRangeAllocator(&vertices, capacity);
 
-        glDisable(GL_BLEND);
+    for (size_t i = 0; i < textretained.size(); ++i)
+    {
+        RetainedText& text = textretained[i];
+        if (text.capacity == 0)
+            continue;
 
-        x += (glyph->advance_x * sx);
+        size_t first_vertex;
+        AllocateRange(&vertices, text.capacity, 1, &first_vertex);
+        if (text.num_vertices > 0)
+        {
+            GLState_BindBuffer(GL_COPY_READ_BUFFER, textretainedVBO);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                text.first_vertex * vertex_size, first_vertex * vertex_size, text.num_vertices * vertex_size);
+        }
+        text.first_vertex = first_vertex;
+    }
+    GLState_BindBuffer(GL_COPY_READ_BUFFER, 0);
+    GLState_BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (textretainedVBO != 0)
+        GLState_DeleteBuffers(1, &textretainedVBO);
+    textretainedVBO = buffer_id;
+    textretainedvertices = vertices;
+
+    GLState_BindVertexArray(textretainedVAO);
+    GLState_BindBuffer(GL_ARRAY_BUFFER, textretainedVBO);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+    glCheckError();
+}
+
+// Cria um texto retido, inicialmente vazio. Textos que mudam raramente (ou
+// nunca) são definidos por TextRendering_SetText() somente quando mudam, e
+// desenhados a cada quadro por TextRendering_DrawText(), sem formatar nem
+// recalcular os caracteres.
+TextHandle TextRendering_CreateText()
+{
+    RetainedText text;
+    text.x = text.y = text.scale = 0.0f;
+    text.layout_generation = 0;
+    text.first_vertex = 0;
+    text.capacity = 0;
+    text.num_vertices = 0;
+    textretained.push_back(text);
+    return (TextHandle)(textretained.size() - 1);
+}
+
+// Retorna true se o texto precisa ser definido por TextRendering_SetText()
+// antes de ser desenhado: se nunca foi definido, ou se a janela foi
+// redimensionada depois disso (o tamanho dos caracteres depende do tamanho
+// da janela, e as posições normalmente também).
+bool TextRendering_TextNeedsLayout(TextHandle handle)
+{
+    return textretained[handle].layout_generation != textlayoutgeneration;
+}
+
+// Define o texto, a posição e a escala de um texto retido. Os caracteres
+// são recalculados e enviados à GPU somente se algum deles mudou, ou se
+// TextRendering_TextNeedsLayout() é verdadeiro.
+void TextRendering_SetText(GLFWwindow* window, TextHandle handle, const std::string &str, float x, float y, float scale = 1.0f)
+{
+    RetainedText& text = textretained[handle];
+    if (text.layout_generation == textlayoutgeneration
+        && text.x == x && text.y == y && text.scale == scale && text.str == str)
+        return;
+
+    text.str = str;
+    text.x = x;
+    text.y = y;
+    text.scale = scale;
+    text.layout_generation = textlayoutgeneration;
+
+    textlayoutvertices.clear();
+    TextRendering_LayoutString(window, str, x, y, scale, &textlayoutvertices);
+    size_t num_vertices = textlayoutvertices.size() / 4;
+
+    // O intervalo do texto é arredondado para uma potência de 2 de
+    // caracteres, para que textos de tamanho variável (como o número de
+    // quadros por segundo) não precisem de um novo intervalo a cada mudança.
+    if (num_vertices > text.capacity)
+    {
+        if (text.capacity > 0)
+            FreeRange(&textretainedvertices, text.first_vertex, text.capacity);
+        text.capacity = 0;
+        text.num_vertices = 0;
+
+        size_t capacity = 6 * 16;
+        while (capacity < num_vertices)
+            capacity *= 2;
+
+        size_t first_vertex;
+        if (!AllocateRange(&textretainedvertices, capacity, 1, &first_vertex))
+        {
+            size_t buffer_capacity = textretainedvertices.capacity > 0 ? textretainedvertices.capacity : 6 * 1024;
+            while (buffer_capacity < textretainedvertices.capacity - textretainedvertices.free_size + capacity)
+                buffer_capacity *= 2;
+            TextRendering_ResizeRetainedBuffer(buffer_capacity);
+            AllocateRange(&textretainedvertices, capacity, 1, &first_vertex);
+        }
+        text.first_vertex = first_vertex;
+        text.capacity = capacity;
+    }
+
+    text.num_vertices = num_vertices;
+    if (num_vertices > 0)
+    {
+        GLState_BindBuffer(GL_ARRAY_BUFFER, textretainedVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, text.first_vertex * 4 * sizeof(float), textlayoutvertices.size() * sizeof(float), textlayoutvertices.data());
+    }
+}
+
+// Desenha um texto retido no quadro atual. Como em
+// TextRendering_PrintString(), nada é desenhado até a chamada de
+// TextRendering_Flush().
+void TextRendering_DrawText(TextHandle handle)
+{
+    const RetainedText& text = textretained[handle];
+    if (text.num_vertices == 0)
+        return;
+
+    textdrawfirsts.push_back((GLint)text.first_vertex);
+    textdrawcounts.push_back((GLsizei)text.num_vertices);
+}
+
+// Indica que o tamanho da janela mudou: todos os textos retidos precisam
+// ser definidos de novo. Chamada por FramebufferSizeCallback() em
+// "main.cpp".
+void TextRendering_InvalidateTextLayouts()
+{
+    textlayoutgeneration += 1;
+}
+
+// Desenha todos os caracteres acumulados desde a última chamada, com um
+// único envio de vértices e uma única chamada de desenho, mais uma chamada
+// para todos os textos retidos. Deve ser chamada uma vez por quadro, depois
+// de todo o texto do quadro.
+void TextRendering_Flush()
+{
+    if (textvertices.empty() && textdrawfirsts.empty())
+        return;
+
+    // Definimos o estado necessário para o texto sem desfazê-lo depois (veja
+    // "glstate.h"). O desenho da cena define o seu próprio estado no início
+    // de cada quadro.
+    GLState_Enable(GL_BLEND);
+    GLState_BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    GLState_PolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    GLState_DepthFunc(GL_ALWAYS);
+
+    // glBufferData() com o buffer inteiro ("orphaning") permite que o driver
+    // aloque uma nova área de memória se a anterior ainda estiver sendo lida
+    // pelo desenho do quadro anterior, em vez de esperar por ele.
+    GLState_UseProgram(textprogram_id);
+
+    if (!textvertices.empty())
+    {
+        GLState_BindBuffer(GL_ARRAY_BUFFER, textVBO);
+        glBufferData(GL_ARRAY_BUFFER, textvertices.size() * sizeof(float), textvertices.data(), GL_STREAM_DRAW);
+
+        GLState_BindVertexArray(textVAO);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(textvertices.size() / 4));
+
+        textvertices.clear();
+    }
+
+    // Os textos retidos já estão na GPU: uma única chamada de desenho para
+    // todos os intervalos, sem nenhum envio de vértices.
+    if (!textdrawfirsts.empty())
+    {
+        GLState_BindVertexArray(textretainedVAO);
+        glMultiDrawArrays(GL_TRIANGLES, textdrawfirsts.data(), textdrawcounts.data(), (GLsizei)textdrawfirsts.size());
+
+        textdrawfirsts.clear();
+        textdrawcounts.clear();
     }
 }
 
@@ -0,0 +1,274 @@
+// Cálculo de mipmaps e arquivos de cache de texturas. Veja
+// "include/texturecache.h".
+//
+// Formato do arquivo "imagem.texcache" (valores na ordem de bytes nativa da
+// máquina):
+//
+//    TextureCacheHeader
+//    TextureLevel x num_levels
+//    pixels de todos os níveis (a partir de data_offset), do nível 0 ao 1x1
+//
+// O arquivo é válido somente se for mais recente que a imagem original, se
+// a versão do formato for igual a TEXTURE_CACHE_VERSION e se os níveis
+// descritos no arquivo forem exatamente os que BuildTextureMipmaps()
+// produziria para uma imagem de width x height pixels, dentro do arquivo
+// (veja LevelsValid()).
+#include "texturecache.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+
+const uint32_t TEXTURE_CACHE_MAGIC   = 0x58455446; // "FTEX"
+const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+struct TextureCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;      // TextureFormat
+    uint32_t width;
+    uint32_t height;
+    uint32_t num_levels;
+    uint64_t data_offset; // Posição dos pixels do nível 0 no arquivo
+};
+
+// Conversões entre sRGB (8 bits) e RGB linear, veja
+// https://en.wikipedia.org/wiki/SRGB#Transformation
+float SrgbToLinear(unsigned char c)
+{
+    float s = c / 255.0f;
+    return s <= 0.04045f ? s / 12.92f : powf((s + 0.055f) / 1.055f, 2.4f);
+}
+
+unsigned char LinearToSrgb(float l)
+{
+    float s = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+    return (unsigned char)std::min(255.0f, std::max(0.0f, s * 255.0f + 0.5f));
+}
+
+// Reduz um nível à metade em cada dimensão (arredondando para baixo, no
+// mínimo 1). Em dimensões ímpares o último pixel é repetido. Os canais RGB são
+// convertidos para linear antes da média; o canal alfa já é linear.
+void DownsampleLevel(const unsigned char* src, uint32_t src_width, uint32_t src_height,
+                     unsigned char* dst, uint32_t dst_width, uint32_t dst_height,
+                     const float* srgb_to_linear)
+{
+    for (uint32_t y = 0; y < dst_height; ++y)
+    {
+        uint32_t y0 = std::min(2*y, src_height - 1);
+        uint32_t y1 = std::min(2*y + 1, src_height - 1);
+        for (uint32_t x = 0; x < dst_width; ++x)
+        {
+            uint32_t x0 = std::min(2*x, src_width - 1);
+            uint32_t x1 = std::min(2*x + 1, src_width - 1);
+
+            const unsigned char* p[4] = {
+                src + (size_t(y0) * src_width + x0) * 4,
+                src + (size_t(y0) * src_width + x1) * 4,
+                src + (size_t(y1) * src_width + x0) * 4,
+                src + (size_t(y1) * src_width + x1) * 4,
+            };
+
+            unsigned char* out = dst + (size_t(y) * dst_width + x) * 4;
+            for (int c = 0; c < 3; ++c)
+            {
+                float sum = srgb_to_linear[p[0][c]] + srgb_to_linear[p[1][c]]
+                          + srgb_to_linear[p[2][c]] + srgb_to_linear[p[3][c]];
+                out[c] = LinearToSrgb(sum * 0.25f);
+            }
+            out[3] = (unsigned char)((p[0][3] + p[1][3] + p[2][3] + p[3][3] + 2) / 4);
+        }
+    }
+}
+
+// Retorna true se "levels" são os níveis de BuildTextureMipmaps() para uma
+// imagem de width x height pixels: o nível 0 tem o tamanho da imagem e
+// começa em 0, cada nível seguinte tem a metade do tamanho do anterior
+// (arredondando para baixo, no mínimo 1) e começa logo depois dele, e
+// somente o último nível é 1x1. Todos os níveis devem caber nos data_size
+// bytes de pixels do arquivo. Só são somados valores de níveis já
+// verificados, e portanto valores corrompidos não causam overflow.
+bool LevelsValid(const TextureLevel* levels, size_t num_levels, uint32_t width, uint32_t height, uint64_t data_size)
+{
+    if (num_levels == 0 || levels[0].offset != 0
+     || levels[0].width != width || levels[0].height != height)
+        return false;
+
+    for (size_t i = 0; i < num_levels; ++i)
+    {
+        const TextureLevel& level = levels[i];
+        if (i > 0)
+        {
+            const TextureLevel& previous = levels[i-1];
+            if ((previous.width == 1 && previous.height == 1)
+             || level.width != std::max(1u, previous.width / 2)
+             || level.height != std::max(1u, previous.height / 2)
+             || level.offset != previous.offset + previous.size)
+                return false;
+        }
+
+        if (level.width == 0 || level.height == 0
+         || level.size != uint64_t(level.width) * level.height * 4
+         || !(level.size <= data_size && level.offset <= data_size - level.size))
+            return false;
+    }
+
+    const TextureLevel& last = levels[num_levels - 1];
+    return last.width == 1 && last.height == 1;
+}
+
+} // namespace
+
+void BuildTextureMipmaps(const unsigned char* rgba, uint32_t width, uint32_t height, TextureData* texture)
+{
+    texture->format = TEXTURE_FORMAT_SRGB8_ALPHA8;
+    texture->width  = width;
+    texture->height = height;
+    texture->levels.clear();
+    texture->file.data = NULL;
+    texture->file.size = 0;
+    texture->file.handle = NULL;
+
+    // Tamanho e posição de cada nível, até 1x1.
+    uint64_t offset = 0;
+    uint32_t w = width;
+    uint32_t h = height;
+    for (;;)
+    {
+        TextureLevel level;
+        level.width  = w;
+        level.height = h;
+        level.offset = offset;
+        level.size   = uint64_t(w) * h * 4;
+        texture->levels.push_back(level);
+        offset += level.size;
+
+        if (w == 1 && h == 1)
+            break;
+        w = std::max(1u, w / 2);
+        h = std::max(1u, h / 2);
+    }
+
+    texture->storage.resize(offset);
+    memcpy(texture->storage.data(), rgba, texture->levels[0].size);
+
+    float srgb_to_linear[256];
+    for (int i = 0; i < 256; ++i)
+        srgb_to_linear[i] = SrgbToLinear((unsigned char)i);
+
+    for (size_t i = 1; i < texture->levels.size(); ++i)
+    {
+        const TextureLevel& src = texture->levels[i-1];
+        const TextureLevel& dst = texture->levels[i];
+        DownsampleLevel(texture->storage.data() + src.offset, src.width, src.height,
+                        texture->storage.data() + dst.offset, dst.width, dst.height,
+                        srgb_to_linear);
+    }
+
+    texture->pixels = texture->storage.data();
+}
+
+std::string TextureCacheFilename(const char* image_filename)
+{
+    return std::string(image_filename) + ".texcache";
+}
+
+bool LoadTextureCache(const char* image_filename, TextureData* texture)
+{
+    uint64_t source_size, cache_size;
+    int64_t  source_mtime, cache_mtime;
+    std::string cache_filename = TextureCacheFilename(image_filename);
+    if (!GetFileSizeAndModificationTime(image_filename, &source_size, &source_mtime)
+     || !GetFileSizeAndModificationTime(cache_filename.c_str(), &cache_size, &cache_mtime)
+     || cache_mtime < source_mtime)
+        return false;
+
+    MappedFile file;
+    if (!MapFile(cache_filename.c_str(), &file))
+        return false;
+
+    const TextureCacheHeader* header = (const TextureCacheHeader*)file.data;
+
+    bool valid = file.size >= sizeof(TextureCacheHeader)
+              && header->magic == TEXTURE_CACHE_MAGIC
+              && header->version == TEXTURE_CACHE_VERSION
+              && header->format == TEXTURE_FORMAT_SRGB8_ALPHA8
+              && header->num_levels > 0
+              && header->num_levels <= (file.size - sizeof(TextureCacheHeader)) / sizeof(TextureLevel)
+              && header->data_offset >= sizeof(TextureCacheHeader) + header->num_levels * sizeof(TextureLevel)
+              && header->data_offset <= file.size;
+
+    const TextureLevel* levels = (const TextureLevel*)(file.data + sizeof(TextureCacheHeader));
+    valid = valid && LevelsValid(levels, header->num_levels, header->width, header->height,
+                                 file.size - header->data_offset);
+
+    if (!valid)
+    {
+        UnmapFile(&file);
+        return false;
+    }
+
+    texture->levels.assign(levels, levels + header->num_levels);
+    texture->format = (TextureFormat)header->format;
+    texture->width  = header->width;
+    texture->height = header->height;
+    texture->pixels = file.data + header->data_offset;
+    texture->storage.clear();
+    texture->file   = file;
+    return true;
+}
+
+bool SaveTextureCache(const char* image_filename, const TextureData& texture)
+{
+    // Alinhamos o início dos pixels em 16 bytes.
+    const uint64_t alignment = 16;
+
+    TextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic       = TEXTURE_CACHE_MAGIC;
+    header.version     = TEXTURE_CACHE_VERSION;
+    header.format      = texture.format;
+    header.width       = texture.width;
+    header.height      = texture.height;
+    header.num_levels  = texture.levels.size();
+    header.data_offset = sizeof(TextureCacheHeader) + texture.levels.size() * sizeof(TextureLevel);
+    header.data_offset = (header.data_offset + alignment - 1) / alignment * alignment;
+
+    const TextureLevel& last = texture.levels.back();
+    size_t data_size = last.offset + last.size;
+
+    std::string cache_filename = TextureCacheFilename(image_filename);
+    FILE* f = fopen(cache_filename.c_str(), "wb");
+    if (f == NULL)
+        return false;
+
+    static const unsigned char zeros[16] = {0};
+    size_t padding = header.data_offset - sizeof(TextureCacheHeader) - texture.levels.size() * sizeof(TextureLevel);
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = ok && fwrite(texture.levels.data(), sizeof(TextureLevel), texture.levels.size(), f) == texture.levels.size();
+    ok = ok && fwrite(zeros, 1, padding, f) == padding;
+    ok = ok && fwrite(texture.pixels, 1, data_size, f) == data_size;
+
+    if (fclose(f) != 0 || !ok)
+    {
+        remove(cache_filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+void FreeTextureData(TextureData* texture)
+{
+    if (texture->file.data != NULL)
+        UnmapFile(&texture->file);
+    texture->file.data = NULL;
+    texture->pixels = NULL;
+    texture->levels.clear();
+    std::vector<unsigned char>().swap(texture->storage);
+}
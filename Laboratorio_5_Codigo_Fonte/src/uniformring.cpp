@@ -0,0 +1,202 @@
+// Buffer circular de dados "uniform". Veja "include/uniformring.h".
+#include "uniformring.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "glstate.h"
+
+namespace
+{
+
+// Número de segmentos do buffer, e tamanho inicial de cada um. Se um quadro
+// precisar de mais espaço, o buffer é recriado com segmentos maiores.
+const int    UNIFORM_RING_SEGMENTS = 3;
+const size_t UNIFORM_RING_INITIAL_SEGMENT_SIZE = 1 << 20;
+
+struct UniformRing
+{
+    GLuint buffer;       // 0 até a primeira chamada de CreateUniformRing()
+    size_t segment_size; // Em bytes
+    size_t alignment;    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    int    segment;      // Segmento atual
+    size_t cursor;       // Primeiro byte livre do segmento atual
+    GLsync fences[UNIFORM_RING_SEGMENTS];
+    size_t stalls;       // Vezes em que a CPU esperou a GPU liberar um segmento
+
+    FrameUniforms frame; // Último bloco enviado por SetFrameUniforms()
+    bool   has_frame;    // "frame" está ligado, e vale até o fim do quadro (AdvanceUniformRing())
+};
+
+UniformRing ring;
+
+// Cria o buffer, com UNIFORM_RING_SEGMENTS segmentos de
+// UNIFORM_RING_INITIAL_SEGMENT_SIZE bytes. O tamanho do buffer só muda se
+// um quadro precisar de mais espaço; veja ReserveUniforms().
+void CreateUniformRing()
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    ring.alignment = std::max<size_t>(16, size_t(alignment));
+    ring.segment_size = UNIFORM_RING_INITIAL_SEGMENT_SIZE;
+    glGenBuffers(1, &ring.buffer);
+    GLState_BindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+    glBufferData(GL_UNIFORM_BUFFER, UNIFORM_RING_SEGMENTS * ring.segment_size, NULL, GL_STREAM_DRAW);
+    GLState_BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Termina o segmento atual, marcando com um fence o ponto em que a GPU terá
+// terminado de lê-lo, e passa para o próximo segmento, esperando pelo fence
+// dele se a GPU ainda estiver lendo-o (o que só acontece se a GPU estiver
+// UNIFORM_RING_SEGMENTS-1 quadros atrasada, ou se um único quadro ocupar
+// mais de um segmento).
+void AdvanceUniformSegment()
+{
+    if (ring.buffer == 0)
+        return;
+
+    ring.fences[ring.segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ring.segment = (ring.segment + 1) % UNIFORM_RING_SEGMENTS;
+    ring.cursor = 0;
+
+    GLsync fence = ring.fences[ring.segment];
+    if (fence != 0)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            ring.stalls += 1;
+            do
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            while (result == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fence);
+        ring.fences[ring.segment] = 0;
+    }
+}
+
+// Envia ring.frame no segmento atual, que precisa ter espaço (veja
+// ReserveUniforms()), e o liga ao ponto FRAME_UNIFORMS_BINDING.
+void WriteFrameUniforms()
+{
+    size_t start = (ring.cursor + ring.alignment - 1) / ring.alignment * ring.alignment;
+    ring.cursor = start + sizeof(FrameUniforms);
+    size_t offset = ring.segment * ring.segment_size + start;
+
+    memcpy(MapUniforms(offset, sizeof(FrameUniforms)), &ring.frame, sizeof(FrameUniforms));
+    UnmapUniforms();
+    GLState_BindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, ring.buffer, offset, sizeof(FrameUniforms));
+}
+
+} // namespace
+
+// Nos dois casos de ReserveUniforms(), o bloco FrameUniforms do quadro
+// atual é enviado de novo no novo segmento, antes dos "size" bytes.
+void ReserveUniforms(size_t size)
+{
+    if (ring.buffer == 0)
+        CreateUniformRing();
+
+    size_t start = (ring.cursor + ring.alignment - 1) / ring.alignment * ring.alignment;
+    if (start + size <= ring.segment_size)
+        return;
+
+    size_t frame_size = ring.has_frame ? UniformStride(sizeof(FrameUniforms)) : 0;
+
+    AdvanceUniformSegment();
+    if (frame_size + size <= ring.segment_size)
+    {
+        if (ring.has_frame)
+            WriteFrameUniforms();
+        return;
+    }
+    size += frame_size;
+
+    // Os desenhos já enviados continuam lendo o armazenamento antigo, que o
+    // driver libera quando a GPU terminar; os fences do armazenamento
+    // antigo não são mais necessários.
+    ring.segment_size = std::max(2 * ring.segment_size, (size + ring.alignment - 1) / ring.alignment * ring.alignment);
+    GLState_BindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+    glBufferData(GL_UNIFORM_BUFFER, UNIFORM_RING_SEGMENTS * ring.segment_size, NULL, GL_STREAM_DRAW);
+    GLState_BindBuffer(GL_UNIFORM_BUFFER, 0);
+    for (int segment = 0; segment < UNIFORM_RING_SEGMENTS; ++segment)
+    {
+        if (ring.fences[segment] != 0)
+            glDeleteSync(ring.fences[segment]);
+        ring.fences[segment] = 0;
+    }
+    ring.segment = 0;
+    ring.cursor = 0;
+    printf("Buffer de dados \"uniform\" recriado com segmentos de %lu bytes.\n", (unsigned long)ring.segment_size);
+
+    if (ring.has_frame)
+        WriteFrameUniforms();
+}
+
+size_t AllocateUniforms(size_t size)
+{
+    ReserveUniforms(size);
+
+    size_t start = (ring.cursor + ring.alignment - 1) / ring.alignment * ring.alignment;
+    ring.cursor = start + size;
+    return ring.segment * ring.segment_size + start;
+}
+
+// A GPU não está lendo o segmento atual (veja AdvanceUniformSegment()), e
+// portanto o driver não precisa sincronizar (GL_MAP_UNSYNCHRONIZED_BIT) nem
+// preservar o conteúdo anterior (GL_MAP_INVALIDATE_RANGE_BIT).
+void* MapUniforms(size_t offset, size_t size)
+{
+    GLState_BindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+    void* data = glMapBufferRange(GL_UNIFORM_BUFFER, offset, size,
+                                  GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (data == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot map uniform buffer range.\n");
+        std::exit(EXIT_FAILURE);
+    }
+    return data;
+}
+
+void UnmapUniforms()
+{
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+}
+
+size_t UniformStride(size_t size)
+{
+    if (ring.buffer == 0)
+        CreateUniformRing();
+    return (size + ring.alignment - 1) / ring.alignment * ring.alignment;
+}
+
+// O bloco é enviado depois de reservar o seu espaço: se a reserva passar
+// para outro segmento, o bloco anterior não precisa ser enviado de novo.
+void SetFrameUniforms(const FrameUniforms& frame)
+{
+    ring.has_frame = false;
+    ReserveUniforms(sizeof(FrameUniforms));
+    ring.frame = frame;
+    ring.has_frame = true;
+    WriteFrameUniforms();
+}
+
+void AdvanceUniformRing()
+{
+    ring.has_frame = false;
+    AdvanceUniformSegment();
+}
+
+GLuint UniformRingBuffer()
+{
+    if (ring.buffer == 0)
+        CreateUniformRing();
+    return ring.buffer;
+}
+
+size_t UniformRingStalls()
+{
+    return ring.stalls;
+}
@@ -0,0 +1,25 @@
+#ifndef _CHECK_H
+#define _CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+
+// Verificações dos testes de "tests/". Cada teste é um executável que não
+// precisa de janela nem de contexto OpenGL: imprime as verificações que
+// falharam e termina com CHECK_RESULT(), que retorna EXIT_FAILURE se alguma
+// falhou. Os testes são executados por "ctest"; veja CMakeLists.txt.
+static int g_CheckFailures = 0;
+
+#define CHECK(condition)                                                          \
+    do                                                                            \
+    {                                                                             \
+        if (!(condition))                                                         \
+        {                                                                         \
+            fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #condition); \
+            g_CheckFailures += 1;                                                 \
+        }                                                                         \
+    } while (0)
+
+#define CHECK_RESULT() (g_CheckFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+#endif // _CHECK_H
@@ -0,0 +1,111 @@
+// Testes do descarte de objetos fora do frustum de "culling.h": os planos de
+// ExtractFrustumPlanes() devem classificar cada ponto como as coordenadas de
+// recorte da própria matriz (-w <= x,y,z <= w), e CullBoundingBoxes() deve
+// concordar com CullBoundingBoxesScalar().
+#include "culling.h"
+
+#include <cmath>
+
+#include "matrices.h"
+#include "check.h"
+
+namespace
+{
+
+uint32_t g_Seed = 12345;
+
+// Número pseudo-aleatório em [a,b], sempre a mesma sequência.
+float RandomFloat(float a, float b)
+{
+    g_Seed = g_Seed * 1664525u + 1013904223u;
+    return a + (b - a) * float(g_Seed >> 8) / float(1u << 24);
+}
+
+bool InsidePlanes(const glm::vec4 planes[6], const glm::vec4& p)
+{
+    for (int i = 0; i < 6; ++i)
+        if (glm::dot(planes[i], p) < 0.0f)
+            return false;
+    return true;
+}
+
+bool InsideClipSpace(const glm::mat4& view_projection, const glm::vec4& p)
+{
+    glm::vec4 clip = view_projection * p;
+    return fabs(clip.x) <= clip.w && fabs(clip.y) <= clip.w && fabs(clip.z) <= clip.w;
+}
+
+// Compara as duas classificações em pontos aleatórios, ignorando os que
+// estão muito perto de algum plano (onde o arredondamento decide).
+bool PlanesMatchClipSpace(const glm::mat4& view_projection)
+{
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(view_projection, planes);
+    for (int i = 0; i < 10000; ++i)
+    {
+        glm::vec4 p(RandomFloat(-20.0f, 20.0f), RandomFloat(-20.0f, 20.0f), RandomFloat(-20.0f, 20.0f), 1.0f);
+        bool near_plane = false;
+        for (int j = 0; j < 6; ++j)
+            near_plane = near_plane || fabs(glm::dot(planes[j], p)) < 1e-3f;
+        if (!near_plane && InsidePlanes(planes, p) != InsideClipSpace(view_projection, p))
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    // Câmera na origem olhando para -z, como em main.cpp.
+    glm::mat4 view = Matrix_Camera_View(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f),
+                                        glm::vec4(0.0f, 0.0f, -1.0f, 0.0f),
+                                        glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+    const float pi = 3.141592f;
+    glm::mat4 perspective = Matrix_Perspective(pi / 2.0f, 1.0f, -0.1f, -10.0f) * view;
+
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(perspective, planes);
+    CHECK(InsidePlanes(planes, glm::vec4(0.0f, 0.0f, -5.0f, 1.0f)));
+    CHECK(InsidePlanes(planes, glm::vec4(4.9f, -4.9f, -5.0f, 1.0f)));
+    CHECK(!InsidePlanes(planes, glm::vec4(0.0f, 0.0f, 5.0f, 1.0f)));   // Atrás da câmera
+    CHECK(!InsidePlanes(planes, glm::vec4(0.0f, 0.0f, -0.05f, 1.0f))); // Antes do near plane
+    CHECK(!InsidePlanes(planes, glm::vec4(0.0f, 0.0f, -20.0f, 1.0f))); // Depois do far plane
+    CHECK(!InsidePlanes(planes, glm::vec4(5.1f, 0.0f, -5.0f, 1.0f)));  // À direita
+    CHECK(!InsidePlanes(planes, glm::vec4(-5.1f, 0.0f, -5.0f, 1.0f))); // À esquerda
+    CHECK(!InsidePlanes(planes, glm::vec4(0.0f, 5.1f, -5.0f, 1.0f)));  // Acima
+    CHECK(!InsidePlanes(planes, glm::vec4(0.0f, -5.1f, -5.0f, 1.0f))); // Abaixo
+
+    CHECK(PlanesMatchClipSpace(perspective));
+    CHECK(PlanesMatchClipSpace(Matrix_Orthographic(-8.0f, 4.0f, -3.0f, 6.0f, -0.5f, -15.0f) * view));
+
+    glm::mat4 rotated_view = Matrix_Camera_View(glm::vec4(2.0f, 3.0f, 4.0f, 1.0f),
+                                                glm::vec4(-1.0f, -0.5f, -2.0f, 0.0f),
+                                                glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+    CHECK(PlanesMatchClipSpace(Matrix_Perspective(pi / 3.0f, 16.0f / 9.0f, -0.1f, -30.0f) * rotated_view));
+
+    // Caixas de vários tamanhos, dentro, fora e cruzando os planos. O
+    // número de caixas não é múltiplo de 8, para testar o final do laço SIMD.
+    BoundingBoxes boxes;
+    for (int i = 0; i < 1003; ++i)
+        AddBoundingBox(&boxes,
+                       glm::vec3(RandomFloat(-20.0f, 20.0f), RandomFloat(-20.0f, 20.0f), RandomFloat(-20.0f, 20.0f)),
+                       glm::vec3(RandomFloat(0.0f, 2.0f), RandomFloat(0.0f, 2.0f), RandomFloat(0.0f, 2.0f)));
+    std::vector<unsigned char> visible(boxes.center_x.size());
+    std::vector<unsigned char> visible_scalar(boxes.center_x.size());
+    size_t num_visible = CullBoundingBoxes(planes, boxes, visible.data());
+    size_t num_visible_scalar = CullBoundingBoxesScalar(planes, boxes, visible_scalar.data());
+    CHECK(num_visible == num_visible_scalar);
+    CHECK(num_visible > 0 && num_visible < boxes.center_x.size());
+    CHECK(visible == visible_scalar);
+
+    // Nenhuma caixa com o centro dentro do frustum é descartada.
+    for (size_t i = 0; i < boxes.center_x.size(); ++i)
+    {
+        glm::vec4 center(boxes.center_x[i], boxes.center_y[i], boxes.center_z[i], 1.0f);
+        if (InsidePlanes(planes, center))
+            CHECK(visible[i] == 1);
+    }
+
+    return CHECK_RESULT();
+}
@@ -0,0 +1,101 @@
+// Testes das normal matrices de "normalmatrix.h": ComputeNormalMatrices()
+// (com SSE), ComputeNormalMatricesScalar() e NormalMatrix() devem resultar
+// na inversa da transposta da parte 3x3 de cada matriz model, com w igual a
+// 0, lendo e escrevendo em arrays de structs.
+#include "normalmatrix.h"
+
+#include <cmath>
+#include <vector>
+
+#include <glm/mat3x3.hpp>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include "matrices.h"
+#include "check.h"
+
+namespace
+{
+
+uint32_t g_Seed = 12345;
+
+// Número pseudo-aleatório em [a,b], sempre a mesma sequência.
+float RandomFloat(float a, float b)
+{
+    g_Seed = g_Seed * 1664525u + 1013904223u;
+    return a + (b - a) * float(g_Seed >> 8) / float(1u << 24);
+}
+
+// Como os objetos da cena, em que a matriz model fica junto de outros dados.
+struct Object
+{
+    glm::mat4   model;
+    float       other_data[3];
+    glm::mat3x4 normal_matrix;
+};
+
+// Verifica se a normal matrix tem as colunas de "expected", com w igual a 0.
+bool NearlyEqual(const glm::mat3x4& normal_matrix, const glm::mat3& expected)
+{
+    for (int c = 0; c < 3; ++c)
+    {
+        for (int r = 0; r < 3; ++r)
+            if (fabs(normal_matrix[c][r] - expected[c][r]) > 1e-4f * (1.0f + fabs(expected[c][r])))
+                return false;
+        if (normal_matrix[c][3] != 0.0f)
+            return false;
+    }
+    return true;
+}
+
+glm::mat3 InverseTranspose(const glm::mat4& model)
+{
+    return glm::inverse(glm::transpose(glm::mat3(model)));
+}
+
+} // namespace
+
+int main()
+{
+    // Número de objetos que não é múltiplo de 4, para testar o final do
+    // laço SIMD.
+    std::vector<Object> objects(11);
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        glm::vec4 axis(RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(0.1f, 1.0f), 0.0f);
+        objects[i].model = Matrix_Translate(RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f))
+                         * Matrix_Rotate(RandomFloat(-3.0f, 3.0f), axis / glm::length(axis))
+                         * Matrix_Scale(RandomFloat(0.1f, 5.0f), RandomFloat(0.1f, 5.0f), RandomFloat(0.1f, 5.0f));
+    }
+
+    // Uma escala uniforme com rotação: a normal matrix é a própria rotação
+    // dividida pela escala.
+    objects[0].model = Matrix_Rotate_Y(0.5f) * Matrix_Scale(2.0f, 2.0f, 2.0f);
+    glm::mat3 rotation = glm::mat3(Matrix_Rotate_Y(0.5f));
+    CHECK(NearlyEqual(NormalMatrix(objects[0].model), rotation * 0.5f));
+
+    ComputeNormalMatrices(&objects[0].model, sizeof(Object), &objects[0].normal_matrix, sizeof(Object), objects.size());
+    for (size_t i = 0; i < objects.size(); ++i)
+        CHECK(NearlyEqual(objects[i].normal_matrix, InverseTranspose(objects[i].model)));
+
+    ComputeNormalMatricesScalar(&objects[0].model, sizeof(Object), &objects[0].normal_matrix, sizeof(Object), objects.size());
+    for (size_t i = 0; i < objects.size(); ++i)
+        CHECK(NearlyEqual(objects[i].normal_matrix, InverseTranspose(objects[i].model)));
+
+    for (size_t i = 0; i < objects.size(); ++i)
+        CHECK(NearlyEqual(NormalMatrix(objects[i].model), InverseTranspose(objects[i].model)));
+
+    // Matriz singular: o resultado é a matriz dos cofatores, cujas colunas
+    // são os produtos vetoriais das colunas da parte 3x3.
+    glm::mat4 singular = Matrix_Rotate_Z(0.3f) * Matrix_Scale(2.0f, 0.0f, 3.0f);
+    glm::mat3 m = glm::mat3(singular);
+    glm::mat3 cofactors(glm::cross(m[1], m[2]), glm::cross(m[2], m[0]), glm::cross(m[0], m[1]));
+    glm::mat3x4 normal_matrices[4];
+    glm::mat4 models[4] = { singular, singular, singular, singular };
+    ComputeNormalMatrices(models, sizeof(glm::mat4), normal_matrices, sizeof(glm::mat3x4), 4);
+    CHECK(NearlyEqual(normal_matrices[0], cofactors));
+    ComputeNormalMatricesScalar(models, sizeof(glm::mat4), normal_matrices, sizeof(glm::mat3x4), 1);
+    CHECK(NearlyEqual(normal_matrices[0], cofactors));
+
+    return CHECK_RESULT();
+}
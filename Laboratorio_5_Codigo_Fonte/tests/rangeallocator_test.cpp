@@ -0,0 +1,110 @@
+// Testes do alocador de intervalos de "rangeallocator.h": first fit,
+// alinhamento e união ("coalescing") dos intervalos livres vizinhos.
+#include "rangeallocator.h"
+
+#include "check.h"
+
+// Verifica se os intervalos livres são exatamente os dados, como pares
+// (início, tamanho) em ordem.
+static bool FreeRangesAre(const RangeAllocator& allocator, const size_t (*expected)[2], size_t count)
+{
+    if (allocator.free_ranges.size() != count)
+        return false;
+    std::map<size_t, size_t>::const_iterator it = allocator.free_ranges.begin();
+    for (size_t i = 0; i < count; ++i, ++it)
+        if (it->first != expected[i][0] || it->second != expected[i][1])
+            return false;
+    return true;
+}
+
+static void TestFirstFit()
+{
+    RangeAllocator allocator;
+    InitRangeAllocator(&allocator, 100);
+    CHECK(allocator.free_size == 100);
+    CHECK(LargestFreeRange(allocator) == 100);
+
+    size_t a = 0, b = 0, c = 0;
+    CHECK(AllocateRange(&allocator, 10, 1, &a) && a == 0);
+    CHECK(AllocateRange(&allocator, 20, 1, &b) && b == 10);
+    CHECK(AllocateRange(&allocator, 30, 1, &c) && c == 30);
+    CHECK(allocator.free_size == 40);
+
+    // O primeiro intervalo livre grande o suficiente é reutilizado.
+    FreeRange(&allocator, a, 10);
+    size_t d = 0;
+    CHECK(AllocateRange(&allocator, 5, 1, &d) && d == 0);
+    CHECK(allocator.free_size == 45);
+}
+
+static void TestCoalescing()
+{
+    RangeAllocator allocator;
+    InitRangeAllocator(&allocator, 100);
+
+    size_t offsets[4];
+    for (int i = 0; i < 4; ++i)
+        CHECK(AllocateRange(&allocator, 25, 1, &offsets[i]) && offsets[i] == size_t(25 * i));
+    CHECK(allocator.free_ranges.empty());
+
+    // Intervalos sem vizinhos livres ficam separados.
+    FreeRange(&allocator, offsets[0], 25);
+    FreeRange(&allocator, offsets[2], 25);
+    const size_t separate[2][2] = { { 0, 25 }, { 50, 25 } };
+    CHECK(FreeRangesAre(allocator, separate, 2));
+
+    // O espaço livre é suficiente, mas está fragmentado.
+    size_t offset = 0;
+    CHECK(allocator.free_size == 50);
+    CHECK(LargestFreeRange(allocator) == 25);
+    CHECK(!AllocateRange(&allocator, 30, 1, &offset));
+
+    // Liberar o intervalo entre os dois une os três.
+    FreeRange(&allocator, offsets[1], 25);
+    const size_t joined[1][2] = { { 0, 75 } };
+    CHECK(FreeRangesAre(allocator, joined, 1));
+
+    // E o último une tudo de novo em um único intervalo.
+    FreeRange(&allocator, offsets[3], 25);
+    const size_t all[1][2] = { { 0, 100 } };
+    CHECK(FreeRangesAre(allocator, all, 1));
+    CHECK(allocator.free_size == 100);
+}
+
+static void TestAlignment()
+{
+    RangeAllocator allocator;
+    InitRangeAllocator(&allocator, 100);
+
+    size_t a = 0, b = 0;
+    CHECK(AllocateRange(&allocator, 5, 1, &a) && a == 0);
+    CHECK(AllocateRange(&allocator, 8, 16, &b) && b == 16);
+
+    // O espaço antes do início alinhado continua livre.
+    const size_t padded[2][2] = { { 5, 11 }, { 24, 76 } };
+    CHECK(FreeRangesAre(allocator, padded, 2));
+    CHECK(allocator.free_size == 87);
+
+    FreeRange(&allocator, b, 8);
+    const size_t joined[1][2] = { { 5, 95 } };
+    CHECK(FreeRangesAre(allocator, joined, 1));
+}
+
+static void TestArenaIndexOffset()
+{
+    GeometryArena arena;
+    arena.meshes.resize(2);
+    arena.meshes[1].index_offset = 64;
+    CHECK(ArenaIndexOffset(arena, 1, 0, 2) == 64);
+    CHECK(ArenaIndexOffset(arena, 1, 10, 2) == 84);
+    CHECK(ArenaIndexOffset(arena, 1, 10, 4) == 104);
+}
+
+int main()
+{
+    TestFirstFit();
+    TestCoalescing();
+    TestAlignment();
+    TestArenaIndexOffset();
+    return CHECK_RESULT();
+}
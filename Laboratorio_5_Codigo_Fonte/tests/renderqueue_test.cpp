@@ -0,0 +1,113 @@
+// Testes das chaves de ordenação da fila de desenho de "renderqueue.h": o
+// empacotamento dos campos por MakeDrawKey() e a ordenação (estável) de
+// RadixSortDrawKeys(), comparada com std::stable_sort().
+#include "renderqueue.h"
+
+#include <algorithm>
+
+#include "check.h"
+
+namespace
+{
+
+// Gerador congruencial linear, para que as chaves sejam sempre as mesmas.
+uint32_t g_Seed = 12345;
+
+uint32_t NextRandom()
+{
+    g_Seed = g_Seed * 1664525u + 1013904223u;
+    return g_Seed;
+}
+
+struct KeyLess
+{
+    const std::vector<uint64_t>* keys;
+    bool operator()(uint32_t a, uint32_t b) const { return (*keys)[a] < (*keys)[b]; }
+};
+
+// Ordena "keys" com RadixSortDrawKeys() e verifica o resultado contra
+// std::stable_sort() dos índices dos itens.
+bool SortsLikeStableSort(const std::vector<uint64_t>& keys)
+{
+    std::vector<uint32_t> expected(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+        expected[i] = uint32_t(i);
+    KeyLess less = { &keys };
+    std::stable_sort(expected.begin(), expected.end(), less);
+
+    std::vector<uint64_t> sorted_keys = keys;
+    std::vector<uint32_t> items(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+        items[i] = uint32_t(i);
+    std::vector<uint64_t> temp_keys;
+    std::vector<uint32_t> temp_items;
+    RadixSortDrawKeys(sorted_keys.data(), items.data(), keys.size(), &temp_keys, &temp_items);
+
+    for (size_t i = 0; i < keys.size(); ++i)
+        if (items[i] != expected[i] || sorted_keys[i] != keys[expected[i]])
+            return false;
+    return true;
+}
+
+void TestMakeDrawKey()
+{
+    CHECK(MakeDrawKey(1, 2, 3, 0.0f) == 0x0102000300000000ull);
+
+    // Identificadores maiores que o seu campo são truncados.
+    CHECK(MakeDrawKey(0x1FF, 0x1FE, 0x1FFFD, 0.0f) == 0xFFFEFFFD00000000ull);
+
+    // Profundidade: os 24 bits mais significativos do float; valores
+    // negativos (atrás da câmera) ficam em zero.
+    CHECK((MakeDrawKey(0, 0, 0, 1.0f) & 0xFFFFFFFF) == 0x3F800000);
+    CHECK((MakeDrawKey(0, 0, 0, -1.0f) & 0xFFFFFFFF) == 0);
+    CHECK((MakeDrawKey(0, 0, 0, 1.5f) & 0xFF) == 0);
+
+    // Do mais próximo para o mais distante, dentro do mesmo estado.
+    CHECK(MakeDrawKey(1, 2, 3, 1.0f) < MakeDrawKey(1, 2, 3, 2.0f));
+    CHECK(MakeDrawKey(1, 2, 3, 0.5f) < MakeDrawKey(1, 2, 3, 100.0f));
+
+    // O estado tem prioridade sobre a profundidade.
+    CHECK(MakeDrawKey(1, 2, 3, 100.0f) < MakeDrawKey(1, 2, 4, 0.5f));
+    CHECK(MakeDrawKey(1, 2, 4, 100.0f) < MakeDrawKey(1, 3, 0, 0.5f));
+    CHECK(MakeDrawKey(1, 3, 4, 100.0f) < MakeDrawKey(2, 0, 0, 0.5f));
+}
+
+void TestRadixSort()
+{
+    // Chaves com todos os dígitos variando.
+    std::vector<uint64_t> keys(1000);
+    for (size_t i = 0; i < keys.size(); ++i)
+        keys[i] = (uint64_t(NextRandom()) << 32) | NextRandom();
+    CHECK(SortsLikeStableSort(keys));
+
+    // Chaves como as da fila, com poucos programas, conjuntos de texturas
+    // e VAOs, e muitas repetidas (a ordenação deve ser estável). Alguns
+    // dígitos são iguais em todas as chaves e são pulados, e o resultado
+    // pode terminar nos vetores temporários.
+    for (size_t i = 0; i < keys.size(); ++i)
+        keys[i] = MakeDrawKey(NextRandom() % 3, NextRandom() % 2, NextRandom() % 4,
+                              float(NextRandom() % 8));
+    CHECK(SortsLikeStableSort(keys));
+
+    // Somente um dígito varia: uma única passada.
+    for (size_t i = 0; i < keys.size(); ++i)
+        keys[i] = uint64_t(NextRandom() % 5) << 56;
+    CHECK(SortsLikeStableSort(keys));
+
+    // Todas as chaves iguais, e os casos triviais.
+    keys.assign(10, 42);
+    CHECK(SortsLikeStableSort(keys));
+    keys.assign(1, 7);
+    CHECK(SortsLikeStableSort(keys));
+    keys.clear();
+    CHECK(SortsLikeStableSort(keys));
+}
+
+} // namespace
+
+int main()
+{
+    TestMakeDrawKey();
+    TestRadixSort();
+    return CHECK_RESULT();
+}
@@ -0,0 +1,153 @@
+// Testes dos arquivos de cache de texturas de "texturecache.h": um arquivo
+// gravado por SaveTextureCache() é lido de volta, e arquivos com o
+// cabeçalho ou os níveis corrompidos, ou mais antigos que a imagem, são
+// rejeitados por LoadTextureCache().
+#include "texturecache.h"
+
+#include <cstring>
+#include <ctime>
+#include <utime.h>
+
+#include "check.h"
+
+namespace
+{
+
+const char* IMAGE_FILENAME = "texturecache_test.png";
+
+// Posições de campos do cabeçalho do arquivo de cache (veja
+// TextureCacheHeader em "texturecache.cpp") e do primeiro TextureLevel.
+const size_t MAGIC_OFFSET       = 0;
+const size_t VERSION_OFFSET     = 4;
+const size_t NUM_LEVELS_OFFSET  = 20;
+const size_t DATA_OFFSET_OFFSET = 24;
+const size_t LEVELS_OFFSET      = 32;
+
+bool WriteFile(const char* filename, const std::vector<unsigned char>& bytes)
+{
+    FILE* f = fopen(filename, "wb");
+    if (f == NULL)
+        return false;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    return fclose(f) == 0 && ok;
+}
+
+std::vector<unsigned char> ReadFile(const char* filename)
+{
+    std::vector<unsigned char> bytes;
+    FILE* f = fopen(filename, "rb");
+    if (f == NULL)
+        return bytes;
+    unsigned char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        bytes.insert(bytes.end(), buffer, buffer + count);
+    fclose(f);
+    return bytes;
+}
+
+void Patch32(std::vector<unsigned char>* bytes, size_t offset, uint32_t value)
+{
+    memcpy(bytes->data() + offset, &value, sizeof(value));
+}
+
+void Patch64(std::vector<unsigned char>* bytes, size_t offset, uint64_t value)
+{
+    memcpy(bytes->data() + offset, &value, sizeof(value));
+}
+
+// Grava o arquivo de cache "bytes" e tenta carregá-lo.
+bool LoadsAfterWriting(const std::vector<unsigned char>& bytes)
+{
+    std::string cache_filename = TextureCacheFilename(IMAGE_FILENAME);
+    if (!WriteFile(cache_filename.c_str(), bytes))
+        return false;
+    TextureData texture;
+    bool loaded = LoadTextureCache(IMAGE_FILENAME, &texture);
+    if (loaded)
+        FreeTextureData(&texture);
+    return loaded;
+}
+
+} // namespace
+
+int main()
+{
+    // O conteúdo da imagem não importa, somente a data de modificação.
+    std::string cache_filename = TextureCacheFilename(IMAGE_FILENAME);
+    CHECK(cache_filename == "texturecache_test.png.texcache");
+    CHECK(WriteFile(IMAGE_FILENAME, std::vector<unsigned char>(16, 0)));
+
+    // Imagem 4x2: níveis 4x2, 2x1 e 1x1.
+    std::vector<unsigned char> rgba(4 * 2 * 4);
+    for (size_t i = 0; i < rgba.size(); ++i)
+        rgba[i] = (unsigned char)(i * 8);
+    TextureData built;
+    BuildTextureMipmaps(rgba.data(), 4, 2, &built);
+    CHECK(built.levels.size() == 3);
+    CHECK(built.levels[1].width == 2 && built.levels[1].height == 1);
+    CHECK(built.levels[2].width == 1 && built.levels[2].height == 1);
+    CHECK(memcmp(built.pixels, rgba.data(), rgba.size()) == 0);
+    CHECK(SaveTextureCache(IMAGE_FILENAME, built));
+
+    TextureData loaded;
+    CHECK(LoadTextureCache(IMAGE_FILENAME, &loaded));
+    CHECK(loaded.width == 4 && loaded.height == 2);
+    CHECK(loaded.levels.size() == built.levels.size());
+    const TextureLevel& last = built.levels.back();
+    CHECK(loaded.pixels != NULL && memcmp(loaded.pixels, built.pixels, last.offset + last.size) == 0);
+    FreeTextureData(&loaded);
+
+    const std::vector<unsigned char> valid = ReadFile(cache_filename.c_str());
+    CHECK(valid.size() > LEVELS_OFFSET);
+    CHECK(LoadsAfterWriting(valid));
+
+    std::vector<unsigned char> bytes = valid;
+    Patch32(&bytes, MAGIC_OFFSET, 0);
+    CHECK(!LoadsAfterWriting(bytes));
+
+    bytes = valid;
+    Patch32(&bytes, VERSION_OFFSET, 2);
+    CHECK(!LoadsAfterWriting(bytes));
+
+    // Mais níveis do que cabem no arquivo.
+    bytes = valid;
+    Patch32(&bytes, NUM_LEVELS_OFFSET, 0xFFFFFFFF);
+    CHECK(!LoadsAfterWriting(bytes));
+
+    // Níveis a menos: o último não é 1x1.
+    bytes = valid;
+    Patch32(&bytes, NUM_LEVELS_OFFSET, 2);
+    CHECK(!LoadsAfterWriting(bytes));
+
+    // Pixels depois do fim do arquivo.
+    bytes = valid;
+    Patch64(&bytes, DATA_OFFSET_OFFSET, valid.size() + 1);
+    CHECK(!LoadsAfterWriting(bytes));
+
+    // Nível 0 maior que a imagem.
+    bytes = valid;
+    Patch32(&bytes, LEVELS_OFFSET, 8);
+    CHECK(!LoadsAfterWriting(bytes));
+
+    // Arquivo truncado: os pixels não cabem.
+    bytes = valid;
+    bytes.resize(bytes.size() - 1);
+    CHECK(!LoadsAfterWriting(bytes));
+
+    bytes.resize(LEVELS_OFFSET / 2);
+    CHECK(!LoadsAfterWriting(bytes));
+
+    // Um arquivo válido, porém mais antigo que a imagem.
+    CHECK(LoadsAfterWriting(valid));
+    struct utimbuf times;
+    times.actime = times.modtime = time(NULL) + 3600;
+    CHECK(utime(IMAGE_FILENAME, &times) == 0);
+    TextureData stale;
+    CHECK(!LoadTextureCache(IMAGE_FILENAME, &stale));
+
+    FreeTextureData(&built);
+    remove(cache_filename.c_str());
+    remove(IMAGE_FILENAME);
+    return CHECK_RESULT();
+}